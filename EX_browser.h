@@ -256,6 +256,24 @@ void SetPing999(server_data *s);
 void SetPing(server_data *s, int ping);
 void SB_Server_SetBestPing(server_data *s, int bestping);
 
+// EX_browser_ping
+typedef void (* sb_query_reply_callback) (server_data *serv, char *answer, int len);
+typedef void (* sb_query_finish_callback) (server_data *serv, int ping);
+
+typedef struct sb_query_s {
+	const char *packet;                 // request sent to each host
+	int packet_len;
+	char reply;                         // expected reply type, see SB_Query_IsReply
+	int attempts;                       // max requests per host
+	qbool stop_on_reply;                // host is done after the first answer
+	double timeout;                     // per request timeout in seconds
+	double rate;                        // requests per second
+	sb_query_reply_callback on_reply;   // called for each answer
+	sb_query_finish_callback on_finish; // called once per server, ping is -1 if no answer came
+} sb_query_t;
+
+qbool SB_Query_Run(server_data *servs[], int servsn, const sb_query_t *query);
+
 void SB_Shutdown(void);
 void SB_RootInit(void);    // must be called as root
 
@@ -45,12 +45,6 @@ extern sem_t serverinfo_semaphore;
 // To prevent several Serverinfo threads to be started at the same time
 static int serverinfo_lock;
 
-typedef struct infohost_s
-{
-    double lastsenttime;
-    int phase;
-} infohost;
-
 int autoupdate_serverinfo = 0;
 
 server_data *autoupdate_server;
@@ -376,157 +370,57 @@ void GetServerInfo(server_data *serv)
 // Gets multiple server info simultaneously
 //
 
-int GetServerInfosProc(void * lpParameter)
+static void GetServerInfos_OnReply(server_data *serv, char *answer, int len)
 {
-    infohost *hosts;   // 0 if not sent yet, -1 if data read
-    double interval, lastsenttime;
+    Parse_Serverinfo(serv, answer);
+}
 
-    socket_t newsocket;
-    struct sockaddr_storage dest;
-    int ret, i;
-    fd_set fd;
-    struct timeval timeout;
+int GetServerInfosProc(void * lpParameter)
+{
+    server_data **query_servers;
+    int query_serversn;
+    sb_query_t query;
+    int i;
 
     if (abort_ping)
         return 0;
 
-    // so we have a socket
-    newsocket = UDP_OpenSocket(PORT_ANY);
-
-    hosts = (infohost *) Q_malloc (serversn * sizeof(infohost));
-    for (i=0; i < serversn; i++)
-    {
-        hosts[i].phase = 0;
-        hosts[i].lastsenttime = -1000;
+    query_servers = (server_data **) Q_malloc(serversn * sizeof(server_data *));
+    query_serversn = 0;
+    for (i = 0; i < serversn; i++) {
         Reset_Server(servers[i]);
 
         // do not update dead servers
-		if (servers[i]->ping < 0) {
-            hosts[i].phase = -1;//(int)sb_inforetries.value;
-		}
-		// do not update too distant servers
-		else if (sb_hidehighping.integer && servers[i]->ping > sb_pinglimit.integer) {
-			hosts[i].phase = -1;
-		}
-    }
-
-    interval = (1000.0 / sb_infospersec.value) / 1000;
-    lastsenttime = Sys_DoubleTime() - interval;
-    timeout.tv_sec = 0;
-    timeout.tv_usec = (long)(interval * 1000.0 * 1000.0 / 2);
-
-    ping_pos = 0;
-
-    while (1  &&  !abort_ping)
-    {
-        int index = -1;
-        double time = Sys_DoubleTime();
-
-        // if it is time to send next request
-        if (time > lastsenttime + interval)
-        {
-            int finished = 0;
-            int to_ask = 0;
-            int phase = (int)(sb_inforetries.value);
-
-            // find next server to ask
-            for (i=0; i < serversn; i++)
-            {
-                if (hosts[i].phase < phase  &&  hosts[i].phase >= 0  &&
-                    time > hosts[i].lastsenttime + (sb_infotimeout.value / 1000))
-                {
-                    index = i;
-                    phase = hosts[i].phase;
-                }
-
-                if (hosts[i].phase >= (int)sb_inforetries.value)
-                    finished++;
-                else
-                    if (hosts[i].phase >= 0)
-                        to_ask++;
-            }
-            //ping_pos = finished / (double)serversn;
-            ping_pos = (finished+to_ask <= 0) ? 0 :
-            finished / (double)(finished+to_ask);
-        }
-
-        // check if we should finish
-        if (index < 0)
-            if (time > lastsenttime + 1.2 * (sb_infotimeout.value / 1000))
-                break;
-
-        // send status request
-        if (index >= 0)
-        {
-            hosts[index].phase ++;
-            hosts[index].lastsenttime = time;
-            lastsenttime = time;
-
-            NetadrToSockadr (&(servers[index]->address), &dest);
-
-            ret = sendto (newsocket, senddata, sizeof(senddata), 0,
-                          (struct sockaddr *)&dest, sizeof(*(struct sockaddr *)&dest));
-            if(ret < 0)
-            {
-                Com_DPrintf("sendto() gave errno = %d : %s\n", errno, strerror(errno));
-            }
-            if (ret == -1)
-                ;//return;
-
-            // requests_sent++;
-            // ping_pos = requests_total <= 0 ? 0 : requests_sent / (double)requests_total;
+        if (servers[i]->ping < 0) {
+            continue;
         }
-
-        // check if answer arrived and decode it
-        //fd.fd_count = 1;
-        //fd.fd_array[0] = newsocket;
-        FD_ZERO(&fd);
-        FD_SET(newsocket, &fd);
-
-        ret = select(newsocket+1, &fd, NULL, NULL, &timeout);
-        if (ret < 1)
-        {
-            Com_DPrintf("select() gave errno = %d : %s\n", errno, strerror(errno));
+        // do not update too distant servers
+        if (sb_hidehighping.integer && servers[i]->ping > sb_pinglimit.integer) {
+            continue;
         }
 
-        if (FD_ISSET(newsocket, &fd))
-        {
-            struct sockaddr_storage hostaddr;
-            netadr_t from;
-            int i;
-            char answer[5000];
-            answer[0] = 0;
+        query_servers[query_serversn++] = servers[i];
+    }
 
-            i = sizeof(hostaddr);
-            ret = recvfrom (newsocket, answer, 5000, 0, (struct sockaddr *)&hostaddr, (socklen_t *)&i);
-            answer[max(0, min(ret, 4999))] = 0;
+    memset(&query, 0, sizeof(query));
+    query.packet = senddata;
+    query.packet_len = sizeof(senddata);
+    query.reply = A2C_PRINT; // status answer
+    query.attempts = max(1, sb_inforetries.integer);
+    query.stop_on_reply = true;
+    query.timeout = sb_infotimeout.value / 1000;
+    query.rate = max(1, sb_infospersec.value);
+    query.on_reply = GetServerInfos_OnReply;
 
-            if (ret > 0)
-            {
-                SockadrToNetadr (&hostaddr, &from);
-
-                for (i=0; i < serversn; i++)
-                    if (from.ip[0] == servers[i]->address.ip[0] &&
-                        from.ip[1] == servers[i]->address.ip[1] &&
-                        from.ip[2] == servers[i]->address.ip[2] &&
-                        from.ip[3] == servers[i]->address.ip[3] &&
-                        from.port == servers[i]->address.port)
-                    {
-                        hosts[i].phase = (int)sb_inforetries.value;
-                        Parse_Serverinfo(servers[i], answer);
-                        break;
-                    }
-            }
-        }
-    }
+    ping_pos = 0;
+    SB_Query_Run(query_servers, query_serversn, &query);
 
     // reset pings to 999 if server didn't answer
     for (i=0; i < serversn; i++)
         if (servers[i]->keysn <= 0)
             SetPing(servers[i], -1);
 
-    closesocket(newsocket);
-    Q_free(hosts);
+    Q_free(query_servers);
 
     return 0;
 }
@@ -570,7 +464,7 @@ int GetServerPingsAndInfosProc(void * lpParameter)
 
 		SB_Sources_Update(true);
 		if (useNewPing) {
-			// New Ping = UPD QW Packet ping using 2 threads (sender and receiver)
+			// New Ping = UDP QW Packet ping, all hosts multiplexed on one socket
 			PingHosts(servers, serversn, sb_pings.integer);
 		}
 		else {
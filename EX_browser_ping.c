@@ -141,10 +141,6 @@ qbool useNewPing = false; // New Ping = UDP QW Packet multithreaded ping
 socket_t sock;
 socket_t ping_sock;
 
-/* Used for thread syncronisation */
-static qbool ping_finished = false;
-static sem_t ping_semaphore;
-
 // =============================================================================
 //  Local Functions
 // =============================================================================
@@ -598,101 +594,6 @@ int oldPingHosts(server_data *servs[], int servsn, int count)
     return success;
 }
 
-/**
- * Pings multiple hosts in parrallel, each host is pingged count times
- */
-void PingSendParrallelMultiHosts(pinghost_t *phosts, int nelms, int count) {
-	struct sockaddr_in to;
-	int interval; 
-	int i, j;
-	int ret;
-	timerresolution_session_t timer_session;
-	
-	memset(&timer_session, 0, sizeof(timer_session));
-
-	count = bound(1, count, 6);
-	interval = 1000.0 / sb_pingspersec.integer;
-
-	Sys_TimerResolution_InitSession(&timer_session);
-	Sys_TimerResolution_RequestMinimum(&timer_session);
-
-	for (i = 0; i < count && !abort_ping; i++) {
-		for (j = 0; j < nelms && !abort_ping; j++) {
-			char *packet = PING_PACKET_DATA;
-
-			ping_pos = min(1, (j / (double)(nelms * count))) + (i / (double)count);
-
-			to.sin_family = AF_INET;
-			to.sin_port = htons(phosts[j].port);
-			to.sin_addr.s_addr = phosts[j].ip;
-
-			ret = sendto(ping_sock, packet, strlen(packet), 0, (struct sockaddr *)&to, sizeof(struct sockaddr));
-
-			if (ret == -1) {
-				continue;
-			}
-
-			phosts[j].stime[phosts[j].send] = Sys_DoubleTime();
-			phosts[j].send++;
-
-			Sys_MSleep(interval);
-
-		}
-	}
-
-	Sys_TimerResolution_Clear(&timer_session);
-}
-
-/**
- * Thread entry point for parrallel recving of ping responses
- */
-int PingRecvProc(void *lpParameter)
-{
-	socklen_t inaddrlen;
-	struct sockaddr_in from;
-	fd_set fd;
-	int k, ret;
-	struct timeval timeout;
-	pinghost_list_t *host_list = (pinghost_list_t *)lpParameter;
-
-	while (!ping_finished && !abort_ping) {
-		FD_ZERO(&fd);
-		FD_SET(ping_sock, &fd);
-		timeout.tv_sec = 0;
-		timeout.tv_usec = 100 * 1000;
-
-		ret = select(ping_sock+1, &fd, NULL, NULL, &timeout);
-		if (ret <= 0) // error or timeout
-			continue;
-
-		while (1) {
-			char buf[16];
-
-			inaddrlen = sizeof(struct sockaddr_in);
-			ret = recvfrom(ping_sock, buf, sizeof(buf), 0, (struct sockaddr *)&from, &inaddrlen);
-			if (ret <= 0) // socket is asynch, so most likely this means there is no data to read
-				break;
-			if (buf[0] != 'l') // not A2A_ACK
-				continue;
-	
-			for (k = 0; k < host_list->nelms; k++) {
-				if (host_list->hosts[k].ip == (int) from.sin_addr.s_addr &&
-				    host_list->hosts[k].port == ntohs(from.sin_port)) {
-					host_list->hosts[k].ping += Sys_DoubleTime() 
-									- host_list->hosts[k]
-											.stime[host_list->hosts[k].recv];
-					host_list->hosts[k].recv++;
-					break;
-				}
-			}
-		}
-	}
-
-	Sys_SemPost(&ping_semaphore);
-
-	return 0;
-}
-
 /**
  * Ping a single host count times, returns the average of the responses
  */
@@ -747,56 +648,407 @@ _select:
 	return pings ? (int)((ping * 1000) / pings) : 0;
 }
 
+// =============================================================================
+//  Asynchronous query multiplexer
+// =============================================================================
+//
+// All hosts are queried through one non-blocking UDP socket from the calling
+// thread. Requests are paced by a token bucket, replies are matched to hosts
+// through an address hash and outstanding requests expire through a timer
+// wheel, so the total time depends on the request rate and not on the
+// number of servers.
+//
+
+#define SB_QUERY_TICK         0.01   // timer wheel granularity in seconds
+#define SB_QUERY_WHEEL_SLOTS  256    // must be power of two
+#define SB_QUERY_MAX_REPLY    8192
+
+typedef struct sb_queryhost_s
+{
+	unsigned int ip;        // network order
+	unsigned short port;    // network order
+	int first_serv;         // index into servs[], further servers sharing this address are chained in serv_next[]
+	int hash_next;
+	int wheel_prev, wheel_next;
+	int wheel_slot;         // -1 if no request is outstanding
+	double deadline;
+	double stime;           // send time of the outstanding request
+	double ping;            // sum of round trip times
+	int sent, recv;
+	qbool done;
+} sb_queryhost_t;
+
+typedef struct sb_querystate_s
+{
+	sb_queryhost_t *hosts;
+	int hostsn;
+	int *serv_next;
+	int *hash;
+	unsigned int hash_mask;
+	int wheel[SB_QUERY_WHEEL_SLOTS];
+	unsigned int wheel_tick;    // last processed tick
+	int *sendqueue;             // ring buffer of hosts waiting for the next request
+	int sendqueue_head, sendqueue_count;
+	int finished;
+} sb_querystate_t;
+
+static unsigned int SB_Query_Hash(unsigned int ip, unsigned short port)
+{
+	unsigned int h = ip ^ (port * 0x9E3779B1);
+
+	h ^= h >> 16;
+	h *= 0x85EBCA6B;
+	h ^= h >> 13;
+	return h;
+}
+
+static sb_queryhost_t *SB_Query_FindHost(sb_querystate_t *st, unsigned int ip, unsigned short port)
+{
+	int i;
+
+	for (i = st->hash[SB_Query_Hash(ip, port) & st->hash_mask]; i >= 0; i = st->hosts[i].hash_next) {
+		if (st->hosts[i].ip == ip && st->hosts[i].port == port) {
+			return &st->hosts[i];
+		}
+	}
+
+	return NULL;
+}
+
+static unsigned int SB_Query_TimeToTick(double time)
+{
+	return (unsigned int)(time / SB_QUERY_TICK);
+}
+
+static void SB_Query_WheelInsert(sb_querystate_t *st, int index, double deadline)
+{
+	sb_queryhost_t *host = &st->hosts[index];
+	unsigned int tick = SB_Query_TimeToTick(deadline);
+	int slot;
+
+	// never schedule into a slot that has already been processed
+	if ((int)(tick - st->wheel_tick) <= 0) {
+		tick = st->wheel_tick + 1;
+	}
+
+	slot = tick & (SB_QUERY_WHEEL_SLOTS - 1);
+	host->deadline = deadline;
+	host->wheel_slot = slot;
+	host->wheel_prev = -1;
+	host->wheel_next = st->wheel[slot];
+	if (host->wheel_next >= 0) {
+		st->hosts[host->wheel_next].wheel_prev = index;
+	}
+	st->wheel[slot] = index;
+}
+
+static void SB_Query_WheelRemove(sb_querystate_t *st, int index)
+{
+	sb_queryhost_t *host = &st->hosts[index];
+
+	if (host->wheel_slot < 0) {
+		return;
+	}
+
+	if (host->wheel_prev >= 0) {
+		st->hosts[host->wheel_prev].wheel_next = host->wheel_next;
+	}
+	else {
+		st->wheel[host->wheel_slot] = host->wheel_next;
+	}
+	if (host->wheel_next >= 0) {
+		st->hosts[host->wheel_next].wheel_prev = host->wheel_prev;
+	}
+
+	host->wheel_slot = host->wheel_prev = host->wheel_next = -1;
+}
+
+static void SB_Query_Enqueue(sb_querystate_t *st, int index)
+{
+	st->sendqueue[(st->sendqueue_head + st->sendqueue_count) % st->hostsn] = index;
+	st->sendqueue_count++;
+}
+
+static void SB_Query_Finish(sb_querystate_t *st, const sb_query_t *query, server_data *servs[], int index)
+{
+	sb_queryhost_t *host = &st->hosts[index];
+	int s;
+
+	if (host->done) {
+		return;
+	}
+
+	host->done = true;
+	st->finished++;
+	ping_pos = st->finished / (double)st->hostsn;
+
+	if (query->on_finish) {
+		int ping = host->recv > 0 ? (int)((host->ping / host->recv) * 1000) : -1;
+
+		for (s = host->first_serv; s >= 0; s = st->serv_next[s]) {
+			query->on_finish(servs[s], ping);
+		}
+	}
+}
+
+// an outstanding request has either been answered or has timed out
+static void SB_Query_Resolve(sb_querystate_t *st, const sb_query_t *query, server_data *servs[], int index, qbool answered)
+{
+	sb_queryhost_t *host = &st->hosts[index];
+
+	SB_Query_WheelRemove(st, index);
+
+	if ((answered && query->stop_on_reply) || host->sent >= query->attempts) {
+		SB_Query_Finish(st, query, servs, index);
+	}
+	else {
+		SB_Query_Enqueue(st, index);
+	}
+}
+
+static void SB_Query_Expire(sb_querystate_t *st, const sb_query_t *query, server_data *servs[], double time)
+{
+	unsigned int now_tick = SB_Query_TimeToTick(time);
+
+	while ((int)(now_tick - st->wheel_tick) > 0) {
+		int slot, index;
+
+		st->wheel_tick++;
+		slot = st->wheel_tick & (SB_QUERY_WHEEL_SLOTS - 1);
+		index = st->wheel[slot];
+
+		while (index >= 0) {
+			int next = st->hosts[index].wheel_next;
+
+			if (st->hosts[index].deadline <= time) {
+				SB_Query_Resolve(st, query, servs, index, false);
+			}
+			else if (SB_Query_TimeToTick(st->hosts[index].deadline) != st->wheel_tick) {
+				// deadline beyond the wheel horizon, go round once more
+				SB_Query_WheelRemove(st, index);
+				SB_Query_WheelInsert(st, index, st->hosts[index].deadline);
+			}
+
+			index = next;
+		}
+	}
+}
+
 /**
- * Send several ping requests at once, start another thread to recieve
- * the responses.
- * FIXME: error handling is in rly bad shape
+ * Tells if answer is a reply of the expected type. Servers answer A2A_PING
+ * with a bare A2A_ACK byte, everything else comes after the 0xFFFFFFFF
+ * connectionless header.
  */
-int PingHosts(server_data *servs[], int servsn, int count)
+static qbool SB_Query_IsReply(const char *answer, int len, char reply)
 {
-	u_int arg;
-	pinghost_list_t host_list;
+	if (reply == A2A_ACK && len >= 1 && answer[0] == A2A_ACK) {
+		return true;
+	}
 
-	host_list.hosts = ParseServerList(servs, servsn, &host_list.nelms);
-	ping_finished = false;
+	return len >= 5 && !memcmp(answer, "\xff\xff\xff\xff", 4) && answer[4] == reply;
+}
+
+static void SB_Query_Receive(sb_querystate_t *st, const sb_query_t *query, server_data *servs[], socket_t sock)
+{
+	char answer[SB_QUERY_MAX_REPLY];
+	struct sockaddr_in from;
+	socklen_t fromlen;
+	int ret;
+
+	while (1) {
+		sb_queryhost_t *host;
+		int index, s;
+		double time;
+
+		fromlen = sizeof(from);
+		ret = recvfrom(sock, answer, sizeof(answer) - 1, 0, (struct sockaddr *)&from, &fromlen);
+		if (ret <= 0) {
+			// socket is asynch, so most likely this means there is no data to read
+			break;
+		}
+
+		if (!SB_Query_IsReply(answer, ret, query->reply)) {
+			continue;
+		}
+
+		host = SB_Query_FindHost(st, from.sin_addr.s_addr, from.sin_port);
+		if (host == NULL || host->done || host->wheel_slot < 0) {
+			// unknown, finished or late answer
+			continue;
+		}
 
-	ping_sock = UDP_OpenSocket(PORT_ANY);
+		time = Sys_DoubleTime();
+		index = host - st->hosts;
+		host->ping += time - host->stime;
+		host->recv++;
 
-#ifndef _WIN32
-	if ((fcntl (ping_sock, F_SETFL, O_NONBLOCK)) == -1) { // O'Rly?! @@@
-		Com_Printf ("TCP_OpenStream: fcntl: (%i): %s\n", qerrno, strerror(qerrno));
-		//closesocket(ping_sock);
+		if (query->on_reply) {
+			answer[ret] = 0;
+			for (s = host->first_serv; s >= 0; s = st->serv_next[s]) {
+				char copy[SB_QUERY_MAX_REPLY];
+
+				// parsers tokenize in place, give every server its own copy
+				memcpy(copy, answer, ret + 1);
+				query->on_reply(servs[s], copy, ret);
+			}
+		}
+
+		SB_Query_Resolve(st, query, servs, index, true);
 	}
-#endif
+}
+
+/**
+ * Query all servers through a single socket, calling back into the browser
+ * as answers arrive. Returns false if the query could not be started.
+ */
+qbool SB_Query_Run(server_data *servs[], int servsn, const sb_query_t *query)
+{
+	sb_querystate_t st;
+	socket_t sock;
+	double interval, tokens, burst, lasttime;
+	int i;
 
-	arg = 1;
-	if (ioctlsocket (ping_sock, FIONBIO, (u_long *)&arg) == -1) { // make asynchronous
-		Com_Printf ("PingHosts: ioctl: (%i): %s\n", qerrno, strerror(qerrno));
-		//closesocket(newsocket);
+	if (servsn <= 0 || query->attempts <= 0 || query->rate <= 0) {
+		return true;
 	}
 
-	Sys_SemInit(&ping_semaphore, 0, 1);
+	sock = UDP_OpenSocket(PORT_ANY);
+	if (sock == INVALID_SOCKET) {
+		return false;
+	}
 
-	if (Sys_CreateDetachedThread(PingRecvProc, (void *)&host_list) < 0) {
-		Com_Printf("Failed to create Ping receiver thread\n");
+	memset(&st, 0, sizeof(st));
+	st.hosts = (sb_queryhost_t *) Q_malloc(sizeof(sb_queryhost_t) * servsn);
+	st.serv_next = (int *) Q_malloc(sizeof(int) * servsn);
+	st.sendqueue = (int *) Q_malloc(sizeof(int) * servsn);
+	for (st.hash_mask = 1; st.hash_mask < (unsigned int)servsn * 2; st.hash_mask <<= 1)
+		;
+	st.hash = (int *) Q_malloc(sizeof(int) * st.hash_mask);
+	st.hash_mask--;
+	memset(st.hash, 0xFF, sizeof(int) * (st.hash_mask + 1));
+	memset(st.wheel, 0xFF, sizeof(st.wheel));
+
+	// build unique host list, servers on the same address share the host
+	for (i = 0; i < servsn; i++) {
+		netadr_t *adr = &servs[i]->address;
+		unsigned int ip;
+		sb_queryhost_t *host;
+
+		memcpy(&ip, adr->ip, sizeof(ip));
+		st.serv_next[i] = -1;
+
+		if ((host = SB_Query_FindHost(&st, ip, adr->port))) {
+			st.serv_next[i] = host->first_serv;
+			host->first_serv = i;
+			continue;
+		}
+
+		host = &st.hosts[st.hostsn];
+		memset(host, 0, sizeof(*host));
+		host->ip = ip;
+		host->port = adr->port;
+		host->first_serv = i;
+		host->wheel_slot = host->wheel_prev = host->wheel_next = -1;
+		host->hash_next = st.hash[SB_Query_Hash(ip, adr->port) & st.hash_mask];
+		st.hash[SB_Query_Hash(ip, adr->port) & st.hash_mask] = st.hostsn;
+		SB_Query_Enqueue(&st, st.hostsn);
+		st.hostsn++;
 	}
 
-	PingSendParrallelMultiHosts(host_list.hosts, host_list.nelms, count);
+	interval = 1.0 / query->rate;
+	burst = max(1, query->rate * SB_QUERY_TICK);
+	tokens = 1;
+	lasttime = Sys_DoubleTime();
+	st.wheel_tick = SB_Query_TimeToTick(lasttime);
+	ping_pos = 0;
 
-	Sys_MSleep(500); // Wait for slow pings
+	while (st.finished < st.hostsn && !abort_ping) {
+		struct timeval timeout;
+		double time = Sys_DoubleTime();
+		double wait;
+		fd_set fd;
 
-	ping_finished = true; // let thread know we are done
-	Sys_SemWait(&ping_semaphore);
-	Sys_SemDestroy(&ping_semaphore);
-	closesocket(ping_sock);
+		tokens = min(burst, tokens + (time - lasttime) * query->rate);
+		lasttime = time;
 
-	if (!abort_ping) {
-		FillServerListPings(servs, servsn, host_list.hosts, host_list.nelms);
+		// send as many requests as the pacing allows
+		while (tokens >= 1 && st.sendqueue_count > 0) {
+			int index = st.sendqueue[st.sendqueue_head];
+			sb_queryhost_t *host = &st.hosts[index];
+			struct sockaddr_in to;
+
+			st.sendqueue_head = (st.sendqueue_head + 1) % st.hostsn;
+			st.sendqueue_count--;
+
+			memset(&to, 0, sizeof(to));
+			to.sin_family = AF_INET;
+			to.sin_port = host->port;
+			to.sin_addr.s_addr = host->ip;
+
+			host->sent++;
+			host->stime = time;
+			tokens -= 1;
+
+			if (sendto(sock, query->packet, query->packet_len, 0, (struct sockaddr *)&to, sizeof(to)) < 0) {
+				Com_DPrintf("SB_Query_Run: sendto: (%i): %s\n", qerrno, strerror(qerrno));
+				SB_Query_Resolve(&st, query, servs, index, false);
+				continue;
+			}
+
+			SB_Query_WheelInsert(&st, index, time + query->timeout);
+		}
+
+		SB_Query_Expire(&st, query, servs, time);
+
+		// sleep until an answer arrives, a new request may be sent or the wheel ticks
+		wait = SB_QUERY_TICK;
+		if (st.sendqueue_count > 0 && tokens < 1) {
+			wait = min(wait, (1 - tokens) * interval);
+		}
+
+		FD_ZERO(&fd);
+		FD_SET(sock, &fd);
+		timeout.tv_sec = 0;
+		timeout.tv_usec = (long)(max(0, wait) * 1000000.0);
+
+		if (select(sock + 1, &fd, NULL, NULL, &timeout) > 0) {
+			SB_Query_Receive(&st, query, servs, sock);
+		}
 	}
 
-	Q_free(host_list.hosts);
+	closesocket(sock);
+	Q_free(st.hash);
+	Q_free(st.sendqueue);
+	Q_free(st.serv_next);
+	Q_free(st.hosts);
+
+	return true;
+}
 
-	return 1;
+static void PingHosts_OnFinish(server_data *serv, int ping)
+{
+	SetPing(serv, ping);
+}
+
+/**
+ * Ping all servers count times using A2A_PING packets, pings are written to
+ * the servers as soon as each host has been pinged.
+ */
+int PingHosts(server_data *servs[], int servsn, int count)
+{
+	sb_query_t query;
+
+	memset(&query, 0, sizeof(query));
+	query.packet = PING_PACKET_DATA;
+	query.packet_len = strlen(PING_PACKET_DATA);
+	query.reply = A2A_ACK;
+	query.attempts = bound(1, count, 6);
+	query.stop_on_reply = false;
+	query.timeout = sb_pingtimeout.value / 1000;
+	query.rate = max(1, sb_pingspersec.value);
+	query.on_finish = PingHosts_OnFinish;
+
+	return SB_Query_Run(servs, servsn, &query);
 }
 
 //
@@ -20,6 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 
 #include <time.h>
+#include <SDL_thread.h>
 #include "quakedef.h"
 #include "movie.h"
 #include "menu_demo.h"
@@ -82,20 +83,27 @@ static qbool	qwz_packing = false;
 
 #define QWZ_DECOMPRESSION_TIMEOUT_MS	10000
 
-static void		OnChange_demo_format(cvar_t*, char*, qbool*);
-cvar_t			demo_format = {"demo_format", "qwz", 0, OnChange_demo_format};
-
 static HANDLE hQizmoProcess = NULL;
 static char tempqwd_name[256] = {0}; // This file must be deleted after playback is finished.
 int CL_Demo_Compress(char*);
 #endif
 
+// qwd.gz is packed natively, qwz and mvd need external apps and are only available in Win32.
+static void		OnChange_demo_format(cvar_t*, char*, qbool*);
+#ifdef _WIN32
+cvar_t			demo_format = {"demo_format", "qwz", 0, OnChange_demo_format};
+#else
+cvar_t			demo_format = {"demo_format", "qwd", 0, OnChange_demo_format};
+#endif
+
 static vfsfile_t *CL_Open_Demo_File(char *name, qbool searchpaks, char **fullpath);
+static vfsfile_t *CL_Open_Demo_Archive(char *name, char *inner_name, int inner_name_size);
 static void OnChange_demo_dir(cvar_t *var, char *string, qbool *cancel);
 cvar_t demo_dir = {"demo_dir", "", 0, OnChange_demo_dir};
 cvar_t demo_benchmarkdumps = {"demo_benchmarkdumps", "1"};
 cvar_t cl_startupdemo = {"cl_startupdemo", ""};
 cvar_t demo_jump_rewind = { "demo_jump_rewind", "-10" };
+cvar_t demo_readahead = {"demo_readahead", "4096"};	// KB decoded ahead of playback for demos streamed out of archives.
 
 // Used to save track status when rewinding.
 static vec3_t rewind_angle;
@@ -1535,6 +1543,287 @@ void CL_RecordMvd_f(void)
 	}
 }
 
+//=============================================================================
+//								DEMO READ-AHEAD
+//=============================================================================
+
+//
+// Demos streamed out of archives are decompressed on a thread of their own,
+// which keeps a window of demo_readahead KB ahead of the playback position.
+// Reads block until data arrives so the demo probe and everything else that
+// reads playbackfile works unchanged, pb_raw_read() checks what's available
+// first so normal playback never waits on the disk.
+//
+
+#define DEMO_READAHEAD_CHUNK	(64 * 1024)
+
+typedef struct demo_readahead_s
+{
+	vfsfile_t funcs; // <= must be at top/begining of struct
+
+	vfsfile_t *src;			// Only touched by the reader thread once it is running.
+	unsigned long len;
+
+	SDL_Thread *thread;
+	SDL_mutex *lock;
+	SDL_cond *cond;			// Signalled on new data, free space, seeks and quit.
+
+	byte *buf;
+	int size;
+	int head;				// Ring position of the next byte to hand out.
+	int count;				// Bytes ready in the ring.
+	unsigned long pos;		// File position of buf[head].
+	int generation;			// Bumped on every seek so reads in flight get dropped.
+	qbool seek;
+	qbool eof;
+	qbool quit;
+} demo_readahead_t;
+
+static int demo_underruns = 0;		// Times playback caught up with the reader since the demo started.
+static qbool demo_underrun = false;	// Playback is waiting for the reader right now.
+
+static int CL_DemoReadAhead_Thread(void *arg)
+{
+	demo_readahead_t *ra = (demo_readahead_t *) arg;
+	vfserrno_t err;
+	int generation, tail, space, r;
+
+	SDL_LockMutex(ra->lock);
+
+	while (!ra->quit)
+	{
+		if (ra->seek)
+		{
+			unsigned long pos = ra->pos;
+
+			ra->seek = false;
+			generation = ra->generation;
+
+			SDL_UnlockMutex(ra->lock);
+			r = VFS_SEEK(ra->src, pos, SEEK_SET);
+			SDL_LockMutex(ra->lock);
+
+			if (r && generation == ra->generation)
+			{
+				ra->eof = true;
+				SDL_CondBroadcast(ra->cond);
+			}
+			continue;
+		}
+
+		if (ra->eof || ra->count == ra->size)
+		{
+			SDL_CondWait(ra->cond, ra->lock);
+			continue;
+		}
+
+		// The free part of the ring is ours, playback only looks at [head, head + count).
+		tail = (ra->head + ra->count) % ra->size;
+		space = min(ra->size - ra->count, ra->size - tail);
+		space = min(space, DEMO_READAHEAD_CHUNK);
+		generation = ra->generation;
+
+		SDL_UnlockMutex(ra->lock);
+		r = VFS_READ(ra->src, ra->buf + tail, space, &err);
+		SDL_LockMutex(ra->lock);
+
+		if (generation != ra->generation)
+			continue; // Seeked away meanwhile.
+
+		if (r > 0)
+			ra->count += r;
+		else
+			ra->eof = true;
+
+		SDL_CondBroadcast(ra->cond);
+	}
+
+	SDL_UnlockMutex(ra->lock);
+	return 0;
+}
+
+static int CL_DemoReadAhead_ReadBytes(vfsfile_t *file, void *buffer, int bytestoread, vfserrno_t *err)
+{
+	demo_readahead_t *ra = (demo_readahead_t *) file;
+	byte *out = (byte *) buffer;
+	int r = 0;
+
+	SDL_LockMutex(ra->lock);
+
+	while (r < bytestoread)
+	{
+		int len;
+
+		if (!ra->count)
+		{
+			if (ra->eof)
+				break;
+
+			SDL_CondWait(ra->cond, ra->lock);
+			continue;
+		}
+
+		len = min(bytestoread - r, min(ra->count, ra->size - ra->head));
+		memcpy(out + r, ra->buf + ra->head, len);
+
+		ra->head = (ra->head + len) % ra->size;
+		ra->count -= len;
+		ra->pos += len;
+		r += len;
+
+		SDL_CondBroadcast(ra->cond);
+	}
+
+	SDL_UnlockMutex(ra->lock);
+
+	if (err)
+		*err = ((r || bytestoread <= 0) ? VFSERR_NONE : VFSERR_EOF);
+
+	return r;
+}
+
+static int CL_DemoReadAhead_Seek(vfsfile_t *file, unsigned long offset, int whence)
+{
+	demo_readahead_t *ra = (demo_readahead_t *) file;
+
+	SDL_LockMutex(ra->lock);
+
+	switch (whence)
+	{
+	case SEEK_SET: break;
+	case SEEK_CUR: offset += ra->pos; break;
+	case SEEK_END: offset += ra->len; break;
+	default:
+		SDL_UnlockMutex(ra->lock);
+		return -1;
+	}
+
+	if (offset >= ra->pos && offset <= ra->pos + ra->count)
+	{
+		// Skipping forward inside the window.
+		int skip = offset - ra->pos;
+
+		ra->head = (ra->head + skip) % ra->size;
+		ra->count -= skip;
+	}
+	else
+	{
+		ra->head = ra->count = 0;
+		ra->eof = false;
+		ra->seek = true;
+		ra->generation++;
+	}
+
+	ra->pos = offset;
+	SDL_CondBroadcast(ra->cond);
+	SDL_UnlockMutex(ra->lock);
+
+	return 0;
+}
+
+static unsigned long CL_DemoReadAhead_Tell(vfsfile_t *file)
+{
+	demo_readahead_t *ra = (demo_readahead_t *) file;
+	unsigned long pos;
+
+	SDL_LockMutex(ra->lock);
+	pos = ra->pos;
+	SDL_UnlockMutex(ra->lock);
+
+	return pos;
+}
+
+static unsigned long CL_DemoReadAhead_GetLen(vfsfile_t *file)
+{
+	return ((demo_readahead_t *) file)->len;
+}
+
+static void CL_DemoReadAhead_Close(vfsfile_t *file)
+{
+	demo_readahead_t *ra = (demo_readahead_t *) file;
+
+	SDL_LockMutex(ra->lock);
+	ra->quit = true;
+	SDL_CondBroadcast(ra->cond);
+	SDL_UnlockMutex(ra->lock);
+
+	SDL_WaitThread(ra->thread, NULL);
+
+	VFS_CLOSE(ra->src);
+	SDL_DestroyCond(ra->cond);
+	SDL_DestroyMutex(ra->lock);
+	Q_free(ra->buf);
+	Q_free(ra);
+}
+
+//
+// Returns how many bytes can be read from the file without waiting.
+//
+static int CL_DemoReadAhead_Available(vfsfile_t *file, qbool *eof)
+{
+	demo_readahead_t *ra = (demo_readahead_t *) file;
+	int count;
+
+	SDL_LockMutex(ra->lock);
+	count = ra->count;
+	*eof = ra->eof;
+	SDL_UnlockMutex(ra->lock);
+
+	return count;
+}
+
+//
+// Puts a read-ahead thread in front of src, returns src itself if that's not possible.
+//
+static vfsfile_t *CL_DemoReadAhead_Open(vfsfile_t *src, int size)
+{
+	demo_readahead_t *ra;
+
+	ra = Q_calloc(1, sizeof(*ra));
+	ra->src  = src;
+	ra->len  = VFS_GETLEN(src);
+	ra->pos  = VFS_TELL(src);
+	ra->size = size;
+	ra->buf  = Q_malloc(size);
+
+	ra->funcs.ReadBytes     = CL_DemoReadAhead_ReadBytes;
+	ra->funcs.Seek          = CL_DemoReadAhead_Seek;
+	ra->funcs.Tell          = CL_DemoReadAhead_Tell;
+	ra->funcs.GetLen        = CL_DemoReadAhead_GetLen;
+	ra->funcs.Close         = CL_DemoReadAhead_Close;
+	ra->funcs.copyprotected = src->copyprotected;
+
+	ra->lock = SDL_CreateMutex();
+	ra->cond = SDL_CreateCond();
+	if (ra->lock && ra->cond)
+		ra->thread = SDL_CreateThread(CL_DemoReadAhead_Thread, "demoreadahead", ra);
+
+	if (!ra->thread)
+	{
+		Com_Printf("Couldn't start the demo read-ahead thread\n");
+		if (ra->cond)
+			SDL_DestroyCond(ra->cond);
+		if (ra->lock)
+			SDL_DestroyMutex(ra->lock);
+		Q_free(ra->buf);
+		Q_free(ra);
+		return src;
+	}
+
+	return (vfsfile_t *) ra;
+}
+
+//
+// The demo HUD shows these while playback waits for the reader.
+//
+int CL_Demo_Underruns(qbool *waiting)
+{
+	if (waiting)
+		*waiting = demo_underrun;
+
+	return demo_underruns;
+}
+
 //=============================================================================
 //								DEMO READING
 //=============================================================================
@@ -1604,7 +1893,28 @@ int CL_Demo_Read(void *buf, int size, qbool peek)
 static int pb_raw_read(void *buf, int size)
 {
 	vfserrno_t err;
-	int r = VFS_READ(playbackfile, buf, size, &err);
+	int r;
+
+	// Don't wait for the read-ahead thread, rather let the frame go by.
+	if (playbackfile->ReadBytes == CL_DemoReadAhead_ReadBytes && size > 0)
+	{
+		qbool eof;
+		int avail = CL_DemoReadAhead_Available(playbackfile, &eof);
+
+		if (!avail && !eof)
+		{
+			if (!demo_underrun)
+				demo_underruns++;
+			demo_underrun = true;
+			return 0;
+		}
+
+		demo_underrun = false;
+		if (avail)
+			size = min(size, avail);
+	}
+
+	r = VFS_READ(playbackfile, buf, size, &err);
 
 	// Size > 0 mean detect EOF only if we actually trying read some data.
 	if (size > 0 && !r && err == VFSERR_EOF)
@@ -1642,6 +1952,14 @@ qbool pb_ensure(void)
 			return true;
 	}
 
+	// Hold the demo clock while the read-ahead thread catches up.
+	if (demo_underrun)
+	{
+		extern qbool host_skipframe;
+
+		host_skipframe = true;
+	}
+
 	// Set the buffering time if it hasn't been set already.
 	if (cls.mvdplayback == QTV_PLAYBACK && !bufferingtime && !cls.qtv_donotbuffer)
 	{
@@ -2027,6 +2345,7 @@ qbool CL_GetDemoMessage (void)
 		// saved as the number of miliseconds since last frame message.
 		// This is also used when seeking in qwds to keep the gameclock in time.
 		cls.demopackettime = demotime;
+		CL_DemoTimeline_Packet(demotime);
 
 		// Get the msg type.
 		CL_Demo_Read(&c, sizeof(c), false);
@@ -2160,18 +2479,21 @@ static void OnChange_demo_dir(cvar_t *var, char *string, qbool *cancel)
 	}
 }
 
-#ifdef _WIN32
 static void OnChange_demo_format(cvar_t *var, char *string, qbool *cancel)
 {
-	char* allowed_formats[5] = { "qwd", "qwz", "mvd", "mvd.gz", "qwd.gz" };
-	int i;
+#ifdef _WIN32
+	char* allowed_formats[] = { "qwd", "qwz", "mvd", "mvd.gz", "qwd.gz" };
+#else
+	char* allowed_formats[] = { "qwd", "qwd.gz" };
+#endif
+	int i, count = sizeof(allowed_formats) / sizeof(allowed_formats[0]);
 
-	for (i = 0; i < 5; i++)
+	for (i = 0; i < count; i++)
 		if (!strcmp(allowed_formats[i], string))
 			return;
 
 	Com_Printf("Not valid demo format. Allowed values are: ");
-	for (i = 0; i < 5; i++)
+	for (i = 0; i < count; i++)
 	{
 		if (i)
 			Com_Printf(", ");
@@ -2181,8 +2503,40 @@ static void OnChange_demo_format(cvar_t *var, char *string, qbool *cancel)
 
 	*cancel = true;
 }
+
+//
+// Packs a finished qwd into demo_format, returns true if it's taken care of
+// (the qwd is gone or an external app is packing it).
+//
+static qbool CL_Demo_Pack(char *qwdname)
+{
+#ifdef WITH_ZLIB
+	if (!strcmp(demo_format.string, "qwd.gz"))
+	{
+		// No external tool needed, and the result can be played back with seeking.
+		if (!FS_GZipPackBlocked (qwdname, va("%s.gz", qwdname), true))
+		{
+			Com_Printf ("Couldn't compress %s\n", COM_SkipPath(qwdname));
+			return false;
+		}
+
+		remove (qwdname);
+		return true;
+	}
+#endif // WITH_ZLIB
+
+#ifdef _WIN32
+	// If the file type is not QWD we need to conver it using external apps.
+	if (!strcmp(demo_format.string, "qwz") || !strcmp(demo_format.string, "mvd"))
+	{
+		Com_Printf("Converting QWD to %s format.\n", demo_format.string);
+		return CL_Demo_Compress(qwdname);
+	}
 #endif
 
+	return false;
+}
+
 //
 // Writes a "pimp message" for ezQuake at the end of a demo.
 //
@@ -2261,14 +2615,12 @@ void CL_Stop_f (void)
 	if (autorecording)
 	{
 		CL_AutoRecord_StopMatch();
-#ifdef _WIN32
 	}
 	else if (easyrecording)
 	{
 		CL_StopRecording();
-		CL_Demo_Compress(fulldemoname);
+		CL_Demo_Pack(fulldemoname);
 		easyrecording = false;
-#endif
 	}
 	else
 	{
@@ -2722,25 +3074,24 @@ void CL_AutoRecord_SaveMatch(void)
 		error = rename(tempname, fullsavedname);
 	}
 
-#ifdef _WIN32
-
-	// If the file type is not QWD we need to conver it using external apps.
-	if (!strcmp(demo_format.string, "qwz") || !strcmp(demo_format.string, "mvd"))
+	if (!error && strcmp(demo_format.string, "qwd"))
 	{
-		Com_Printf("Converting QWD to %s format.\n", demo_format.string);
-
-		// Convert the file to either MVD or QWZ.
-		if (CL_Demo_Compress(fullsavedname))
+		if (CL_Demo_Pack(fullsavedname))
 		{
-			return;
+#ifdef _WIN32
+			// Packed by an external app, it reports when it's done.
+			if (qwz_packing)
+				return;
+#endif
+			strlcat(savedname, ".gz", sizeof(savedname));
 		}
+#ifdef _WIN32
 		else
 		{
 			qwz_packing = false;
 		}
-	}
-
 #endif
+	}
 
 	if (!error)
 		Com_Printf("Match demo saved to %s\n", savedname);
@@ -3178,6 +3529,9 @@ void CL_StopPlayback (void)
 	if (playbackfile)
 		VFS_CLOSE(playbackfile);
 
+	// Keep what was found out about the demo for the next time it's played.
+	CL_DemoTimeline_Stop();
+
 	// Reset demo playback vars.
 	playbackfile = NULL;
 	cls.mvdplayback = cls.demoplayback = cls.nqdemoplayback = false;
@@ -3552,6 +3906,8 @@ void CL_Play_f (void)
 	char *real_name;
 	char name[MAX_OSPATH], **s;
 	static char *ext[] = {"qwd", "mvd", "dem", NULL};
+	char archived_name[MAX_OSPATH];
+	qbool streaming = false;
 
 	// Show usage.
 	if (Cmd_Argc() != 2)
@@ -3572,13 +3928,25 @@ void CL_Play_f (void)
 	// Disconnect any current game.
 	Host_EndGame();
 
+	//
+	// Stream demos straight out of .gz and .zip files rather than unpacking them to a temp file first.
+	//
+	if ((playbackfile = CL_Open_Demo_Archive (real_name, archived_name, sizeof(archived_name))))
+	{
+		streaming = true;
+		real_name = archived_name;
+
+		if (demo_readahead.integer > 0)
+			playbackfile = CL_DemoReadAhead_Open (playbackfile, max(demo_readahead.integer, 64) * 1024);
+	}
+
 	// VFS-FIXME: This will affect playing qwz inside a zip
 	#ifndef WITH_VFS_ARCHIVE_LOADING 
 	#ifdef WITH_ZIP
 	//
 	// Unpack the demo if it's zipped or gzipped. And get the path to the unpacked demo file.
 	//
-	if (CL_GetUnpackedDemoPath (Cmd_Argv(1), unpacked_path, sizeof(unpacked_path)))
+	if (!playbackfile && CL_GetUnpackedDemoPath (Cmd_Argv(1), unpacked_path, sizeof(unpacked_path)))
 	{
 		real_name = unpacked_path;
 	}
@@ -3672,8 +4040,8 @@ void CL_Play_f (void)
 	}
 	#endif // WITH_VFS_ARCHIVE_LOADING else
 
-	// Read the file completely into memory
-	if (playbackfile) 
+	// Read the file completely into memory, demos in archives are streamed instead.
+	if (playbackfile && !streaming) 
 	{
 		size_t len;
 		void *buf;
@@ -3713,12 +4081,59 @@ void CL_Play_f (void)
 	cls.demorewinding	= false;
 	cls.demo_rewindtime = 0;
 
+	demo_underruns = 0;
+	demo_underrun = false;
+
 	CL_DemoPlaybackInit();
+	CL_DemoTimeline_Start(cls.demoname, demo_time_length);
 	TP_ExecTrigger("f_demostart");
 
 	Com_Printf("Playing demo from %s\n", COM_SkipPath(name));
 }
 
+//
+// Opens a demo inside a .gz file or a zip file ("demos.zip/demo.mvd") for streaming.
+// inner_name gets the name of the demo itself, which tells the demo type.
+//
+static vfsfile_t *CL_Open_Demo_Archive(char *name, char *inner_name, int inner_name_size)
+{
+	vfsfile_t *raw, *file = NULL;
+	char *fullname;
+
+	#ifdef WITH_ZLIB
+	if (!strcmp(COM_FileExtension(name), "gz"))
+	{
+		COM_StripExtension(COM_SkipPath(name), inner_name, inner_name_size);
+
+		// Blocked .gz demos are read through the vfs and can come out of paks too.
+		if ((raw = CL_Open_Demo_File(name, true, &fullname)) && !(file = FSGZIP_OpenBlockedVFS(raw, fullname)))
+		{
+			VFS_CLOSE(raw);
+
+			// Plain gzip is read with zlib straight from the OS file.
+			if ((raw = CL_Open_Demo_File(name, false, &fullname)))
+				file = FS_OpenArchiveEntryVFS(&gzipfilefuncs, raw, fullname, inner_name);
+		}
+
+		return file;
+	}
+	#endif // WITH_ZLIB
+
+	#ifdef WITH_ZIP
+	{
+		char archive_path[MAX_OSPATH];
+
+		if (FS_ZipBreakupArchivePath("zip", name, archive_path, sizeof(archive_path), inner_name, inner_name_size) < 0)
+			return NULL;
+
+		if ((raw = CL_Open_Demo_File(archive_path, false, &fullname)))
+			file = FS_OpenArchiveEntryVFS(&zipfilefuncs, raw, fullname, inner_name);
+	}
+	#endif // WITH_ZIP
+
+	return file;
+}
+
 static vfsfile_t* CL_Open_Demo_File(char* name, qbool searchpaks, char** fullPath)
 {
 	static char fullname[MAX_OSPATH];
@@ -4550,6 +4965,7 @@ void CL_Demo_Check_For_Rewind(float nextdemotime)
 
 		cls.demopackettime  = 0.0;
 		cls.demorewinding   = true;
+		CL_DemoTimeline_Rewind();
 	}
 	
 	if (cls.demorewinding)
@@ -4745,34 +5161,34 @@ static void CL_Demo_Jump_Status_Condition_Negate (demoseekingstatus_condition_t
 	}
 }
 
-static qbool CL_Demo_Jump_Status_Match (demoseekingstatus_condition_t *condition)
+qbool CL_Demo_Jump_Status_Match (demoseekingstatus_condition_t *condition, int *stats)
 {
-	if (condition->or && CL_Demo_Jump_Status_Match(condition->or))
+	if (condition->or && CL_Demo_Jump_Status_Match(condition->or, stats))
 		return true;
 
 	switch (condition->type) {
 		case DEMOSEEKINGSTATUS_MATCH_EQUAL:
-			if (cl.stats[condition->stat] != condition->value)
+			if (stats[condition->stat] != condition->value)
 				return false;
 			break;
 		case DEMOSEEKINGSTATUS_MATCH_NOT_EQUAL:
-			if (cl.stats[condition->stat] == condition->value)
+			if (stats[condition->stat] == condition->value)
 				return false;
 			break;
 		case DEMOSEEKINGSTATUS_MATCH_LESS_THAN:
-			if (cl.stats[condition->stat] >= condition->value)
+			if (stats[condition->stat] >= condition->value)
 				return false;
 			break;
 		case DEMOSEEKINGSTATUS_MATCH_GREATER_THAN:
-			if (cl.stats[condition->stat] <= condition->value)
+			if (stats[condition->stat] <= condition->value)
 				return false;
 			break;
 		case DEMOSEEKINGSTATUS_MATCH_BIT_ON:
-			if (!(cl.stats[condition->stat] & condition->value))
+			if (!(stats[condition->stat] & condition->value))
 				return false;
 			break;
 		case DEMOSEEKINGSTATUS_MATCH_BIT_OFF:
-			if (cl.stats[condition->stat] & condition->value)
+			if (stats[condition->stat] & condition->value)
 				return false;
 			break;
 		default:
@@ -4781,7 +5197,7 @@ static qbool CL_Demo_Jump_Status_Match (demoseekingstatus_condition_t *condition
 	}
 
 	if (condition->and != NULL) {
-		return CL_Demo_Jump_Status_Match(condition->and);
+		return CL_Demo_Jump_Status_Match(condition->and, stats);
 	} else {
 		return true;
 	}
@@ -4789,7 +5205,7 @@ static qbool CL_Demo_Jump_Status_Match (demoseekingstatus_condition_t *condition
 
 void CL_Demo_Jump_Status_Check (void)
 {
-	if (CL_Demo_Jump_Status_Match(cls.demoseekingstatus.conditions)) {
+	if (CL_Demo_Jump_Status_Match(cls.demoseekingstatus.conditions, cl.stats)) {
 		if (cls.demoseekingstatus.non_matching_found) {
 			CL_Demo_Jump_Status_Free(cls.demoseekingstatus.conditions);
 			cls.demoseekingstatus.conditions = NULL;
@@ -4848,6 +5264,7 @@ static int CL_Demo_Jump_Status_Parse_Constraint (const char *arg, int *value)
 static void CL_Demo_Jump_Status_f (void)
 {
 	int i;
+	double time;
 	qbool or = false;
 	demoseekingstatus_condition_t *parent = NULL;
 
@@ -4957,6 +5374,20 @@ static void CL_Demo_Jump_Status_f (void)
 		or = false;
 	}
 
+	// Known from earlier seeks, jump right past the message that made the conditions true.
+	if (CL_DemoTimeline_Find(cls.demoseekingstatus.conditions, (cls.mvdplayback ? Cam_TrackNum() : cl.playernum), cl.stats, cls.demopackettime, &time)) {
+		CL_Demo_Jump_Status_Free(cls.demoseekingstatus.conditions);
+		cls.demoseekingstatus.conditions = NULL;
+
+		time += 0.001;
+		if (demo_jump_rewind.value < 0) {
+			time += demo_jump_rewind.value;
+		}
+
+		CL_Demo_Jump(time - demostarttime, 0, DST_SEEKING_NORMAL);
+		return;
+	}
+
 	CL_Demo_Jump(99999, 0, DST_SEEKING_STATUS);
 }
 
@@ -5171,15 +5602,16 @@ void CL_Demo_Init(void)
 	Cmd_AddMacro ("demolength", CL_Macro_DemoLength_f);
 
 	Cvar_SetCurrentGroup(CVAR_GROUP_DEMO);
-#ifdef _WIN32
 	Cvar_Register(&demo_format);
-#endif
 	Cvar_Register(&demo_dir);
 	Cvar_Register(&demo_benchmarkdumps);
 	Cvar_Register(&cl_startupdemo);
 	Cvar_Register(&demo_jump_rewind);
+	Cvar_Register(&demo_readahead);
 
 	Cvar_ResetCurrentGroup();
+
+	CL_DemoTimeline_Init();
 }
 
 qbool CL_Demo_NotForTrackedPlayer(void)
@@ -0,0 +1,278 @@
+/*
+Copyright (C) 2007-2015 ezQuake team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the included (GNU.txt) GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// cl_demo_timeline.c -- the stats of every player over the course of a demo
+
+// While a demo is parsed every change of a player's stats (items, weapon, health, armor, ammo)
+// is appended to a timeline with the time of the message that made it. demo_jump_status looks
+// its conditions up in the timeline as far as it reaches instead of parsing the demo again, so
+// only the first search over a part of the demo costs a seek. The timeline is kept in
+// timelines/<demo>.tl in the game directory and picked up again when the demo is played later.
+// Times are kept relative to the first message of the demo: the MVD clock goes on from the demo
+// played before and restarts from zero on rewind, so absolute times differ between playbacks.
+
+#include "quakedef.h"
+#include "fs.h"
+
+cvar_t demo_timeline = {"demo_timeline", "1"};
+
+typedef struct demo_event_s {
+	double	time;			// cls.demopackettime of the message, relative to the first one
+	int		value;
+	byte	player;
+	byte	stat;
+} demo_event_t;
+
+typedef struct demo_timeline_header_s {
+	char	id[4];			// "EZTL"
+	int		version;
+	double	length;			// demo_time_length, tells a changed demo of the same name
+	double	end;
+	int		numevents;
+} demo_timeline_header_t;
+
+#define DEMO_TIMELINE_VERSION	2
+#define MAX_TIMELINE_EVENTS		(4 * 1024 * 1024)	// way more than a long demo has
+
+static struct {
+	qbool			active;
+	qbool			recording;		// the message being parsed is past end
+	qbool			changed;		// there are events that are not saved
+	qbool			based;			// the first message since the demo (re)started was read
+	double			base;			// its cls.demopackettime
+	char			filename[MAX_OSPATH];
+	double			length;
+	double			end;			// the timeline is complete up to here, -1 when empty
+	demo_event_t	*events;
+	int				numevents;
+	int				maxevents;
+} timeline;
+
+static void CL_DemoTimeline_Load (void)
+{
+	demo_timeline_header_t header;
+	vfsfile_t *f;
+	vfserrno_t err;
+	int i;
+
+	if (!(f = FS_OpenVFS(timeline.filename, "rb", FS_GAME_OS)))
+		return;
+
+	// the header has to describe exactly the events that follow it, anything else starts empty
+	if (VFS_READ(f, &header, sizeof(header), &err) != sizeof(header)
+		|| memcmp(header.id, "EZTL", 4) || header.version != DEMO_TIMELINE_VERSION
+		|| header.length != timeline.length || header.numevents < 0 || header.numevents > MAX_TIMELINE_EVENTS
+		|| VFS_GETLEN(f) != sizeof(header) + header.numevents * sizeof(demo_event_t)
+		|| !(header.end >= -1))
+	{
+		VFS_CLOSE(f);
+		return;
+	}
+
+	timeline.maxevents = max(header.numevents, 1024);
+	timeline.events = (demo_event_t *) Q_malloc(timeline.maxevents * sizeof(demo_event_t));
+
+	if (VFS_READ(f, timeline.events, header.numevents * sizeof(demo_event_t), &err) == header.numevents * sizeof(demo_event_t))
+	{
+		timeline.numevents = header.numevents;
+		timeline.end = header.end;
+	}
+
+	VFS_CLOSE(f);
+
+	// CL_DemoTimeline_Find looks events up by time, they have to be in order and within the timeline
+	for (i = 0; i < timeline.numevents; i++)
+	{
+		if (timeline.events[i].player >= MAX_CLIENTS || timeline.events[i].stat >= MAX_CL_STATS
+			|| !(timeline.events[i].time >= 0 && timeline.events[i].time <= timeline.end)
+			|| (i && timeline.events[i].time < timeline.events[i - 1].time))
+		{
+			timeline.numevents = 0;
+			timeline.end = -1;
+			break;
+		}
+	}
+}
+
+static void CL_DemoTimeline_Save (void)
+{
+	demo_timeline_header_t header;
+	int size = sizeof(header) + timeline.numevents * sizeof(demo_event_t);
+	byte *data;
+
+	memcpy(header.id, "EZTL", 4);
+	header.version = DEMO_TIMELINE_VERSION;
+	header.length = timeline.length;
+	header.end = timeline.end;
+	header.numevents = timeline.numevents;
+
+	data = (byte *) Q_malloc(size);
+	memcpy(data, &header, sizeof(header));
+	memcpy(data + sizeof(header), timeline.events, timeline.numevents * sizeof(demo_event_t));
+
+	if (!FS_WriteFile(timeline.filename, data, size))
+		Com_DPrintf("Couldn't write %s\n", timeline.filename);
+
+	Q_free(data);
+}
+
+// A demo of that name and length starts playing.
+void CL_DemoTimeline_Start (const char *demoname, double length)
+{
+	CL_DemoTimeline_Stop();
+
+	if (!demo_timeline.integer || length <= 0)
+		return;
+
+	snprintf(timeline.filename, sizeof(timeline.filename), "timelines/%s.tl", COM_SkipPath((char *) demoname));
+	timeline.length = length;
+	timeline.end = -1;
+	timeline.active = true;
+
+	CL_DemoTimeline_Load();
+}
+
+// The demo stops playing, the new part of the timeline is saved.
+void CL_DemoTimeline_Stop (void)
+{
+	if (timeline.active && timeline.changed)
+		CL_DemoTimeline_Save();
+
+	Q_free(timeline.events);
+	memset(&timeline, 0, sizeof(timeline));
+}
+
+// The demo is read again from the start, with the clock reset.
+void CL_DemoTimeline_Rewind (void)
+{
+	timeline.based = false;
+	timeline.recording = false;
+}
+
+// A message of that time is parsed next.
+void CL_DemoTimeline_Packet (double time)
+{
+	if (!timeline.active)
+		return;
+
+	if (!timeline.based)
+	{
+		timeline.base = time;
+		timeline.based = true;
+	}
+	time -= timeline.base;
+
+	// Rewinding parses what the timeline has again, the first time after it has to be added.
+	timeline.recording = !cls.demorewinding && time >= timeline.end;
+	if (timeline.recording)
+		timeline.end = time;
+}
+
+// The parsed message changes a stat of player.
+void CL_DemoTimeline_Stat (int player, int stat, int old_value, int value)
+{
+	demo_event_t *e;
+
+	if (!timeline.recording || old_value == value || stat == STAT_TIME || player < 0 || player >= MAX_CLIENTS)
+		return;
+
+	if (timeline.numevents == timeline.maxevents)
+	{
+		timeline.maxevents = max(1024, timeline.maxevents * 2);
+		timeline.events = (demo_event_t *) Q_realloc(timeline.events, timeline.maxevents * sizeof(demo_event_t));
+	}
+
+	e = &timeline.events[timeline.numevents++];
+	e->time = cls.demopackettime - timeline.base;
+	e->value = value;
+	e->player = player;
+	e->stat = stat;
+
+	timeline.changed = true;
+}
+
+/*
+	Finds when the stats of player, which are stats at the time from, change from not matching
+	conditions to matching them, like demo_jump_status does while it seeks. Only answers within
+	the part of the demo the timeline has, false means a seek has to find out.
+*/
+qbool CL_DemoTimeline_Find (demoseekingstatus_condition_t *conditions, int player, int *stats, double from, double *time)
+{
+	int s[MAX_CL_STATS];
+	int lo, hi, mid, i;
+	qbool non_matching, changed;
+	double t;
+
+	if (!timeline.active || !timeline.based || player < 0 || player >= MAX_CLIENTS)
+		return false;
+
+	from -= timeline.base;
+	if (from > timeline.end)
+		return false;
+
+	memcpy(s, stats, sizeof(s));
+	non_matching = !CL_Demo_Jump_Status_Match(conditions, s);
+
+	// the first event after from
+	lo = 0;
+	hi = timeline.numevents;
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if (timeline.events[mid].time <= from)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (i = lo; i < timeline.numevents; )
+	{
+		t = timeline.events[i].time;
+		changed = false;
+
+		for ( ; i < timeline.numevents && timeline.events[i].time == t; i++)
+		{
+			if (timeline.events[i].player == player)
+			{
+				s[timeline.events[i].stat] = timeline.events[i].value;
+				changed = true;
+			}
+		}
+
+		if (!changed)
+			continue;
+
+		if (!CL_Demo_Jump_Status_Match(conditions, s))
+			non_matching = true;
+		else if (non_matching)
+		{
+			*time = t + timeline.base;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void CL_DemoTimeline_Init (void)
+{
+	Cvar_SetCurrentGroup(CVAR_GROUP_DEMO);
+	Cvar_Register(&demo_timeline);
+	Cvar_ResetCurrentGroup();
+}
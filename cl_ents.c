@@ -52,6 +52,9 @@ char *cl_modelnames[cl_num_modelindices];
 int cl_modelindices[cl_num_modelindices];
 model_t *cl_flame0_model;
 
+static visentlist_t scene_firstpassents, scene_visents, scene_alphaents;	// the scene being built, see CL_AddEntity
+static visentlist_t mv_firstpassents, mv_visents, mv_alphaents;			// packet entities shared by multiview views
+
 void CL_InitEnts(void) {
 	int i;
 	byte *memalloc;
@@ -150,11 +153,26 @@ void CL_InitEnts(void) {
 	cl_alphaents.max = 64;
 	cl_alphaents.alpha = 1;
 
-	memalloc = (byte *) Hunk_AllocName((cl_firstpassents.max + cl_visents.max + cl_alphaents.max) * sizeof(entity_t), "visents");
+	scene_firstpassents = mv_firstpassents = cl_firstpassents;
+	scene_visents = mv_visents = cl_visents;
+	scene_alphaents = mv_alphaents = cl_alphaents;
+
+	// One set is drawn, one is built and one holds what multiview views share.
+	memalloc = (byte *) Hunk_AllocName(3 * (cl_firstpassents.max + cl_visents.max + cl_alphaents.max) * sizeof(entity_t), "visents");
 	cl_firstpassents.list = (entity_t *) memalloc;
 	cl_visents.list = (entity_t *) memalloc + cl_firstpassents.max;
 	cl_alphaents.list = (entity_t *) memalloc + cl_firstpassents.max + cl_visents.max;
 
+	memalloc += (cl_firstpassents.max + cl_visents.max + cl_alphaents.max) * sizeof(entity_t);
+	scene_firstpassents.list = (entity_t *) memalloc;
+	scene_visents.list = (entity_t *) memalloc + cl_firstpassents.max;
+	scene_alphaents.list = (entity_t *) memalloc + cl_firstpassents.max + cl_visents.max;
+
+	memalloc += (cl_firstpassents.max + cl_visents.max + cl_alphaents.max) * sizeof(entity_t);
+	mv_firstpassents.list = (entity_t *) memalloc;
+	mv_visents.list = (entity_t *) memalloc + cl_firstpassents.max;
+	mv_alphaents.list = (entity_t *) memalloc + cl_firstpassents.max + cl_visents.max;
+
 	CL_ClearScene();
 }
 
@@ -169,28 +187,94 @@ static qbool is_monster (int modelindex)
 	return false;
 }
 
-void CL_ClearScene (void) {
-	cl_firstpassents.count = cl_visents.count = cl_alphaents.count = 0;
-}
+/*
+	The scene
+
+	cl_firstpassents, cl_visents and cl_alphaents are what the renderer draws, the scene_ lists are
+	what CL_EmitEntities builds, and the two are swapped once the scene is complete.
+
+	With cl_pipeline the packet entities and projectiles are linked on a worker thread while the
+	main thread draws the previous scene. For that time the worker owns the scene_ lists and the
+	interpolation state of packet entities in cl_entities, everything else is the main thread's.
+	The worker does not touch particles, dlights, beams or pmove: effects are queued and run, and
+	players and temp entities are linked, on the main thread in CL_FinishScene. The scene is drawn
+	one frame after it is built.
+
+	From cl the worker reads cl.frames[cl.validsequence].packet_entities, cl.parsecount and
+	cl.oldparsecount, cl.time, cl.model_precache, cl.int_projectiles, cl.teamfortress and
+	cl.racing, and takes the address of cl.players[].translations (never its contents). Those are
+	only written by parsing, and packets are not read while the worker runs: it is started after
+	CL_ReadPackets and joined before the next one.
+
+	In multiview the packet entities and projectiles look the same from every view, so they are
+	linked once per frame by CL_StartMultiviewScene, on the worker with cl_pipeline, and copied
+	into the scene of each view, which then only links players and temp entities itself. Here
+	the first view runs Cam_SetViewPlayer and prediction while the worker links. They write
+	cl.viewplayernum, cl.simorg and the like, predicted players and the playerstates of cl.frames,
+	none of which the worker reads. Multiview scenes are not shared while racing, so the
+	Cam_TrackNum check of the race pacemaker can't depend on which view is being set up.
+
+	The mini-HUD of a view (SCR_DrawMVStatus, SCR_DrawMVStatusStrings) is not prepared on the
+	worker. It reads cl.stats, which Cam_SetViewPlayer copies from the tracked player as that
+	view is set up, and draws as it formats. There is no per-view HUD state to build ahead.
+*/
 
-void CL_AddEntity (entity_t *ent) {
+extern cvar_t cl_pipeline;
+
+typedef enum
+{
+	SCENE_FX_DLIGHT,
+	SCENE_FX_TRAIL,
+	SCENE_FX_INFERNO,
+	SCENE_FX_BUBBLE
+} scene_fx_type_t;
+
+// An effect of linking an entity, queued while the worker links.
+typedef struct scene_fx_s
+{
+	scene_fx_type_t	type;
+	entity_t		ent;
+	centity_t		*cent;
+	entity_state_t	*state;
+	customlight_t	light;
+	qbool			trail_from_ent;		// the trail starts at ent.origin instead of cent->trail_origin
+	int				key;
+	vec3_t			origin;
+	float			radius;
+} scene_fx_t;
+
+static scene_fx_t	*scene_fx;
+static int			scene_numfx;
+static int			scene_maxfx;
+
+static qbool		scene_deferred;			// effects are queued, set while the worker links
+static qbool		scene_building;			// the worker is linking or has not been waited for
+static qbool		scene_thread_started;
+static qbool		scene_multiview;		// the worker links the packet entities shared by multiview views
+static qbool		mv_scene_valid;		// mv_ lists hold this frame's packet entities
+static sem_t		scene_start;
+static sem_t		scene_done;
+static char			scene_error[256];		// a Host_Error from the worker, raised in CL_FinishScene
+
+static void CL_AddEntityToScene (entity_t *ent, visentlist_t *firstpassents, visentlist_t *visents, visentlist_t *alphaents)
+{
 	visentlist_t *vislist;
 
 	if ((ent->effects & (EF_BLUE | EF_RED | EF_GREEN)) && bound(0, gl_powerupshells.value, 1)) {
-		vislist = &cl_visents;
+		vislist = visents;
 	}
 	else if (ent->renderfx & RF_NORMALENT) {
-		vislist = &cl_visents;
+		vislist = visents;
 	}
 	else if (ent->model->type == mod_sprite) {
-		vislist = &cl_alphaents;
+		vislist = alphaents;
 	}
 	else if (ent->model->modhint == MOD_PLAYER || ent->model->modhint == MOD_EYES || ent->renderfx & RF_PLAYERMODEL) {
-		vislist = &cl_firstpassents;
+		vislist = firstpassents;
 		ent->renderfx |= RF_NOSHADOW;
 	}
 	else {
-		vislist = &cl_visents;
+		vislist = visents;
 	}
 
 	if (vislist->count < vislist->max) {
@@ -198,6 +282,142 @@ void CL_AddEntity (entity_t *ent) {
 	}
 }
 
+// Adds to the scene being built.
+void CL_AddEntity (entity_t *ent) {
+	CL_AddEntityToScene(ent, &scene_firstpassents, &scene_visents, &scene_alphaents);
+}
+
+// Adds to the scene being drawn, for the renderer itself (static entities).
+void CL_AddRenderEntity (entity_t *ent) {
+	CL_AddEntityToScene(ent, &cl_firstpassents, &cl_visents, &cl_alphaents);
+}
+
+static void CL_SwapScene (void)
+{
+	visentlist_t tmp;
+
+	tmp = cl_firstpassents; cl_firstpassents = scene_firstpassents; scene_firstpassents = tmp;
+	tmp = cl_visents; cl_visents = scene_visents; scene_visents = tmp;
+	tmp = cl_alphaents; cl_alphaents = scene_alphaents; scene_alphaents = tmp;
+}
+
+static void CL_ClearBuildScene (void)
+{
+	scene_firstpassents.count = scene_visents.count = scene_alphaents.count = 0;
+	scene_numfx = 0;
+	scene_error[0] = 0;
+}
+
+// Waits for the worker to finish linking, without using what it linked.
+void CL_SceneWait (void)
+{
+	if (!scene_building)
+		return;
+
+	Sys_SemWait(&scene_done);
+	scene_building = scene_deferred = scene_multiview = false;
+}
+
+void CL_ClearScene (void) {
+	CL_SceneWait();
+	CL_ClearBuildScene();
+	mv_scene_valid = false;
+	cl_firstpassents.count = cl_visents.count = cl_alphaents.count = 0;
+}
+
+// Host_Error for the linking code, the worker can't longjmp so it leaves the error for the main thread.
+static void CL_SceneError (char *error)
+{
+	if (!scene_deferred)
+		Host_Error ("%s", error);
+
+	if (!scene_error[0])
+		strlcpy(scene_error, error, sizeof(scene_error));
+}
+
+static scene_fx_t *CL_SceneEffect (scene_fx_type_t type)
+{
+	scene_fx_t *fx;
+
+	if (scene_numfx == scene_maxfx)
+	{
+		scene_maxfx = max(64, scene_maxfx * 2);
+		scene_fx = (scene_fx_t *) Q_realloc(scene_fx, scene_maxfx * sizeof(scene_fx_t));
+	}
+
+	fx = &scene_fx[scene_numfx++];
+	fx->type = type;
+	return fx;
+}
+
+static void CL_LinkDlightEx (int key, vec3_t origin, float radius, customlight_t *l)
+{
+	scene_fx_t *fx;
+
+	if (!scene_deferred)
+	{
+		CL_NewDlightEx (key, origin, radius, 0.1, l, 0);
+		return;
+	}
+
+	fx = CL_SceneEffect(SCENE_FX_DLIGHT);
+	fx->key = key;
+	VectorCopy(origin, fx->origin);
+	fx->radius = radius;
+	fx->light = *l;
+}
+
+static void CL_LinkDlight (int key, vec3_t origin, float radius, dlighttype_t type)
+{
+	customlight_t l;
+
+	memset(&l, 0, sizeof(l));
+	l.type = type;
+	CL_LinkDlightEx(key, origin, radius, &l);
+}
+
+static void CL_RunSceneEffect (scene_fx_t *fx)
+{
+	switch (fx->type)
+	{
+		case SCENE_FX_DLIGHT:
+			CL_NewDlightEx(fx->key, fx->origin, fx->radius, 0.1, &fx->light, 0);
+			break;
+		case SCENE_FX_TRAIL:
+			CL_AddParticleTrail(&fx->ent, fx->cent, (fx->trail_from_ent ? &fx->ent.origin : &fx->cent->trail_origin), &fx->light, fx->state);
+			break;
+		case SCENE_FX_INFERNO:
+			QMB_InfernoFlame(fx->ent.origin);
+			break;
+		case SCENE_FX_BUBBLE:
+			QMB_StaticBubble(&fx->ent);
+			break;
+	}
+}
+
+static void CL_LinkEffect (scene_fx_type_t type, entity_t *ent, centity_t *cent, vec3_t *old_origin, customlight_t *light, entity_state_t *state)
+{
+	scene_fx_t fx, *queued;
+
+	queued = (scene_deferred ? CL_SceneEffect(type) : &fx);
+	queued->type = type;
+	queued->ent = *ent;
+	queued->cent = cent;
+	queued->state = state;
+	queued->trail_from_ent = (old_origin == &ent->origin);
+	if (light)
+		queued->light = *light;
+
+	if (!scene_deferred)
+	{
+		// The trail may start from the entity itself, keep pointing at what the caller passed.
+		if (type == SCENE_FX_TRAIL)
+			CL_AddParticleTrail(ent, cent, old_origin, light, state);
+		else
+			CL_RunSceneEffect(queued);
+	}
+}
+
 // NUM_DLIGHTTYPES - this constant not used here, but help u find dynamic light related code if u change something
 static dlighttype_t dl_colors[] = {lt_red, lt_blue, lt_redblue, lt_green, lt_redgreen, lt_bluegreen, lt_white};
 static int dl_colors_cnt = sizeof(dl_colors) / sizeof(dl_colors[0]);
@@ -885,38 +1105,38 @@ void CL_LinkPacketEntities(void)
 			// Spawn light flashes, even ones coming from invisible objects.
 			if ((state->effects & (EF_BLUE | EF_RED | EF_GREEN)) == (EF_BLUE | EF_RED | EF_GREEN)) 
 			{
-				CL_NewDlight (state->number, state->origin, 200 + flicker, 0.1, lt_white, 0);
+				CL_LinkDlight (state->number, state->origin, 200 + flicker, lt_white);
 			} 
 			else if ((state->effects & (EF_BLUE | EF_RED)) == (EF_BLUE | EF_RED)) 
 			{
-				CL_NewDlight (state->number, state->origin, 200 + flicker, 0.1, lt_redblue, 0);
+				CL_LinkDlight (state->number, state->origin, 200 + flicker, lt_redblue);
 			} 
 			else if ((state->effects & (EF_BLUE | EF_GREEN)) == (EF_BLUE | EF_GREEN)) 
 			{
-				CL_NewDlight (state->number, state->origin, 200 + flicker, 0.1, lt_bluegreen, 0);
+				CL_LinkDlight (state->number, state->origin, 200 + flicker, lt_bluegreen);
 			}
 			else if ((state->effects & (EF_RED | EF_GREEN)) == (EF_RED | EF_GREEN)) 
 			{
-				CL_NewDlight (state->number, state->origin, 200 + flicker, 0.1, lt_redgreen, 0);
+				CL_LinkDlight (state->number, state->origin, 200 + flicker, lt_redgreen);
 			} 
 			else if (state->effects & EF_BLUE)
 			{
-				CL_NewDlight (state->number, state->origin, 200 + flicker, 0.1, lt_blue, 0);
+				CL_LinkDlight (state->number, state->origin, 200 + flicker, lt_blue);
 			} 
 			else if (state->effects & EF_RED) 
 			{
-				CL_NewDlight (state->number, state->origin, 200 + flicker, 0.1, lt_red, 0);
+				CL_LinkDlight (state->number, state->origin, 200 + flicker, lt_red);
 			}
 			else if (state->effects & EF_GREEN) 
 			{
-				CL_NewDlight (state->number, state->origin, 200 + flicker, 0.1, lt_green, 0);
+				CL_LinkDlight (state->number, state->origin, 200 + flicker, lt_green);
 			}
 			else if (state->effects & EF_BRIGHTLIGHT) 
 			{
 				vec3_t	tmp;
 				VectorCopy (state->origin, tmp);
 				tmp[2] += 16;
-				CL_NewDlight (state->number, tmp, 400 + flicker, 0.1, lt_default, 0);
+				CL_LinkDlight (state->number, tmp, 400 + flicker, lt_default);
 			}
 			else if (state->effects & EF_DIMLIGHT)
 			{
@@ -930,11 +1150,11 @@ void CL_LinkPacketEntities(void)
 				if (flagcolor)
 				{
 					dlightColorEx(r_flagcolor.value, r_flagcolor.string, lt_default, false, &cst_lt);
-					CL_NewDlightEx(state->number, state->origin, 200 + flicker, 0.1, &cst_lt, 0);
+					CL_LinkDlightEx (state->number, state->origin, 200 + flicker, &cst_lt);
 				}
 				else
 				{
-					CL_NewDlight(state->number, state->origin, 200 + flicker, 0.1, lt_default, 0);
+					CL_LinkDlight (state->number, state->origin, 200 + flicker, lt_default);
 				}
 			}
 		}
@@ -976,7 +1196,8 @@ void CL_LinkPacketEntities(void)
 
 		if (!(model = cl.model_precache[state->modelindex]))
 		{
-			Host_Error ("CL_LinkPacketEntities: bad modelindex");
+			CL_SceneError ("CL_LinkPacketEntities: bad modelindex");
+			continue;
 		}
 
 		ent.model = model;
@@ -1074,14 +1295,14 @@ void CL_LinkPacketEntities(void)
 			{
 				if (gl_part_inferno.value) 
 				{
-					QMB_InfernoFlame (ent.origin);
+					CL_LinkEffect (SCENE_FX_INFERNO, &ent, NULL, NULL, NULL, NULL);
 					continue;
 				}
 			}
 
 			if (state->modelindex == cl_modelindices[mi_bubble]) 
 			{
-				QMB_StaticBubble (&ent);
+				CL_LinkEffect (SCENE_FX_BUBBLE, &ent, NULL, NULL, NULL, NULL);
 				continue;
 			}
 		}
@@ -1099,7 +1320,7 @@ void CL_LinkPacketEntities(void)
 				old_origin = &cent->trail_origin;
 			}
 
-			CL_AddParticleTrail(&ent, cent, old_origin, &cst_lt, state);
+			CL_LinkEffect (SCENE_FX_TRAIL, &ent, cent, old_origin, &cst_lt, state);
 		}
 		VectorCopy (ent.origin, cent->lerp_origin);
 
@@ -2140,24 +2361,165 @@ static int AlphaEntityComparer(const void* lhs_, const void* rhs_)
 static void CL_SortEntities(void)
 {
 	if (Cam_TrackNum() >= 0 && cl.racing) {
-		qsort(cl_visents.list, cl_visents.count, sizeof(cl_visents.list[0]), AlphaEntityComparer);
+		qsort(scene_visents.list, scene_visents.count, sizeof(scene_visents.list[0]), AlphaEntityComparer);
 	}
 }
 
+static int CL_SceneThread (void *unused)
+{
+	while (true)
+	{
+		Sys_SemWait(&scene_start);
+
+		CL_LinkPacketEntities();
+		CL_LinkProjectiles();
+
+		Sys_SemPost(&scene_done);
+	}
+
+	return 0;
+}
+
+static qbool CL_SceneThreadStarted (void)
+{
+	if (!scene_thread_started)
+	{
+		Sys_SemInit(&scene_start, 0, 1);
+		Sys_SemInit(&scene_done, 0, 1);
+
+		if (Sys_CreateDetachedThread(CL_SceneThread, NULL) < 0)
+		{
+			Com_Printf("Couldn't start the scene thread, cl_pipeline disabled\n");
+			Cvar_SetValue(&cl_pipeline, 0);
+			return false;
+		}
+
+		scene_thread_started = true;
+	}
+
+	return true;
+}
+
+static qbool CL_ScenePipelined (void)
+{
+	if (!cl_pipeline.integer || cls.nqdemoplayback || CL_MultiviewEnabled())
+		return false;
+
+	return CL_SceneThreadStarted();
+}
+
+static qbool CL_SceneReady (void)
+{
+	return cls.state == ca_active && !cls.demoseeking && (cl.validsequence || cls.nqdemoplayback);
+}
+
+// Waits for the worker and runs what it queued, without completing the scene.
+static void CL_JoinScene (void)
+{
+	int i;
+
+	CL_SceneWait();
+
+	if (scene_error[0])
+		Host_Error ("%s", scene_error);
+
+	for (i = 0; i < scene_numfx; i++)
+		CL_RunSceneEffect(&scene_fx[i]);
+	scene_numfx = 0;
+}
+
+static void CL_CopyEntityList (visentlist_t *to, visentlist_t *from)
+{
+	memcpy(to->list, from->list, from->count * sizeof(entity_t));
+	to->count = from->count;
+}
+
+/*
+	Links the packet entities and projectiles of this frame for all multiview views,
+	before the first view sets up its player. Racing hides the pacemaker depending on
+	the view, the views link everything themselves then.
+*/
+void CL_StartMultiviewScene (void)
+{
+	mv_scene_valid = false;
+
+	if (!CL_SceneReady() || !cls.mvdplayback || cl.racing)
+		return;
+
+	CL_FinishScene ();
+
+	CL_ClearBuildScene ();
+
+	if (cl_pipeline.integer && CL_SceneThreadStarted())
+	{
+		// Joined by the first view in CL_EmitEntities.
+		scene_deferred = scene_building = scene_multiview = true;
+		Sys_SemPost(&scene_start);
+		return;
+	}
+
+	CL_LinkPacketEntities();
+	CL_LinkProjectiles();
+
+	CL_CopyEntityList(&mv_firstpassents, &scene_firstpassents);
+	CL_CopyEntityList(&mv_visents, &scene_visents);
+	CL_CopyEntityList(&mv_alphaents, &scene_alphaents);
+	mv_scene_valid = true;
+}
+
+// Builds the scene of a multiview view from the packet entities linked for all of them.
+static void CL_EmitMultiviewEntities (void)
+{
+	if (scene_multiview)
+	{
+		CL_JoinScene();
+
+		CL_CopyEntityList(&mv_firstpassents, &scene_firstpassents);
+		CL_CopyEntityList(&mv_visents, &scene_visents);
+		CL_CopyEntityList(&mv_alphaents, &scene_alphaents);
+		mv_scene_valid = true;
+	}
+
+	CL_ClearBuildScene ();
+
+	CL_CopyEntityList(&scene_firstpassents, &mv_firstpassents);
+	CL_CopyEntityList(&scene_visents, &mv_visents);
+	CL_CopyEntityList(&scene_alphaents, &mv_alphaents);
+
+	CL_LinkPlayers();
+
+	CL_UpdateTEnts();
+
+	CL_SortEntities();
+
+	CL_SwapScene();
+}
+
 // Builds the visedicts array for cl.time
 // Made up of: clients, packet_entities, nails, and tents
 void CL_EmitEntities (void) 
 {
-	if (cls.state != ca_active)
+	if (!CL_SceneReady())
 		return;
 
-	if (cls.demoseeking)
+	if (CL_MultiviewEnabled() && (scene_multiview || mv_scene_valid))
+	{
+		CL_EmitMultiviewEntities ();
 		return;
+	}
 
-	if (!cl.validsequence && !cls.nqdemoplayback)
-		return;
+	// Left over from a frame that didn't finish.
+	CL_FinishScene ();
+
+	CL_ClearBuildScene ();
 
-	CL_ClearScene ();
+	if (CL_ScenePipelined())
+	{
+		// Linked while the last scene is drawn, CL_FinishScene does the rest.
+		scene_deferred = scene_building = true;
+		Sys_SemPost(&scene_start);
+		return;
+	}
 	
 	if (cls.nqdemoplayback) {
 		NQD_LinkEntities();
@@ -2171,6 +2533,31 @@ void CL_EmitEntities (void)
 	CL_UpdateTEnts();
 
 	CL_SortEntities();
+
+	CL_SwapScene();
+}
+
+// Completes a scene started on the worker by CL_EmitEntities, it is drawn next frame.
+void CL_FinishScene (void)
+{
+	qbool multiview = scene_multiview;
+
+	if (!scene_building)
+		return;
+
+	CL_JoinScene();
+
+	// No view was drawn from these multiview packet entities, they are of no use any more.
+	if (multiview)
+		return;
+
+	CL_LinkPlayers();
+
+	CL_UpdateTEnts();
+
+	CL_SortEntities();
+
+	CL_SwapScene();
 }
 
 int	mvd_fixangle;
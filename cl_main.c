@@ -94,6 +94,7 @@ cvar_t	cl_pext_256packetentities = {"cl_pext_256packetentities", "1"};
 #ifdef FTE_PEXT_CHUNKEDDOWNLOADS
 cvar_t  cl_pext_chunkeddownloads  = {"cl_pext_chunkeddownloads", "1"};
 cvar_t  cl_chunksperframe  = {"cl_chunksperframe", "5"};
+cvar_t  cl_download_window = {"cl_download_window", "64"};
 #endif
 
 #ifdef FTE_PEXT_FLOATCOORDS
@@ -145,6 +146,7 @@ void OnChangeDemoTeamplay (cvar_t *var, char *value, qbool *cancel);
 cvar_t  cl_demoteamplay = {"cl_demoteamplay", "0", 0, OnChangeDemoTeamplay};	// for NQ demos where we need to say it is teamplay rather than FFA
 
 cvar_t	cl_earlypackets = {"cl_earlypackets", "1"};
+cvar_t	cl_pipeline = {"cl_pipeline", "0"};
 
 cvar_t	cl_restrictions = {"cl_restrictions", "0"}; // 1 is FuhQuake and QW262 defaults
 
@@ -1095,6 +1097,8 @@ void CL_ClearState (void)
 
 	Com_DPrintf ("Clearing memory\n");
 
+	CL_SceneWait ();
+
 	if (!com_serveractive)
 		Host_ClearMemory();
 
@@ -1157,6 +1161,9 @@ void CL_Disconnect (void)
 	connect_time = 0;
 	con_addtimestamp = true;
 
+	// The scene thread may still be linking entities of this connection.
+	CL_SceneWait ();
+
 	if (cl.teamfortress)
 		V_TF_ClearGrenadeEffects();
 	cl.teamfortress = false;
@@ -1771,6 +1778,7 @@ void CL_InitLocal (void)
 	Cvar_Register (&cl_delay_packet);
 	Cvar_Register (&cl_delay_packet_dev);
 	Cvar_Register (&cl_earlypackets);
+	Cvar_Register (&cl_pipeline);
 
 #if defined(PROTOCOL_VERSION_FTE) || defined(PROTOCOL_VERSION_FTE2) || defined(PROTOCOL_VERSION_MVD1)
 	Cvar_Register (&cl_pext);
@@ -1785,6 +1793,7 @@ void CL_InitLocal (void)
 #ifdef FTE_PEXT_CHUNKEDDOWNLOADS
 	Cvar_Register (&cl_pext_chunkeddownloads);
 	Cvar_Register (&cl_chunksperframe);
+	Cvar_Register (&cl_download_window);
 #endif
 
 #ifdef FTE_PEXT_FLOATCOORDS
@@ -2436,6 +2445,9 @@ void CL_Frame (double time)
 	// update video
 	if (CL_MultiviewEnabled())
 	{
+		// Packet entities are the same in all views, link them once.
+		CL_StartMultiviewScene ();
+
 		SCR_UpdateScreenPrePlayerView ();
 
 		qbool draw_next_view = true;
@@ -2461,6 +2473,9 @@ void CL_Frame (double time)
 
 		SCR_UpdateScreen ();
 
+		// With cl_pipeline the entities were linked while drawing, they are drawn next frame.
+		CL_FinishScene ();
+
 		CL_SoundFrame ();
 	}
 
@@ -1709,6 +1709,7 @@ void SCR_DrawMultiviewBorders(void)
 	{
 		extern byte color_black[4];
 
+		Draw_FlushBatch();
 		glMatrixMode(GL_PROJECTION);
 		glLoadIdentity();
 		glOrtho(0, glwidth, 0, glheight, -99999, 99999);
@@ -802,6 +802,87 @@ int recievedblock[MAXBLOCKS];
 int firstblock;
 int blockcycle;
 
+//
+// Windowed requests: keep up to downloadwindow chunks in flight and only ask
+// again for the ones which didn't arrive in time. The window grows while
+// chunks keep coming and is halved on loss, so it settles at whatever the
+// server's drate and the path allow. Servers which don't know about it just
+// ignore the extra nextdl argument and drop what's over their own limit.
+//
+
+#define DL_MAXREQUESTS 32	// per frame, each one costs a few bytes of the move packet
+
+double requestedblock[MAXBLOCKS];	// when the block was asked for, 0 if not in flight
+int blocksinflight;
+float downloadwindow;
+float downloadthreshold;
+double downloadlastloss;
+
+static double CL_ChunkTimeout(void)
+{
+	return bound(0.1, 2 * cls.latency + 0.05, 2.0);
+}
+
+static void CL_ChunkLost(double now)
+{
+	// only back off once per round trip, a burst of losses is one congestion event
+	if (now - downloadlastloss < CL_ChunkTimeout())
+		return;
+
+	downloadlastloss = now;
+	downloadthreshold = max(1, downloadwindow / 2);
+	downloadwindow = downloadthreshold;
+}
+
+static void CL_ChunkArrived(void)
+{
+	extern cvar_t cl_download_window;
+
+	if (downloadwindow < downloadthreshold)
+		downloadwindow += 1;
+	else
+		downloadwindow += 1 / downloadwindow;
+
+	downloadwindow = min(downloadwindow, max(1, cl_download_window.integer));
+}
+
+// Returns the next block to ask for, -1 if the download is complete
+// or -2 if everything missing is already in flight.
+static int CL_RequestAWindowedChunk(void)
+{
+	int lastblock = (downloadsize+DLBLOCKSIZE-1)/DLBLOCKSIZE;
+	double now = Sys_DoubleTime();
+	double timeout = CL_ChunkTimeout();
+	int b, i;
+
+	if (firstblock >= lastblock)
+		return -1;
+
+	for (b = firstblock; b < firstblock + MAXBLOCKS && b < lastblock; b++)
+	{
+		i = b & (MAXBLOCKS-1);
+
+		if (recievedblock[i])
+			continue;
+
+		if (requestedblock[i])
+		{
+			if (requestedblock[i] + timeout > now)
+				continue;
+
+			requestedblock[i] = 0;
+			blocksinflight--;
+			CL_ChunkLost(now);
+		}
+
+		requestedblock[i] = now;
+		blocksinflight++;
+		return b;
+	}
+
+	return -2;
+}
+
 int CL_RequestADownloadChunk(void)
 {
 	int i;
@@ -829,17 +910,23 @@ int CL_RequestADownloadChunk(void)
 
 void CL_SendChunkDownloadReq(void)
 {
-	extern cvar_t cl_chunksperframe;
+	extern cvar_t cl_chunksperframe, cl_download_window;
 	int i, j, chunks;
+	qbool windowed = (cl_download_window.integer > 0);
 	
-	chunks = bound(1, cl_chunksperframe.integer, 5);
+	chunks = windowed ? DL_MAXREQUESTS : bound(1, cl_chunksperframe.integer, 5);
 
 	for (j = 0; j < chunks; j++)
 	{
 		if (cls.downloadmethod != DL_QWCHUNKS)
 			return;
 
-		i = CL_RequestADownloadChunk();
+		if (windowed && blocksinflight >= (int)downloadwindow)
+			return;
+
+		i = windowed ? CL_RequestAWindowedChunk() : CL_RequestADownloadChunk();
+		if (i == -2)
+			return;
 		// i < 0 mean client complete download, let server know
 		// qqshka: download percent optional, server does't really require it, that my extension, hope does't fuck up something
 
@@ -853,6 +940,10 @@ void CL_SendChunkDownloadReq(void)
 			cls.downloadpercent = 100;
 			CL_FinishDownload(); // this also request next dl
 		}
+		else if (windowed)
+		{
+			CL_SendClientCommand(false, "nextdl %d %d %d %d", i, cls.downloadpercent, chunked_download_number, (int)downloadwindow);
+		}
 		else
 		{
 			CL_SendClientCommand(false, "nextdl %d %d %d", i, cls.downloadpercent, chunked_download_number);
@@ -894,6 +985,7 @@ void CL_Parse_OOB_ChunkedDownload(void)
 
 void CL_ParseChunkedDownload(void)
 {
+	extern cvar_t cl_chunksperframe, cl_download_window;
 	char *svname;
 	int totalsize;
 	int chunknum;
@@ -961,6 +1053,12 @@ void CL_ParseChunkedDownload(void)
 		receivedbytes = 0;
 		blockcycle    = -1;	//so it requests 0 first. :)
 		memset(recievedblock, 0, sizeof(recievedblock));
+
+		memset(requestedblock, 0, sizeof(requestedblock));
+		blocksinflight    = 0;
+		downloadwindow    = bound(1, cl_chunksperframe.integer, 5);
+		downloadthreshold = max(1, cl_download_window.integer);
+		downloadlastloss  = 0;
 		return;
 	}
 
@@ -998,6 +1096,13 @@ void CL_ParseChunkedDownload(void)
 	receivedbytes += DLBLOCKSIZE;
 	recievedblock[chunknum&(MAXBLOCKS-1)] = true;
 
+	if (requestedblock[chunknum&(MAXBLOCKS-1)])
+	{
+		requestedblock[chunknum&(MAXBLOCKS-1)] = 0;
+		blocksinflight--;
+		CL_ChunkArrived();
+	}
+
 	while(recievedblock[firstblock&(MAXBLOCKS-1)])
 	{
 		recievedblock[firstblock&(MAXBLOCKS-1)] = false;
@@ -3176,6 +3281,9 @@ void CL_SetStat (int stat, int value)
 	if (stat < 0 || stat >= MAX_CL_STATS)
 		Host_Error ("CL_SetStat: %i is invalid", stat);
 
+	if (cls.demoplayback)
+		CL_DemoTimeline_Stat((cls.mvdplayback ? cls.lastto : cl.playernum), stat, (cls.mvdplayback ? cl.players[cls.lastto].stats[stat] : cl.stats[stat]), value);
+
 	// Set the stat value for the current player we're parsing in the MVD.
 	if (cls.mvdplayback)
 	{
@@ -35,6 +35,442 @@ static vec3_t saved_angles;
 qbool clpred_newpos = false;
 #endif
 
+/*
+==============================================================================
+
+PMOVE RECORDING
+
+pmove_record writes every move the client predicts to a file: the physents,
+movevars, player state and usercmd going in and the player state coming out.
+pmove_replay loads the map through CM_LoadMap, runs the moves again and
+checks the results against the recorded ones, so changes to pmove.c and
+pmovetst.c can be checked against real movement on any map format.  It also
+reports how many moves per second it ran.
+
+==============================================================================
+*/
+
+#define PMREC_MAGIC			"PMR1"
+#define PMREC_MOVEVARS		1		// record carries movevars
+#define PMREC_PHYSENTS		2		// record carries physents
+#define PMREC_RESULTWORDS	15
+
+typedef struct {
+	int		model;			// -1 for a box, else the inline model number, 0 is the world
+	vec3_t	origin;
+	vec3_t	mins, maxs;
+} pmrecphysent_t;
+
+static FILE				*pmrec_file;
+static char				pmrec_mapname[MAX_QPATH];
+static int				pmrec_moves;
+static movevars_t		pmrec_movevars;
+static int				pmrec_numphysent;
+static pmrecphysent_t	pmrec_physents[MAX_PHYSENTS];
+static playermove_t		pmrec_in;
+
+static void CL_PmoveWriteLong (int v)
+{
+	v = LittleLong (v);
+	fwrite (&v, sizeof(v), 1, pmrec_file);
+}
+
+static void CL_PmoveWriteFloats (const float *v, int count)
+{
+	float f;
+
+	for ( ; count > 0; count--, v++) {
+		f = LittleFloat (*v);
+		fwrite (&f, sizeof(f), 1, pmrec_file);
+	}
+}
+
+// the parts of the move result that get compared on replay
+static void CL_PmoveResultWords (int *w)
+{
+	memcpy (w, pmove.origin, sizeof(vec3_t));
+	memcpy (w + 3, pmove.velocity, sizeof(vec3_t));
+	memcpy (w + 6, &pmove.waterjumptime, sizeof(float));
+	w[7] = pmove.onground;
+	w[8] = pmove.onground ? pmove.groundent : -1;
+	w[9] = pmove.waterlevel;
+	w[10] = pmove.watertype;
+	w[11] = pmove.jump_held;
+	w[12] = pmove.jump_msec;
+	w[13] = pmove.numtouch;
+	w[14] = pmove.numtouch ? pmove.touchindex[0] : -1;
+}
+
+static void CL_PmoveMakeRecPhysents (playermove_t *pm, pmrecphysent_t *out)
+{
+	physent_t *pe;
+	int i;
+
+	memset (out, 0, pm->numphysent * sizeof(*out));
+	for (i = 0, pe = pm->physents; i < pm->numphysent; i++, pe++, out++) {
+		out->model = pe->model ? pe->model - cl.clipmodels[1] : -1;
+		VectorCopy (pe->origin, out->origin);
+		if (!pe->model) {
+			VectorCopy (pe->mins, out->mins);
+			VectorCopy (pe->maxs, out->maxs);
+		}
+	}
+}
+
+static void CL_PmoveRecordStop (void)
+{
+	if (!pmrec_file)
+		return;
+
+	fclose (pmrec_file);
+	pmrec_file = NULL;
+	Com_Printf ("pmove_record: %i moves recorded\n", pmrec_moves);
+}
+
+// called by CL_PredictUsercmd around PM_PlayerMove
+static void CL_PmoveRecordMove (qbool done)
+{
+	pmrecphysent_t physents[MAX_PHYSENTS];
+	int result[PMREC_RESULTWORDS];
+	int flags = 0, i;
+	float f;
+
+	if (strcmp (cl.model_name[1], pmrec_mapname)) {
+		CL_PmoveRecordStop ();	// the map changed under us
+		return;
+	}
+
+	if (!done) {
+		pmrec_in = pmove;
+		return;
+	}
+
+	CL_PmoveMakeRecPhysents (&pmrec_in, physents);
+
+	if (!pmrec_moves || memcmp (&movevars, &pmrec_movevars, sizeof(movevars)))
+		flags |= PMREC_MOVEVARS;
+	if (!pmrec_moves || pmrec_in.numphysent != pmrec_numphysent || memcmp (physents, pmrec_physents, pmrec_numphysent * sizeof(physents[0])))
+		flags |= PMREC_PHYSENTS;
+
+	CL_PmoveWriteLong (flags);
+
+	if (flags & PMREC_MOVEVARS) {
+		pmrec_movevars = movevars;
+		CL_PmoveWriteFloats (&movevars.gravity, 12);
+		CL_PmoveWriteLong (movevars.slidefix);
+		CL_PmoveWriteLong (movevars.airstep);
+		CL_PmoveWriteLong (movevars.pground);
+	}
+
+	if (flags & PMREC_PHYSENTS) {
+		pmrec_numphysent = pmrec_in.numphysent;
+		memcpy (pmrec_physents, physents, pmrec_numphysent * sizeof(physents[0]));
+
+		CL_PmoveWriteLong (pmrec_numphysent);
+		for (i = 0; i < pmrec_numphysent; i++) {
+			CL_PmoveWriteLong (physents[i].model);
+			CL_PmoveWriteFloats (physents[i].origin, 3);
+			CL_PmoveWriteFloats (physents[i].mins, 3);
+			CL_PmoveWriteFloats (physents[i].maxs, 3);
+		}
+	}
+
+	// what went in
+	CL_PmoveWriteFloats (pmrec_in.origin, 3);
+	CL_PmoveWriteFloats (pmrec_in.velocity, 3);
+	CL_PmoveWriteLong (pmrec_in.jump_held);
+	CL_PmoveWriteLong (pmrec_in.jump_msec);
+	CL_PmoveWriteFloats (&pmrec_in.waterjumptime, 1);
+	CL_PmoveWriteLong (pmrec_in.pm_type);
+	CL_PmoveWriteLong (pmrec_in.onground);
+
+	CL_PmoveWriteLong (pmrec_in.cmd.msec);
+	CL_PmoveWriteFloats (pmrec_in.cmd.angles, 3);
+	CL_PmoveWriteLong (pmrec_in.cmd.forwardmove);
+	CL_PmoveWriteLong (pmrec_in.cmd.sidemove);
+	CL_PmoveWriteLong (pmrec_in.cmd.upmove);
+	CL_PmoveWriteLong (pmrec_in.cmd.buttons);
+	CL_PmoveWriteLong (pmrec_in.cmd.impulse);
+
+	// what came out
+	CL_PmoveResultWords (result);
+	for (i = 0; i < PMREC_RESULTWORDS; i++) {
+		if (i < 7) {
+			memcpy (&f, &result[i], sizeof(f));
+			CL_PmoveWriteFloats (&f, 1);
+		}
+		else {
+			CL_PmoveWriteLong (result[i]);
+		}
+	}
+
+	pmrec_moves++;
+}
+
+// Full path of a move recording, false if it doesn't fit with its extension.
+static qbool CL_PmoveRecordPath (char *name, const char *filename)
+{
+	int len = snprintf (name, MAX_OSPATH, "%s/%s", cls.gamedir, filename);
+
+	if (len < 0 || len >= MAX_OSPATH - (int) sizeof(".pmr")) {
+		Com_Printf ("%s: file name too long\n", Cmd_Argv(0));
+		return false;
+	}
+
+	COM_DefaultExtension (name, ".pmr");
+	return true;
+}
+
+static void CL_PmoveRecord_f (void)
+{
+	char name[MAX_OSPATH];
+
+	if (Cmd_Argc() != 2) {
+		if (pmrec_file) {
+			CL_PmoveRecordStop ();
+			return;
+		}
+		Com_Printf ("Usage: %s <filename>\n", Cmd_Argv(0));
+		Com_Printf ("Run it again without a filename to stop recording\n");
+		return;
+	}
+
+	if (cls.state != ca_active || !cl.clipmodels[1]) {
+		Com_Printf ("pmove_record: not connected\n");
+		return;
+	}
+
+	CL_PmoveRecordStop ();
+
+	if (!CL_PmoveRecordPath (name, Cmd_Argv(1)))
+		return;
+
+	if (!(pmrec_file = fopen (name, "wb"))) {
+		Com_Printf ("pmove_record: couldn't open %s\n", name);
+		return;
+	}
+
+	strlcpy (pmrec_mapname, cl.model_name[1], sizeof(pmrec_mapname));
+	fwrite (PMREC_MAGIC, 4, 1, pmrec_file);
+	fwrite (pmrec_mapname, sizeof(pmrec_mapname), 1, pmrec_file);
+	pmrec_moves = 0;
+
+	Com_Printf ("Recording moves to %s\n", name);
+}
+
+typedef struct {
+	byte	*data, *end;
+	qbool	overrun;
+} pmrecreader_t;
+
+static int CL_PmoveReadLong (pmrecreader_t *r)
+{
+	int v;
+
+	if (r->data + 4 > r->end) {
+		r->overrun = true;
+		return 0;
+	}
+	memcpy (&v, r->data, 4);
+	r->data += 4;
+	return LittleLong (v);
+}
+
+static void CL_PmoveReadFloats (pmrecreader_t *r, float *v, int count)
+{
+	for ( ; count > 0; count--, v++) {
+		if (r->data + 4 > r->end) {
+			r->overrun = true;
+			*v = 0;
+			continue;
+		}
+		memcpy (v, r->data, 4);
+		r->data += 4;
+		*v = LittleFloat (*v);
+	}
+}
+
+static const char *pmrec_resultnames[PMREC_RESULTWORDS] = {
+	"origin[0]", "origin[1]", "origin[2]", "velocity[0]", "velocity[1]", "velocity[2]", "waterjumptime",
+	"onground", "groundent", "waterlevel", "watertype", "jump_held", "jump_msec", "numtouch", "touchindex[0]"
+};
+
+// Runs the moves from r, returns the number of moves or -1 if the file is bad
+static int CL_PmoveReplay (pmrecreader_t *r, cmodel_t *world, int *mismatches)
+{
+	int expected[PMREC_RESULTWORDS], result[PMREC_RESULTWORDS];
+	int flags, model, moves = 0, i, j;
+	float f;
+	physent_t *pe;
+
+	if (mismatches)
+		*mismatches = 0;
+
+	while (r->data < r->end) {
+		flags = CL_PmoveReadLong (r);
+
+		if (flags & PMREC_MOVEVARS) {
+			CL_PmoveReadFloats (r, &movevars.gravity, 12);
+			movevars.slidefix = CL_PmoveReadLong (r);
+			movevars.airstep = CL_PmoveReadLong (r);
+			movevars.pground = CL_PmoveReadLong (r);
+		}
+
+		if (flags & PMREC_PHYSENTS) {
+			pmove.numphysent = CL_PmoveReadLong (r);
+			if (pmove.numphysent < 1 || pmove.numphysent > MAX_PHYSENTS)
+				return -1;
+
+			for (i = 0, pe = pmove.physents; i < pmove.numphysent; i++, pe++) {
+				memset (pe, 0, sizeof(*pe));
+				model = CL_PmoveReadLong (r);
+				if (model < -1 || model >= CM_NumInlineModels ())
+					return -1;
+				pe->model = (model >= 0) ? world + model : NULL;
+				CL_PmoveReadFloats (r, pe->origin, 3);
+				CL_PmoveReadFloats (r, pe->mins, 3);
+				CL_PmoveReadFloats (r, pe->maxs, 3);
+			}
+		}
+
+		CL_PmoveReadFloats (r, pmove.origin, 3);
+		CL_PmoveReadFloats (r, pmove.velocity, 3);
+		pmove.jump_held = CL_PmoveReadLong (r);
+		pmove.jump_msec = CL_PmoveReadLong (r);
+		CL_PmoveReadFloats (r, &pmove.waterjumptime, 1);
+		pmove.pm_type = CL_PmoveReadLong (r);
+		pmove.onground = CL_PmoveReadLong (r);
+
+		memset (&pmove.cmd, 0, sizeof(pmove.cmd));
+		pmove.cmd.msec = CL_PmoveReadLong (r);
+		CL_PmoveReadFloats (r, pmove.cmd.angles, 3);
+		pmove.cmd.forwardmove = CL_PmoveReadLong (r);
+		pmove.cmd.sidemove = CL_PmoveReadLong (r);
+		pmove.cmd.upmove = CL_PmoveReadLong (r);
+		pmove.cmd.buttons = CL_PmoveReadLong (r);
+		pmove.cmd.impulse = CL_PmoveReadLong (r);
+		VectorCopy (pmove.cmd.angles, pmove.angles);
+
+		for (i = 0; i < PMREC_RESULTWORDS; i++) {
+			if (i < 7) {
+				CL_PmoveReadFloats (r, &f, 1);
+				memcpy (&expected[i], &f, sizeof(f));
+			}
+			else {
+				expected[i] = CL_PmoveReadLong (r);
+			}
+		}
+
+		if (r->overrun)
+			return -1;
+
+		PM_PlayerMove ();
+		CL_PmoveResultWords (result);
+
+		if (mismatches && memcmp (result, expected, sizeof(result))) {
+			for (j = 0; result[j] == expected[j]; j++)
+				;
+			if (++*mismatches <= 10)
+				Com_Printf ("move %i: %s differs\n", moves, pmrec_resultnames[j]);
+		}
+
+		moves++;
+	}
+
+	return moves;
+}
+
+static void CL_PmoveReplay_f (void)
+{
+	static playermove_t saved_pmove;
+	movevars_t saved_movevars;
+	char name[MAX_OSPATH], mapname[MAX_QPATH];
+	pmrecreader_t r;
+	cmodel_t *world;
+	byte *buf;
+	unsigned int checksum2;
+	int iterations, moves, mismatches, i;
+	double elapsed;
+	FILE *f;
+	long len;
+
+	if (Cmd_Argc() < 2) {
+		Com_Printf ("Usage: %s <filename> [iterations]\n", Cmd_Argv(0));
+		return;
+	}
+
+	iterations = (Cmd_Argc() > 2) ? max(1, atoi(Cmd_Argv(2))) : 1;
+
+	if (!CL_PmoveRecordPath (name, Cmd_Argv(1)))
+		return;
+
+	if (!(f = fopen (name, "rb"))) {
+		Com_Printf ("pmove_replay: couldn't open %s\n", name);
+		return;
+	}
+
+	fseek (f, 0, SEEK_END);
+	len = ftell (f);
+	fseek (f, 0, SEEK_SET);
+
+	if (len < 4 + MAX_QPATH) {
+		fclose (f);
+		Com_Printf ("pmove_replay: %s is not a move recording\n", name);
+		return;
+	}
+
+	buf = Q_malloc (len);
+	if (fread (buf, 1, len, f) != len || memcmp (buf, PMREC_MAGIC, 4)) {
+		fclose (f);
+		Q_free (buf);
+		Com_Printf ("pmove_replay: %s is not a move recording\n", name);
+		return;
+	}
+	fclose (f);
+
+	strlcpy (mapname, (char *) buf + 4, sizeof(mapname));
+
+	// the collision map can only be swapped while nothing uses it
+	if (strcmp (CM_MapName (), mapname)) {
+		if (cls.state != ca_disconnected) {
+			Com_Printf ("pmove_replay: recorded on %s, disconnect first\n", mapname);
+			Q_free (buf);
+			return;
+		}
+		CM_InvalidateMap ();
+	}
+	world = CM_LoadMap (mapname, true, NULL, &checksum2);
+
+	saved_pmove = pmove;
+	saved_movevars = movevars;
+
+	// check the results once, then just run the moves for timing
+	r.data = buf + 4 + MAX_QPATH;
+	r.end = buf + len;
+	r.overrun = false;
+	moves = CL_PmoveReplay (&r, world, &mismatches);
+
+	elapsed = Sys_DoubleTime ();
+	for (i = 0; i < iterations && moves > 0; i++) {
+		r.data = buf + 4 + MAX_QPATH;
+		r.overrun = false;
+		CL_PmoveReplay (&r, world, NULL);
+	}
+	elapsed = max(Sys_DoubleTime () - elapsed, 0.000001);
+
+	pmove = saved_pmove;
+	movevars = saved_movevars;
+	Q_free (buf);
+
+	if (moves < 0) {
+		Com_Printf ("pmove_replay: %s is damaged\n", name);
+		return;
+	}
+
+	Com_Printf ("pmove_replay: %s, %i moves, %i mismatches\n", mapname, moves, mismatches);
+	Com_Printf ("%.0f moves/sec\n", iterations * moves / elapsed);
+}
+
 void CL_PredictUsercmd (player_state_t *from, player_state_t *to, usercmd_t *u) {
 	// split up very long moves
 	if (u->msec > 50) {
@@ -73,8 +509,14 @@ void CL_PredictUsercmd (player_state_t *from, player_state_t *to, usercmd_t *u)
 	movevars.maxspeed = cl.maxspeed;
 	movevars.bunnyspeedcap = cl.bunnyspeedcap;
 
+	if (pmrec_file)
+		CL_PmoveRecordMove (false);
+
 	PM_PlayerMove();
 
+	if (pmrec_file)
+		CL_PmoveRecordMove (true);
+
 	to->waterjumptime = pmove.waterjumptime;
 	to->pm_type = pmove.pm_type;
 	to->jump_held = pmove.jump_held;
@@ -406,7 +848,71 @@ void CL_PredictMove (qbool physframe) {
 	
 }
 
+// Replays the usercmds still held in the frame buffer from the last player state
+// the server sent, with and without the physent broadphase, and reports the speed.
+static void CL_PmoveBenchmark_f (void)
+{
+	static playermove_t saved;
+	player_state_t start, from, to;
+	usercmd_t *cmds[UPDATE_BACKUP];
+	vec3_t endorigin[2];
+	double elapsed[2];
+	int numcmds, numphysent, iterations, pass, i, j;
+
+	if (cls.state != ca_active || !cl.validsequence) {
+		Com_Printf ("pmove_benchmark: not connected\n");
+		return;
+	}
+
+	iterations = (Cmd_Argc() > 1) ? max(1, atoi(Cmd_Argv(1))) : 100;
+
+	// oldest first
+	numcmds = 0;
+	for (i = max(1, cls.netchan.outgoing_sequence - UPDATE_BACKUP + 1); i < cls.netchan.outgoing_sequence; i++)
+		cmds[numcmds++] = &cl.frames[i & UPDATE_MASK].cmd;
+
+	if (!numcmds) {
+		Com_Printf ("pmove_benchmark: no usercmds recorded yet\n");
+		return;
+	}
+
+	start = cl.frames[cl.validsequence & UPDATE_MASK].playerstate[cl.playernum];
+
+	saved = pmove;
+	CL_SetSolidPlayers (cl.playernum);
+	numphysent = pmove.numphysent;
+
+	for (pass = 0; pass < 2; pass++) {
+		pm_nobroadphase = (pass == 1);
+		elapsed[pass] = Sys_DoubleTime ();
+
+		for (j = 0; j < iterations; j++) {
+			from = start;
+			for (i = 0; i < numcmds; i++) {
+				CL_PredictUsercmd (&from, &to, cmds[i]);
+				from = to;
+			}
+		}
+
+		elapsed[pass] = max(Sys_DoubleTime () - elapsed[pass], 0.000001);
+		VectorCopy (from.origin, endorigin[pass]);
+	}
+
+	pm_nobroadphase = false;
+	pmove = saved;
+
+	Com_Printf ("pmove_benchmark: %i moves, %i physents\n", iterations * numcmds, numphysent);
+	Com_Printf ("broadphase: %8.0f moves/sec\n", iterations * numcmds / elapsed[0]);
+	Com_Printf ("per trace:  %8.0f moves/sec\n", iterations * numcmds / elapsed[1]);
+	if (!VectorCompare (endorigin[0], endorigin[1]))
+		Com_Printf ("pmove_benchmark: results differ!\n");
+}
+
 void CL_InitPrediction (void) {
+	Cmd_AddCommand ("pmove_benchmark", CL_PmoveBenchmark_f);
+	Cmd_AddCommand ("pmove_record", CL_PmoveRecord_f);
+	Cmd_AddCommand ("pmove_replay", CL_PmoveReplay_f);
+
 	Cvar_SetCurrentGroup(CVAR_GROUP_NETWORK);
 	Cvar_Register(&cl_nopred);
 	Cvar_Register(&cl_pushlatency);
@@ -582,6 +582,7 @@ void SCR_DrawRam (void) {
 #ifdef EXPERIMENTAL_SHOW_ACCELERATION
 static void draw_accel_bar(int x, int y, int length, int charsize, int pos)
 {
+	Draw_FlushBatch();
 	glPushAttrib(GL_TEXTURE_BIT);
 	glDisable(GL_TEXTURE_2D);
 
@@ -1686,6 +1687,7 @@ static int SCR_Draw_TeamInfoPlayer(ti_player_t *ti_cl, int x, int y, int maxname
 										col[0] =   0; col[1] = 255; col[2] =   0; col[3] = 255;
 									}
 
+									Draw_FlushBatch();
 									glDisable (GL_TEXTURE_2D);
 									glColor4ub(col[0], col[1], col[2], col[3]);
 									glRectf(x, y, x + 3 * FONTWIDTH, y + 1 * FONTWIDTH);
@@ -1873,6 +1875,7 @@ static void SCR_Draw_TeamInfo(void)
 	if ( !slots_num )
 		return;
 
+	Draw_FlushBatch();
 	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 	glColor4f(1, 1, 1, 1);
 	glDisable(GL_ALPHA_TEST);
@@ -1909,6 +1912,8 @@ static void SCR_Draw_TeamInfo(void)
 		y += FONTWIDTH;
 	}
 
+	Draw_FlushBatch();
+
 	if (scale != 1)
 		glPopMatrix();
 
@@ -2053,6 +2058,7 @@ static void SCR_Draw_ShowNick(void)
 	maxname = 999;
 	maxname = bound(0, maxname, scr_shownick_name_width.integer);
 
+	Draw_FlushBatch();
 	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 	glColor4f(1, 1, 1, 1);
 	glDisable(GL_ALPHA_TEST);
@@ -2075,6 +2081,7 @@ static void SCR_Draw_ShowNick(void)
 
 	// draw frame
 	col = scr_shownick_frame_color.color;
+	Draw_FlushBatch();
 	glDisable (GL_TEXTURE_2D);
 	glColor4ub(col[0], col[1], col[2], col[3]);
 	glRectf(x, y, x + w * FONTWIDTH, y + h * FONTWIDTH);
@@ -2084,6 +2091,8 @@ static void SCR_Draw_ShowNick(void)
 	// draw shownick
 	SCR_Draw_TeamInfoPlayer(&shownick, x, y, maxname, maxloc, false, true);
 
+	Draw_FlushBatch();
+
 	if (scale != 1)
 		glPopMatrix();
 
@@ -3016,6 +3025,100 @@ void SCR_DrawMultiviewIndividualElements (void)
 	}
 }
 
+/*
+	draw_benchmark
+
+	Each frame the status bar, HUD, scoreboard and console are drawn once more with draw recording
+	on, so the pass costs no GL and its CPU time and output can be compared between runs.
+	Run it while a demo or timedemo is playing to get the same game state each time.
+*/
+static int		draw_benchmark_frames;		// frames left
+static int		draw_benchmark_total;
+static double	draw_benchmark_time;
+static double	draw_benchmark_max;
+static double	draw_benchmark_commands;
+static double	draw_benchmark_bytes;
+static unsigned int draw_benchmark_checksum;
+static double	draw_benchmark_quads;		// batched by the frames drawn normally
+static double	draw_benchmark_flushes;
+
+static void SCR_DrawBenchmark_f (void)
+{
+	int quads, flushes;
+
+	if (Cmd_Argc() > 2)
+	{
+		Com_Printf("Usage: %s [frames]\n", Cmd_Argv(0));
+		return;
+	}
+
+	if (draw_benchmark_frames)
+	{
+		Com_Printf("Draw benchmark: %d of %d frames left\n", draw_benchmark_frames, draw_benchmark_total);
+		return;
+	}
+
+	draw_benchmark_total = draw_benchmark_frames = bound(1, (Cmd_Argc() == 2 ? Q_atoi(Cmd_Argv(1)) : 100), 100000);
+	draw_benchmark_time = draw_benchmark_max = 0;
+	draw_benchmark_commands = draw_benchmark_bytes = 0;
+	draw_benchmark_checksum = 0;
+	draw_benchmark_quads = draw_benchmark_flushes = 0;
+	Draw_BatchStats(&quads, &flushes);
+	Com_Printf("Recording the 2D pass over %d frames\n", draw_benchmark_total);
+}
+
+static void SCR_DrawBenchmarkFrame (void)
+{
+	extern qbool sb_showscores;
+	qbool showscores = sb_showscores;
+	unsigned int checksum;
+	double start, time;
+	int commands, bytes, quads, flushes;
+
+	if (!draw_benchmark_frames)
+		return;
+
+	// Everything drawn since the last benchmark frame, so one whole frame.
+	Draw_BatchStats(&quads, &flushes);
+	draw_benchmark_quads += quads;
+	draw_benchmark_flushes += flushes;
+
+	// Let the HUD draw a second time this frame.
+	host_screenupdatecount++;
+
+	start = Sys_DoubleTime();
+	Draw_RecordStart();
+
+	Sbar_Changed();
+	Sbar_Draw();
+	HUD_Draw();
+
+	sb_showscores = true;
+	Sbar_Draw();
+	sb_showscores = showscores;
+
+	Con_DrawConsole(vid.height / 2);
+	Con_DrawNotify();
+
+	commands = Draw_RecordStop(&bytes, &checksum);
+	time = Sys_DoubleTime() - start;
+
+	draw_benchmark_time += time;
+	draw_benchmark_max = max(draw_benchmark_max, time);
+	draw_benchmark_commands += commands;
+	draw_benchmark_bytes += bytes;
+	draw_benchmark_checksum = draw_benchmark_checksum * 31 + checksum;
+
+	if (--draw_benchmark_frames)
+		return;
+
+	Com_Printf("Draw benchmark, %d frames:\n", draw_benchmark_total);
+	Com_Printf("  cpu      %.3f ms mean, %.3f ms max\n", 1000 * draw_benchmark_time / draw_benchmark_total, 1000 * draw_benchmark_max);
+	Com_Printf("  commands %.0f per frame, %.0f bytes\n", draw_benchmark_commands / draw_benchmark_total, draw_benchmark_bytes / draw_benchmark_total);
+	Com_Printf("  batching %.0f quads in %.1f draw calls per frame\n", draw_benchmark_quads / draw_benchmark_total, draw_benchmark_flushes / draw_benchmark_total);
+	Com_Printf("  checksum %08x\n", draw_benchmark_checksum);
+}
+
 static void SCR_DrawElements(void) 
 {
 	extern qbool  sb_showscores,  sb_showteamscores;
@@ -3125,6 +3228,10 @@ static void SCR_DrawElements(void)
 
 		SCR_DrawCursor();
 	}
+
+	SCR_DrawBenchmarkFrame();
+
+	Draw_FlushBatch();
 }
 
 /******************************* UPDATE SCREEN *******************************/
@@ -3235,6 +3342,9 @@ void SCR_UpdateScreenPlayerView (int flags)
 	if (flags & UPDATESCREEN_MULTIVIEW) {
 		SCR_DrawMultiviewIndividualElements ();
 	}
+
+	// The next view draws 3D over this one.
+	Draw_FlushBatch();
 }
 
 void SCR_HUD_WeaponStats(hud_t* hud);
@@ -3920,6 +4030,7 @@ void SCR_Init (void)
 
 	Cvar_ResetCurrentGroup();
 
+	Cmd_AddCommand ("draw_benchmark", SCR_DrawBenchmark_f);
 	Cmd_AddCommand ("screenshot", SCR_ScreenShot_f);
 	Cmd_AddCommand ("sizeup", SCR_SizeUp_f);
 	Cmd_AddCommand ("sizedown", SCR_SizeDown_f);
@@ -749,6 +749,7 @@ void CL_CheckQizmoCompletion(void);
 void CL_Demo_Jump(double seconds, int relative, demoseekingtype_t seeking);
 void CL_Demo_Init(void);
 void CL_Demo_Jump_Status_Check (void);
+qbool CL_Demo_Jump_Status_Match (demoseekingstatus_condition_t *condition, int *stats);
 void CL_Demo_Check_For_Rewind(float nextdemotime);
 void CL_Demo_Stop_Rewinding(void);
 double Demo_GetSpeed(void);
@@ -756,6 +757,7 @@ void Demo_AdjustSpeed(void);
 qbool CL_IsDemoExtension(const char *filename);
 qbool CL_Demo_SkipMessage(qbool skip_if_seeking);
 qbool CL_Demo_NotForTrackedPlayer(void);
+int CL_Demo_Underruns(qbool *waiting);
 
 void CL_AutoRecord_StopMatch(void);
 void CL_AutoRecord_CancelMatch(void);
@@ -766,6 +768,15 @@ void CL_AutoRecord_SaveMatch(void);
 extern double demostarttime;
 extern double nextdemotime, olddemotime;
 
+// cl_demo_timeline.c
+void CL_DemoTimeline_Init (void);
+void CL_DemoTimeline_Start (const char *demoname, double length);
+void CL_DemoTimeline_Stop (void);
+void CL_DemoTimeline_Rewind (void);
+void CL_DemoTimeline_Packet (double time);
+void CL_DemoTimeline_Stat (int player, int stat, int old_value, int value);
+qbool CL_DemoTimeline_Find (demoseekingstatus_condition_t *conditions, int player, int *stats, double from, double *time);
+
 // cl_parse.c
 #define NET_TIMINGS 256
 #define NET_TIMINGSMASK 255
@@ -887,7 +898,11 @@ extern struct model_s *cl_flame0_model;
 
 void CL_InitEnts(void);
 void CL_AddEntity (entity_t *ent);
+void CL_AddRenderEntity (entity_t *ent);
 void CL_ClearScene (void) ;
+void CL_SceneWait (void);
+void CL_FinishScene (void);
+void CL_StartMultiviewScene (void);
 void CL_AddParticleTrail(entity_t* ent, centity_t* cent, vec3_t* old_origin, customlight_t* cst_lt, entity_state_t *state);
 
 dlighttype_t dlightColor(float f, dlighttype_t def, qbool random);
@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "common.h"
 #include "cvar.h"
 #endif
+#include "fs.h"
 
 typedef struct cnode_s {
 	// common with leaf
@@ -89,6 +90,31 @@ HULL BOXES
 static hull_t		box_hull;
 static mclipnode_t	box_clipnodes[6];
 static mplane_t		box_planes[6];
+static chullnode_t	box_nodes[6];
+
+/*
+** CM_PackHullNodes
+**
+** Fold the plane of each clipnode into a chullnode_t.
+*/
+static void CM_PackHullNodes (chullnode_t *out, const mclipnode_t *in, const mplane_t *planes, int count, int maxplanes)
+{
+	const mplane_t *plane;
+	int i;
+
+	for (i = 0; i < count; i++, in++, out++) {
+		if (in->planenum < 0 || in->planenum >= maxplanes)
+			Host_Error ("CM_LoadMap: bad planenum");
+
+		plane = planes + in->planenum;
+		VectorCopy (plane->normal, out->normal);
+		out->dist = plane->dist;
+		out->type = plane->type;
+		out->children[0] = in->children[0];
+		out->children[1] = in->children[1];
+		out->pad = 0;
+	}
+}
 
 /*
 ** CM_InitBoxHull
@@ -102,6 +128,7 @@ static void CM_InitBoxHull(void)
 
 	box_hull.clipnodes = box_clipnodes;
 	box_hull.planes = box_planes;
+	box_hull.nodes = box_nodes;
 	box_hull.firstclipnode = 0;
 	box_hull.lastclipnode = 5;
 
@@ -113,6 +140,8 @@ static void CM_InitBoxHull(void)
 		box_planes[i].type = i >> 1;
 		box_planes[i].normal[i >> 1] = 1;
 	}
+
+	CM_PackHullNodes (box_nodes, box_clipnodes, box_planes, 6, 6);
 }
 
 /*
@@ -123,20 +152,93 @@ static void CM_InitBoxHull(void)
 */
 hull_t *CM_HullForBox (vec3_t mins, vec3_t maxs)
 {
-	box_planes[0].dist = maxs[0];
-	box_planes[1].dist = mins[0];
-	box_planes[2].dist = maxs[1];
-	box_planes[3].dist = mins[1];
-	box_planes[4].dist = maxs[2];
-	box_planes[5].dist = mins[2];
+	box_planes[0].dist = box_nodes[0].dist = maxs[0];
+	box_planes[1].dist = box_nodes[1].dist = mins[0];
+	box_planes[2].dist = box_nodes[2].dist = maxs[1];
+	box_planes[3].dist = box_nodes[3].dist = mins[1];
+	box_planes[4].dist = box_nodes[4].dist = maxs[2];
+	box_planes[5].dist = box_nodes[5].dist = mins[2];
 
 	return &box_hull;
 }
 
-int CM_HullPointContents(hull_t *hull, int num, vec3_t p)
+/*
+** CM_SetBoxHull
+**
+** Same as CM_HullForBox, but the box goes into storage owned by the caller,
+** so any number of boxes can be kept around at once.
+*/
+hull_t *CM_SetBoxHull (cboxhull_t *box, vec3_t mins, vec3_t maxs)
 {
-	mclipnode_t *node;
-	mplane_t *plane;
+	hull_t *hull = &box->hull;
+	int i;
+
+	hull->clipnodes = box_clipnodes;
+	hull->planes = box->planes;
+	hull->nodes = box->nodes;
+	hull->firstclipnode = 0;
+	hull->lastclipnode = 5;
+	VectorClear (hull->clip_mins);
+	VectorClear (hull->clip_maxs);
+
+	memset (box->planes, 0, sizeof(box->planes));
+	for (i = 0; i < 6; i++) {
+		box->planes[i].type = i >> 1;
+		box->planes[i].normal[i >> 1] = 1;
+		box->planes[i].dist = (i & 1) ? mins[i >> 1] : maxs[i >> 1];
+	}
+	CM_PackHullNodes (box->nodes, box_clipnodes, box->planes, 6, 6);
+
+	return hull;
+}
+
+/*
+===============================================================================
+
+POINT CONTENTS
+
+===============================================================================
+*/
+
+static chullnode_t	*map_hullnodes;		// for map_clipnodes, hulls 1 and up
+static chullnode_t	*map_hull0nodes;	// for the clipnodes CM_MakeHull0 builds
+
+// remembers recent point contents in the map hulls, which never move;
+// entities check the same spot several times a frame (water level, ground, stuck tests)
+#define	POINTCACHE_SIZE		1024	// must be a power of two
+
+typedef struct {
+	const chullnode_t	*nodes;
+	int					num;
+	vec3_t				p;
+	int					contents;
+} pointcache_t;
+
+static pointcache_t	pointcache[POINTCACHE_SIZE];
+static int			pointcache_hits, pointcache_misses;
+
+cvar_t	cm_pointcache = {"cm_pointcache", "0"};
+
+static void CM_ClearPointCache (void)
+{
+	memset (pointcache, 0, sizeof(pointcache));
+	pointcache_hits = pointcache_misses = 0;
+}
+
+static pointcache_t *CM_PointCacheSlot (int num, const vec3_t p)
+{
+	unsigned int bits[3], h;
+
+	memcpy (bits, p, sizeof(bits));
+	h = bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u ^ (unsigned int)num * 2654435761u;
+	h ^= h >> 16;
+
+	return &pointcache[h & (POINTCACHE_SIZE - 1)];
+}
+
+static int CM_WalkHull (const hull_t *hull, int num, const vec3_t p)
+{
+	const chullnode_t *node;
 	float d;
 
 	while (num >= 0) {
@@ -147,16 +249,41 @@ int CM_HullPointContents(hull_t *hull, int num, vec3_t p)
 			Sys_Error("CM_HullPointContents: bad node number");
 		}
 
-		node = hull->clipnodes + num;
-		plane = hull->planes + node->planenum;
+		node = hull->nodes + num;
 
-		d = PlaneDiff(p, plane);
+		d = PlaneDiff (p, node);
 		num = (d < 0) ? node->children[1] : node->children[0];
 	}
 
 	return num;
 }
 
+int CM_HullPointContents(hull_t *hull, int num, vec3_t p)
+{
+	pointcache_t *slot;
+	int contents;
+
+	// box hulls get new planes all the time, only map hulls can be remembered
+	if (!cm_pointcache.integer || !hull->nodes || (hull->nodes != map_hullnodes && hull->nodes != map_hull0nodes))
+		return CM_WalkHull (hull, num, p);
+
+	slot = CM_PointCacheSlot (num, p);
+	if (slot->nodes == hull->nodes && slot->num == num && VectorCompare (slot->p, p)) {
+		pointcache_hits++;
+		return slot->contents;
+	}
+
+	contents = CM_WalkHull (hull, num, p);
+
+	slot->nodes = hull->nodes;
+	slot->num = num;
+	VectorCopy (p, slot->p);
+	slot->contents = contents;
+	pointcache_misses++;
+
+	return contents;
+}
+
 /*
 ===============================================================================
 
@@ -170,136 +297,190 @@ LINE TESTING IN HULLS
 
 enum { TR_EMPTY, TR_SOLID, TR_BLOCKED };
 
+// nodes that split the line wait here while their near side is traced;
+// deeper than this is finished by a nested call
+#define	HULLTRACE_STACK		128
+
+typedef struct {
+	const chullnode_t	*node;
+	float		t1, t2;
+	float		p1f, p2f, midf;
+	vec3_t		p1, p2, mid;
+	int			nearside;
+	int			oldcheck;
+	qbool		farside;		// near side done, far side being traced
+} hulltrace_frame_t;
+
 typedef struct {
 	hull_t *hull;
 	trace_t	trace;
 	int leafcount;
 } hulltrace_local_t;
 
-//====================
-int RecursiveHullTrace (hulltrace_local_t *htl, int num, float p1f, float p2f, const vec3_t p1, const vec3_t p2)
+/*
+** HullTrace
+**
+** Walks the line down the hull with an explicit stack. Gives the same answers
+** as the old recursive version, front side first, then the far side of every
+** node that splits the line.
+*/
+static int HullTrace (hulltrace_local_t *htl, int num, float p1f, float p2f, const vec3_t p1, const vec3_t p2)
 {
-	mplane_t	*plane;
-	float		t1, t2;
-	mclipnode_t *node;
+	hulltrace_frame_t	stack[HULLTRACE_STACK], *f;
+	const chullnode_t	*node;
+	hull_t		*hull = htl->hull;
+	trace_t		*trace = &htl->trace;
+	int			depth = 0;
+	int			check;
 	int			i;
-	int			nearside;
-	float		frac, midf;
-	vec3_t		mid;
-	int			check, oldcheck;
-	hull_t *hull = htl->hull;
-	trace_t *trace = &htl->trace;
-
-start:
-	if (num < 0) {
-		// this is a leaf node
-		htl->leafcount++;
-		if (num == CONTENTS_SOLID) {
-			if (htl->leafcount == 1)
-				trace->startsolid = true;
-			return TR_SOLID;
-		}
-		else {
-			if (num == CONTENTS_EMPTY)
-				trace->inopen = true;
-			else
-				trace->inwater = true;
-			return TR_EMPTY;
+	float		t1, t2, frac;
+	float		sp1f = p1f, sp2f = p2f;	// the segment being walked
+	vec3_t		sp1, sp2;
+
+	VectorCopy (p1, sp1);
+	VectorCopy (p2, sp2);
+
+descend:
+	while (num >= 0) {
+		// FIXME, check at load time
+		if (num < hull->firstclipnode || num > hull->lastclipnode) {
+			if (map_halflife && num == hull->lastclipnode + 1) {
+				check = TR_EMPTY;
+				goto ascend;
+			}
+			Sys_Error ("HullTrace: bad node number");
 		}
-	}
 
-	// FIXME, check at load time
-	if (num < hull->firstclipnode || num > hull->lastclipnode)
-	{
-		if (map_halflife && num == hull->lastclipnode + 1)
-			return TR_EMPTY;
-		Sys_Error ("RecursiveHullTrace: bad node number");
-	}
+		node = hull->nodes + num;
 
-	node = hull->clipnodes + num;
+		//
+		// find the point distances
+		//
+		t1 = PlaneDiff (sp1, node);
+		t2 = PlaneDiff (sp2, node);
 
-	//
-	// find the point distances
-	//
-	plane = hull->planes + node->planenum;
+		// see which sides we need to consider
+		if (t1 >= 0 && t2 >= 0) {
+			num = node->children[0];	// go down the front side
+			continue;
+		}
+		if (t1 < 0 && t2 < 0) {
+			num = node->children[1];	// go down the back side
+			continue;
+		}
 
-	if (plane->type < 3) {
-		t1 = p1[plane->type] - plane->dist;
-		t2 = p2[plane->type] - plane->dist;
-	}
-	else {
-		t1 = DotProduct (plane->normal, p1) - plane->dist;
-		t2 = DotProduct (plane->normal, p2) - plane->dist;
-	}
+		if (depth == HULLTRACE_STACK) {
+			check = HullTrace (htl, num, sp1f, sp2f, sp1, sp2);
+			goto ascend;
+		}
 
-	// see which sides we need to consider
-	if (t1 >= 0 && t2 >= 0) {
-		num = node->children[0];	// go down the front side
-		goto start;
-	}
-	if (t1 < 0 && t2 < 0) {
-		num = node->children[1];	// go down the back side
-		goto start;
+		f = &stack[depth++];
+		f->node = node;
+		f->t1 = t1;
+		f->t2 = t2;
+		f->p1f = sp1f;
+		f->p2f = sp2f;
+		VectorCopy (sp1, f->p1);
+		VectorCopy (sp2, f->p2);
+		f->farside = false;
+
+		// find the intersection point
+		frac = t1 / (t1 - t2);
+		frac = bound (0, frac, 1);
+		f->midf = sp1f + (sp2f - sp1f)*frac;
+		for (i = 0; i < 3; i++)
+			f->mid[i] = sp1[i] + frac*(sp2[i] - sp1[i]);
+
+		// move up to the node
+		f->nearside = (t1 < t2) ? 1 : 0;
+		num = node->children[f->nearside];
+		sp2f = f->midf;
+		VectorCopy (f->mid, sp2);
 	}
 
-	// find the intersection point
-	frac = t1 / (t1 - t2);
-	frac = bound (0, frac, 1);
-	midf = p1f + (p2f - p1f)*frac;
-	for (i = 0; i < 3; i++)
-		mid[i] = p1[i] + frac*(p2[i] - p1[i]);
-
-	// move up to the node
-	nearside = (t1 < t2) ? 1 : 0;
-	check = RecursiveHullTrace (htl, node->children[nearside], p1f, midf, p1, mid);
-	if (check == TR_BLOCKED)
-		return check;
-
-	// if we started in solid, allow us to move out to an empty area
-	if (check == TR_SOLID && (trace->inopen || trace->inwater))
-		return check;
-	oldcheck = check;
-
-	// go past the node
-	check = RecursiveHullTrace (htl, node->children[1 - nearside], midf, p2f, mid, p2);
-	if (check == TR_EMPTY || check == TR_BLOCKED)
-		return check;
-
-	if (oldcheck != TR_EMPTY)
-		return check;	// still in solid
-
-	// near side is empty, far side is solid
-	// this is the impact point
-	if (!nearside) {
-		VectorCopy (plane->normal, trace->plane.normal);
-		trace->plane.dist = plane->dist;
+	// this is a leaf node
+	htl->leafcount++;
+	if (num == CONTENTS_SOLID) {
+		if (htl->leafcount == 1)
+			trace->startsolid = true;
+		check = TR_SOLID;
 	}
 	else {
-		VectorNegate (plane->normal, trace->plane.normal);
-		trace->plane.dist = -plane->dist;
+		if (num == CONTENTS_EMPTY)
+			trace->inopen = true;
+		else
+			trace->inwater = true;
+		check = TR_EMPTY;
 	}
 
-	// put the final point DIST_EPSILON pixels on the near side
-	if (t1 < t2)
-		frac = (t1 + DIST_EPSILON) / (t1 - t2);
-	else
-		frac = (t1 - DIST_EPSILON) / (t1 - t2);
-	frac = bound (0, frac, 1);
-	midf = p1f + (p2f - p1f)*frac;
-	for (i = 0; i < 3; i++)
-		mid[i] = p1[i] + frac*(p2[i] - p1[i]);
+ascend:
+	while (depth > 0) {
+		f = &stack[depth - 1];
 
-	trace->fraction = midf;
-	VectorCopy (mid, trace->endpos);
+		if (!f->farside) {
+			if (check == TR_BLOCKED) {
+				depth--;
+				continue;
+			}
 
-	return TR_BLOCKED;
+			// if we started in solid, allow us to move out to an empty area
+			if (check == TR_SOLID && (trace->inopen || trace->inwater)) {
+				depth--;
+				continue;
+			}
+
+			// go past the node
+			f->oldcheck = check;
+			f->farside = true;
+			num = f->node->children[1 - f->nearside];
+			sp1f = f->midf;
+			sp2f = f->p2f;
+			VectorCopy (f->mid, sp1);
+			VectorCopy (f->p2, sp2);
+			goto descend;
+		}
+
+		depth--;
+
+		if (check == TR_EMPTY || check == TR_BLOCKED)
+			continue;
+
+		if (f->oldcheck != TR_EMPTY)
+			continue;	// still in solid
+
+		// near side is empty, far side is solid
+		// this is the impact point
+		node = f->node;
+		if (!f->nearside) {
+			VectorCopy (node->normal, trace->plane.normal);
+			trace->plane.dist = node->dist;
+		}
+		else {
+			VectorNegate (node->normal, trace->plane.normal);
+			trace->plane.dist = -node->dist;
+		}
+
+		// put the final point DIST_EPSILON pixels on the near side
+		if (f->t1 < f->t2)
+			frac = (f->t1 + DIST_EPSILON) / (f->t1 - f->t2);
+		else
+			frac = (f->t1 - DIST_EPSILON) / (f->t1 - f->t2);
+		frac = bound (0, frac, 1);
+		trace->fraction = f->p1f + (f->p2f - f->p1f)*frac;
+		for (i = 0; i < 3; i++)
+			trace->endpos[i] = f->p1[i] + frac*(f->p2[i] - f->p1[i]);
+
+		check = TR_BLOCKED;
+	}
+
+	return check;
 }
 
 trace_t CM_HullTrace (hull_t *hull, vec3_t start, vec3_t end)
 {
 	int check;
 
-	// this structure is passed as a pointer to RecursiveHullTrace
+	// this structure is passed as a pointer to HullTrace
 	// so as not to use much stack but still be thread safe
 	hulltrace_local_t htl;
 	htl.hull = hull;
@@ -310,7 +491,7 @@ trace_t CM_HullTrace (hull_t *hull, vec3_t start, vec3_t end)
 	htl.trace.startsolid = false;
 	VectorCopy (end, htl.trace.endpos);
 
-	check = RecursiveHullTrace (&htl, hull->firstclipnode, 0, 1, start, end);
+	check = HullTrace (&htl, hull->firstclipnode, 0, 1, start, end);
 
 	if (check == TR_SOLID) {
 		htl.trace.startsolid = htl.trace.allsolid = true;
@@ -331,6 +512,12 @@ int	CM_NumInlineModels (void)
 	return numcmodels;
 }
 
+// name of the loaded map, empty if none
+char *CM_MapName (void)
+{
+	return map_name;
+}
+
 char *CM_EntityString (void)
 {
 	return map_entitystring;
@@ -906,6 +1093,33 @@ static void CM_MakeHull0(void)
 	}
 }
 
+/*
+=================
+CM_MakeHullNodes
+
+Pack the clipnodes of all hulls together with their planes
+=================
+*/
+static void CM_MakeHullNodes(void)
+{
+	int i, j;
+
+	map_hullnodes = (chullnode_t *)Hunk_AllocName(numclipnodes * sizeof(chullnode_t), loadname);
+	CM_PackHullNodes(map_hullnodes, map_clipnodes, map_planes, numclipnodes, numplanes);
+
+	map_hull0nodes = (chullnode_t *)Hunk_AllocName(numnodes * sizeof(chullnode_t), loadname);
+	CM_PackHullNodes(map_hull0nodes, map_cmodels[0].hulls[0].clipnodes, map_planes, numnodes, numplanes);
+
+	for (i = 0; i < numcmodels; i++) {
+		map_cmodels[i].hulls[0].nodes = map_hull0nodes;
+		for (j = 1; j < MAX_MAP_HULLS; j++) {
+			map_cmodels[i].hulls[j].nodes = map_hullnodes;
+		}
+	}
+
+	CM_ClearPointCache();
+}
+
 /*
 =================
 CM_LoadPlanes
@@ -1133,10 +1347,14 @@ void CM_InvalidateMap (void)
 	map_planes = NULL;
 	map_nodes = NULL;
 	map_clipnodes = NULL;
+	map_hullnodes = NULL;
+	map_hull0nodes = NULL;
 	map_leafs = NULL;
 	map_pvs = NULL;
 	map_phs = NULL;
 	map_entitystring = NULL;
+
+	CM_ClearPointCache ();
 }
 
 /*
@@ -1151,7 +1369,9 @@ cmodel_t *CM_LoadMap (char *name, qbool clientload, unsigned *checksum, unsigned
 
 	unsigned int i;
 	dheader_t *header;
-	unsigned int *buf;
+	dheader_t header_swapped;
+	fs_mappedfile_t mapped;
+	const byte *buf;
 	unsigned int *padded_buf = NULL;
 	BuildPVSFunction cm_load_pvs_func = CM_BuildPVS;
 	qbool pad_lumps = false;
@@ -1167,14 +1387,18 @@ cmodel_t *CM_LoadMap (char *name, qbool clientload, unsigned *checksum, unsigned
 		return &map_cmodels[0]; // still have the right version
 	}
 
-	// load the file
-	buf = (unsigned int *) FS_LoadTempFile (name, &filelen);
-	if (!buf)
+	// load the file, the view is read-only when it comes from a pak
+	if (!FS_MapFile (name, &mapped))
 		Host_Error ("CM_LoadMap: %s not found", name);
+	buf = mapped.data;
+	filelen = mapped.len;
+	if (filelen < sizeof(dheader_t))
+		Host_Error ("CM_LoadMap: %s is truncated", name);
 
 	COM_FileBase (name, loadname);
 
-	header = (dheader_t *)buf;
+	memcpy(&header_swapped, buf, sizeof(header_swapped));
+	header = &header_swapped;
 
 	i = LittleLong (header->version);
 	if (i != Q1_BSPVERSION && i != HL_BSPVERSION && i != Q1_BSPVERSION2 && i != Q1_BSPVERSION29a)
@@ -1192,7 +1416,8 @@ cmodel_t *CM_LoadMap (char *name, qbool clientload, unsigned *checksum, unsigned
 		((int *)header)[i] = LittleLong(((int *)header)[i]);
 	}
 
-	// Align the lumps
+	// Align the lumps, a mapped file inside a pak may start at any offset
+	pad_lumps = ((uintptr_t)buf % 4) != 0;
 	for (i = 0; i < HEADER_LUMPS; ++i) {
 		pad_lumps |= (header->lumps[i].fileofs % 4) != 0;
 
@@ -1212,8 +1437,7 @@ cmodel_t *CM_LoadMap (char *name, qbool clientload, unsigned *checksum, unsigned
 		padded_buf = Q_malloc(required_size);
 
 		// Copy header
-		memcpy(padded_buf, buf, sizeof(dheader_t));
-		header = (dheader_t*)padded_buf;
+		memcpy(padded_buf, header, sizeof(dheader_t));
 		position += sizeof(dheader_t);
 
 		// Copy lumps: align on 4-byte boundary
@@ -1224,17 +1448,17 @@ cmodel_t *CM_LoadMap (char *name, qbool clientload, unsigned *checksum, unsigned
 			if (position + header->lumps[i].filelen > required_size) {
 				Host_Error("CM_LoadMap: %s caused error while aligning lumps", name);
 			}
-			memcpy((byte*)padded_buf + position, ((byte*)buf) + header->lumps[i].fileofs, header->lumps[i].filelen);
+			memcpy((byte*)padded_buf + position, buf + header->lumps[i].fileofs, header->lumps[i].filelen);
 			header->lumps[i].fileofs = position;
 
 			position += header->lumps[i].filelen;
 		}
 
 		// Use the new buffer
-		buf = padded_buf;
+		buf = (byte *)padded_buf;
 	}
 
-	cmod_base = (byte *)header;
+	cmod_base = (byte *)buf;
 
 	// checksum all of the map, except for entities
 	map_checksum = map_checksum2 = 0;
@@ -1275,6 +1499,7 @@ cmodel_t *CM_LoadMap (char *name, qbool clientload, unsigned *checksum, unsigned
 	CM_LoadSubmodels (&header->lumps[LUMP_MODELS]);
 
 	CM_MakeHull0 ();
+	CM_MakeHullNodes ();
 
 	cm_load_pvs_func (&header->lumps[LUMP_VISIBILITY], &header->lumps[LUMP_LEAFS]);
 
@@ -1284,6 +1509,7 @@ cmodel_t *CM_LoadMap (char *name, qbool clientload, unsigned *checksum, unsigned
 	strlcpy (map_name, name, sizeof(map_name));
 
 	Q_free(padded_buf);
+	FS_UnmapFile(&mapped);
 
 	return &map_cmodels[0];
 }
@@ -1302,8 +1528,83 @@ cmodel_t *CM_InlineModel (char *name)
 	return &map_cmodels[num];
 }
 
+/*
+** CM_TraceBench_f
+**
+** Times hull traces and point contents over the loaded map. The lines are
+** short hops from random points inside the world, like movement and
+** visibility checks, and the same seed is used every run.
+*/
+static void CM_TraceBench_f (void)
+{
+	cmodel_t *world = &map_cmodels[0];
+	unsigned int seed = 0x2545f491;
+	int i, j, count, hits, hull;
+	vec3_t *starts, *ends;
+	double start, elapsed;
+	float total;
+	trace_t trace;
+
+	if (!map_name[0]) {
+		Com_Printf ("cm_tracebench: no map loaded\n");
+		return;
+	}
+
+	count = (Cmd_Argc() > 1) ? atoi (Cmd_Argv(1)) : 100000;
+	count = bound (1, count, 10000000);
+
+	starts = (vec3_t *)Q_malloc (count * sizeof(vec3_t));
+	ends = (vec3_t *)Q_malloc (count * sizeof(vec3_t));
+
+	for (i = 0; i < count; i++) {
+		for (j = 0; j < 3; j++) {
+			seed = seed * 1664525 + 1013904223;
+			starts[i][j] = world->mins[j] + (world->maxs[j] - world->mins[j]) * ((seed >> 8) / 16777216.0f);
+			seed = seed * 1664525 + 1013904223;
+			ends[i][j] = starts[i][j] + ((int)(seed >> 23) - 256);
+		}
+	}
+
+	Com_Printf ("cm_tracebench: %s, %d lines\n", map_name, count);
+
+	for (hull = 0; hull < 3; hull++) {
+		total = 0;
+		hits = 0;
+		start = Sys_DoubleTime ();
+		for (i = 0; i < count; i++) {
+			trace = CM_HullTrace (&world->hulls[hull], starts[i], ends[i]);
+			total += trace.fraction;
+			hits += (trace.fraction < 1);
+		}
+		elapsed = Sys_DoubleTime () - start;
+		Com_Printf ("  hull %d traces: %.0f/sec, %d hit, mean fraction %.3f\n", hull,
+			count / max(elapsed, 0.000001), hits, total / count);
+	}
+
+	// each point is asked about a few times over, which is what the memo is for
+	CM_ClearPointCache ();
+	hits = 0;
+	start = Sys_DoubleTime ();
+	for (j = 0; j < 4; j++) {
+		for (i = 0; i < count; i++) {
+			hits += (CM_HullPointContents (&world->hulls[0], world->hulls[0].firstclipnode, starts[i]) == CONTENTS_SOLID);
+		}
+	}
+	elapsed = Sys_DoubleTime () - start;
+	Com_Printf ("  point contents: %.0f/sec, %d solid", 4 * count / max(elapsed, 0.000001), hits / 4);
+	if (cm_pointcache.integer)
+		Com_Printf (", memo %d hits %d misses", pointcache_hits, pointcache_misses);
+	Com_Printf ("\n");
+
+	Q_free (starts);
+	Q_free (ends);
+}
+
 void CM_Init (void)
 {
 	memset (map_novis, 0xff, sizeof(map_novis));
 	CM_InitBoxHull ();
+
+	Cvar_Register (&cm_pointcache);
+	Cmd_AddCommand ("cm_tracebench", CM_TraceBench_f);
 }
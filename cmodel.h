@@ -41,10 +41,19 @@ typedef struct mplane_s {
 	byte	pad[2];
 } mplane_t;
 
-// !!! if this is changed, it must be changed in asm_i386.h too !!!
+// a clipnode with its plane folded in, so a hull walk reads one record per node
+typedef struct {
+	vec3_t	normal;
+	float	dist;
+	int		type;
+	int		children[2];	// negative numbers are contents
+	int		pad;
+} chullnode_t;
+
 typedef struct {
 	mclipnode_t	*clipnodes;
 	mplane_t	*planes;
+	chullnode_t	*nodes;			// same indexing as clipnodes, what the traces actually walk
 	int			firstclipnode;
 	int			lastclipnode;
 	vec3_t		clip_mins;
@@ -75,7 +84,15 @@ typedef struct {
 	hull_t	hulls[MAX_MAP_HULLS];
 } cmodel_t;
 
+// storage for a box hull that outlives the next CM_HullForBox call
+typedef struct {
+	hull_t		hull;
+	mplane_t	planes[6];
+	chullnode_t	nodes[6];
+} cboxhull_t;
+
 hull_t *CM_HullForBox (vec3_t mins, vec3_t maxs);
+hull_t *CM_SetBoxHull (cboxhull_t *box, vec3_t mins, vec3_t maxs);
 int CM_HullPointContents (hull_t *hull, int num, vec3_t p);
 trace_t CM_HullTrace (hull_t *hull, vec3_t start, vec3_t end);
 struct cleaf_s *CM_PointInLeaf (const vec3_t p);
@@ -87,6 +104,7 @@ byte *CM_FatPVS (vec3_t org);
 int CM_FindTouchedLeafs (const vec3_t mins, const vec3_t maxs, int leafs[], int maxleafs, int headnode, int *topnode);
 char *CM_EntityString (void);
 int CM_NumInlineModels (void);
+char *CM_MapName (void);
 cmodel_t *CM_InlineModel (char *name);
 void CM_InvalidateMap (void);
 cmodel_t *CM_LoadMap (char *name, qbool clientload, unsigned *checksum, unsigned *checksum2);
@@ -44,6 +44,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define     DEFAULT_CONBUFSIZE     (1 << 16)
 #define     MAXIMUM_CONBUFSIZE     (1 << 22)
 #define     MAX_NOTIFICATION_TIME  10
+#define     CON_MAXLINELEN         1024	// longer lines are broken up into several
+#define     CON_LOG_BUFFER_SIZE    (64 * 1024)
+
+#define     CON_LINE(i)            (&con.lines[(i) & (con.maxlines - 1)])
+#define     CON_CHAR(i)            con.text[(i) & (con.maxsize - 1)]
+#define     CON_RUN(i)             con.runs[(i) & (con.maxruns - 1)]
 
 console_t	con;
 int         con_margin=0;       // kazik: margin on the left side
@@ -52,7 +58,6 @@ qbool    con_addtimestamp;
 
 int			con_ormask;
 int 		con_linewidth;		// characters across screen
-int			con_totallines;		// total lines in console scrollback
 float		con_cursorspeed = 4;
 
 cvar_t		con_notify = {"con_notify", "1"};
@@ -83,8 +88,7 @@ cvar_t      con_toggle_deadkey      = {"con_deadkey", "1"};
 #endif
 
 #define	NUM_CON_TIMES 16
-float		con_times[NUM_CON_TIMES];	// cls.realtime time the line was generated
-										// for transparent notify lines
+static unsigned int	con_notifystart;	// lines before this one don't go to notify
 
 int			con_vislines;
 int			con_notifylines;			// scan lines to clear for notify lines
@@ -94,6 +98,14 @@ qbool	con_suppress = false;
 
 FILE		*qconsole_log = NULL;
 
+static sem_t	con_log_buffer_lock;	// guards con_log_buffer, con_log_spare, con_log_buffered and con_log_wakeup_posted
+static sem_t	con_log_file_lock;		// guards qconsole_log and the contents of con_log_spare
+static sem_t	con_log_wakeup;			// posted by Con_LogWrite when there's something to write
+static qbool	con_log_wakeup_posted;
+static char		*con_log_buffer, *con_log_spare;
+static int		con_log_buffered;
+static qbool	con_log_initialized, con_log_thread_started;
+
 
 char *months[12] = {
     "jan",
@@ -245,41 +257,26 @@ void Con_ToggleConsole_f (void) {
 		Con_ClearNotify ();
 }
 
-void Con_SetColor(int idx_from, int count, int c) {
-	int i;
-
-	if (idx_from < 0 || idx_from >= con.maxsize || count < 0 || idx_from + count > con.maxsize)
-		Sys_Error("Con_SetColor: wrong idx");;
-
-	for (i = idx_from; i < count; i++) {
-		memset(&con.clr[i], 0, sizeof(clrinfo_t)); // zeroing whole struct
-		con.clr[i].c = c;
-		con.clr[i].i = i;
-	}
-}
+static void Con_ResetLines (void) {
+	conline_t *line;
 
-void Con_SetWhite (void) {
-// no need for memset(), Con_SetColor() do it too
-//	memset (con.clr, 0, con.maxsize * sizeof(clrinfo_t)); // set whole struct array to zero
+	con.first = con.current;
+	con.linefeed = con.cr = false;
+	con.x = 0;
+	con.backscroll = false;
 
-	Con_SetColor(0, con.maxsize, COLOR_WHITE); // set white color
+	line = CON_LINE(con.current);
+	memset(line, 0, sizeof(*line));
+	line->start = con.textpos;
+	line->run = con.runpos;
 }
 
 void Con_Clear_f (void) {
-	int	i;
-
-	con.numlines = 0;
-	for (i = 0; i < con.maxsize; i++)
-		con.text[i] = ' ';
-	con.display = con.current;
-	Con_SetWhite(); // set default color to white
+	Con_ResetLines();
 }
 
 void Con_ClearNotify (void) {
-	int i;
-
-	for (i = 0; i < NUM_CON_TIMES; i++)
-		con_times[i] = 0;
+	con_notifystart = con.current + 1;
 }
 
 void Con_MessageMode_Common (chat_type t) {
@@ -319,10 +316,9 @@ void Con_MessageModeQTVtoGAME_f (void) {
 	Con_MessageMode_Common(chat_qtvtogame);
 }
 
-//If the line width has changed, reformat the buffer
+//Lines are wrapped as they are drawn, so a new width is all it takes
 void Con_CheckResize (void) {
-	int i, j, width, oldwidth, oldtotallines, numlines, numchars;
-	wchar *tempbuf;
+	int width;
 
 	width = (vid.width >> 3) - 2;
 
@@ -342,56 +338,9 @@ void Con_CheckResize (void) {
 		else
 #endif
 			width = 38;
-
-		con_linewidth = width;
-		con_totallines = con.maxsize / con_linewidth;
-		for (i = 0; i < con.maxsize; i++)
-			con.text[i] = ' ';
-		Con_SetWhite();
-	} else {
-		int idx_old, idx_new;
-		clrinfo_t *clr;
-
-		oldwidth = con_linewidth;
-		con_linewidth = width;
-		oldtotallines = con_totallines;
-		con_totallines = con.maxsize / con_linewidth;
-		numlines = oldtotallines;
-
-		if (con_totallines < numlines)
-			numlines = con_totallines;
-
-		numchars = oldwidth;
-
-		if (con_linewidth < numchars)
-			numchars = con_linewidth;
-
-		tempbuf = (wchar *) Hunk_TempAlloc(con.maxsize * sizeof(wchar));
-		memcpy (tempbuf, con.text, con.maxsize * sizeof(wchar));
-		for (i = 0; i < con.maxsize; i++)
-			con.text[i] = ' ';
-
-		clr = Q_malloc(con.maxsize * sizeof(clrinfo_t)); // alloc temporaly
-		memcpy(clr, con.clr, con.maxsize * sizeof(clrinfo_t)); // save color array
-		Con_SetWhite(); // wipe color array entirely
-
-		for (i = 0; i < numlines; i++) {
-			for (j = 0; j < numchars; j++) {
-				idx_new = (con_totallines - 1 - i) * con_linewidth + j;
-				idx_old = ((con.current - i + oldtotallines) % oldtotallines) * oldwidth + j;
-				con.text[idx_new] = tempbuf[idx_old];
-
-				con.clr[idx_new]   = clr[idx_old]; // restore color info
-				con.clr[idx_new].i = idx_new; // re-index
-			}
-		}
-
-		Con_ClearNotify ();
-		Q_free(clr); // free
 	}
 
-	con.current = con_totallines - 1;
-	con.display = con.current;
+	con_linewidth = width;
 }
 
 
@@ -415,9 +364,126 @@ static void Con_CreateReadableChars(void) {
 
 
 static void Con_InitConsoleBuffer(console_t *conbuffer, int size) {
+	// the rings are indexed with a mask
+	while (size & (size - 1))
+		size &= size - 1;
+
 	con.maxsize = size;
+	con.maxruns = size / 4;
+	con.maxlines = size / 8;
 	con.text = (wchar *) Hunk_AllocName(con.maxsize * sizeof(wchar), "console_buffer");
-	con.clr = (clrinfo_t *) Hunk_AllocName(con.maxsize * sizeof(clrinfo_t), "console_clr");
+	con.runs = (conrun_t *) Hunk_AllocName(con.maxruns * sizeof(conrun_t), "console_runs");
+	con.lines = (conline_t *) Hunk_AllocName(con.maxlines * sizeof(conline_t), "console_lines");
+	Con_ResetLines();
+}
+
+/*
+==================
+Console log
+
+qconsole_log is written by a background thread, Con_PrintW only copies
+the text into a buffer and wakes the thread, so printing doesn't wait for
+the disk.
+==================
+*/
+
+// Writes out whatever was buffered, must be called with con_log_file_lock held.
+static void Con_LogWriteBuffered (void) {
+	char *data;
+	int len;
+
+	Sys_SemWait(&con_log_buffer_lock);
+	data = con_log_buffer;
+	len = con_log_buffered;
+	con_log_buffer = con_log_spare;
+	con_log_buffered = 0;
+	con_log_spare = data;
+	Sys_SemPost(&con_log_buffer_lock);
+
+	if (len && qconsole_log) {
+		fwrite(data, 1, len, qconsole_log);
+		fflush(qconsole_log);
+	}
+}
+
+void Con_FlushLog (void) {
+	if (!con_log_initialized)
+		return;
+
+	Sys_SemWait(&con_log_file_lock);
+	Con_LogWriteBuffered();
+	Sys_SemPost(&con_log_file_lock);
+}
+
+static int Con_LogThread (void *ignored) {
+	int buffered;
+
+	for (;;) {
+		Sys_SemWait(&con_log_wakeup);
+
+		Sys_SemWait(&con_log_buffer_lock);
+		con_log_wakeup_posted = false;
+		buffered = con_log_buffered;
+		Sys_SemPost(&con_log_buffer_lock);
+
+		if (buffered)
+			Con_FlushLog();
+	}
+
+	return 0;
+}
+
+static void Con_LogWrite (const wchar *txt) {
+	int i, len = qwcslen(txt), n;
+
+	// printed before Con_Init
+	if (!con_log_initialized) {
+		char *tempbuf = wcs2str_malloc(txt);
+		fprintf(qconsole_log, "%s", tempbuf);
+		fflush(qconsole_log);
+		Q_free(tempbuf);
+		return;
+	}
+
+	if (!con_log_thread_started)
+		con_log_thread_started = (Sys_CreateDetachedThread(Con_LogThread, NULL) == 0);
+
+	while (len > 0) {
+		n = min(len, CON_LOG_BUFFER_SIZE);
+
+		Sys_SemWait(&con_log_buffer_lock);
+
+		// no room left, write it out ourselves
+		if (con_log_buffered + n > CON_LOG_BUFFER_SIZE) {
+			Sys_SemPost(&con_log_buffer_lock);
+			Con_FlushLog();
+			Sys_SemWait(&con_log_buffer_lock);
+		}
+
+		for (i = 0; i < n; i++)
+			con_log_buffer[con_log_buffered++] = txt[i] <= 255 ? (char) txt[i] : '?';
+
+		if (con_log_thread_started && !con_log_wakeup_posted) {
+			con_log_wakeup_posted = true;
+			Sys_SemPost(&con_log_wakeup);
+		}
+		Sys_SemPost(&con_log_buffer_lock);
+
+		txt += n;
+		len -= n;
+	}
+
+	if (!con_log_thread_started)
+		Con_FlushLog();
+}
+
+static void Con_LogInit (void) {
+	Sys_SemInit(&con_log_buffer_lock, 1, 1);
+	Sys_SemInit(&con_log_file_lock, 1, 1);
+	Sys_SemInit(&con_log_wakeup, 0, 1);
+	con_log_buffer = (char *) Q_malloc(CON_LOG_BUFFER_SIZE);
+	con_log_spare = (char *) Q_malloc(CON_LOG_BUFFER_SIZE);
+	con_log_initialized = true;
 }
 
 void Con_Init (void) {
@@ -430,6 +496,7 @@ void Con_Init (void) {
 		snprintf(&tmp_path[0], sizeof(tmp_path), "%s/qw/qconsole.log", com_basedir);
 		qconsole_log = fopen(tmp_path, "a");
 	}
+	Con_LogInit();
 
 	if ((i = COM_CheckParm("-conbufsize")) && i + 1 < COM_Argc()) {
 		conbufsize = Q_atoi(COM_Argv(i + 1)) << 10;
@@ -507,28 +574,224 @@ void Con_Init (void) {
 }
 
 void Con_Shutdown (void) {
+	if (con_log_initialized) {
+		Sys_SemWait(&con_log_file_lock);
+		Con_LogWriteBuffered();
+	}
+
 	if (qconsole_log)
 		fclose(qconsole_log);
+	qconsole_log = NULL;
+
+	if (con_log_initialized)
+		Sys_SemPost(&con_log_file_lock);
 }
 
-void Con_Linefeed (void) {
-	int idx, i;
-	con.x = 0;
-	con.x = con_margin;    // kazik
-	if (con.display == con.current)
-		con.display++;
+/*
+==============================================================================
+LINES
+==============================================================================
+*/
+
+static void Con_NewLine (void) {
+	conline_t *line;
+
+	if (con.current + 1 - con.first >= (unsigned int) con.maxlines)
+		con.first++;
 	con.current++;
-	if (con.numlines < con_totallines)
-		con.numlines++;
-	idx = (con.current%con_totallines)*con_linewidth;
-	for (i = 0; i < con_linewidth; i++)
-		con.text[idx + i] = ' ';
-	Con_SetColor(idx, con_linewidth, COLOR_WHITE);
+
+	line = CON_LINE(con.current);
+	line->start = con.textpos;
+	line->len = 0;
+	line->run = con.runpos;
+	line->numruns = 0;
+	line->wrapkey = 0;
 
 	// mark time for transparent overlay
-	if (con.current >= 0) {
-		con_times[con.current % NUM_CON_TIMES] = (Print_flags[Print_current] & PR_NONOTIFY ? 0 : cls.realtime);
+	line->time = (Print_flags[Print_current] & PR_NONOTIFY ? 0 : cls.realtime);
+}
+
+static void Con_AddChar (wchar c, int color) {
+	conline_t *line = CON_LINE(con.current);
+
+	if (con.linefeed || line->len >= CON_MAXLINELEN) {
+		Con_NewLine();
+		line = CON_LINE(con.current);
+	} else if (con.cr) {
+		// the current line is always the last one, its room can be reused
+		con.textpos = line->start;
+		con.runpos = line->run;
+		line->len = 0;
+		line->numruns = 0;
+	}
+	con.linefeed = con.cr = false;
+
+	if (!line->numruns || CON_RUN(line->run + line->numruns - 1).c != color) {
+		while (con.runpos + 1 - CON_LINE(con.first)->run > (unsigned int) con.maxruns && con.first != con.current)
+			con.first++;
+
+		CON_RUN(con.runpos).pos = line->len;
+		CON_RUN(con.runpos).c = color;
+		con.runpos++;
+		line->numruns++;
+	}
+
+	while (con.textpos + 1 - CON_LINE(con.first)->start > (unsigned int) con.maxsize && con.first != con.current)
+		con.first++;
+
+	CON_CHAR(con.textpos) = c;
+	con.textpos++;
+	line->len++;
+	line->wrapkey = 0;
+}
+
+// everything the wrapping depends on
+static int Con_WrapKey (void) {
+	return (con_linewidth << 10) + (con_margin << 1) + (con_wordwrap.value ? 1 : 0);
+}
+
+// Breaks the line into rows of con_linewidth, fills in where the first maxrows of them start
+// and returns how many there are, lastx gets the column after the last char.
+static int Con_WrapLine (conline_t *line, int *rowstart, int maxrows, int *lastx) {
+	int i, j, l, d, x = 0, rows = 0;
+
+	for (i = 0; i < line->len; i++) {
+		// count word length
+		for (j = i, l = 0; j < line->len && l < con_linewidth; j++, l++) {
+			d = (CON_CHAR(line->start + j) & ~128);
+			if (   ( con_wordwrap.value && (!d || d == 0x09 || d == 0x0D || d == 0x0A || d == 0x20))
+				|| (!con_wordwrap.value && d <= 32) // 32 is a space as well as 0x20
+			   )
+				break;
+		}
+
+		// word wrap
+		if (l != con_linewidth && x + l > con_linewidth)
+			x = 0;
+
+		if (!x || x >= con_linewidth) {
+			if (rows < maxrows)
+				rowstart[rows] = i;
+			rows++;
+			x = con_margin;    // kazik
+		}
+		x++;
 	}
+
+	if (!rows) {
+		if (maxrows > 0)
+			rowstart[0] = 0;
+		rows = 1;
+	}
+
+	*lastx = x;
+	return rows;
+}
+
+static int Con_LineRows (unsigned int i) {
+	conline_t *line = CON_LINE(i);
+	int x;
+
+	if (line->wrapkey != Con_WrapKey()) {
+		line->rows = Con_WrapLine(line, NULL, 0, &x);
+		line->wrapkey = Con_WrapKey();
+	}
+
+	return line->rows;
+}
+
+// Fills buf with a row of the line padded to con_linewidth, returns the number of color runs put to clr.
+static int Con_FillRow (unsigned int i, int row, wchar *buf, clrinfo_t *clr) {
+	conline_t *line = CON_LINE(i);
+	int rowstart[CON_MAXLINELEN + 1];
+	int x, r, n = 0, from, to, rows;
+
+	for (x = 0; x < con_linewidth; x++)
+		buf[x] = ' ';
+	buf[x] = 0;
+
+	rows = Con_WrapLine(line, rowstart, CON_MAXLINELEN + 1, &x);
+	if (row >= rows)
+		return 0;
+	from = rowstart[row];
+	to = (row + 1 < rows ? rowstart[row + 1] : line->len);
+
+	for (x = from; x < to && con_margin + x - from < con_linewidth; x++)
+		buf[con_margin + x - from] = CON_CHAR(line->start + x);
+
+	for (r = 0; r < line->numruns; r++) {
+		if (r + 1 < line->numruns && CON_RUN(line->run + r + 1).pos <= from)
+			continue; // ends before the row
+		if (CON_RUN(line->run + r).pos >= to)
+			break;
+
+		clr[n].c = CON_RUN(line->run + r).c;
+		clr[n].i = (n ? con_margin + CON_RUN(line->run + r).pos - from : 0);
+		n++;
+	}
+
+	return n;
+}
+
+// keeps the backscrolled view on lines that are still there
+static void Con_ClampDisplay (void) {
+	if ((int) (con.display - con.first) < 0) {
+		con.display = con.first;
+		con.displayrow = 0;
+	}
+
+	con.displayrow = min(con.displayrow, Con_LineRows(con.display) - 1);
+}
+
+// Scrolls the console back by rows, forward if negative.
+void Con_Scroll (int rows) {
+	if (!con.backscroll) {
+		if (rows <= 0)
+			return;
+
+		con.backscroll = true;
+		con.display = con.current;
+		con.displayrow = Con_LineRows(con.current) - 1;
+	}
+
+	Con_ClampDisplay();
+
+	for (; rows > 0; rows--) {
+		if (con.displayrow > 0) {
+			con.displayrow--;
+		} else if (con.display != con.first) {
+			con.display--;
+			con.displayrow = Con_LineRows(con.display) - 1;
+		} else {
+			break;
+		}
+	}
+
+	for (; rows < 0; rows++) {
+		if (con.displayrow < Con_LineRows(con.display) - 1) {
+			con.displayrow++;
+		} else if (con.display != con.current) {
+			con.display++;
+			con.displayrow = 0;
+		} else {
+			break;
+		}
+	}
+
+	// back at the bottom, follow new text again
+	if (con.display == con.current && con.displayrow == Con_LineRows(con.current) - 1)
+		con.backscroll = false;
+}
+
+void Con_ScrollHome (void) {
+	con.backscroll = true;
+	con.display = con.first;
+	con.displayrow = 0;
+	Con_Scroll(0);
+}
+
+void Con_ScrollEnd (void) {
+	con.backscroll = false;
 }
 
 /*
@@ -555,18 +818,13 @@ void Con_SafePrintf (char *fmt, ...)
     scr_disabled_for_loading = temp;
 }
 
-//Handles cursor positioning, line wrapping, etc
+//Splits the text into lines and color runs, wrapping is left to drawing
 void Con_PrintW (wchar *txt) {
-	int y, c, l, d, mask, color = COLOR_WHITE, r, g, b, idx;
-	wchar *s;
-	static int cr;
+	int c, mask, color = COLOR_WHITE, r, g, b;
 
 	if (!(Print_flags[Print_current] & PR_LOG_SKIP)) {
 		if (qconsole_log) {
-			char *tempbuf = wcs2str_malloc(txt);
-			fprintf(qconsole_log, "%s", tempbuf);
-			fflush(qconsole_log);
-			Q_free(tempbuf);
+			Con_LogWrite(txt);
 		}
 		if (Log_IsLogging()) {
 			if (log_readable.value) {
@@ -613,71 +871,32 @@ void Con_PrintW (wchar *txt) {
 			}
 		}
 
-		// count word length
-		for (s = txt, l = 0; s[0] && l < con_linewidth;) {
-			// skip color, not count in word length
-			if (*s == '&') {
-				if (s[1] == 'c' && s[2] && s[3] && s[4]) {
-					r = HexToInt(s[2]);
-					g = HexToInt(s[3]);
-					b = HexToInt(s[4]);
-					if (r >= 0 && g >= 0 && b >= 0) {
-						s += 5;
-						continue; // we got color, get now normal char
-					}
-                } else if (s[1] == 'r') {
-					s += 2;
-					continue; // we got color, get now normal char
-				}
-			}
-		
-			d = (s[0] & ~128);
-			if (   ( con_wordwrap.value && (!d || d == 0x09 || d == 0x0D || d == 0x0A || d == 0x20))
-				|| (!con_wordwrap.value && d <= 32) // 32 is a space as well as 0x20
-			   )
-				break;
-
-			l++; // increase word length
-			s++; // get next char
-		}
-
-		// word wrap
-		if (l != con_linewidth && con.x + l > con_linewidth)
-			con.x = 0;
-
 		txt++;
 
-		if (cr) {
-			con.current--;
-			cr = false;
-		}
-
-		if (!con.x)
-			Con_Linefeed ();
-
 		switch (c) {
 			case '\n':
-				con.x = 0;
+				if (con.linefeed)
+					Con_NewLine (); // empty line
+				con.linefeed = true;
+				con.cr = false;
 				break;
 
 			case '\r':
-				con.x = 0;
-				cr = 1;
+				con.cr = true;
 				break;
 
-			default:	// display character and advance
-				if (con.x >= con_linewidth)
-					Con_Linefeed ();
-				y = con.current % con_totallines;
-				idx = y * con_linewidth + con.x;
-				con.text[idx] = c | (c <= 0x7F ? mask | con_ormask : 0);	// only apply mask if in 'standard' charset
-				memset(&con.clr[idx], 0, sizeof(clrinfo_t)); // zeroing whole struct
-				con.clr[idx].c = color;
-				con.clr[idx].i = idx; // no, that not stupid :P
-				con.x++;
+			default:
+				Con_AddChar(c | (c <= 0x7F ? mask | con_ormask : 0), color);	// only apply mask if in 'standard' charset
 				break;
 		}
 	}
+
+	// where the next print goes, some printing lines things up with it
+	if (con.linefeed || con.cr)
+		con.x = 0;
+	else
+		Con_WrapLine(CON_LINE(con.current), NULL, 0, &con.x);
+
 zomfg:
 	Print_flags[Print_current] = 0;
 }
@@ -719,21 +938,31 @@ static void Con_DrawInput(void) {
 	Draw_StringW (8, con_vislines-22 + bound(0, con_shift.value, 8), text);
 }
 
-// Returns first line to start printing from in order to fill up notify area
-static int Con_FirstNotifyLine (int notification_lines, float notification_timelimit)
+static qbool Con_Notifies (unsigned int i, float timeout) {
+	conline_t *line = CON_LINE(i);
+
+	return (int) (i - con_notifystart) >= 0 && line->time && cls.realtime - line->time <= timeout;
+}
+
+// Returns first line to start printing from in order to fill up notify area,
+// skiprows gets the number of its rows that don't fit.
+static unsigned int Con_FirstNotifyLine (int notification_rows, float notification_timelimit, int *skiprows)
 {
-	int maxlines = bound(0, notification_lines, NUM_CON_TIMES - 1);
-	int first_line = con.current;
-	float threshold_time = cls.realtime - notification_timelimit;
+	int maxrows = bound(0, notification_rows, NUM_CON_TIMES - 1);
+	unsigned int i = con.current, first_line = con.current + 1;
+	int rows = 0, lookback;
+
+	*skiprows = 0;
 
 	// Work backwards to skip non-ignored lines
-	while (first_line >= 0 && first_line > (con.current - NUM_CON_TIMES + 1) && maxlines) {
-		float line_time = con_times[first_line % NUM_CON_TIMES];
-		if (line_time && line_time > threshold_time) {
-			--maxlines;
+	for (lookback = 0; lookback < NUM_CON_TIMES && rows < maxrows; lookback++, i--) {
+		if (Con_Notifies(i, notification_timelimit)) {
+			first_line = i;
+			rows += Con_LineRows(i);
+			*skiprows = max(rows - maxrows, 0);
 		}
-		if (maxlines)
-			--first_line;
+		if (i == con.first)
+			break;
 	}
 
 	return first_line;
@@ -741,43 +970,32 @@ static int Con_FirstNotifyLine (int notification_lines, float notification_timel
 
 //Draws the last few lines of output transparently over the game top
 void Con_DrawNotify (void) {
-	int x, v, skip = 0, i, idx;
-	wchar *text, *s;
+	int x, v, skip = 0, row, rows, skiprows, n;
+	unsigned int i, first_line;
+	wchar *s;
 	wchar buf[1024];
 	clrinfo_t clr[sizeof(buf)];
-	float time;
 	float timeout = bound (0, con_notifytime.value, MAX_NOTIFICATION_TIME);
-	int first_line = Con_FirstNotifyLine(_con_notifylines.integer, timeout);
 
 	if (!con_notify.value)
 		return;
 
 	v = 0;
 	if (_con_notifylines.integer) {
-		for (i = first_line; i <= con.current; i++) {
-			if (i < 0)
-				continue;
-			time = con_times[i % NUM_CON_TIMES];
-			if (time == 0)
-				continue;
-			time = cls.realtime - time;
-			if (time > timeout)
+		first_line = Con_FirstNotifyLine(_con_notifylines.integer, timeout, &skiprows);
+		for (i = first_line; (int) (i - con.current) <= 0; i++, skiprows = 0) {
+			if (!Con_Notifies(i, timeout))
 				continue;
-			idx = (i % con_totallines)*con_linewidth;
-			text = con.text + idx;
 
 			clearnotify = 0;
 			scr_copytop = 1;
 
-			// copy current line to buffer
-			for (x = 0; x < con_linewidth; x++) {
-				buf[x] = text[x];
-				clr[x] = con.clr[idx + x]; // copy whole color struct
-				clr[x].i = x; // set proper index
+			rows = Con_LineRows(i);
+			for (row = skiprows; row < rows; row++) {
+				n = Con_FillRow(i, row, buf, clr);
+				Draw_ColoredString3W(8, v + bound(0, con_shift.value, 8), buf, clr, n, 0);
+				v += 8;
 			}
-			buf[x] = '\0';
-			Draw_ColoredString3W(8, v + bound(0, con_shift.value, 8), buf, clr, con_linewidth, 0);
-			v += 8;
 		}
 	}
 
@@ -838,16 +1056,34 @@ void Con_DrawNotify (void) {
 		con_notifylines = v + bound(0, con_shift.value, 8);
 }
 
+// Colors of clr that fall in len chars from from, indexed from there.
+static int Con_SliceColors (clrinfo_t *clr, int n, int from, int len, clrinfo_t *out)
+{
+	int i, k = 0;
+
+	for (i = 0; i < n; i++) {
+		if (i + 1 < n && clr[i + 1].i <= from)
+			continue;
+		if (clr[i].i >= from + len)
+			break;
+
+		out[k].c = clr[i].c;
+		out[k].i = max(clr[i].i - from, 0);
+		k++;
+	}
+
+	return k;
+}
+
 // Draws the last few lines of output as a custom HUD element.
 void SCR_DrawNotify(int posX, int posY, float scale, int notifyTime, int notifyLines, int notifyCols)
 {
-	int v, skip, i, j, k, idx, draw, offset;
-	wchar *text, *s;
-	wchar buf[1024];
-	clrinfo_t clr[sizeof(buf)];
-	float time;
+	int v, skip, j, k, n, len, row, rows, skiprows, offset;
+	unsigned int i, first_line;
+	wchar *s;
+	wchar buf[1024], part[1024];
+	clrinfo_t clr[sizeof(buf)], partclr[sizeof(buf)];
 	float timeout = bound (0, notifyTime, MAX_NOTIFICATION_TIME);
-	int first_line = Con_FirstNotifyLine(notifyLines, timeout);
 
 	if (notifyCols > (con_linewidth))
 		notifyCols = con_linewidth;
@@ -857,86 +1093,43 @@ void SCR_DrawNotify(int posX, int posY, float scale, int notifyTime, int notifyL
 
 	v = 0;
 	if (notifyLines) {
-		for (i = first_line; i <= con.current; i++) {
-			if (i < 0)
-				continue;
-
-			time = con_times[i % NUM_CON_TIMES];
-			if (time == 0)
-				continue;
-
-			time = cls.realtime - time;
-			if (time > timeout)
+		first_line = Con_FirstNotifyLine(notifyLines, timeout, &skiprows);
+		for (i = first_line; (int) (i - con.current) <= 0; i++, skiprows = 0) {
+			if (!Con_Notifies(i, timeout))
 				continue;
 
-			idx = (i % con_totallines)*con_linewidth;
-			text = con.text + idx;
-
 			clearnotify = 0;
 			scr_copytop = 1;
 
-			// Copy current line to buffer
-			offset = 0;
-			draw = 0;
-			for (j = 0; j < con_linewidth; j++)
-			{
+			rows = Con_LineRows(i);
+			for (row = skiprows; row < rows; row++) {
+				n = Con_FillRow(i, row, buf, clr);
+
 				// each new line of a notify hud element
-				if ((j % notifyCols) == 0 && j != 0)
-				{
-					for (k = 0; k < (j - offset); ++k)
-					{
-						if (buf[k] != ' ')
-						{
-							draw = 1;
-							break;
-						}
-					}
-
-					buf[j - offset] = '\0';
-					offset = j;
-				}
-				else if (j == (con_linewidth - 1)) // Ending of the string.
-				{
-					for (k = 0; k < (j - offset); ++k)
-					{
-						if (buf[k] != ' ')
-						{
-							draw = 1;
-							break;
-						}
-					}
-
-					buf[j - offset] = '\0';
-				}
+				for (offset = 0; offset < con_linewidth; offset += notifyCols) {
+					len = min(notifyCols, con_linewidth - offset);
+
+					for (k = 0; k < len && buf[offset + k] == ' '; k++)
+						;
+					if (k == len)
+						continue; // nothing to draw
 
-				// Output.
-				if (draw)
-				{
-					if (!draw)
-						continue;
+					memcpy(part, buf + offset, len * sizeof(wchar));
+					part[len] = 0;
 
 					Draw_SColoredString(
 						posX,
 						v + posY,
-						buf,
-						clr,
-						notifyCols,
+						part,
+						partclr,
+						Con_SliceColors(clr, n, offset, len, partclr),
 						0,
 						scale
 						);
 
 					// move text down
 					v += (8 * scale);
-
-					if (v > (notifyLines * scale))
-						notifyLines = v;
-
-					draw = 0;
 				}
-
-				buf[j - offset] = text[j];
-				clr[j - offset] = con.clr[idx + j]; // copy whole color struct
-				clr[j - offset].i = j; // set proper index
 			}
 		}
 	}
@@ -997,8 +1190,8 @@ void SCR_DrawNotify(int posX, int posY, float scale, int notifyTime, int notifyL
 
 //Draws the console with the solid background
 void Con_DrawConsole (int lines) {
-	int i, j, x, y, n=0, rows, row, idx;
-	wchar *wtext;
+	int i, j, x, y, n=0, rows, row;
+	unsigned int line;
 	char *text, dlbar[1024];
 	wchar buf[1024];
 	clrinfo_t clr[sizeof(buf)];
@@ -1017,37 +1210,34 @@ void Con_DrawConsole (int lines) {
 
 	y = lines - 30;
 
-	row = con.display;
-
 	// draw from the bottom up
-	if (con.display != con.current) {
+	if (con.backscroll) {
 	// draw arrows to show the buffer is backscrolled
 		for (x = 0; x < con_linewidth; x += 4)
 			Draw_Character ((x + 1) << 3, y + bound(0, con_shift.value, 8), '^');
 
 		y -= 8;
 		rows--;
-		row--;
-	}
 
-	for (i = 0; i < rows; i++, y -= 8, row--) {
-		if (row < 0)
-			break;
-		if (con.current - row >= con_totallines)
-			break;		// past scrollback wrap point
+		Con_ClampDisplay();
+		line = con.display;
+		row = con.displayrow;
+	} else {
+		line = con.current;
+		row = Con_LineRows(line) - 1;
+	}
 
-		idx = (row % con_totallines)*con_linewidth;
-		wtext = con.text + idx;
+	// only the rows on screen get wrapped
+	for (i = 0; i < rows; i++, y -= 8) {
+		n = Con_FillRow(line, row, buf, clr);
+		Draw_ColoredString3W( 1 << 3, y + bound(0, con_shift.value, 8), buf, clr, n, 0);
 
-		// copy current line to buffer
-		for(x = 0; x < con_linewidth; x++) {
-			buf[x] = wtext[x];
-			clr[x] = con.clr[idx + x]; // copy whole color struct
-			clr[x].i = x; // set proper index
+		if (--row < 0) {
+			if (line == con.first)
+				break;
+			line--;
+			row = Con_LineRows(line) - 1;
 		}
-		buf[x] = '\0';
-
-		Draw_ColoredString3W( 1 << 3, y + bound(0, con_shift.value, 8), buf, clr, con_linewidth, 0);
 	}
 
 	// draw the download bar
@@ -26,15 +26,45 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #define _CONSOLE_H_
 
+// one line of console output as it was printed, before any wrapping
 typedef struct
 {
-	wchar	*text;
-	int		maxsize;
-	int		current;		// line where next message will be printed
-	int		x;				// offset in current line for next print
-	int		display;		// bottom of console displays this line
-	int		numlines;		// number of non-blank text lines, used for backscroling
-	clrinfo_t *clr; // clr[maxsize]
+	unsigned int	start;		// position of its first char in con.text
+	int				len;
+	unsigned int	run;		// position of its first color run in con.runs
+	int				numruns;
+	float			time;		// cls.realtime the line was started, 0 if it doesn't go to notify
+	int				wrapkey;	// layout the rows below were counted for, 0 if none
+	int				rows;		// rows the line takes when wrapped
+} conline_t;
+
+typedef struct
+{
+	int		pos;			// offset in the line the color starts at
+	color_t	c;
+} conrun_t;
+
+// text, color runs and lines are rings, positions in them only ever grow
+typedef struct
+{
+	wchar		*text;
+	int			maxsize;
+	conrun_t	*runs;
+	int			maxruns;
+	conline_t	*lines;
+	int			maxlines;
+
+	unsigned int	textpos;	// where the next char goes
+	unsigned int	runpos;		// where the next color run goes
+	unsigned int	first;		// oldest line still kept
+	unsigned int	current;	// line where next message will be printed
+	qbool			linefeed;	// current line is finished, the next char starts a new one
+	qbool			cr;			// the next char rewrites the current line
+	int				x;			// offset in current row for next print
+
+	qbool			backscroll;	// view doesn't follow new text
+	unsigned int	display;	// bottom of backscrolled console displays this line
+	int				displayrow;	// ... and this row of it
 } console_t;
 
 extern	console_t	con;
@@ -54,7 +84,6 @@ extern  qbool    con_addtimestamp;
 
 extern	int			con_ormask;
 
-extern int con_totallines;
 extern int con_linewidth;
 extern qbool con_initialized, con_suppress;
 extern	int	con_notifylines;		// scan lines to clear for notify lines
@@ -67,6 +96,10 @@ void Con_SafePrintf (char *fmt, ...);
 void Con_PrintW (wchar *txt);
 void Con_Clear_f (void);
 void Con_DrawNotify (void);
+void Con_Scroll (int rows);
+void Con_ScrollHome (void);
+void Con_ScrollEnd (void);
+void Con_FlushLog (void);
 
 void SCR_DrawNotify(int x, int y, float scale, int notifyTime, int notifyLines, int notifyCols);
 
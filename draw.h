@@ -128,6 +128,42 @@ void Draw_EnableScissorRectangle(int x, int y, int width, int height);
 void Draw_EnableScissor(int left, int right, int top, int bottom);
 void Draw_DisableScissor(void);
 
+// Draws the quads batched so far, call before touching GL directly while 2D is being drawn.
+void Draw_FlushBatch (void);
+void Draw_BatchStats (int *quads, int *flushes);
+
+//
+// Draw recording, 2D drawing is captured as commands instead of going to GL while it is on
+//
+typedef enum
+{
+	DRAW_CMD_CHAR,			// texture is the char
+	DRAW_CMD_PIC,
+	DRAW_CMD_RECT,
+	DRAW_CMD_LINE,			// w, h is the end point
+	DRAW_CMD_POLYGON,		// w is the vertex count
+	DRAW_CMD_PIESLICE,		// w is the radius
+	DRAW_CMD_TILE,
+	DRAW_CMD_FADE,
+	DRAW_CMD_CROSSHAIR,
+	DRAW_CMD_SCISSOR,		// w, h is 0 when turned off
+	DRAW_CMD_MAX
+} draw_cmd_t;
+
+typedef struct draw_command_s
+{
+	int		cmd;
+	int		texture;
+	float	x, y, w, h;
+	color_t	color;
+} draw_command_t;
+
+extern qbool draw_recording;
+
+void Draw_Record (draw_cmd_t cmd, int texture, float x, float y, float w, float h, color_t color);
+void Draw_RecordStart (void);
+int Draw_RecordStop (int *bytes, unsigned int *checksum);
+
 void InitTracker(void);
 
 #endif // __DRAW_H__
@@ -322,30 +322,35 @@ qbool	file_from_gamedir;	// global indicating file came from a gamedir (and game
 
 // VFS-FIXME: D-Kure: This function will be removed once we have the VFS layer
 
+// Look for the file in the filesystem or pack files and open it for reading.
+static vfsfile_t *FS_OpenFileForLoad (const char *path)
+{
+	flocation_t loc;
+
+	//blanket-bans - Avoid combination of / & \ for directories
+	if (Sys_PathProtection(path)) 
+		return NULL;
+
+	// VFS-FIXME: This only checks the pak files, not the base dir's
+	FS_FLocateFile(path, FSLFRT_LENGTH, &loc);
+	if (loc.search) {
+		return loc.search->funcs->OpenVFS(loc.search->handle, &loc, "rb");
+	}
+
+	return FS_OpenVFS(path, "rb", FS_ANY);
+}
+
 // Filename are relative to the quake directory.
 // Always appends a 0 byte to the loaded data.
 static byte *FS_LoadFile (const char *path, int usehunk, int *file_length)
 {
 	vfsfile_t *f = NULL;
 	vfserrno_t err;
-	flocation_t loc;
 	byte *buf;
 	char base[32];
 	int len;
 
-	// Look for it in the filesystem or pack files.
-	//blanket-bans - Avoid combination of / & \ for directories
-    if (Sys_PathProtection(path)) 
-		return NULL;
-
-	// VFS-FIXME: This only checks the pak files, not the base dir's
-    FS_FLocateFile(path, FSLFRT_LENGTH, &loc);
-	if (loc.search) {
-		f = loc.search->funcs->OpenVFS(loc.search->handle, &loc, "rb");
-	} else {
-		f = FS_OpenVFS(path, "rb", FS_ANY);
-	} 
-
+	f = FS_OpenFileForLoad(path);
 	if (!f)
 		return NULL;
 	len = VFS_GETLEN(f);
@@ -409,6 +414,55 @@ byte *FS_LoadHeapFile (const char *path, int *len)
 	return FS_LoadFile (path, 5, len);
 }
 
+// Gives a read-only view of the file, use FS_UnmapFile when done with it.
+qbool FS_MapFile (const char *path, fs_mappedfile_t *map)
+{
+	vfsfile_t *f;
+	vfserrno_t err;
+	int len;
+
+	memset(map, 0, sizeof(*map));
+
+	f = FS_OpenFileForLoad(path);
+	if (!f)
+		return false;
+
+	len = VFS_GETLEN(f);
+	if (len == -1) {
+		VFS_CLOSE(f);
+		return false;
+	}
+
+	map->len = len;
+	map->data = VFS_MAP(f);
+	if (map->data) {
+		// keep the file open, it owns the mapping
+		map->vfs = f;
+		return true;
+	}
+
+	map->copy = Q_malloc(len + 1);
+	map->copy[len] = 0;
+
+	Draw_BeginDisc ();
+	VFS_READ(f, map->copy, len, &err);
+	VFS_CLOSE(f);
+	Draw_EndDisc ();
+
+	map->data = map->copy;
+
+	return true;
+}
+
+void FS_UnmapFile (fs_mappedfile_t *map)
+{
+	if (map->vfs)
+		VFS_CLOSE(map->vfs);
+	Q_free(map->copy);
+
+	memset(map, 0, sizeof(*map));
+}
+
 // QW262 -->
 /*
 ================
@@ -689,6 +743,9 @@ void FS_InitFilesystemEx( qbool guess_cwd ) {
 
 	FS_ShutDown();
 
+	// paks map their file as they are added below
+	vfsos_nommap = COM_CheckParm("-nommap");
+
 	if (guess_cwd) { // so, com_basedir directory will be where ezquake*.exe located
 		char *e;
 
@@ -913,6 +970,11 @@ void VFS_FLUSH (struct vfsfile_s *vf) {
 		vf->Flush(vf);
 }
 
+const byte *VFS_MAP (struct vfsfile_s *vf) {
+	assert(vf);
+	return vf->Map ? vf->Map(vf) : NULL;
+}
+
 // return null terminated string
 char *VFS_GETS(struct vfsfile_s *vf, char *buffer, int buflen)
 {
@@ -1022,6 +1084,35 @@ int FS_BreakUpArchivePath(const char *filename,
 
 #endif // WITH_VFS_ARCHIVE_LOADING
 
+/*
+ * FS_OpenArchiveEntryVFS
+ *
+ * Opens a single file inside an archive without adding the archive to the
+ * search paths. raw is owned by the archive from now on and is closed along
+ * with the returned file, or right away if the file couldn't be opened.
+ */
+vfsfile_t *FS_OpenArchiveEntryVFS(searchpathfuncs_t *funcs, vfsfile_t *raw, const char *archive, const char *inside)
+{
+	flocation_t loc;
+	vfsfile_t *vfs = NULL;
+	void *handle;
+
+	if (!(handle = funcs->OpenNew(raw, archive)))
+	{
+		VFS_CLOSE(raw);
+		return NULL;
+	}
+
+	memset(&loc, 0, sizeof(loc));
+	if (funcs->FindFile(handle, &loc, inside, NULL))
+		vfs = funcs->OpenVFS(handle, &loc, "rb");
+
+	// The opened file holds its own reference to the archive.
+	funcs->ClosePath(handle);
+
+	return vfs;
+}
+
 /* ================
  * FS_OpenVFS
  * ================
@@ -1322,6 +1413,138 @@ int FS_GZipPack (char *source_path,
 	return 1;
 }
 
+static void FS_GZipPutLong(byte *b, unsigned int l)
+{
+	b[0] = l & 0xff;
+	b[1] = (l >> 8) & 0xff;
+	b[2] = (l >> 16) & 0xff;
+	b[3] = (l >> 24) & 0xff;
+}
+
+//
+// Pack a file into a blocked gzip file (see vfs.h) that can be seeked in
+// without inflating it from the start. Any gzip reader can still unpack it.
+// Doesn't print anything so that it can be run from a worker thread.
+//
+int FS_GZipPackBlocked (char *source_path,
+						 char *destination_path,
+						 qbool overwrite)
+{
+	FILE *source = NULL, *dest = NULL;
+	byte *inbuf = NULL, *index = NULL;
+	unsigned char outbuf[CHUNK];
+	unsigned int blocks = 0, total_len = 0, len, index_len;
+	unsigned long filelen;
+	z_stream zs;
+	int ret = 0, r;
+
+	if (COM_FileExists (destination_path) && !overwrite)
+		return 0;
+
+	if (!(source = fopen (source_path, "rb")))
+		return 0;
+
+	fseek (source, 0, SEEK_END);
+	filelen = ftell (source);
+	fseek (source, 0, SEEK_SET);
+
+	if ((filelen + GZIP_BLOCK_SIZE - 1) / GZIP_BLOCK_SIZE > GZIP_BLOCK_MAX_BLOCKS || filelen >= 0xFFFFFFFFUL)
+	{
+		fclose (source);
+		return 0;
+	}
+
+	memset (&zs, 0, sizeof(zs));
+	if (deflateInit2 (&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		fclose (source);
+		return 0;
+	}
+
+	FS_CreatePath (COM_SkipPathWritable (destination_path));
+
+	if (!(dest = fopen (destination_path, "wb")))
+		goto done;
+
+	inbuf = Q_malloc (GZIP_BLOCK_SIZE);
+	index_len = 16 + 4 * GZIP_BLOCK_MAX_BLOCKS;
+	index = Q_malloc (GZIP_BLOCK_INDEX_HDR + 6 + index_len + 10);
+
+	// Every block is a complete gzip member of its own.
+	while ((len = fread (inbuf, 1, GZIP_BLOCK_SIZE, source)) > 0)
+	{
+		if (blocks >= GZIP_BLOCK_MAX_BLOCKS)
+			goto done;
+
+		FS_GZipPutLong (index + GZIP_BLOCK_INDEX_HDR + 6 + 12 + 4 * blocks, ftell (dest));
+		blocks++;
+		total_len += len;
+
+		deflateReset (&zs);
+		zs.next_in  = inbuf;
+		zs.avail_in = len;
+
+		do
+		{
+			zs.next_out  = outbuf;
+			zs.avail_out = sizeof(outbuf);
+			r = deflate (&zs, Z_FINISH);
+			if (r == Z_STREAM_ERROR)
+				goto done;
+
+			if (fwrite (outbuf, 1, sizeof(outbuf) - zs.avail_out, dest) != sizeof(outbuf) - zs.avail_out)
+				goto done;
+		} while (r != Z_STREAM_END);
+	}
+
+	// The index is an empty gzip member carrying the block offsets in an extra field.
+	{
+		byte *b = index;
+		unsigned int index_ofs = ftell (dest);
+
+		index_len = 16 + 4 * blocks;
+
+		b[0] = 0x1f; b[1] = 0x8b; b[2] = 8; b[3] = 4;	// FEXTRA
+		FS_GZipPutLong (b + 4, 0);						// mtime
+		b[8] = 0; b[9] = 0xff;							// xfl, os
+		b[10] = (index_len + 4) & 0xff;
+		b[11] = (index_len + 4) >> 8;
+		b[12] = GZIP_BLOCK_INDEX_ID1;
+		b[13] = GZIP_BLOCK_INDEX_ID2;
+		b[14] = index_len & 0xff;
+		b[15] = index_len >> 8;
+
+		b += GZIP_BLOCK_INDEX_HDR + 6;
+		FS_GZipPutLong (b, GZIP_BLOCK_SIZE);
+		FS_GZipPutLong (b + 4, blocks);
+		FS_GZipPutLong (b + 8, total_len);
+		FS_GZipPutLong (b + 12 + 4 * blocks, index_ofs);
+
+		b += index_len;
+		b[0] = 0x03; b[1] = 0x00;						// Empty final deflate block.
+		FS_GZipPutLong (b + 2, 0);						// crc32
+		FS_GZipPutLong (b + 6, 0);						// isize
+
+		len = GZIP_BLOCK_INDEX_HDR + 6 + index_len + 10;
+		if (fwrite (index, 1, len, dest) != len)
+			goto done;
+	}
+
+	ret = !ferror (source);
+
+done:
+	deflateEnd (&zs);
+	Q_free (inbuf);
+	Q_free (index);
+	fclose (source);
+	if (dest && fclose (dest))
+		ret = 0;
+	if (dest && !ret)
+		remove (destination_path);
+
+	return ret;
+}
+
 //
 // Unpack a .gz file.
 //
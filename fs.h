@@ -55,6 +55,7 @@ typedef struct vfsfile_s {
 	unsigned long (*GetLen) (struct vfsfile_s *file);	// Could give some lag
 	void (*Close) (struct vfsfile_s *file);
 	void (*Flush) (struct vfsfile_s *file);
+	const byte *(*Map) (struct vfsfile_s *file);	// Read-only view of the whole file, NULL if not possible
 	qbool seekingisabadplan;
 	qbool copyprotected;							// File found was in a pak
 } vfsfile_t;
@@ -81,6 +82,9 @@ int				VFS_WRITE  (struct vfsfile_s *vf, const void *buffer, int bytestowrite);
 void			VFS_FLUSH  (struct vfsfile_s *vf);
 char		   *VFS_GETS   (struct vfsfile_s *vf, char *buffer, int buflen); 
 				// return null terminated string
+const byte	   *VFS_MAP    (struct vfsfile_s *vf);
+				// read-only view of the whole file, valid until the file is closed,
+				// NULL if the file can't be mapped
 
 void			VFS_TICK   (void);  // fill in/out our internall buffers 
 									// (do read/write on socket)
@@ -93,6 +97,19 @@ vfsfile_t *FS_OpenVFS(const char *filename, char *mode,relativeto_t relativeto);
 // TCP VFS file
 vfsfile_t *FS_OpenTCP(char *name);
 
+// Read-only view of a file from the quake file system. Files inside paks and
+// stored (uncompressed) zip entries are mapped without copying, anything else
+// is loaded into a heap buffer. Unlike FS_Load*File the data is not zero terminated.
+typedef struct fs_mappedfile_s {
+	const byte *data;
+	int len;
+	vfsfile_t *vfs;		// keeps the pak open while mapped
+	byte *copy;			// heap copy when the file couldn't be mapped
+} fs_mappedfile_t;
+
+qbool FS_MapFile(const char *path, fs_mappedfile_t *map);
+void FS_UnmapFile(fs_mappedfile_t *map);
+
 typedef enum {
 	FS_LOAD_NONE     = 1,
 	FS_LOAD_FILE_PAK = 2,
@@ -107,6 +124,7 @@ typedef enum {
 void FS_AddGameDirectory (char *dir, unsigned int loadstuff);
 
 char *FS_NextPath (char *prevpath);
+void FS_EnumerateFiles (char *match, int (*func)(char *, int, void *), void *parm);
 
 extern cvar_t fs_cache;
 extern qbool filesystemchanged;
@@ -119,6 +137,10 @@ int FS_GZipPack (char *source_path,
 				  char *destination_path,
 				  qbool overwrite);
 
+int FS_GZipPackBlocked (char *source_path,
+						 char *destination_path,
+						 qbool overwrite);
+
 int FS_GZipUnpack (char *source_path,		// The path to the compressed source file.
 					char *destination_path, // The destination file path.
 					qbool overwrite);		// Overwrite the destination file if it exists?
@@ -30,7 +30,7 @@
 //
 // g_public.h -- game module information visible to server
 
-#define	GAME_API_VERSION	15
+#define	GAME_API_VERSION	16
 
 
 //===============================================================
@@ -142,6 +142,11 @@ typedef enum
 	G_SETPAUSE,
 	G_SETUSERINFO,
 	G_MOVETOGOAL,
+	G_WRITEBATCH,	// ( int to, const byte *data, int len );		since api version 16
+	// a run of Write* calls in one trap: for each, one byte with the G_WRITE* trap
+	// number and then its value, a 4 byte int (G_WRITEBYTE, CHAR, SHORT, LONG, ENTITY),
+	// a 4 byte float (G_WRITEANGLE, COORD) or a zero terminated string (G_WRITESTRING).
+	// returns the number of writes, or -1 if the data is malformed and nothing was written
 } gameImport_t;
 
 // !!! new things comes to end of list !!!
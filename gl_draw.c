@@ -48,6 +48,7 @@ static cvar_t crosshairimage          = {"crosshairimage", "", 0, OnChange_cross
 void OnChange_gl_consolefont (cvar_t *, char *, qbool *);
 cvar_t gl_consolefont                 = {"gl_consolefont", "povo5", 0, OnChange_gl_consolefont};
 static cvar_t gl_alphafont            = {"gl_alphafont", "1"};
+static cvar_t gl_batch2d              = {"gl_batch2d", "1"};
 
 cvar_t crosshairalpha                 = {"crosshairalpha", "1"};
 
@@ -330,6 +331,14 @@ void Draw_EnableScissorRectangle(int x, int y, int width, int height)
 	float resdif_w = (glwidth / (float)vid.conwidth);
 	float resdif_h = (glheight / (float)vid.conheight);
 
+	if (draw_recording)
+	{
+		Draw_Record(DRAW_CMD_SCISSOR, 0, x, y, width, height, 0);
+		return;
+	}
+
+	Draw_FlushBatch();
+
 	glEnable(GL_SCISSOR_TEST);
 	glScissor(
 		Q_rint(x * resdif_w), 
@@ -345,6 +354,14 @@ void Draw_EnableScissor(int left, int right, int top, int bottom)
 
 void Draw_DisableScissor(void)
 {
+	if (draw_recording)
+	{
+		Draw_Record(DRAW_CMD_SCISSOR, 0, 0, 0, 0, 0, 0);
+		return;
+	}
+
+	Draw_FlushBatch();
+
 	glDisable(GL_SCISSOR_TEST);
 }
 
@@ -440,6 +457,150 @@ static void Scap_Init(void)
 	Scrap_Upload();
 }
 
+//
+// 2D quad batching
+//
+// Characters, pics and tiles are collected into one vertex array and drawn with a single call for
+// each run of quads that share a texture and blend state. Anything else that touches GL while 2D
+// is being drawn has to call Draw_FlushBatch first, so things still end up in the order drawn.
+//
+
+#define DRAW_BATCH_QUADS		4096
+
+#define DRAW_BATCH_NOALPHATEST	1
+#define DRAW_BATCH_BLEND		2
+#define DRAW_BATCH_MODULATE		4
+
+typedef struct draw_vertex_s
+{
+	float	x, y;
+	float	s, t;
+	byte	color[4];
+} draw_vertex_t;
+
+static draw_vertex_t	draw_batch[DRAW_BATCH_QUADS * 4];
+static int				draw_batch_quads;
+static int				draw_batch_texture;
+static int				draw_batch_state;
+
+// Counted since Draw_BatchStats was last called.
+static int				draw_batch_stat_quads;
+static int				draw_batch_stat_flushes;
+
+// State and color characters are drawn with, set per string or per character.
+static int				draw_char_state;
+static byte				draw_char_color[4] = {255, 255, 255, 255};
+
+void Draw_FlushBatch (void)
+{
+	if (!draw_batch_quads)
+		return;
+
+	GL_Bind(draw_batch_texture);
+
+	if (draw_batch_state & DRAW_BATCH_NOALPHATEST)
+	{
+		glDisable(GL_ALPHA_TEST);
+	}
+
+	if (draw_batch_state & DRAW_BATCH_BLEND)
+	{
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	}
+
+	if (draw_batch_state & DRAW_BATCH_MODULATE)
+	{
+		glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+	}
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+
+	glVertexPointer(2, GL_FLOAT, sizeof(draw_vertex_t), &draw_batch[0].x);
+	glTexCoordPointer(2, GL_FLOAT, sizeof(draw_vertex_t), &draw_batch[0].s);
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(draw_vertex_t), draw_batch[0].color);
+
+	glDrawArrays(GL_QUADS, 0, draw_batch_quads * 4);
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	// Back to the 2D state set by GL_Set2D.
+	glEnable(GL_ALPHA_TEST);
+	glDisable(GL_BLEND);
+	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+	glColor4ubv(color_white);
+
+	draw_batch_stat_quads += draw_batch_quads;
+	draw_batch_stat_flushes++;
+	draw_batch_quads = 0;
+}
+
+// Quads and draw calls since the last call.
+void Draw_BatchStats (int *quads, int *flushes)
+{
+	*quads = draw_batch_stat_quads;
+	*flushes = draw_batch_stat_flushes;
+	draw_batch_stat_quads = draw_batch_stat_flushes = 0;
+}
+
+static void Draw_BatchQuad (int texture, int state, const byte color[4], float x, float y, float w, float h, float sl, float tl, float sh, float th)
+{
+	draw_vertex_t *v;
+	int i;
+
+	if (draw_batch_quads && (texture != draw_batch_texture || state != draw_batch_state || draw_batch_quads == DRAW_BATCH_QUADS))
+	{
+		Draw_FlushBatch();
+	}
+
+	draw_batch_texture = texture;
+	draw_batch_state = state;
+
+	v = &draw_batch[draw_batch_quads++ * 4];
+
+	v[0].x = x;		v[0].y = y;		v[0].s = sl;	v[0].t = tl;
+	v[1].x = x + w;	v[1].y = y;		v[1].s = sh;	v[1].t = tl;
+	v[2].x = x + w;	v[2].y = y + h;	v[2].s = sh;	v[2].t = th;
+	v[3].x = x;		v[3].y = y + h;	v[3].s = sl;	v[3].t = th;
+
+	for (i = 0; i < 4; i++)
+	{
+		memcpy(v[i].color, color, sizeof(v[i].color));
+	}
+
+	if (!gl_batch2d.integer)
+	{
+		Draw_FlushBatch();
+	}
+}
+
+static void Draw_SubPicQuad (int x, int y, mpic_t *pic, int src_x, int src_y, int src_width, int src_height, float scale_x, float scale_y, int state, const byte color[4])
+{
+	float newsl, newtl, newsh, newth;
+	float oldglwidth, oldglheight;
+
+	if (scrap_dirty)
+	{
+		Draw_FlushBatch();
+		Scrap_Upload ();
+	}
+
+	oldglwidth = pic->sh - pic->sl;
+	oldglheight = pic->th - pic->tl;
+
+	newsl = pic->sl + (src_x * oldglwidth) / (float)pic->width;
+	newsh = newsl + (src_width * oldglwidth) / (float)pic->width;
+
+	newtl = pic->tl + (src_y * oldglheight) / (float)pic->height;
+	newth = newtl + (src_height * oldglheight) / (float)pic->height;
+
+	Draw_BatchQuad(pic->texnum, state, color, x, y, scale_x * src_width, scale_y * src_height, newsl, newtl, newsh, newth);
+}
+
 //=============================================================================
 // Support Routines
 
@@ -523,8 +684,9 @@ mpic_t *Draw_CachePicSafe (const char *path, qbool crash, qbool only24bit)
 	mpic_t *fpic;
 	mpic_t *pic_24bit;
 	qbool lmp_found = false;
-	qpic_t *dat = NULL;
-	vfsfile_t *v = NULL;
+	fs_mappedfile_t lmp;
+	const qpic_t *dat;
+	int lmp_width = 0, lmp_height = 0;
 
 	// Check if the picture was already cached, if so inc refcount.
 	if ((fpic = CachePic_Find(path, true))) {
@@ -550,20 +712,22 @@ mpic_t *Draw_CachePicSafe (const char *path, qbool crash, qbool only24bit)
 		return CachePic_Add(path, pic_24bit);
 	}
 
-	// Load the ".lmp" file.
-	if ((v = FS_OpenVFS(lmp_path, "rb", FS_ANY))) {
-		VFS_CLOSE(v);
+	// Load the ".lmp" file, it's read in place so the header isn't swapped.
+	if (FS_MapFile(lmp_path, &lmp)) {
+		dat = (const qpic_t *)lmp.data;
+		if (lmp.len >= 8) {
+			lmp_width = LittleLong(dat->width);
+			lmp_height = LittleLong(dat->height);
+		}
 
-		if (!(dat = (qpic_t *)FS_LoadTempFile(lmp_path, NULL))) {
+		if (lmp.len < 8 || lmp_width < 0 || lmp_height < 0 || (lmp_width && (lmp.len - 8) / lmp_width < lmp_height)) {
+			FS_UnmapFile(&lmp);
 			if(crash) {
 				Sys_Error ("Draw_CachePicSafe: failed to load %s", lmp_path);
 			}
 			return NULL;
 		}
 		lmp_found = true;
-
-		// Make sure the width and height are correct.
-		SwapPic (dat);
 	}
 
 	// Try loading the 24-bit picture.
@@ -571,15 +735,17 @@ mpic_t *Draw_CachePicSafe (const char *path, qbool crash, qbool only24bit)
 	if ((pic_24bit = GL_LoadPicImage(path, NULL, 0, 0, TEX_ALPHA))) {
 		// Only use the lmp-data if there was one.
 		if (lmp_found) {
-			pic_24bit->width = dat->width;
-			pic_24bit->height = dat->height;
+			pic_24bit->width = lmp_width;
+			pic_24bit->height = lmp_height;
+			FS_UnmapFile(&lmp);
 		}
 		return CachePic_Add(path, pic_24bit);
-	} else if (dat) {
+	} else if (lmp_found) {
 		mpic_t tmp = {0};
-		tmp.width = dat->width;
-		tmp.height = dat->height;
-		GL_LoadPicTexture(path, &tmp, dat->data);
+		tmp.width = lmp_width;
+		tmp.height = lmp_height;
+		GL_LoadPicTexture(path, &tmp, (byte *)dat->data);
+		FS_UnmapFile(&lmp);
 		return CachePic_Add(path, &tmp);
 	} else {
 		if(crash) {
@@ -801,6 +967,7 @@ void Draw_Init (void)
 	Cvar_Register (&gl_smoothfont);
 	Cvar_Register (&gl_consolefont);
 	Cvar_Register (&gl_alphafont);
+	Cvar_Register (&gl_batch2d);
 
 	Cvar_SetCurrentGroup(CVAR_GROUP_SCREEN);
 	Cvar_Register (&scr_menualpha);
@@ -816,6 +983,7 @@ void Draw_Init (void)
 
 	draw_chars = NULL;
 	draw_disc = draw_backtile = NULL;
+	draw_batch_quads = 0;
 
 	W_LoadWadFile("gfx.wad"); // Safe re-init.
 	CachePics_DeInit();
@@ -881,34 +1049,39 @@ static void Draw_CharacterBase (int x, int y, wchar num, float scale, qbool appl
 	if (num == 32)
 		return;
 
+	if (draw_recording)
+	{
+		Draw_Record(DRAW_CMD_CHAR, num, x, y, char_size * scale, char_size * scale, RGBA_TO_COLOR(color[0], color[1], color[2], color[3]));
+		return;
+	}
+
 	// Only apply overall opacity if it's not fully opague.
 	apply_overall_alpha = (apply_overall_alpha && (overall_alpha < 1.0));
 
-	// Only change the GL state if we're told to. We keep track of the need for GL state changes
+	// Only change the state if we're told to. We keep track of the need for state changes
 	// in the string drawing function instead. For character drawing functions we do this every time.
 	// (For instance, only change color in a string when the actual color changes, instead of doing
 	// it on each character always).
 	if (gl_statechange)
 	{
+		draw_char_state = DRAW_BATCH_BLEND;
+
 		// Turn on alpha transparency.
 		if ((gl_alphafont.value || apply_overall_alpha))
 		{
-			glDisable(GL_ALPHA_TEST);
+			draw_char_state |= DRAW_BATCH_NOALPHATEST;
 		}
 
-		glEnable(GL_BLEND);
-
 		if (scr_coloredText.integer)
 		{
-			glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-		}
-		else
-		{
-			glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+			draw_char_state |= DRAW_BATCH_MODULATE;
 		}
 
 		// Set the overall alpha.
-		glColor4ub(color[0], color[1], color[2], color[3] * overall_alpha);
+		draw_char_color[0] = color[0];
+		draw_char_color[1] = color[1];
+		draw_char_color[2] = color[2];
+		draw_char_color[3] = color[3] * overall_alpha;
 	}
 
 	if (bigchar)
@@ -927,8 +1100,10 @@ static void Draw_CharacterBase (int x, int y, wchar num, float scale, qbool appl
 
 			if (sx >= 0)
 			{
-				// Don't apply alpha here, since we already applied it above.
-				Draw_SAlphaSubPic(x, y, p, sx, sy, char_width, char_height, (((float)char_size / char_width) * scale), 1);
+				float char_scale = (((float)char_size / char_width) * scale);
+
+				// Drawn with the character state and color, alpha is already applied.
+				Draw_SubPicQuad(x, y, p, sx, sy, char_width, char_height, char_scale, char_scale, draw_char_state, draw_char_color);
 			}
 
 			return;
@@ -961,39 +1136,8 @@ static void Draw_CharacterBase (int x, int y, wchar num, float scale, qbool appl
 	frow = (num >> 4) * CHARSET_CHAR_HEIGHT;	// row = num * (16 chars per row)
 	fcol = (num & 0x0F) * CHARSET_CHAR_WIDTH;
 
-	GL_Bind(char_textures[slot]);
-
-	// Draw the character polygon.
-	glBegin(GL_QUADS);
-	{
-		float scale8 = scale * 8;
-		float scale8_2 = scale8 * 2;
-
-		// Top left.
-		glTexCoord2f (fcol, frow);
-		glVertex2f (x, y);
-
-		// Top right.
-		glTexCoord2f(fcol + CHARSET_CHAR_WIDTH, frow);
-		glVertex2f(x + scale8, y);
-
-		// Bottom right.
-		glTexCoord2f(fcol + CHARSET_CHAR_WIDTH, frow + CHARSET_CHAR_WIDTH);
-		glVertex2f(x + scale8, y + scale8_2);
-
-		// Bottom left.
-		glTexCoord2f(fcol, frow + CHARSET_CHAR_WIDTH);
-		glVertex2f(x, y + scale8_2);
-	}
-	glEnd();
-}
-
-static void Draw_ResetCharGLState(void)
-{
-	glEnable(GL_ALPHA_TEST);
-	glDisable(GL_BLEND);
-	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
-	glColor4ubv(color_white);
+	Draw_BatchQuad(char_textures[slot], draw_char_state, draw_char_color, x, y, scale * 8, scale * 16,
+		fcol, frow, fcol + CHARSET_CHAR_WIDTH, frow + CHARSET_CHAR_WIDTH);
 }
 
 void Draw_BigCharacter(int x, int y, char c, color_t color, float scale, float alpha)
@@ -1001,7 +1145,6 @@ void Draw_BigCharacter(int x, int y, char c, color_t color, float scale, float a
 	byte rgba[4];
 	COLOR_TO_RGBA(color, rgba);
 	Draw_CharacterBase(x, y, char2wc(c), scale, true, rgba, true, true);
-	Draw_ResetCharGLState();
 }
 
 void Draw_SColoredCharacterW (int x, int y, wchar num, color_t color, float scale)
@@ -1009,38 +1152,36 @@ void Draw_SColoredCharacterW (int x, int y, wchar num, color_t color, float scal
 	byte rgba[4];
 	COLOR_TO_RGBA(color, rgba);
 	Draw_CharacterBase(x, y, num, scale, true, rgba, false, true);
-	Draw_ResetCharGLState();
 }
 
 void Draw_SCharacter (int x, int y, int num, float scale)
 {
 	Draw_CharacterBase(x, y, char2wc(num), scale, true, color_white, false, true);
-	Draw_ResetCharGLState();
 }
 
 void Draw_SCharacterW (int x, int y, wchar num, float scale)
 {
 	Draw_CharacterBase(x, y, num, scale, true, color_white, false, true);
-	Draw_ResetCharGLState();
 }
 
 void Draw_CharacterW (int x, int y, wchar num)
 {
 	Draw_CharacterBase(x, y, num, 1, true, color_white, false, true);
-	Draw_ResetCharGLState();
 }
 
 void Draw_Character (int x, int y, int num)
 {
 	Draw_CharacterBase(x, y, char2wc(num), 1, true, color_white, false, true);
-	Draw_ResetCharGLState();
 }
 
 void Draw_SetColor(byte *rgba, float alpha)
 {
 	if (scr_coloredText.integer)
 	{
-		glColor4ub(rgba[0], rgba[1], rgba[2], rgba[3] * alpha * overall_alpha);
+		draw_char_color[0] = rgba[0];
+		draw_char_color[1] = rgba[1];
+		draw_char_color[2] = rgba[2];
+		draw_char_color[3] = rgba[3] * alpha * overall_alpha;
 	}
 }
 
@@ -1059,28 +1200,27 @@ static void Draw_StringBase (int x, int y, const wchar *text, clrinfo_t *color,
 
 	Draw_SetColor(color_white, alpha);
 
+	draw_char_state = DRAW_BATCH_BLEND;
+
 	// Turn on alpha transparency.
 	if (gl_alphafont.value || (overall_alpha < 1.0))
 	{
-		glDisable(GL_ALPHA_TEST);
+		draw_char_state |= DRAW_BATCH_NOALPHATEST;
 	}
 
-	glEnable(GL_BLEND);
+	if (scr_coloredText.integer)
+	{
+		draw_char_state |= DRAW_BATCH_MODULATE;
+	}
 
 	// Make sure we set the color from scratch so that the 
 	// overall opacity is applied properly.
-	if (scr_coloredText.integer)
+	if (scr_coloredText.integer && color_count > 0)
 	{
-		if (color_count > 0)
-		{
-			COLOR_TO_RGBA(color[color_index].c, rgba);
-		}
-
-		glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+		COLOR_TO_RGBA(color[color_index].c, rgba);
 	}
 	else
 	{
-		glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
 		memcpy(rgba, color_white, sizeof(byte) * 4);
 	}
 
@@ -1160,7 +1300,6 @@ static void Draw_StringBase (int x, int y, const wchar *text, clrinfo_t *color,
 		x += ((bigchar ? 64 : 8) * scale) + char_gap;
 	}
 
-	Draw_ResetCharGLState();
 }
 
 void Draw_BigString (int x, int y, const char *text, clrinfo_t *color, int color_count, float scale, float alpha, int char_gap)
@@ -1243,6 +1382,14 @@ void Draw_Crosshair (void)
 	float crosshair_scale = (crosshairscalemethod.integer ? 1 : ((float)glwidth / 320));
 	int crosshair_pixel_size = CrosshairPixelSize();
 
+	if (draw_recording)
+	{
+		Draw_Record(DRAW_CMD_CROSSHAIR, crosshair.value, cl_crossx.value, cl_crossy.value, 0, 0, RGBA_TO_COLOR(crosshaircolor.color[0], crosshaircolor.color[1], crosshaircolor.color[2], crosshaircolor.color[3]));
+		return;
+	}
+
+	Draw_FlushBatch();
+
 	if (current_crosshair_pixel_size != crosshair_pixel_size) {
 		BuildBuiltinCrosshairs();
 	}
@@ -1427,17 +1574,13 @@ void Draw_TextBox (int x, int y, int width, int lines)
 // This repeats a 64 * 64 tile graphic to fill the screen around a sized down refresh window.
 void Draw_TileClear (int x, int y, int w, int h)
 {
-	GL_Bind (draw_backtile->texnum);
-	glBegin (GL_QUADS);
-	glTexCoord2f (x / 64.0, y / 64.0);
-	glVertex2f (x, y);
-	glTexCoord2f ((x + w) / 64.0, y / 64.0);
-	glVertex2f (x + w, y);
-	glTexCoord2f ((x + w) / 64.0, (y + h) / 64.0);
-	glVertex2f (x + w, y + h);
-	glTexCoord2f (x / 64.0, (y + h) / 64.0 );
-	glVertex2f (x, y + h);
-	glEnd ();
+	if (draw_recording)
+	{
+		Draw_Record(DRAW_CMD_TILE, draw_backtile->texnum, x, y, w, h, 0);
+		return;
+	}
+
+	Draw_BatchQuad(draw_backtile->texnum, 0, color_white, x, y, w, h, x / 64.0, y / 64.0, (x + w) / 64.0, (y + h) / 64.0);
 }
 
 void Draw_AlphaRectangleRGB (int x, int y, int w, int h, float thickness, qbool fill, color_t color)
@@ -1448,6 +1591,14 @@ void Draw_AlphaRectangleRGB (int x, int y, int w, int h, float thickness, qbool
 	if ((byte)(color >> 24 & 0xFF) == 0)
 		return;
 
+	if (draw_recording)
+	{
+		Draw_Record(DRAW_CMD_RECT, fill, x, y, w, h, color);
+		return;
+	}
+
+	Draw_FlushBatch();
+
 	glDisable (GL_TEXTURE_2D);
 	glEnable (GL_BLEND);
 	glDisable(GL_ALPHA_TEST);
@@ -1499,6 +1650,15 @@ void Draw_Fill (int x, int y, int w, int h, byte c)
 void Draw_AlphaLineRGB (int x_start, int y_start, int x_end, int y_end, float thickness, color_t color)
 {
 	byte bytecolor[4];
+
+	if (draw_recording)
+	{
+		Draw_Record(DRAW_CMD_LINE, 0, x_start, y_start, x_end, y_end, color);
+		return;
+	}
+
+	Draw_FlushBatch();
+
 	glDisable (GL_TEXTURE_2D);
 
 	glEnable (GL_BLEND);
@@ -1534,6 +1694,14 @@ void Draw_Polygon(int x, int y, vec3_t *vertices, int num_vertices, qbool fill,
 	byte bytecolor[4];
 	int i = 0;
 
+	if (draw_recording)
+	{
+		Draw_Record(DRAW_CMD_POLYGON, fill, x, y, num_vertices, 0, color);
+		return;
+	}
+
+	Draw_FlushBatch();
+
 	glPushAttrib(GL_ALL_ATTRIB_BITS);
 
 	glEnable (GL_BLEND);
@@ -1573,6 +1741,14 @@ void Draw_AlphaPieSliceRGB (int x, int y, float radius, float startangle, float
 	int start;
 	int end;
 
+	if (draw_recording)
+	{
+		Draw_Record(DRAW_CMD_PIESLICE, fill, x, y, radius, endangle - startangle, color);
+		return;
+	}
+
+	Draw_FlushBatch();
+
 	glPushAttrib(GL_ALL_ATTRIB_BITS);
 
 	glDisable (GL_TEXTURE_2D);
@@ -1690,60 +1866,23 @@ void Draw_AlphaCircleFill (int x, int y, float radius, byte color, float alpha)
 //=============================================================================
 void Draw_SAlphaSubPic2 (int x, int y, mpic_t *pic, int src_x, int src_y, int src_width, int src_height, float scale_x, float scale_y, float alpha)
 {
-	float newsl, newtl, newsh, newth;
-    float oldglwidth, oldglheight;
+	byte color[4] = {255, 255, 255, 255};
 
-    if (scrap_dirty)
+	if (draw_recording)
 	{
-        Scrap_Upload ();
+		Draw_Record(DRAW_CMD_PIC, pic->texnum, x, y, src_width * scale_x, src_height * scale_y, RGBA_TO_COLOR(255, 255, 255, (byte)(bound(0, alpha, 1) * 255)));
+		return;
 	}
 
-    oldglwidth = pic->sh - pic->sl;
-    oldglheight = pic->th - pic->tl;
-
-    newsl = pic->sl + (src_x * oldglwidth) / (float)pic->width;
-    newsh = newsl + (src_width * oldglwidth) / (float)pic->width;
-
-    newtl = pic->tl + (src_y * oldglheight) / (float)pic->height;
-    newth = newtl + (src_height * oldglheight) / (float)pic->height;
-
 	alpha *= overall_alpha;
-	if(alpha < 1.0) {
-		glDisable (GL_ALPHA_TEST);
-		glEnable (GL_BLEND);
-		glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		glTexEnvf (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-		glCullFace (GL_FRONT);
-		glColor4f (1, 1, 1, alpha);
-	}
-
-    GL_Bind (pic->texnum);
-
-    glBegin (GL_QUADS);
+	if (alpha < 1.0)
 	{
-		// Upper left corner.
-		glTexCoord2f (newsl, newtl);
-		glVertex2f (x, y);
-
-		// Upper right corner.
-		glTexCoord2f (newsh, newtl);
-		glVertex2f (x + (scale_x * src_width), y);
-
-		// Bottom right corner.
-		glTexCoord2f (newsh, newth);
-		glVertex2f (x + (scale_x * src_width), y + (scale_y * src_height));
-
-		// Bottom left corner.
-		glTexCoord2f (newsl, newth);
-		glVertex2f (x, y + (scale_y * src_height));
+		color[3] = bound(0, alpha, 1) * 255;
+		Draw_SubPicQuad(x, y, pic, src_x, src_y, src_width, src_height, scale_x, scale_y, DRAW_BATCH_NOALPHATEST | DRAW_BATCH_BLEND | DRAW_BATCH_MODULATE, color);
 	}
-	glEnd ();
-	
-	if(alpha < 1.0) {
-		glEnable (GL_ALPHA_TEST);
-		glDisable (GL_BLEND);
-		glTexEnvf (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
-		glColor4f (1, 1, 1, 1);
+	else
+	{
+		Draw_SubPicQuad(x, y, pic, src_x, src_y, src_width, src_height, scale_x, scale_y, 0, color);
 	}
 }
 
@@ -1812,6 +1951,14 @@ void Draw_TransPic (int x, int y, mpic_t *pic)
 
 void Draw_SFill (int x, int y, int w, int h, byte c, float scale)
 {
+	if (draw_recording)
+	{
+		Draw_Record(DRAW_CMD_RECT, true, x, y, w * scale, h * scale, RGBA_TO_COLOR(host_basepal[c * 3], host_basepal[c * 3 + 1], host_basepal[c * 3 + 2], 255));
+		return;
+	}
+
+	Draw_FlushBatch();
+
     glDisable(GL_TEXTURE_2D);
     glColor4ub(host_basepal[c * 3], host_basepal[(c * 3) + 1], host_basepal[(c * 3) + 2 ], overall_alpha);
 
@@ -1922,6 +2069,14 @@ void Draw_FadeScreen (float alpha)
 	if (!alpha)
 		return;
 
+	if (draw_recording)
+	{
+		Draw_Record(DRAW_CMD_FADE, 0, 0, 0, vid.width, vid.height, RGBA_TO_COLOR(0, 0, 0, (byte)(alpha * 255)));
+		return;
+	}
+
+	Draw_FlushBatch();
+
 	if (alpha < 1)
 	{
 		glDisable (GL_ALPHA_TEST);
@@ -1980,8 +2135,10 @@ void Draw_BeginDisc (void)
 		return;
 #endif
 
+	Draw_FlushBatch();
 	glDrawBuffer  (GL_FRONT);
 	Draw_Pic (vid.width - 24, 0, draw_disc);
+	Draw_FlushBatch();
 	glDrawBuffer  (GL_BACK);
 }
 
@@ -1994,6 +2151,8 @@ void Draw_EndDisc (void) {}
 //
 void GL_Set2D (void)
 {
+	Draw_FlushBatch();
+
 	glViewport (glx, gly, glwidth, glheight);
 
 	glMatrixMode(GL_PROJECTION);
@@ -2051,4 +2210,57 @@ void Draw_2dAlphaTexture(float x, float y, float width, float height, int textur
 	glEnd ();
 
 	glPopAttrib();*/
-}
\ No newline at end of file
+}
+//
+// Draw recording
+//
+// While recording, the Draw_ functions above add a command to a buffer instead of touching GL,
+// so a 2D pass can be timed by itself and compared between runs.
+//
+
+qbool draw_recording = false;
+
+static draw_command_t	*draw_commands = NULL;
+static int				draw_numcommands = 0;
+static int				draw_maxcommands = 0;
+
+void Draw_Record (draw_cmd_t cmd, int texture, float x, float y, float w, float h, color_t color)
+{
+	draw_command_t *c;
+
+	if (draw_numcommands == draw_maxcommands)
+	{
+		draw_maxcommands = max(1024, draw_maxcommands * 2);
+		draw_commands = (draw_command_t *) Q_realloc(draw_commands, draw_maxcommands * sizeof(draw_command_t));
+	}
+
+	c = &draw_commands[draw_numcommands++];
+	c->cmd = cmd;
+	c->texture = texture;
+	c->x = x;
+	c->y = y;
+	c->w = w;
+	c->h = h;
+	c->color = color;
+}
+
+void Draw_RecordStart (void)
+{
+	draw_numcommands = 0;
+	draw_recording = true;
+}
+
+// Stops recording, returns the number of commands recorded.
+// bytes and checksum are optional, checksum covers the whole command stream.
+int Draw_RecordStop (int *bytes, unsigned int *checksum)
+{
+	draw_recording = false;
+
+	if (bytes)
+		*bytes = draw_numcommands * sizeof(draw_command_t);
+
+	if (checksum)
+		*checksum = draw_numcommands ? Com_BlockChecksum(draw_commands, draw_numcommands * sizeof(draw_command_t)) : 0;
+
+	return draw_numcommands;
+}
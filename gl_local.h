@@ -161,6 +161,7 @@ extern	cvar_t	r_mirroralpha;
 extern	cvar_t	r_wateralpha;
 extern	cvar_t	r_dynamic;
 extern	cvar_t	r_novis;
+extern	cvar_t	r_viscache;
 extern	cvar_t	r_netgraph;
 extern	cvar_t	r_netstats;
 extern	cvar_t	r_fullbrightSkins;
@@ -290,6 +291,10 @@ void GL_MakeAliasModelDisplayLists (model_t *m, aliashdr_t *hdr);
 void EmitDetailPolys (void);
 void R_DrawBrushModel (entity_t *e);
 void R_DrawWorld (void);
+void R_BuildWorldChains (vec3_t origin);
+void R_ClearVisCache (void);
+void R_WorldBenchmark_f (void);
+void R_SetFrustum (void);
 void R_DrawWaterSurfaces (void);
 void R_DrawAlphaChain (void);
 void GL_BuildLightmaps (void);
@@ -490,6 +490,14 @@ void Mod_LoadAlias3Model (model_t *mod, void *buffer, int filesize)
 
 	end = Hunk_LowMark ();
 	total = end - start;
+
+	if (!Hunk_LowContiguous (start)) {
+		// the hunk grew while the model was loaded, load it again into room that holds it whole
+		Hunk_FreeToLowMark (start);
+		Hunk_LowReserve (total);
+		Mod_LoadAlias3Model (mod, buffer, filesize);
+		return;
+	}
 	
 	Cache_Alloc (&mod->cache, total, loadname);
 	if (!mod->cache.data)
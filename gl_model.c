@@ -195,6 +195,7 @@ void Mod_TouchModels (void)
 model_t *Mod_LoadModel (model_t *mod, qbool crash) {
 	void *d;
 	unsigned *buf;
+	fs_mappedfile_t mapped;
 	int namelen;
 	int filesize;
 
@@ -209,38 +210,52 @@ model_t *Mod_LoadModel (model_t *mod, qbool crash) {
 	}
 
 	namelen = strlen (mod->name);
-	buf = NULL;
+	memset (&mapped, 0, sizeof(mapped));
 	if (namelen >= 4 && (!strcmp (mod->name + namelen - 4, ".mdl") ||
 		(namelen >= 9 && mod->name[5] == 'b' && mod->name[6] == '_' && !strcmp (mod->name + namelen - 4, ".bsp"))))
 	{
 		char newname[MAX_QPATH];
 		COM_StripExtension (mod->name, newname, sizeof(newname));
 		COM_DefaultExtension (newname, ".md3");
-		buf = (unsigned *) FS_LoadTempFile (newname, &filesize);
+		FS_MapFile (newname, &mapped);
 	}
 
 	// load the file
-	if (!buf)
-		buf = (unsigned *) FS_LoadTempFile (mod->name, &filesize);
-	if (!buf) {
+	if (!mapped.data)
+		FS_MapFile (mod->name, &mapped);
+	if (!mapped.data) {
 		if (crash)
 			Host_Error ("Mod_LoadModel: %s not found", mod->name);
 		return NULL;
 	}
+	if (mapped.len < 4) {
+		FS_UnmapFile (&mapped);
+		Host_Error ("Mod_LoadModel: %s is truncated", mod->name);
+	}
+	filesize = mapped.len;
 
 	// allocate a new model
 	COM_FileBase (mod->name, loadname);
 	loadmodel = mod;
-	FMod_CheckModel(mod->name, buf, filesize);
+	FMod_CheckModel(mod->name, mapped.data, filesize);
 
 	// call the apropriate loader
 	mod->needload = false;
 
-	switch (LittleLong(*((unsigned *)buf))) {
-	case IDPOLYHEADER:
-		Mod_LoadAliasModel (mod, buf, filesize);
-		break;
+	if (LittleLong(*((const unsigned *)mapped.data)) == IDPOLYHEADER) {
+		// parsed in place, the view is read-only when it comes from a pak
+		Mod_LoadAliasModel (mod, (void *) mapped.data, filesize);
+		FS_UnmapFile (&mapped);
+		return mod;
+	}
 
+	// the other loaders swap and patch the data in place
+	buf = (unsigned *) Hunk_TempAlloc (filesize + 1);
+	memcpy (buf, mapped.data, filesize);
+	((byte *) buf)[filesize] = 0;
+	FS_UnmapFile (&mapped);
+
+	switch (LittleLong(*((unsigned *)buf))) {
 	case MD3_IDENT:
 		Mod_LoadAlias3Model (mod, buf, filesize);
  		break;
@@ -1968,17 +1983,20 @@ static int Mod_LoadExternalSkin(char *identifier, int *fb_texnum)
 static void *Mod_LoadAllSkins (int numskins, daliasskintype_t *pskintype) {
 	int i, j, k, s, groupskins, gl_texnum, fb_texnum, texmode;
 	char basename[64], identifier[64];
-	byte *skin;
+	byte *skin, *texels;
 	daliasskingroup_t *pinskingroup;
 	daliasskininterval_t *pinskinintervals;
 
-	skin = (byte *) (pskintype + 1);
-
 	if (numskins < 1 || numskins > MAX_SKINS)
 		Host_Error ("Mod_LoadAllSkins: Invalid # of skins: %d\n", numskins);
 
 	s = pheader->skinwidth * pheader->skinheight;
 
+	// the model may be a read-only view of a pak, flood fill a copy of the first skin
+	skin = (byte *) Q_malloc (s);
+	memcpy (skin, pskintype + 1, s);
+	Mod_FloodFillSkin (skin, pheader->skinwidth, pheader->skinheight);
+
 	COM_StripExtension(COM_SkipPath(loadmodel->name), basename, sizeof(basename));
 
 	texmode = TEX_MIPMAP;
@@ -1987,13 +2005,13 @@ static void *Mod_LoadAllSkins (int numskins, daliasskintype_t *pskintype) {
 
 	for (i = 0; i < numskins; i++) {
 		if (pskintype->type == ALIAS_SKIN_SINGLE) {
-			Mod_FloodFillSkin (skin, pheader->skinwidth, pheader->skinheight);
+			texels = (i == 0) ? skin : (byte *) (pskintype + 1);
 
 			// save 8 bit texels for the player model to remap
 			if (loadmodel->modhint == MOD_PLAYER) {
 				if (s > sizeof(player_8bit_texels))
 					Host_Error ("Mod_LoadAllSkins: Player skin too large");
-				memcpy (player_8bit_texels, (byte *) (pskintype + 1), s);
+				memcpy (player_8bit_texels, texels, s);
 			}
 
 			snprintf (identifier, sizeof(identifier), "%s_%i", basename, i);
@@ -2001,11 +2019,11 @@ static void *Mod_LoadAllSkins (int numskins, daliasskintype_t *pskintype) {
 			gl_texnum = fb_texnum = 0;
 			if (!(gl_texnum = Mod_LoadExternalSkin(identifier, &fb_texnum))) {
 				gl_texnum = GL_LoadTexture (identifier, pheader->skinwidth, pheader->skinheight,
-					(byte *) (pskintype + 1), texmode, 1);
+					texels, texmode, 1);
 
-				if (Img_HasFullbrights((byte *)(pskintype + 1),	pheader->skinwidth * pheader->skinheight))
+				if (Img_HasFullbrights(texels, pheader->skinwidth * pheader->skinheight))
 					fb_texnum = GL_LoadTexture (va("@fb_%s", identifier), pheader->skinwidth,
-					pheader->skinheight, (byte *) (pskintype + 1), texmode | TEX_FULLBRIGHT, 1);
+					pheader->skinheight, texels, texmode | TEX_FULLBRIGHT, 1);
 			}
 
 			pheader->gl_texturenum[i][0] = pheader->gl_texturenum[i][1] =
@@ -2025,18 +2043,18 @@ static void *Mod_LoadAllSkins (int numskins, daliasskintype_t *pskintype) {
 			pskintype = (void *) (pinskinintervals + groupskins);
 
 			for (j = 0; j < groupskins; j++) {
-				Mod_FloodFillSkin (skin, pheader->skinwidth, pheader->skinheight);
+				texels = (byte *) (pskintype);
 
 				snprintf (identifier, sizeof(identifier), "%s_%i_%i", basename, i, j);
 
 				gl_texnum = fb_texnum = 0;
 				if (!(gl_texnum = Mod_LoadExternalSkin(identifier, &fb_texnum))) {
 					gl_texnum = GL_LoadTexture (identifier, pheader->skinwidth,
-						pheader->skinheight, (byte *) (pskintype), texmode, 1);
+						pheader->skinheight, texels, texmode, 1);
 
-					if (Img_HasFullbrights((byte *) (pskintype), pheader->skinwidth*pheader->skinheight))
+					if (Img_HasFullbrights(texels, pheader->skinwidth*pheader->skinheight))
 						fb_texnum = GL_LoadTexture (va("@fb_%s", identifier),
-						pheader->skinwidth,  pheader->skinheight, (byte *) (pskintype), texmode | TEX_FULLBRIGHT, 1);
+						pheader->skinwidth,  pheader->skinheight, texels, texmode | TEX_FULLBRIGHT, 1);
 				}
 
 				pheader->gl_texturenum[i][j & 3] = gl_texnum;
@@ -2051,6 +2069,9 @@ static void *Mod_LoadAllSkins (int numskins, daliasskintype_t *pskintype) {
 			}
 		}
 	}
+
+	Q_free (skin);
+
 	return pskintype;
 }
 
@@ -2186,6 +2207,14 @@ void Mod_LoadAliasModel (model_t *mod, void *buffer, int filesize) {
 	end = Hunk_LowMark ();
 	total = end - start;
 
+	if (!Hunk_LowContiguous (start)) {
+		// the hunk grew while the model was loaded, load it again into room that holds it whole
+		Hunk_FreeToLowMark (start);
+		Hunk_LowReserve (total);
+		Mod_LoadAliasModel (mod, buffer, filesize);
+		return;
+	}
+
 	Cache_Alloc (&mod->cache, total, loadname);
 	if (!mod->cache.data)
 		return;
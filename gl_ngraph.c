@@ -224,6 +224,14 @@ void R_MQW_NetGraph(int outgoing_sequence, int incoming_sequence, int *packet_la
         y += 8;
     }
 
+    if (draw_recording)
+    {
+        Draw_Record(DRAW_CMD_PIC, netgraphtexture, x, y, width, height, RGBA_TO_COLOR(255, 255, 255, (byte)(alpha * 255)));
+        return;
+    }
+
+    Draw_FlushBatch();
+
     if (alpha < 1)
     {
         glDisable(GL_ALPHA_TEST);
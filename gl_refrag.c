@@ -172,7 +172,7 @@ void R_StoreEfrags (efrag_t **ppefrag) {
 		case mod_brush:
 		case mod_sprite:
 			if (pent->visframe != r_framecount) {
-				CL_AddEntity (pent);				
+				CL_AddRenderEntity (pent);				
 				pent->visframe = r_framecount;	// mark that we've recorded this entity for this frame
 				pent->oldframe = pent->frame;
 			}
@@ -1987,6 +1987,7 @@ void R_Init(void)
 
 	Cmd_AddCommand ("loadsky", R_LoadSky_f);
 	Cmd_AddCommand ("timerefresh", R_TimeRefresh_f);
+	Cmd_AddCommand ("r_worldbenchmark", R_WorldBenchmark_f);
 #ifndef CLIENTONLY
 	Cmd_AddCommand ("pointfile", R_ReadPointFile_f);
 #endif
@@ -2060,6 +2061,7 @@ void R_Init(void)
 	Cvar_Register (&r_watercolor);
 
 	Cvar_Register (&r_novis);
+	Cvar_Register (&r_viscache);
 	Cvar_Register (&r_wateralpha);
 	Cvar_Register (&gl_caustics);
 	if (!COM_CheckParm ("-nomtex")) {
@@ -1397,6 +1397,8 @@ void R_DrawBrushModel (entity_t *e) {
 }
 
 
+static qbool r_world_efrags = true;	// false when chains are built without drawing, see R_WorldBenchmark_f
+
 void R_RecursiveWorldNode (mnode_t *node, int clipflags) {
 	int c, side, clipped, underwater;
 	mplane_t *plane, *clipplane;
@@ -1434,7 +1436,7 @@ void R_RecursiveWorldNode (mnode_t *node, int clipflags) {
 		}
 
 	// deal with model fragments in this leaf
-		if (pleaf->efrags)
+		if (pleaf->efrags && r_world_efrags)
 			R_StoreEfrags (&pleaf->efrags);
 
 		return;
@@ -1487,6 +1489,16 @@ void R_RecursiveWorldNode (mnode_t *node, int clipflags) {
 	R_RecursiveWorldNode (node->children[!side], clipflags);
 }
 
+// Chains the world surfaces visible from origin, within the frustum and the leaves marked by R_MarkLeaves. No GL.
+void R_BuildWorldChains (vec3_t origin)
+{
+	R_ClearTextureChains(cl.worldmodel);
+
+	VectorCopy (origin, modelorg);
+
+	R_RecursiveWorldNode (cl.worldmodel->nodes, 15);
+}
+
 void R_DrawWorld (void)
 {
 	entity_t ent;
@@ -1496,15 +1508,11 @@ void R_DrawWorld (void)
 	memset (&ent, 0, sizeof(ent));
 	ent.model = cl.worldmodel;
 
-	R_ClearTextureChains(cl.worldmodel);
-
-	VectorCopy (r_refdef.vieworg, modelorg);
-
 	currententity = &ent;
 	currenttexture = -1;
 
 	//set up texture chains for the world
-	R_RecursiveWorldNode (cl.worldmodel->nodes, 15);
+	R_BuildWorldChains (r_refdef.vieworg);
 	
 	//draw the world sky
 	R_DrawSky ();
@@ -1541,41 +1549,47 @@ void R_DrawWorld (void)
 	R_DrawAlphaChain ();
 }
 
-void R_MarkLeaves (void) {
-	byte *vis;
-	mnode_t *node;
+/*
+	Visibility cache
+
+	The PVS of a viewleaf is kept as the list of the leaves it makes visible together with their
+	parent nodes, so going back to a viewleaf seen recently (multiview, a player moving back and
+	forth between two leaves) only stamps those nodes instead of decompressing and walking the PVS
+	again. The entries are reused least recently used first, and dropped on map change.
+*/
+
+#define VIS_CACHE_SIZE	8
+
+typedef struct vis_cache_s {
+	mleaf_t		*leaf, *leaf2;		// r_viewleaf and r_viewleaf2 (watervis hack) of the entry, NULL leaf for unused
+	mnode_t		**nodes;			// the leaves in the PVS and every node above them, once each
+	int			numnodes;
+	int			maxnodes;
+	int			lastused;
+} vis_cache_t;
+
+static vis_cache_t	vis_cache[VIS_CACHE_SIZE];
+static int			vis_cache_time;
+static mleaf_t		*vis_marked_leaf, *vis_marked_leaf2;	// the nodes are marked with r_visframecount for these, NULL if for none
+
+cvar_t r_viscache = {"r_viscache", "1"};
+
+void R_ClearVisCache (void)
+{
 	int i;
-	byte solid[MAX_MAP_LEAFS/8];
 
-	if (!r_novis.value && r_oldviewleaf == r_viewleaf
-		&& r_oldviewleaf2 == r_viewleaf2)	// watervis hack
-		return;
+	for (i = 0; i < VIS_CACHE_SIZE; i++)
+		vis_cache[i].leaf = vis_cache[i].leaf2 = NULL;
 
-	r_visframecount++;
-	r_oldviewleaf = r_viewleaf;
+	vis_marked_leaf = vis_marked_leaf2 = NULL;
+}
+
+// Marks the leaves set in vis and their parents with r_visframecount, and lists them in entry if there is one.
+static void R_MarkVisLeaves (byte *vis, vis_cache_t *entry)
+{
+	mnode_t *node;
+	int i;
 
-	if (r_novis.value) {
-		vis = solid;
-		memset (solid, 0xff, (cl.worldmodel->numleafs + 7) >> 3);
-	} else {
-		vis = Mod_LeafPVS (r_viewleaf, cl.worldmodel);
-
-		if (r_viewleaf2) {
-			int			i, count;
-			unsigned	*src, *dest;
-
-			// merge visibility data for two leafs
-			count = (cl.worldmodel->numleafs + 7) >> 3;
-			memcpy (solid, vis, count);
-			src = (unsigned *) Mod_LeafPVS (r_viewleaf2, cl.worldmodel);
-			dest = (unsigned *) solid;
-			count = (count + 3) >> 2;
-			for (i = 0; i < count; i++)
-				*dest++ |= *src++;
-			vis = solid;
-		}
-	}
-		
 	for (i = 0; i < cl.worldmodel->numleafs; i++)	{
 		if (vis[i >> 3] & (1 << (i & 7))) {
 			node = (mnode_t *)&cl.worldmodel->leafs[i + 1];
@@ -1583,12 +1597,202 @@ void R_MarkLeaves (void) {
 				if (node->visframe == r_visframecount)
 					break;
 				node->visframe = r_visframecount;
+
+				if (entry) {
+					if (entry->numnodes == entry->maxnodes) {
+						entry->maxnodes = max(256, entry->maxnodes * 2);
+						entry->nodes = (mnode_t **) Q_realloc(entry->nodes, entry->maxnodes * sizeof(mnode_t *));
+					}
+					entry->nodes[entry->numnodes++] = node;
+				}
+
 				node = node->parent;
 			} while (node);
 		}
 	}
 }
 
+static vis_cache_t *R_VisCacheFind (mleaf_t *leaf, mleaf_t *leaf2)
+{
+	vis_cache_t *entry, *oldest = vis_cache;
+	int i;
+
+	for (i = 0, entry = vis_cache; i < VIS_CACHE_SIZE; i++, entry++) {
+		if (entry->leaf == leaf && entry->leaf2 == leaf2)
+			return entry;
+
+		if (!entry->leaf || (oldest->leaf && entry->lastused < oldest->lastused))
+			oldest = entry;
+	}
+
+	oldest->leaf = NULL;
+	oldest->numnodes = 0;
+	return oldest;
+}
+
+void R_MarkLeaves (void) {
+	byte *vis;
+	vis_cache_t *entry = NULL;
+	int i;
+	byte solid[MAX_MAP_LEAFS/8];
+
+	if (r_novis.value) {
+		vis_marked_leaf = vis_marked_leaf2 = NULL;
+		r_visframecount++;
+		memset (solid, 0xff, (cl.worldmodel->numleafs + 7) >> 3);
+		R_MarkVisLeaves (solid, NULL);
+		return;
+	}
+
+	if (vis_marked_leaf == r_viewleaf && vis_marked_leaf2 == r_viewleaf2)
+		return;
+
+	r_visframecount++;
+	vis_marked_leaf = r_viewleaf;
+	vis_marked_leaf2 = r_viewleaf2;
+
+	if (r_viscache.integer) {
+		entry = R_VisCacheFind (r_viewleaf, r_viewleaf2);
+		entry->lastused = ++vis_cache_time;
+
+		if (entry->leaf) {
+			for (i = 0; i < entry->numnodes; i++)
+				entry->nodes[i]->visframe = r_visframecount;
+			return;
+		}
+	}
+
+	vis = Mod_LeafPVS (r_viewleaf, cl.worldmodel);
+
+	if (r_viewleaf2) {
+		int			count;
+		unsigned	*src, *dest;
+
+		// merge visibility data for two leafs
+		count = (cl.worldmodel->numleafs + 7) >> 3;
+		memcpy (solid, vis, count);
+		src = (unsigned *) Mod_LeafPVS (r_viewleaf2, cl.worldmodel);
+		dest = (unsigned *) solid;
+		count = (count + 3) >> 2;
+		for (i = 0; i < count; i++)
+			*dest++ |= *src++;
+		vis = solid;
+	}
+
+	R_MarkVisLeaves (vis, entry);
+
+	if (entry) {
+		entry->leaf = r_viewleaf;
+		entry->leaf2 = r_viewleaf2;
+	}
+}
+
+static int R_CountChain (msurface_t *chain)
+{
+	int count = 0;
+
+	for ( ; chain; chain = chain->texturechain)
+		count++;
+
+	return count;
+}
+
+/*
+	r_worldbenchmark [views]
+
+	Flies through the leaves of the map, looking around in each, and times marking the PVS and
+	chaining the world surfaces without and with r_viscache, nothing is drawn. The path is split
+	between views walkers that take turns, the way multiview views do.
+*/
+void R_WorldBenchmark_f (void)
+{
+	mleaf_t *leaf, *saved_leaf, *saved_leaf2;
+	vec3_t saved_origin, saved_vpn, saved_vright, saved_vup, origin, angles;
+	mplane_t saved_frustum[4];
+	double start, time[2];
+	int views, steps, numleafs, step, view, pass, i, frames, surfaces, saved_viscache;
+	texture_t *texture;
+
+	if (cls.state != ca_active || !cl.worldmodel) {
+		Com_Printf ("r_worldbenchmark: no map loaded\n");
+		return;
+	}
+
+	views = (Cmd_Argc() > 1 ? bound(1, Q_atoi(Cmd_Argv(1)), 4) : 1);
+	numleafs = cl.worldmodel->numleafs;
+	steps = numleafs * 4;
+
+	saved_leaf = r_viewleaf;
+	saved_leaf2 = r_viewleaf2;
+	VectorCopy (r_origin, saved_origin);
+	VectorCopy (vpn, saved_vpn);
+	VectorCopy (vright, saved_vright);
+	VectorCopy (vup, saved_vup);
+	memcpy (saved_frustum, frustum, sizeof(frustum));
+	saved_viscache = r_viscache.integer;
+
+	r_world_efrags = false;
+	surfaces = 0;
+
+	for (pass = 0; pass < 2; pass++) {
+		r_viscache.integer = pass;
+		R_ClearVisCache ();
+		frames = 0;
+
+		start = Sys_DoubleTime ();
+		for (step = 0; step < steps; step++) {
+			// each view walks its own part of the map, four directions in every leaf
+			view = step % views;
+			i = ((step / views) / 4 + view * numleafs / views) % numleafs;
+			leaf = &cl.worldmodel->leafs[i + 1];
+			if (leaf->contents == CONTENTS_SOLID)
+				continue;
+
+			VectorAdd (leaf->minmaxs, leaf->minmaxs + 3, origin);
+			VectorScale (origin, 0.5, origin);
+			VectorSet (angles, 0, ((step / views) % 4) * 90, 0);
+
+			frames++;
+			r_framecount++;
+			VectorCopy (origin, r_origin);
+			AngleVectors (angles, vpn, vright, vup);
+			R_SetFrustum ();
+
+			r_viewleaf = leaf;
+			r_viewleaf2 = NULL;
+			R_MarkLeaves ();
+			R_BuildWorldChains (origin);
+
+			if (pass) {
+				surfaces += R_CountChain (skychain) + R_CountChain (waterchain) + R_CountChain (alphachain);
+				for (i = 0; i < cl.worldmodel->numtextures; i++) {
+					if ((texture = cl.worldmodel->textures[i]))
+						surfaces += R_CountChain (texture->texturechain[0]) + R_CountChain (texture->texturechain[1]);
+				}
+			}
+		}
+		time[pass] = Sys_DoubleTime () - start;
+	}
+
+	r_world_efrags = true;
+	r_viscache.integer = saved_viscache;
+	R_ClearVisCache ();
+	R_ClearTextureChains (cl.worldmodel);
+
+	r_viewleaf = saved_leaf;
+	r_viewleaf2 = saved_leaf2;
+	VectorCopy (saved_origin, r_origin);
+	VectorCopy (saved_vpn, vpn);
+	VectorCopy (saved_vright, vright);
+	VectorCopy (saved_vup, vup);
+	memcpy (frustum, saved_frustum, sizeof(frustum));
+
+	frames = max(frames, 1);
+	Com_Printf ("%s: %d leaves, %d view%s, %d frames, %.1f surfaces per frame\n", cl.worldmodel->name, numleafs, views, (views == 1 ? "" : "s"), frames, (float) surfaces / frames);
+	Com_Printf ("r_viscache 0: %.3f ms per frame\n", 1000 * time[0] / frames);
+	Com_Printf ("r_viscache 1: %.3f ms per frame\n", 1000 * time[1] / frames);
+}
+
 
 // returns a texture number and the position inside it
 int AllocBlock (int w, int h, int *x, int *y) {
@@ -321,7 +321,7 @@ static void brighten32 (byte *data, int size)
 static void GL_Upload32 (unsigned *data, int width, int height, int mode) 
 {
 	int	internal_format, tempwidth, tempheight, miplevel;
-	unsigned int *newdata;
+	unsigned int *newdata, *mipdata, *swap;
 
 	if (gl_support_arb_texture_non_power_of_two)
 	{
@@ -365,10 +365,17 @@ static void GL_Upload32 (unsigned *data, int width, int height, int mode)
 	// Get the scaled dimension (scales according to gl_picmip and max allowed texture size).
 	ScaleDimensions(width, height, &tempwidth, &tempheight, mode);
 
+	// Mip levels are reduced back and forth between two buffers rather than
+	// in place, so Image_MipReduce can spread big ones over its worker threads.
+	mipdata = (unsigned int *) Q_malloc((width * height / 2 + 1) * 4);
+
 	// If the image size is bigger than the max allowed size or 
 	// set picmip value we calculate it's next closest mip map.
 	while (width > tempwidth || height > tempheight)
-		Image_MipReduce ((byte *) newdata, (byte *) newdata, &width, &height, 4);
+	{
+		Image_MipReduce ((byte *) newdata, (byte *) mipdata, &width, &height, 4);
+		swap = newdata; newdata = mipdata; mipdata = swap;
+	}
 
 	if (mode & TEX_BRIGHTEN)
 		brighten32 ((byte *)newdata, width * height * 4);
@@ -395,7 +402,8 @@ static void GL_Upload32 (unsigned *data, int width, int height, int mode)
 		// Calculate the mip maps for the images.
 		while (width > 1 || height > 1)
 		{
-			Image_MipReduce ((byte *) newdata, (byte *) newdata, &width, &height, 4);
+			Image_MipReduce ((byte *) newdata, (byte *) mipdata, &width, &height, 4);
+			swap = newdata; newdata = mipdata; mipdata = swap;
 			miplevel++;
 			glTexImage2D (GL_TEXTURE_2D, miplevel, internal_format, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, newdata);
 		}
@@ -413,6 +421,7 @@ static void GL_Upload32 (unsigned *data, int width, int height, int mode)
 	}
 
 	Q_free(newdata);
+	Q_free(mipdata);
 }
 
 static void GL_Upload8 (byte *data, int width, int height, int mode) 
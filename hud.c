@@ -67,6 +67,14 @@ char *snap_strings[] = {
 // Hud elements list.
 hud_t *hud_huds = NULL;
 
+// Bumped whenever element positions have to be worked out again.
+static int hud_layout_sequence = 1;
+static qbool hud_layout_changed;		// A placement cvar was changed.
+
+// Frames left to time with hud_profile.
+static int hud_profile_frames;
+static int hud_profile_total;
+
 //
 // Hud plus func - show element.
 //
@@ -778,12 +786,87 @@ void HUD_Recalculate(void)
 
         hud = hud->next;
     }
+
+    hud_layout_sequence++;
+    hud_layout_changed = false;
 }
 void HUD_Recalculate_f(void)
 {
     HUD_Recalculate();
 }
 
+//
+// Time the next frames and show what each element took.
+//
+void HUD_Profile_f(void)
+{
+	if (Cmd_Argc() > 2)
+	{
+		Com_Printf("Usage: %s [frames]\n", Cmd_Argv(0));
+		return;
+	}
+
+	if (hud_profile_frames)
+	{
+		Com_Printf("HUD profile: %d of %d frames left\n", hud_profile_frames, hud_profile_total);
+		return;
+	}
+
+	hud_profile_total = hud_profile_frames = bound(1, (Cmd_Argc() == 2 ? Q_atoi(Cmd_Argv(1)) : 100), 100000);
+	Com_Printf("Timing HUD elements over %d frames\n", hud_profile_total);
+}
+
+static int HUD_ProfileCompare(const void *p1, const void *p2)
+{
+	const hud_t *h1 = *((hud_t **)p1);
+	const hud_t *h2 = *((hud_t **)p2);
+
+	if (h1->profile_time == h2->profile_time)
+		return 0;
+
+	return (h1->profile_time < h2->profile_time) ? 1 : -1;
+}
+
+//
+// Prints what hud_profile measured and resets it.
+//
+static void HUD_ProfileReport(void)
+{
+	hud_t *huds[MAX_HUD_ELEMENTS];
+	hud_t *hud;
+	double total = 0;
+	int i, count = 0;
+
+	for (hud = hud_huds; hud && count < MAX_HUD_ELEMENTS; hud = hud->next)
+	{
+		if (hud->profile_frames)
+		{
+			huds[count++] = hud;
+			total += hud->profile_time;
+		}
+	}
+
+	qsort(huds, count, sizeof(huds[0]), HUD_ProfileCompare);
+
+	Com_Printf("HUD profile over %d frames, ms per frame:\n", hud_profile_total);
+	Com_Printf("%-20s %8s %8s %7s\n", "element", "mean", "max", "frames");
+
+	for (i = 0; i < count; i++)
+	{
+		hud = huds[i];
+		Com_Printf("%-20s %8.3f %8.3f %7d\n", hud->name,
+			1000 * hud->profile_time / hud_profile_total, 1000 * hud->profile_max, hud->profile_frames);
+	}
+
+	Com_Printf("%-20s %8.3f\n", "total", 1000 * total / hud_profile_total);
+
+	for (hud = hud_huds; hud; hud = hud->next)
+	{
+		hud->profile_time = hud->profile_max = 0;
+		hud->profile_frames = 0;
+	}
+}
+
 //
 // Initialize HUD.
 //
@@ -802,6 +885,7 @@ void HUD_Init(void)
     Cmd_AddCommand ("togglehud", HUD_Toggle_f);
     Cmd_AddCommand ("align", HUD_Align_f);
     Cmd_AddCommand ("hud_recalculate", HUD_Recalculate_f);
+    Cmd_AddCommand ("hud_profile", HUD_Profile_f);
 
 	// Variables.
     Cvar_SetCurrentGroup(CVAR_GROUP_HUD);
@@ -931,10 +1015,9 @@ qbool HUD_PrepareDrawByName(char *name, int width, int height,	// In.
 }
 
 //
-// Calculate object extents and draws frame if needed.
+// Works out where the element goes, into its layout cache.
 //
-qbool HUD_PrepareDraw(hud_t *hud, int width, int height, // In.
-					  int *ret_x, int *ret_y)			 // Out (Position).
+static void HUD_CalcLayout(hud_t *hud, int width, int height)
 {
     extern vrect_t scr_vrect;
     int x, y;
@@ -942,14 +1025,11 @@ qbool HUD_PrepareDraw(hud_t *hud, int width, int height, // In.
     int area_x, area_y, area_width, area_height;			// Area coordinates & sizes to align.
     int bounds_x, bounds_y, bounds_width, bounds_height;	// Bounds to draw within.
 
-	// Don't show the hud element.
-	if (cls.state < hud->min_state || !hud->show->value)
-	{
-        return false;
-	}
-
     HUD_CalcFrameExtents(hud, width, height, &frame_left, &frame_right, &frame_top, &frame_bottom);
 
+    hud->layout_w = width;
+    hud->layout_h = height;
+
     width  += frame_left + frame_right;
     height += frame_top + frame_bottom;
 
@@ -1091,6 +1171,59 @@ qbool HUD_PrepareDraw(hud_t *hud, int width, int height, // In.
 
     y += hud->pos_y->value;
 
+    hud->layout_x = x;
+    hud->layout_y = y;
+    hud->layout_frame[0] = frame_left;
+    hud->layout_frame[1] = frame_right;
+    hud->layout_frame[2] = frame_top;
+    hud->layout_frame[3] = frame_bottom;
+    hud->layout_sequence = hud_layout_sequence;
+}
+
+//
+// Calculate object extents and draws frame if needed.
+//
+qbool HUD_PrepareDraw(hud_t *hud, int width, int height, // In.
+					  int *ret_x, int *ret_y)			 // Out (Position).
+{
+    int x, y;
+    int frame_left, frame_right, frame_top, frame_bottom;	// Frame left, right, top and bottom.
+    int area[4];
+
+	// Don't show the hud element.
+	if (cls.state < hud->min_state || !hud->show->value)
+	{
+        return false;
+	}
+
+    // Where the parent is can change from frame to frame.
+    memset(area, 0, sizeof(area));
+    if (hud->place_hud)
+    {
+        area[0] = hud->place_hud->lx - (hud->place_outside ? hud->place_hud->al : 0);
+        area[1] = hud->place_hud->ly - (hud->place_outside ? hud->place_hud->at : 0);
+        area[2] = hud->place_hud->lw + (hud->place_outside ? hud->place_hud->al + hud->place_hud->ar : 0);
+        area[3] = hud->place_hud->lh + (hud->place_outside ? hud->place_hud->at + hud->place_hud->ab : 0);
+    }
+
+    if (hud->layout_sequence != hud_layout_sequence
+        || hud->layout_w != width || hud->layout_h != height
+        || memcmp(hud->layout_area, area, sizeof(area))
+        || hud->align_y_num == HUD_ALIGN_CONSOLE)	// follows the console as it slides
+    {
+        memcpy(hud->layout_area, area, sizeof(area));
+        HUD_CalcLayout(hud, width, height);
+    }
+
+    x = hud->layout_x;
+    y = hud->layout_y;
+    frame_left = hud->layout_frame[0];
+    frame_right = hud->layout_frame[1];
+    frame_top = hud->layout_frame[2];
+    frame_bottom = hud->layout_frame[3];
+    width = hud->layout_w + frame_left + frame_right;
+    height = hud->layout_h + frame_top + frame_bottom;
+
     // Draw frame.
     HUD_DrawFrame(hud, x, y, width, height);
 
@@ -1156,6 +1289,14 @@ void HUD_OnChangeOrder(cvar_t *var, char *val, qbool *cancel)
 	HUD_Sort();
 }
 
+//
+// Onchange for the cvars placing an element, positions are worked out again before the next draw.
+//
+void HUD_OnChangePlacement(cvar_t *var, char *val, qbool *cancel)
+{
+	hud_layout_changed = true;
+}
+
 //
 // Registers a new HUD element to the list of HUD elements.
 //
@@ -1229,6 +1370,7 @@ hud_t * HUD_Register(char *name, char *var_alias, char *description,
     // Place.
 	//
     hud->place = HUD_CreateVar(name, "place", place);
+    hud->place->OnChange = HUD_OnChangePlacement;
     i = HUD_FindPlace(hud);
     if (i == 0)
     {
@@ -1265,6 +1407,7 @@ hud_t * HUD_Register(char *name, char *var_alias, char *description,
     {
         hud->pos_x = HUD_CreateVar(name, "pos_x", pos_x);
         hud->align_x = HUD_CreateVar(name, "align_x", align_x);
+        hud->pos_x->OnChange = hud->align_x->OnChange = HUD_OnChangePlacement;
     }
     else
 	{
@@ -1278,6 +1421,7 @@ hud_t * HUD_Register(char *name, char *var_alias, char *description,
     {
         hud->pos_y = HUD_CreateVar(name, "pos_y", pos_y);
         hud->align_y = HUD_CreateVar(name, "align_y", align_y);
+        hud->pos_y->OnChange = hud->align_y->OnChange = HUD_OnChangePlacement;
     }
     else
 	{
@@ -1290,6 +1434,7 @@ hud_t * HUD_Register(char *name, char *var_alias, char *description,
     if (frame)
     {
         hud->frame = HUD_CreateVar(name, "frame", frame);
+        hud->frame->OnChange = HUD_OnChangePlacement;
         hud->params[hud->num_params++] = hud->frame;
 
 		hud->frame_color = HUD_CreateVar(name, "frame_color", frame_color);
@@ -1377,13 +1522,11 @@ hud_t * HUD_Find(char *name)
 cvar_t *HUD_FindVar(hud_t *hud, char *subvar)
 {
     int i;
-    char buf[128];
-
-    snprintf(buf, sizeof(buf), "hud_%s_%s", hud->name, subvar);
+    size_t prefix = strlen(hud->name) + 5;	// All params are named "hud_<element>_<subvar>".
 
     for (i=0; i < hud->num_params; i++)
 	{
-        if (!strcmp(buf, hud->params[i]->name))
+        if (strlen(hud->params[i]->name) > prefix && !strcmp(hud->params[i]->name + prefix, subvar))
 		{
             return hud->params[i];
 		}
@@ -1449,13 +1592,48 @@ void HUD_DrawObject(hud_t *hud)
 	// Let the HUD element draw itself - updates last_draw_sequence itself.
 	//
 	Draw_SetOverallAlpha(hud->opacity->value);
-	hud->draw_func(hud);
+	if (hud_profile_frames)
+	{
+		double t = Sys_DoubleTime();
+
+		hud->draw_func(hud);
+
+		t = Sys_DoubleTime() - t;
+		hud->profile_time += t;
+		hud->profile_max = max(hud->profile_max, t);
+		hud->profile_frames++;
+	}
+	else
+	{
+		hud->draw_func(hud);
+	}
 	Draw_SetOverallAlpha(1.0);
 
 	// last_draw_sequence is update by HUD_PrepareDraw
     // if object was succesfully drawn (wasn't outside area etc..)
 }
 
+//
+// Invalidates the cached positions if a placement cvar or the screen changed.
+//
+static void HUD_CheckLayout(void)
+{
+    extern vrect_t scr_vrect;
+	static int last_screen[7];
+	int screen[7] = { vid.width, vid.height, sb_lines, scr_vrect.x, scr_vrect.y, scr_vrect.width, scr_vrect.height };
+
+	if (hud_layout_changed)
+	{
+		HUD_Recalculate();
+	}
+	else if (memcmp(screen, last_screen, sizeof(screen)))
+	{
+		hud_layout_sequence++;
+	}
+
+	memcpy(last_screen, screen, sizeof(screen));
+}
+
 //
 // Draw all active elements.
 //
@@ -1485,6 +1663,8 @@ void HUD_Draw(void)
 		return;
 	}
 
+	HUD_CheckLayout();
+
     hud = hud_huds;
 
 	HUD_BeforeDraw();
@@ -1499,6 +1679,11 @@ void HUD_Draw(void)
     }
 
 	HUD_AfterDraw();
+
+	if (hud_profile_frames && !--hud_profile_frames)
+	{
+		HUD_ProfileReport();
+	}
 }
 
 //
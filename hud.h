@@ -111,6 +111,18 @@ typedef struct hud_s
     int last_try_sequence;				// Sequence, at which object tried to draw itself.
     int last_draw_sequence;				// Sequence, at which it was last drawn successfully.
 
+    // Layout cache, HUD_PrepareDraw reuses the position while nothing it depends on changes.
+    int layout_sequence;				// hud_layout_sequence the position was worked out at.
+    int layout_w, layout_h;				// Size it was worked out for.
+    int layout_area[4];					// Parent area it was aligned in, if placed at another element.
+    int layout_x, layout_y;				// Position of the frame.
+    int layout_frame[4];				// Frame extents, left, right, top and bottom.
+
+    // hud_profile
+    double profile_time;				// Time spent drawing, in seconds.
+    double profile_max;					// Longest frame.
+    int profile_frames;					// Frames it was drawn in.
+
     struct hud_s *next;					// Next HUD in the list.
 } hud_t;
 
@@ -714,11 +714,15 @@ void SCR_HUD_DrawDemoClock(hud_t *hud)
 	int x = 0;
 	int y = 0;
 	const char *t;
+	char underruns[32] = "";
+	qbool waiting;
+	int clock_height;
 	static cvar_t
 		*hud_democlock_big = NULL,
 		*hud_democlock_style,
 		*hud_democlock_blink,
-		*hud_democlock_scale;
+		*hud_democlock_scale,
+		*hud_democlock_underruns;
 
 	if (!cls.demoplayback || cls.mvdplayback == QTV_PLAYBACK)
 	{
@@ -732,11 +736,24 @@ void SCR_HUD_DrawDemoClock(hud_t *hud)
 		hud_democlock_style = HUD_FindVar(hud, "style");
 		hud_democlock_blink = HUD_FindVar(hud, "blink");
 		hud_democlock_scale = HUD_FindVar(hud, "scale");
+		hud_democlock_underruns = HUD_FindVar(hud, "underruns");
 	}
 
 	t = SCR_GetTimeString(TIMETYPE_DEMOCLOCK, NULL);
 	width = SCR_GetClockStringWidth(t, hud_democlock_big->integer, hud_democlock_scale->value);
-	height = SCR_GetClockStringHeight(hud_democlock_big->integer, hud_democlock_scale->value);
+	height = clock_height = SCR_GetClockStringHeight(hud_democlock_big->integer, hud_democlock_scale->value);
+
+	// Let the user know the demo is held up by reading it from disk.
+	if (hud_democlock_underruns->integer && CL_Demo_Underruns(&waiting))
+	{
+		if (waiting)
+			strlcpy(underruns, "buffering", sizeof(underruns));
+		else
+			snprintf(underruns, sizeof(underruns), "%d underruns", CL_Demo_Underruns(NULL));
+
+		width = max(width, (int) (strlen(underruns) * 8 * hud_democlock_scale->value));
+		height += 8 * hud_democlock_scale->value;
+	}
 
 	if (HUD_PrepareDraw(hud, width, height, &x, &y))
 	{
@@ -744,6 +761,9 @@ void SCR_HUD_DrawDemoClock(hud_t *hud)
 			SCR_DrawBigClock(x, y, hud_democlock_style->value, hud_democlock_blink->value, hud_democlock_scale->value, t);
 		else
 			SCR_DrawSmallClock(x, y, hud_democlock_style->value, hud_democlock_blink->value, hud_democlock_scale->value, t);
+
+		if (underruns[0])
+			Draw_SString(x, y + clock_height, underruns, hud_democlock_scale->value);
 	}
 }
 
@@ -4799,6 +4819,24 @@ void SCR_HUD_DrawTeamHoldInfo(hud_t *hud)
 
 static int SCR_HudDrawTeamInfoPlayer(ti_player_t *ti_cl, int x, int y, int maxname, int maxloc, qbool width_only, hud_t *hud);
 
+// Parameters used for each player, looked up once.
+static cvar_t
+	*hud_teaminfo_layout = NULL,
+	*hud_teaminfo_player_scale,
+	*hud_teaminfo_player_weapon_style,
+	*hud_teaminfo_low_health,
+	*hud_teaminfo_armor_style,
+	*hud_teaminfo_powerup_style;
+
+// hud_teaminfo_layout with the fun chars parsed, until it changes.
+static char hud_teaminfo_layout_parsed[MAX_MACRO_STRING];
+static qbool hud_teaminfo_layout_valid = false;
+
+static void TeamInfo_OnChangeLayout(cvar_t *var, char *newval, qbool *cancel)
+{
+	hud_teaminfo_layout_valid = false;
+}
+
 static int HUD_CompareTeamInfoSlots(const void* lhs_, const void* rhs_)
 {
 	int lhs = *(const int*)lhs_;
@@ -4950,12 +4988,26 @@ static int SCR_HudDrawTeamInfoPlayer(ti_player_t *ti_cl, int x, int y, int maxna
 	int x_in = x; // save x
 	int i;
 	mpic_t *pic;
-	float scale = HUD_FindVar(hud, "scale")->value;
+	float scale;
 
 	extern mpic_t  *sb_face_invis, *sb_face_quad, *sb_face_invuln;
 	extern mpic_t  *sb_armor[3];
 	extern mpic_t *sb_items[32];
 
+	if (hud_teaminfo_layout == NULL)    // first time
+	{
+		hud_teaminfo_layout					= HUD_FindVar(hud, "layout");
+		hud_teaminfo_player_scale			= HUD_FindVar(hud, "scale");
+		hud_teaminfo_player_weapon_style	= HUD_FindVar(hud, "weapon_style");
+		hud_teaminfo_low_health				= HUD_FindVar(hud, "low_health");
+		hud_teaminfo_armor_style			= HUD_FindVar(hud, "armor_style");
+		hud_teaminfo_powerup_style			= HUD_FindVar(hud, "powerup_style");
+
+		hud_teaminfo_layout->OnChange = TeamInfo_OnChangeLayout;
+	}
+
+	scale = hud_teaminfo_player_scale->value;
+
 	if (!ti_cl)
 		return 0;
 
@@ -4967,10 +5019,14 @@ static int SCR_HudDrawTeamInfoPlayer(ti_player_t *ti_cl, int x, int y, int maxna
 		return 0;
 	}
 
-	// this limit len of string because TP_ParseFunChars() do not check overflow
-	strlcpy(tmp2, HUD_FindVar(hud, "layout")->string , sizeof(tmp2));
-	strlcpy(tmp2, TP_ParseFunChars(tmp2, false), sizeof(tmp2));
-	s = tmp2;
+	if (!hud_teaminfo_layout_valid)
+	{
+		// this limit len of string because TP_ParseFunChars() do not check overflow
+		strlcpy(tmp2, hud_teaminfo_layout->string , sizeof(tmp2));
+		strlcpy(hud_teaminfo_layout_parsed, TP_ParseFunChars(tmp2, false), sizeof(hud_teaminfo_layout_parsed));
+		hud_teaminfo_layout_valid = true;
+	}
+	s = hud_teaminfo_layout_parsed;
 
 	//
 	// parse/draw string like this "%n %h:%a %l %p %w"
@@ -4995,7 +5051,7 @@ static int SCR_HudDrawTeamInfoPlayer(ti_player_t *ti_cl, int x, int y, int maxna
 						break;
 					case 'w': // draw "best" weapon icon/name
 
-						switch (HUD_FindVar(hud, "weapon_style")->integer) {
+						switch (hud_teaminfo_player_weapon_style->integer) {
 							case 1:
 								if(!width_only) {
 									if (Has_Both_RL_and_LG(ti_cl->items)) {
@@ -5028,7 +5084,7 @@ static int SCR_HudDrawTeamInfoPlayer(ti_player_t *ti_cl, int x, int y, int maxna
 					case 'H': // draw health, padding with space on right side
 
 						if(!width_only) {
-							snprintf(tmp, sizeof(tmp), (s[0] == 'h' ? "%s%3d" : "%s%-3d"), (ti_cl->health < HUD_FindVar(hud, "low_health")->integer ? "&cf00" : ""), ti_cl->health);
+							snprintf(tmp, sizeof(tmp), (s[0] == 'h' ? "%s%3d" : "%s%-3d"), (ti_cl->health < hud_teaminfo_low_health->integer ? "&cf00" : ""), ti_cl->health);
 							Draw_SString (x, y, tmp, scale);
 						}
 						x += 3 * FONTWIDTH * scale;
@@ -5051,7 +5107,7 @@ static int SCR_HudDrawTeamInfoPlayer(ti_player_t *ti_cl, int x, int y, int maxna
 						//
 						// different styles of armor
 						//
-						switch (HUD_FindVar(hud,"armor_style")->integer) {
+						switch (hud_teaminfo_armor_style->integer) {
 							case 1: // image prefixed armor value
 								if(!width_only) {
 									if (ti_cl->items & IT_ARMOR3)
@@ -5128,7 +5184,7 @@ static int SCR_HudDrawTeamInfoPlayer(ti_player_t *ti_cl, int x, int y, int maxna
 
 						break;
 					case 'p': // draw powerups
-						switch (HUD_FindVar(hud, "powerup_style")->integer) {
+						switch (hud_teaminfo_powerup_style->integer) {
 							case 1: // quad/pent/ring image
 								if(!width_only) {
 									if (ti_cl->items & IT_QUAD)
@@ -6060,6 +6116,7 @@ void CommonDraw_Init(void)
 		"style",    "0",
 		"scale",    "1",
 		"blink",    "0",
+		"underruns", "1",
 		NULL
 	);
 
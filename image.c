@@ -20,9 +20,16 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #ifdef __FreeBSD__
 #include <dlfcn.h>
 #endif
+#include <SDL_thread.h>
+#include <SDL_cpuinfo.h>
 #include "quakedef.h"
 #include "image.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_SSE2
+#include <emmintrin.h>
+#endif
+
 #ifdef WITH_PNG
 #include "png.h"
 /*#ifdef _WIN32
@@ -42,36 +49,228 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 cvar_t image_png_compression_level = {"image_png_compression_level", "1"};
 cvar_t image_jpeg_quality_level = {"image_jpeg_quality_level", "75"};
+cvar_t image_threads = {"image_threads", "0"};
+
+/****************************** WORKER THREADS *******************************/
+
+// Large resamples and mip reductions are split into bands of rows that run on
+// worker threads, the calling thread takes the first band itself. All calls
+// come from the main thread, so there is only ever one job in flight.
+
+#define MAX_IMAGE_THREADS		8
+#define IMAGE_PARALLEL_PIXELS	(256 * 256)	// Below this the threads cost more than they save.
+
+typedef void (*image_rows_func_t) (void *ctx, int start, int end);
+
+typedef struct image_worker_s
+{
+	SDL_Thread *thread;
+	SDL_sem *signal;
+	int band;
+} image_worker_t;
+
+static image_worker_t image_workers[MAX_IMAGE_THREADS];
+static int image_worker_count = 0;
+static int image_worker_wanted = -1;
+static SDL_sem *image_workers_done;
+static qbool image_workers_quit;
+
+static image_rows_func_t image_job_func;
+static void *image_job_ctx;
+static int image_job_rows;
+static int image_job_bands;
+
+static void Image_RunBand(int band)
+{
+	int start = image_job_rows * band / image_job_bands;
+	int end = image_job_rows * (band + 1) / image_job_bands;
+
+	if (start < end)
+		image_job_func(image_job_ctx, start, end);
+}
+
+static int Image_WorkerThread(void *data)
+{
+	image_worker_t *worker = (image_worker_t *) data;
+
+	while (true)
+	{
+		SDL_SemWait(worker->signal);
+		if (image_workers_quit)
+			break;
+
+		Image_RunBand(worker->band);
+		SDL_SemPost(image_workers_done);
+	}
+
+	return 0;
+}
+
+static void Image_StopWorkers(void)
+{
+	int i;
+
+	image_workers_quit = true;
+	for (i = 0; i < image_worker_count; i++)
+		SDL_SemPost(image_workers[i].signal);
+
+	for (i = 0; i < image_worker_count; i++)
+	{
+		SDL_WaitThread(image_workers[i].thread, NULL);
+		SDL_DestroySemaphore(image_workers[i].signal);
+	}
+
+	image_worker_count = 0;
+	image_workers_quit = false;
+}
+
+// (Re)starts the workers when image_threads has changed, 0 means one per extra cpu core.
+static void Image_CheckWorkers(void)
+{
+	int i, wanted = image_threads.integer > 0 ? image_threads.integer - 1 : SDL_GetCPUCount() - 1;
+
+	wanted = bound(0, wanted, MAX_IMAGE_THREADS);
+	if (wanted == image_worker_wanted)
+		return;
+
+	Image_StopWorkers();
+	image_worker_wanted = wanted;
+
+	if (!image_workers_done && !(image_workers_done = SDL_CreateSemaphore(0)))
+		return;
+
+	for (i = 0; i < wanted; i++)
+	{
+		image_worker_t *worker = &image_workers[image_worker_count];
+
+		worker->band = image_worker_count + 1;
+		if (!(worker->signal = SDL_CreateSemaphore(0)))
+			break;
+
+		if (!(worker->thread = SDL_CreateThread(Image_WorkerThread, "image", worker)))
+		{
+			SDL_DestroySemaphore(worker->signal);
+			break;
+		}
+
+		image_worker_count++;
+	}
+}
+
+// Calls func for all rows, split across the worker threads if the image is big enough.
+static void Image_ParallelRows(image_rows_func_t func, void *ctx, int rows, int pixels)
+{
+	int i;
+
+	Image_CheckWorkers();
+
+	if (!image_worker_count || pixels < IMAGE_PARALLEL_PIXELS || rows < 2)
+	{
+		func(ctx, 0, rows);
+		return;
+	}
+
+	image_job_func = func;
+	image_job_ctx = ctx;
+	image_job_rows = rows;
+	image_job_bands = min(rows, image_worker_count + 1);
+
+	for (i = 0; i < image_job_bands - 1; i++)
+		SDL_SemPost(image_workers[i].signal);
+
+	Image_RunBand(0);
+
+	for (i = 0; i < image_job_bands - 1; i++)
+		SDL_SemWait(image_workers_done);
+}
 
 /***************************** IMAGE RESAMPLING ******************************/
 
 static void Image_Resample32LerpLine (byte *in, byte *out, int inwidth, int outwidth) 
 {
-	int j, xi, oldx = 0, f, fstep, endx, lerp;
+	int j = 0, xi, f = 0, fstep, endx, lerp;
 
 	fstep = (int) (inwidth * 65536.0f / outwidth);
 	endx = (inwidth - 1);
-	for (j = 0, f = 0; j < outwidth; j++, f += fstep) {
-		xi = (int) f >> 16;
-		if (xi != oldx) {
-			in += (xi - oldx) * 4;
-			oldx = xi;
+
+#ifdef IMAGE_SSE2
+	{
+		// Two output pixels at a time. The lerp is 0..65535 so it doesn't fit a signed
+		// word, mulhi on (lerp - 65536) and adding back the difference gives the same
+		// (diff * lerp) >> 16 as the C code below.
+		__m128i zero = _mm_setzero_si128();
+
+		for (; j + 1 < outwidth; j += 2, f += 2 * fstep)
+		{
+			int x0 = f >> 16, x1 = (f + fstep) >> 16;
+			short l0 = (short) (f & 0xFFFF), l1 = (short) ((f + fstep) & 0xFFFF);
+			__m128i p0, p1, a, b, d, l;
+
+			if (x1 >= endx)
+				break;
+
+			p0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (in + x0 * 4)), zero);
+			p1 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (in + x1 * 4)), zero);
+			a = _mm_unpacklo_epi64(p0, p1);
+			b = _mm_unpackhi_epi64(p0, p1);
+			d = _mm_sub_epi16(b, a);
+			l = _mm_set_epi16(l1, l1, l1, l1, l0, l0, l0, l0);
+
+			d = _mm_add_epi16(_mm_mulhi_epi16(d, l), _mm_and_si128(d, _mm_srai_epi16(l, 15)));
+			_mm_storel_epi64((__m128i *) (out + j * 4), _mm_packus_epi16(_mm_add_epi16(d, a), zero));
 		}
+		out += j * 4;
+	}
+#endif
+
+	for (; j < outwidth; j++, f += fstep) {
+		byte *p;
+
+		xi = (int) f >> 16;
+		p = in + xi * 4;
 		if (xi < endx) {
 			lerp = f & 0xFFFF;
-			*out++ = (byte) ((((in[4] - in[0]) * lerp) >> 16) + in[0]);
-			*out++ = (byte) ((((in[5] - in[1]) * lerp) >> 16) + in[1]);
-			*out++ = (byte) ((((in[6] - in[2]) * lerp) >> 16) + in[2]);
-			*out++ = (byte) ((((in[7] - in[3]) * lerp) >> 16) + in[3]);
+			*out++ = (byte) ((((p[4] - p[0]) * lerp) >> 16) + p[0]);
+			*out++ = (byte) ((((p[5] - p[1]) * lerp) >> 16) + p[1]);
+			*out++ = (byte) ((((p[6] - p[2]) * lerp) >> 16) + p[2]);
+			*out++ = (byte) ((((p[7] - p[3]) * lerp) >> 16) + p[3]);
 		} else  {
-			*out++ = in[0];
-			*out++ = in[1];
-			*out++ = in[2];
-			*out++ = in[3];
+			*out++ = p[0];
+			*out++ = p[1];
+			*out++ = p[2];
+			*out++ = p[3];
 		}
 	}
 }
 
+// Blends two resampled lines, len is in bytes.
+static void Image_Resample32LerpRows (const byte *row1, const byte *row2, byte *out, int len, int lerp)
+{
+	int i = 0;
+
+#ifdef IMAGE_SSE2
+	__m128i zero = _mm_setzero_si128();
+	__m128i l = _mm_set1_epi16((short) lerp);
+	__m128i lmask = _mm_srai_epi16(l, 15);
+
+	for (; i + 16 <= len; i += 16)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *) (row1 + i));
+		__m128i b = _mm_loadu_si128((const __m128i *) (row2 + i));
+		__m128i alo = _mm_unpacklo_epi8(a, zero), ahi = _mm_unpackhi_epi8(a, zero);
+		__m128i dlo = _mm_sub_epi16(_mm_unpacklo_epi8(b, zero), alo);
+		__m128i dhi = _mm_sub_epi16(_mm_unpackhi_epi8(b, zero), ahi);
+
+		dlo = _mm_add_epi16(_mm_mulhi_epi16(dlo, l), _mm_and_si128(dlo, lmask));
+		dhi = _mm_add_epi16(_mm_mulhi_epi16(dhi, l), _mm_and_si128(dhi, lmask));
+		_mm_storeu_si128((__m128i *) (out + i), _mm_packus_epi16(_mm_add_epi16(dlo, alo), _mm_add_epi16(dhi, ahi)));
+	}
+#endif
+
+	for (; i < len; i++)
+		out[i] = (byte) ((((row2[i] - row1[i]) * lerp) >> 16) + row1[i]);
+}
+
 static void Image_Resample24LerpLine (byte *in, byte *out, int inwidth, int outwidth) 
 {
 	int j, xi, oldx = 0, f, fstep, endx, lerp;
@@ -97,138 +296,109 @@ static void Image_Resample24LerpLine (byte *in, byte *out, int inwidth, int outw
 	}
 }
 
-#define LERPBYTE(i) r = row1[i]; out[i] = (byte) ((((row2[i] - r) * lerp) >> 16) + r)
-#define NOLERPBYTE(i) *out++ = inrow[f + i]
+typedef struct image_resample_s
+{
+	byte *indata, *outdata;
+	int inwidth, inheight, outwidth, outheight;
+} image_resample_t;
 
-static void Image_Resample32 (void *indata, int inwidth, int inheight,
-								void *outdata, int outwidth, int outheight, int quality) 
+static void Image_Resample32LerpBand (void *ctx, int start, int end)
 {
-	if (quality) 
-	{
-		int i, j, r, yi, oldy, f, fstep, endy = (inheight - 1), lerp;
-		int inwidth4 = inwidth * 4, outwidth4 = outwidth * 4;
-		byte *inrow, *out, *row1, *row2, *memalloc;
+	image_resample_t *rs = (image_resample_t *) ctx;
+	int i, yi, oldy = -2, f, fstep, endy = (rs->inheight - 1);
+	int inwidth4 = rs->inwidth * 4, outwidth4 = rs->outwidth * 4;
+	byte *inrow, *out, *row1, *row2, *memalloc;
 
-		out = outdata;
-		fstep = (int) (inheight * 65536.0f / outheight);
+	fstep = (int) (rs->inheight * 65536.0f / rs->outheight);
+	out = rs->outdata + start * outwidth4;
 
-		memalloc = (byte *) Q_malloc(2 * outwidth4);
-		row1 = memalloc;
-		row2 = memalloc + outwidth4;
-		inrow = (byte *) indata;
-		oldy = 0;
-		Image_Resample32LerpLine (inrow, row1, inwidth, outwidth);
-		Image_Resample32LerpLine (inrow + inwidth4, row2, inwidth, outwidth);
-		
-		for (i = 0, f = 0; i < outheight; i++, f += fstep)	
-		{
-			yi = f >> 16;
+	memalloc = (byte *) Q_malloc(2 * outwidth4);
+	row1 = memalloc;
+	row2 = memalloc + outwidth4;
 
-			if (yi < endy) 
-			{
-				lerp = f & 0xFFFF;
+	for (i = start, f = start * fstep; i < end; i++, f += fstep, out += outwidth4)
+	{
+		yi = f >> 16;
+		inrow = rs->indata + inwidth4 * yi;
 
-				if (yi != oldy)
-				{
-					inrow = (byte *) indata + inwidth4 * yi;
-					if (yi == oldy + 1)
-						memcpy(row1, row2, outwidth4);
-					else
-						Image_Resample32LerpLine (inrow, row1, inwidth, outwidth);
-					Image_Resample32LerpLine (inrow + inwidth4, row2, inwidth, outwidth);
-					oldy = yi;
-				}
+		if (yi != oldy)
+		{
+			if (yi == oldy + 1)
+				memcpy(row1, row2, outwidth4);
+			else
+				Image_Resample32LerpLine (inrow, row1, rs->inwidth, rs->outwidth);
+			if (yi < endy)
+				Image_Resample32LerpLine (inrow + inwidth4, row2, rs->inwidth, rs->outwidth);
+			oldy = yi;
+		}
 
-				j = outwidth - 4;
+		if (yi < endy)
+			Image_Resample32LerpRows (row1, row2, out, outwidth4, f & 0xFFFF);
+		else
+			memcpy(out, row1, outwidth4);
+	}
 
-				while(j >= 0)
-				{
-					LERPBYTE(0); LERPBYTE(1); LERPBYTE(2); LERPBYTE(3);
-					LERPBYTE(4); LERPBYTE(5); LERPBYTE(6); LERPBYTE(7);
-					LERPBYTE(8); LERPBYTE(9); LERPBYTE(10); LERPBYTE(11);
-					LERPBYTE(12); LERPBYTE(13); LERPBYTE(14); LERPBYTE(15);
-					out += 16;
-					row1 += 16;
-					row2 += 16;
-					j -= 4;
-				}
+	Q_free(memalloc);
+}
 
-				if (j & 2) 
-				{
-					LERPBYTE(0); LERPBYTE(1); LERPBYTE(2); LERPBYTE(3);
-					LERPBYTE(4); LERPBYTE(5); LERPBYTE(6); LERPBYTE(7);
-					out += 8;
-					row1 += 8;
-					row2 += 8;
-				}
+static void Image_Resample32NearestBand (void *ctx, int start, int end)
+{
+	image_resample_t *rs = (image_resample_t *) ctx;
+	int i, j;
+	unsigned int frac, fracstep, *inrow, *out;
 
-				if (j & 1)
-				{
-					LERPBYTE(0); LERPBYTE(1); LERPBYTE(2); LERPBYTE(3);
-					out += 4;
-					row1 += 4;
-					row2 += 4;
-				}
-				row1 -= outwidth4;
-				row2 -= outwidth4;
-			} 
-			else 
-			{
-				if (yi != oldy) 
-				{
-					inrow = (byte *) indata + inwidth4 * yi;
-					if (yi == oldy+1)
-						memcpy(row1, row2, outwidth4);
-					else
-						Image_Resample32LerpLine (inrow, row1, inwidth, outwidth);
-					oldy = yi;
-				}
-				memcpy(out, row1, outwidth4);
-			}
-		}
+	out = (unsigned int *) rs->outdata + start * rs->outwidth;
 
-		Q_free(memalloc);
-	}
-	else 
+	fracstep = rs->inwidth * 0x10000 / rs->outwidth;
+	for (i = start; i < end; i++)
 	{
-		int i, j;
-		unsigned int frac, fracstep, *inrow, *out;
-
-		out = outdata;
-
-		fracstep = inwidth * 0x10000 / outwidth;
-		for (i = 0; i < outheight; i++)
+		inrow = (unsigned int *) rs->indata + rs->inwidth * (i * rs->inheight / rs->outheight);
+		frac = fracstep >> 1;
+		j = rs->outwidth - 4;
+	
+		while (j >= 0)
 		{
-			inrow = (unsigned int *) indata + inwidth * (i * inheight / outheight);
-			frac = fracstep >> 1;
-			j = outwidth - 4;
-		
-			while (j >= 0)
-			{
-				out[0] = inrow[frac >> 16]; frac += fracstep;
-				out[1] = inrow[frac >> 16]; frac += fracstep;
-				out[2] = inrow[frac >> 16]; frac += fracstep;
-				out[3] = inrow[frac >> 16]; frac += fracstep;
-				out += 4;
-				j -= 4;
-			}
+			out[0] = inrow[frac >> 16]; frac += fracstep;
+			out[1] = inrow[frac >> 16]; frac += fracstep;
+			out[2] = inrow[frac >> 16]; frac += fracstep;
+			out[3] = inrow[frac >> 16]; frac += fracstep;
+			out += 4;
+			j -= 4;
+		}
 
-			if (j & 2)
-			{
-				out[0] = inrow[frac >> 16]; frac += fracstep;
-				out[1] = inrow[frac >> 16]; frac += fracstep;
-				out += 2;
-			}
+		if (j & 2)
+		{
+			out[0] = inrow[frac >> 16]; frac += fracstep;
+			out[1] = inrow[frac >> 16]; frac += fracstep;
+			out += 2;
+		}
 
-			if (j & 1) 
-			{
-				out[0] = inrow[frac >> 16]; frac += fracstep;
-				out += 1;
-			}
+		if (j & 1) 
+		{
+			out[0] = inrow[frac >> 16]; frac += fracstep;
+			out += 1;
 		}
 	}
 }
 
+static void Image_Resample32 (void *indata, int inwidth, int inheight,
+								void *outdata, int outwidth, int outheight, int quality) 
+{
+	image_resample_t rs;
+
+	rs.indata = (byte *) indata;
+	rs.outdata = (byte *) outdata;
+	rs.inwidth = inwidth;
+	rs.inheight = inheight;
+	rs.outwidth = outwidth;
+	rs.outheight = outheight;
+
+	Image_ParallelRows (quality ? Image_Resample32LerpBand : Image_Resample32NearestBand, &rs, outheight, outwidth * outheight);
+}
+
+#define LERPBYTE(i) r = row1[i]; out[i] = (byte) ((((row2[i] - r) * lerp) >> 16) + r)
+#define NOLERPBYTE(i) *out++ = inrow[f + i]
+
 static void Image_Resample24 (void *indata, int inwidth, int inheight,
 					 void *outdata, int outwidth, int outheight, int quality)
 {
@@ -367,6 +537,89 @@ void Image_Resample (void *indata, int inwidth, int inheight,
 		Sys_Error("Image_Resample: unsupported bpp (%d)", bpp);
 }
 
+// Averages 2x2 blocks of two rows, safe to use in place.
+static void Image_MipReduce32Row (const byte *row0, const byte *row1, byte *out, int outwidth)
+{
+	int x = 0;
+
+#ifdef IMAGE_SSE2
+	__m128i zero = _mm_setzero_si128();
+
+	for (; x + 2 <= outwidth; x += 2, row0 += 16, row1 += 16, out += 8)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *) row0);
+		__m128i b = _mm_loadu_si128((const __m128i *) row1);
+		__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+		__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+		lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+		hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+		lo = _mm_srli_epi16(_mm_unpacklo_epi64(lo, hi), 2);
+		_mm_storel_epi64((__m128i *) out, _mm_packus_epi16(lo, zero));
+	}
+#endif
+
+	for (; x < outwidth; x++, row0 += 8, row1 += 8, out += 4)
+	{
+		out[0] = (byte) ((row0[0] + row0[4] + row1[0] + row1[4]) >> 2);
+		out[1] = (byte) ((row0[1] + row0[5] + row1[1] + row1[5]) >> 2);
+		out[2] = (byte) ((row0[2] + row0[6] + row1[2] + row1[6]) >> 2);
+		out[3] = (byte) ((row0[3] + row0[7] + row1[3] + row1[7]) >> 2);
+	}
+}
+
+// Averages pairs of pixels of a single row, safe to use in place.
+static void Image_MipReduce32RowWidth (const byte *in, byte *out, int outwidth)
+{
+	int x = 0;
+
+#ifdef IMAGE_SSE2
+	__m128i zero = _mm_setzero_si128();
+
+	for (; x + 2 <= outwidth; x += 2, in += 16, out += 8)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *) in);
+		__m128i lo = _mm_unpacklo_epi8(a, zero);
+		__m128i hi = _mm_unpackhi_epi8(a, zero);
+
+		lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+		hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+		lo = _mm_srli_epi16(_mm_unpacklo_epi64(lo, hi), 1);
+		_mm_storel_epi64((__m128i *) out, _mm_packus_epi16(lo, zero));
+	}
+#endif
+
+	for (; x < outwidth; x++, in += 8, out += 4)
+	{
+		out[0] = (byte) ((in[0] + in[4]) >> 1);
+		out[1] = (byte) ((in[1] + in[5]) >> 1);
+		out[2] = (byte) ((in[2] + in[6]) >> 1);
+		out[3] = (byte) ((in[3] + in[7]) >> 1);
+	}
+}
+
+typedef struct image_mipreduce_s
+{
+	const byte *in;
+	byte *out;
+	int inwidth, outwidth;
+} image_mipreduce_t;
+
+static void Image_MipReduce32Band (void *ctx, int start, int end)
+{
+	image_mipreduce_t *mr = (image_mipreduce_t *) ctx;
+	int y, nextrow = mr->inwidth * 4;
+
+	for (y = start; y < end; y++)
+	{
+		const byte *inrow = mr->in + y * nextrow * 2;
+
+		Image_MipReduce32Row (inrow, inrow + nextrow, mr->out + y * mr->outwidth * 4, mr->outwidth);
+	}
+}
+
+// The result may be written over the input, but only separate buffers
+// get split across the worker threads.
 void Image_MipReduce (const byte *in, byte *out, int *width, int *height, int bpp) 
 {
 	const byte *inrow;
@@ -386,17 +639,20 @@ void Image_MipReduce (const byte *in, byte *out, int *width, int *height, int bp
 		
 			if (bpp == 4)
 			{
-				for (y = 0; y < *height; y++, inrow += nextrow * 2)
+				if (in != out)
 				{
-					for (in = inrow, x = 0; x < *width; x++)
-					{
-						out[0] = (byte) ((in[0] + in[4] + in[nextrow] + in[nextrow + 4]) >> 2);
-						out[1] = (byte) ((in[1] + in[5] + in[nextrow + 1] + in[nextrow + 5]) >> 2);
-						out[2] = (byte) ((in[2] + in[6] + in[nextrow + 2] + in[nextrow + 6]) >> 2);
-						out[3] = (byte) ((in[3] + in[7] + in[nextrow + 3] + in[nextrow + 7]) >> 2);
-						out += 4;
-						in += 8;
-					}
+					image_mipreduce_t mr;
+
+					mr.in = in;
+					mr.out = out;
+					mr.inwidth = nextrow / 4;
+					mr.outwidth = *width;
+					Image_ParallelRows (Image_MipReduce32Band, &mr, *height, *width * *height);
+				}
+				else
+				{
+					for (y = 0; y < *height; y++, inrow += nextrow * 2, out += *width * 4)
+						Image_MipReduce32Row (inrow, inrow + nextrow, out, *width);
 				}
 			} 
 			else if (bpp == 3) 
@@ -423,18 +679,8 @@ void Image_MipReduce (const byte *in, byte *out, int *width, int *height, int bp
 			// reduce width
 			if (bpp == 4)
 			{
-				for (y = 0; y < *height; y++, inrow += nextrow)
-				{
-					for (in = inrow, x = 0; x < *width; x++)
-					{
-						out[0] = (byte) ((in[0] + in[4]) >> 1);
-						out[1] = (byte) ((in[1] + in[5]) >> 1);
-						out[2] = (byte) ((in[2] + in[6]) >> 1);
-						out[3] = (byte) ((in[3] + in[7]) >> 1);
-						out += 4;
-						in += 8;
-					}
-				}
+				for (y = 0; y < *height; y++, inrow += nextrow, out += *width * 4)
+					Image_MipReduce32RowWidth (inrow, out, *width);
 			} 
 			else if (bpp == 3) 
 			{
@@ -1970,6 +2216,116 @@ int Image_WritePCX (char *filename, byte *data, int width, int height, byte *pal
 	return true;
 }
 
+/********************************* BENCHMARK *********************************/
+
+typedef struct image_benchmark_list_s
+{
+	char **names;
+	int count, size;
+} image_benchmark_list_t;
+
+static int Image_Benchmark_AddFile(char *name, int size, void *parm)
+{
+	image_benchmark_list_t *list = (image_benchmark_list_t *) parm;
+
+	if (list->count == list->size)
+	{
+		list->size = max(64, list->size * 2);
+		list->names = Q_realloc(list->names, list->size * sizeof(*list->names));
+	}
+
+	list->names[list->count++] = Q_strdup(name);
+	return true;
+}
+
+// Decodes, resamples and mip reduces a set of images the way texture loading
+// does, minus the GL upload, and reports the throughput of each stage.
+static void Image_Benchmark_f(void)
+{
+	image_benchmark_list_t list = { NULL, 0, 0 };
+	double t, decode_time = 0, mip_time = 0;
+	double decode_pixels = 0, mip_pixels = 0;
+	int i, loaded = 0;
+
+	if (Cmd_Argc() != 2)
+	{
+		Com_Printf("Usage: %s <wildcard> (e.g. textures/*.png)\n", Cmd_Argv(0));
+		return;
+	}
+
+	FS_EnumerateFiles(Cmd_Argv(1), Image_Benchmark_AddFile, &list);
+
+	for (i = 0; i < list.count; i++)
+	{
+		char *ext = COM_FileExtension(list.names[i]);
+		byte *data = NULL, *resampled, *mip;
+		int width, height, pow2width, pow2height;
+		vfsfile_t *f;
+
+		if (!(f = FS_OpenVFS(list.names[i], "rb", FS_ANY)))
+			continue;
+
+		t = Sys_DoubleTime();
+		if (!strcasecmp(ext, "tga"))
+			data = Image_LoadTGA(f, list.names[i], 0, 0, &width, &height);
+#ifdef WITH_PNG
+		else if (!strcasecmp(ext, "png"))
+			data = Image_LoadPNG(f, list.names[i], 0, 0, &width, &height);
+#endif
+#ifdef WITH_JPEG
+		else if (!strcasecmp(ext, "jpg"))
+			data = Image_LoadJPEG(f, list.names[i], 0, 0, &width, &height);
+#endif
+		else if (!strcasecmp(ext, "pcx"))
+			data = Image_LoadPCX_As32Bit(f, list.names[i], 0, 0, &width, &height);
+		else
+			VFS_CLOSE(f);
+
+		if (!data)
+			continue;
+
+		decode_time += Sys_DoubleTime() - t;
+		decode_pixels += width * height;
+		loaded++;
+
+		// Same steps as GL_Upload32 on a card without non power of two support.
+		t = Sys_DoubleTime();
+		Q_ROUND_POWER2(width, pow2width);
+		Q_ROUND_POWER2(height, pow2height);
+		resampled = Q_malloc(pow2width * pow2height * 4);
+		mip = Q_malloc((pow2width * pow2height / 2 + 1) * 4);
+
+		Image_Resample(data, width, height, resampled, pow2width, pow2height, 4, 1);
+		mip_pixels += pow2width * pow2height;
+
+		width = pow2width;
+		height = pow2height;
+		while (width > 1 || height > 1)
+		{
+			byte *swap;
+
+			Image_MipReduce(resampled, mip, &width, &height, 4);
+			swap = resampled; resampled = mip; mip = swap;
+		}
+		mip_time += Sys_DoubleTime() - t;
+
+		Q_free(resampled);
+		Q_free(mip);
+		Q_free(data);
+	}
+
+	for (i = 0; i < list.count; i++)
+		Q_free(list.names[i]);
+	Q_free(list.names);
+
+	Com_Printf("%d of %d images, %.1f megapixels, %d thread%s\n", loaded, list.count, decode_pixels / 1e6, image_worker_count + 1, image_worker_count ? "s" : "");
+	if (loaded)
+	{
+		Com_Printf("decode:         %.3fs, %.1f megapixels/s\n", decode_time, decode_time > 0 ? decode_pixels / 1e6 / decode_time : 0);
+		Com_Printf("resample + mip: %.3fs, %.1f megapixels/s\n", mip_time, mip_time > 0 ? mip_pixels / 1e6 / mip_time : 0);
+	}
+}
+
 /*********************************** INIT ************************************/
 
 void Image_Init(void) 
@@ -1984,7 +2340,12 @@ void Image_Init(void)
 	Cvar_Register (&image_jpeg_quality_level);
 #endif // WITH_JPEG
 
+	Cvar_SetCurrentGroup(CVAR_GROUP_TEXTURES);
+	Cvar_Register (&image_threads);
+
 	Cvar_ResetCurrentGroup();
+
+	Cmd_AddCommand ("image_benchmark", Image_Benchmark_f);
 }
 
 
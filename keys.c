@@ -1212,16 +1212,11 @@ void Key_Console (int key, int unichar)
 			{
 				if (keydown[K_CTRL] && key == K_PGUP)
 				{
-					con.display -= ((int)scr_conlines - 22) >> 3;
+					Con_Scroll(((int)scr_conlines - 22) >> 3);
 				}
 				else
 				{
-					con.display -= 2;
-				}
-
-				if (con.display - con.current + con.numlines < 0)
-				{
-					con.display = con.current - con.numlines;
+					Con_Scroll(2);
 				}
 				return;
 			}
@@ -1230,16 +1225,11 @@ void Key_Console (int key, int unichar)
 			{
 				if (keydown[K_CTRL] && key == K_PGDN)
 				{
-					con.display += ((int)scr_conlines - 22) >> 3;
+					Con_Scroll(-(((int)scr_conlines - 22) >> 3));
 				}
 				else
 				{
-					con.display += 2;
-				}
-
-				if (con.display - con.current > 0)
-				{
-					con.display = con.current;
+					Con_Scroll(-2);
 				}
 				return;
 			}
@@ -1247,7 +1237,7 @@ void Key_Console (int key, int unichar)
 			{
 				if (keydown[K_CTRL])
 				{
-					con.display = con.current - con.numlines;
+					Con_ScrollHome();
 				}
 				else
 				{
@@ -1259,7 +1249,7 @@ void Key_Console (int key, int unichar)
 			{
 				if (keydown[K_CTRL])
 				{
-					con.display = con.current;
+					Con_ScrollEnd();
 				}
 				else
 				{
@@ -217,6 +217,7 @@ void M_Unscale_Menu(void)
 	{
 		menuwidth = vid.width;
 		menuheight = vid.height;
+		Draw_FlushBatch();
 		glMatrixMode(GL_PROJECTION);
 		glLoadIdentity ();
 		glOrtho  (0, menuwidth, menuheight, 0, -99999, 99999);
@@ -1328,6 +1329,7 @@ void M_Draw (void) {
 			menuheight = (int) ((menuwidth / vid.aspect) + 0.5f);
 		}
 		
+		Draw_FlushBatch();
 		glMatrixMode(GL_PROJECTION);
 		glLoadIdentity ();
 		glOrtho  (0, menuwidth, menuheight, 0, -99999, 99999);
@@ -1365,6 +1367,7 @@ void M_Draw (void) {
 	}
 
 	if (scr_scaleMenu.value) {
+		Draw_FlushBatch();
 		glMatrixMode (GL_PROJECTION);
 		glLoadIdentity ();
 		glOrtho  (0, vid.width, vid.height, 0, -99999, 99999);
@@ -816,9 +816,7 @@ static void PM_SpectatorMove(void)
 	VectorMA(pmove.origin, pm_frametime, pmove.velocity, pmove.origin);
 }
 
-//Returns with origin, angles, and velocity modified in place.
-//Numtouch and touchindex[] will be set if any of the physents were contacted during the move.
-int PM_PlayerMove(void)
+static int PM_RunMove(void)
 {
 	int blocked = 0;
 
@@ -828,9 +826,6 @@ int PM_PlayerMove(void)
 #endif
 #endif
 
-	pm_frametime = pmove.cmd.msec * 0.001;
-	pmove.numtouch = 0;
-
 	if (pmove.pm_type == PM_NONE || pmove.pm_type == PM_LOCK) {
 		PM_CategorizePosition();
 		return 0;
@@ -895,3 +890,20 @@ int PM_PlayerMove(void)
 
 	return blocked;
 }
+
+//Returns with origin, angles, and velocity modified in place.
+//Numtouch and touchindex[] will be set if any of the physents were contacted during the move.
+int PM_PlayerMove(void)
+{
+	int blocked;
+
+	pm_frametime = pmove.cmd.msec * 0.001;
+	pmove.numtouch = 0;
+
+	// the physents stay put for the whole move, so they only get sorted once
+	PM_BeginBroadphase(pm_frametime);
+	blocked = PM_RunMove();
+	PM_EndBroadphase();
+
+	return blocked;
+}
@@ -96,5 +96,9 @@ void PM_CategorizePosition (void);
 qbool PM_TestPlayerPosition (vec3_t point);
 trace_t PM_PlayerTrace (vec3_t start, vec3_t end);
 trace_t PM_TraceLine (vec3_t start, vec3_t end);
+void PM_BeginBroadphase (float frametime);
+void PM_EndBroadphase (void);
+
+extern qbool pm_nobroadphase;
 
 #endif /* !__PMOVE_H__ */
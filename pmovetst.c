@@ -45,12 +45,174 @@ static void PM_TraceBounds (vec3_t start, vec3_t end, vec3_t boxmins, vec3_t box
 	}
 }
 
-static qbool PM_CullTraceBox(vec3_t mins, vec3_t maxs, vec3_t offset, vec3_t emins, vec3_t emaxs, vec3_t hullmins, vec3_t hullmaxs) {
-	return
-		(	mins[0] + hullmins[0] > offset[0] + emaxs[0] || maxs[0] + hullmaxs[0] < offset[0] + emins[0] ||
-			mins[1] + hullmins[1] > offset[1] + emaxs[1] || maxs[1] + hullmaxs[1] < offset[1] + emins[1] ||
-			mins[2] + hullmins[2] > offset[2] + emaxs[2] || maxs[2] + hullmaxs[2] < offset[2] + emins[2]
-		);
+/*
+===============================================================================
+
+PHYSENT BROADPHASE
+
+A player move runs a dozen or so traces, all of them close to the player.
+Rather than walking every physent for each of them, the physents near the
+move are gathered once into a compact list, with their bounds already grown
+by the player hull and a hull of their own for the box entities.  The list
+is good for a region around the player; a trace leaving it makes the list
+get rebuilt for a larger region.
+
+Outside of PM_PlayerMove the physents may change at any time, so there the
+list is built for each trace on its own.
+
+===============================================================================
+*/
+
+#define PM_BROADPHASE_MARGIN	64		// slack around the expected move, covers stepping and ground checks
+#define PM_BROADPHASE_WORLD		1e30f	// bounds which never get culled
+
+typedef struct {
+	int			num;
+	int			index[MAX_PHYSENTS];	// physent number
+	float		mins[3][MAX_PHYSENTS];	// physent bounds grown by the player hull
+	float		maxs[3][MAX_PHYSENTS];
+	hull_t		*hull[MAX_PHYSENTS];
+	vec3_t		offset[MAX_PHYSENTS];	// hull origin in world space
+
+	vec3_t		regionmins, regionmaxs;	// the list holds every physent touching this
+	qbool		active;					// inside PM_PlayerMove, the physents stay put
+	qbool		valid;
+} pmbroadphase_t;
+
+static pmbroadphase_t	pm_broadphase;
+static cboxhull_t		pm_boxhulls[MAX_PHYSENTS];
+
+qbool pm_nobroadphase;	// build the list per trace, for comparison
+
+static void PM_BuildBroadphase (vec3_t regionmins, vec3_t regionmaxs)
+{
+	pmbroadphase_t *bp = &pm_broadphase;
+	physent_t *pe;
+	hull_t *hull;
+	vec3_t mins, maxs, absmins, absmaxs;
+	int i, k, n;
+
+	n = 0;
+	for (i = 0, pe = pmove.physents; i < pmove.numphysent; i++, pe++) {
+		if (pe->model) {
+			hull = &pe->model->hulls[1];
+
+			if (i == 0) {
+				// the world is never culled
+				VectorSet(absmins, -PM_BROADPHASE_WORLD, -PM_BROADPHASE_WORLD, -PM_BROADPHASE_WORLD);
+				VectorSet(absmaxs, PM_BROADPHASE_WORLD, PM_BROADPHASE_WORLD, PM_BROADPHASE_WORLD);
+			}
+			else {
+				VectorSubtract(pe->model->mins, hull->clip_maxs, absmins);
+				VectorSubtract(pe->model->maxs, hull->clip_mins, absmaxs);
+				VectorAdd(absmins, pe->origin, absmins);
+				VectorAdd(absmaxs, pe->origin, absmaxs);
+			}
+		}
+		else {
+			hull = NULL;
+			VectorSubtract(pe->mins, player_maxs, mins);
+			VectorSubtract(pe->maxs, player_mins, maxs);
+			VectorAdd(mins, pe->origin, absmins);
+			VectorAdd(maxs, pe->origin, absmaxs);
+		}
+
+		if (regionmins[0] > absmaxs[0] || regionmaxs[0] < absmins[0] ||
+			regionmins[1] > absmaxs[1] || regionmaxs[1] < absmins[1] ||
+			regionmins[2] > absmaxs[2] || regionmaxs[2] < absmins[2]) {
+			continue;
+		}
+
+		if (hull) {
+			VectorSubtract(hull->clip_mins, player_mins, bp->offset[n]);
+			VectorAdd(bp->offset[n], pe->origin, bp->offset[n]);
+		}
+		else {
+			hull = CM_SetBoxHull(&pm_boxhulls[n], mins, maxs);
+			VectorCopy(pe->origin, bp->offset[n]);
+		}
+
+		for (k = 0; k < 3; k++) {
+			bp->mins[k][n] = absmins[k];
+			bp->maxs[k][n] = absmaxs[k];
+		}
+		bp->hull[n] = hull;
+		bp->index[n] = i;
+		n++;
+	}
+
+	bp->num = n;
+	VectorCopy(regionmins, bp->regionmins);
+	VectorCopy(regionmaxs, bp->regionmaxs);
+	bp->valid = true;
+}
+
+// makes sure the list holds everything a trace within the given bounds can hit
+static pmbroadphase_t *PM_Broadphase (vec3_t tracemins, vec3_t tracemaxs)
+{
+	pmbroadphase_t *bp = &pm_broadphase;
+	vec3_t mins, maxs;
+	int k;
+
+	if (!bp->active || pm_nobroadphase) {
+		PM_BuildBroadphase(tracemins, tracemaxs);
+		return bp;
+	}
+
+	if (bp->valid &&
+		tracemins[0] >= bp->regionmins[0] && tracemaxs[0] <= bp->regionmaxs[0] &&
+		tracemins[1] >= bp->regionmins[1] && tracemaxs[1] <= bp->regionmaxs[1] &&
+		tracemins[2] >= bp->regionmins[2] && tracemaxs[2] <= bp->regionmaxs[2]) {
+		return bp;
+	}
+
+	// grow the region to take in this trace too
+	for (k = 0; k < 3; k++) {
+		mins[k] = tracemins[k] - PM_BROADPHASE_MARGIN;
+		maxs[k] = tracemaxs[k] + PM_BROADPHASE_MARGIN;
+		if (bp->valid) {
+			mins[k] = min(mins[k], bp->regionmins[k]);
+			maxs[k] = max(maxs[k], bp->regionmaxs[k]);
+		}
+	}
+	PM_BuildBroadphase(mins, maxs);
+
+	return bp;
+}
+
+/*
+================
+PM_BeginBroadphase
+
+Called by PM_PlayerMove once the move is set up, the physents must not
+change until PM_EndBroadphase.
+================
+*/
+void PM_BeginBroadphase (float frametime)
+{
+	pmbroadphase_t *bp = &pm_broadphase;
+	float reach;
+	int k;
+
+	bp->active = true;
+	bp->valid = false;
+
+	if (pm_nobroadphase)
+		return;
+
+	// the region the origin is expected to sweep through
+	for (k = 0; k < 3; k++) {
+		reach = fabs(pmove.velocity[k]) * frametime + PM_BROADPHASE_MARGIN;
+		bp->regionmins[k] = pmove.origin[k] - reach;
+		bp->regionmaxs[k] = pmove.origin[k] + reach;
+	}
+	PM_BuildBroadphase(bp->regionmins, bp->regionmaxs);
+}
+
+void PM_EndBroadphase (void)
+{
+	pm_broadphase.active = false;
+	pm_broadphase.valid = false;
 }
 
 /*
@@ -107,27 +269,23 @@ Returns false if the given player position is not valid (in solid)
 */
 qbool PM_TestPlayerPosition (vec3_t pos)
 {
-	int       i;
-	physent_t *pe;
-	vec3_t    mins, maxs, offset, test;
-	hull_t    *hull;
-
-	for (i = 0; i < pmove.numphysent; i++) {
-		pe = &pmove.physents[i];
-		// get the clipping hull
-		if (pe->model) {
-			hull = &pmove.physents[i].model->hulls[1];
-			VectorSubtract(hull->clip_mins, player_mins, offset);
-			VectorAdd(offset, pe->origin, offset);
-		}
-		else {
-			VectorSubtract(pe->mins, player_maxs, mins);
-			VectorSubtract(pe->maxs, player_mins, maxs);
-			hull = CM_HullForBox(mins, maxs);
-			VectorCopy(pe->origin, offset);
+	int            i;
+	pmbroadphase_t *bp;
+	vec3_t         test, tracemins, tracemaxs;
+	hull_t         *hull;
+
+	PM_TraceBounds(pos, pos, tracemins, tracemaxs);
+	bp = PM_Broadphase(tracemins, tracemaxs);
+
+	for (i = 0; i < bp->num; i++) {
+		if (tracemins[0] > bp->maxs[0][i] || tracemaxs[0] < bp->mins[0][i] ||
+			tracemins[1] > bp->maxs[1][i] || tracemaxs[1] < bp->mins[1][i] ||
+			tracemins[2] > bp->maxs[2][i] || tracemaxs[2] < bp->mins[2][i]) {
+			continue;
 		}
 
-		VectorSubtract(pos, offset, test);
+		hull = bp->hull[i];
+		VectorSubtract(pos, bp->offset[i], test);
 
 		if (CM_HullPointContents(hull, hull->firstclipnode, test) == CONTENTS_SOLID) {
 			return false;
@@ -144,13 +302,13 @@ PM_PlayerTrace
 */
 trace_t PM_PlayerTrace (vec3_t start, vec3_t end)
 {
-	trace_t   trace, total;
-	vec3_t    offset;
-	vec3_t    start_l, end_l;
-	hull_t    *hull;
-	int       i;
-	physent_t *pe;
-	vec3_t    mins, maxs, tracemins, tracemaxs;
+	trace_t        trace, total;
+	float          *offset;
+	vec3_t         start_l, end_l;
+	hull_t         *hull;
+	int            i;
+	pmbroadphase_t *bp;
+	vec3_t         tracemins, tracemaxs;
 
 	// fill in a default trace
 	memset (&total, 0, sizeof(trace_t));
@@ -159,32 +317,18 @@ trace_t PM_PlayerTrace (vec3_t start, vec3_t end)
 	VectorCopy (end, total.endpos);
 
 	PM_TraceBounds(start, end, tracemins, tracemaxs);
+	bp = PM_Broadphase(tracemins, tracemaxs);
 
-	for (i = 0; i < pmove.numphysent; i++) {
-		pe = &pmove.physents[i];
-
-		// get the clipping hull
-		if (pe->model) {
-			hull = &pmove.physents[i].model->hulls[1];
-
-			if (i > 0 && PM_CullTraceBox(tracemins, tracemaxs, pe->origin, pe->model->mins, pe->model->maxs, hull->clip_mins, hull->clip_maxs)) {
-				continue;
-			}
-
-			VectorSubtract(hull->clip_mins, player_mins, offset);
-			VectorAdd(offset, pe->origin, offset);
+	for (i = 0; i < bp->num; i++) {
+		if (tracemins[0] > bp->maxs[0][i] || tracemaxs[0] < bp->mins[0][i] ||
+			tracemins[1] > bp->maxs[1][i] || tracemaxs[1] < bp->mins[1][i] ||
+			tracemins[2] > bp->maxs[2][i] || tracemaxs[2] < bp->mins[2][i]) {
+			continue;
 		}
-		else {
-			VectorSubtract(pe->mins, player_maxs, mins);
-			VectorSubtract(pe->maxs, player_mins, maxs);
 
-			if (PM_CullTraceBox(tracemins, tracemaxs, pe->origin, mins, maxs, vec3_origin, vec3_origin)) {
-				continue;
-			}
-
-			hull = CM_HullForBox(mins, maxs);
-			VectorCopy(pe->origin, offset);
-		}
+		// get the clipping hull
+		hull = bp->hull[i];
+		offset = bp->offset[i];
 
 		VectorSubtract(start, offset, start_l);
 		VectorSubtract(end, offset, end_l);
@@ -205,7 +349,7 @@ trace_t PM_PlayerTrace (vec3_t start, vec3_t end)
 		// did we clip the move?
 		if (trace.fraction < total.fraction) {
 			total = trace;
-			total.e.entnum = i;
+			total.e.entnum = bp->index[i];
 		}
 	}
 
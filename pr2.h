@@ -33,6 +33,7 @@ extern vm_t* sv_vm;
 
 
 void		PR2_Init(void);
+void		PR2_TrapProfile_f(void);
 #define PR_Init PR2_Init
 void		PR2_UnLoadProgs(void);
 #define PR_UnLoadProgs PR2_UnLoadProgs
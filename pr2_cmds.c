@@ -968,34 +968,46 @@ gedict_t *findradius( gedict_t * start, vec3_t org, float rad );
 
 void PF2_FindRadius( byte * base, uintptr_t mask, pr2val_t * stack, pr2val_t * retval )
 {
-	int     e,j;
-
-	edict_t *ed;
-	float* org;
-	vec3_t	eorg;
-	float rad;
+	int			e, i, j, numtouch;
+	edict_t		*touchlist[MAX_EDICTS], *ed, *found = NULL;
+	float		*org;
+	vec3_t		mins, maxs, eorg;
+	float		rad;
 
 	e = NUM_FOR_EDICT( (edict_t *) VM_POINTER( base, mask, stack[0]._int ) );
 	org = (float *) VM_POINTER( base, mask, stack[1]._int );
 	rad = stack[2]._float;
 
-	for ( e++; e < sv.num_edicts; e++ )
+	// only look at what is linked around org, same as PF_findradius
+	for (i = 0; i < 3; i++)
 	{
-		ed = EDICT_NUM( e );
+		mins[i] = org[i] - rad - 1;		// enlarge the bbox a bit
+		maxs[i] = org[i] + rad + 1;
+	}
+
+	numtouch = SV_AreaEdicts (mins, maxs, touchlist, sv.max_edicts, AREA_SOLID);
+	numtouch += SV_AreaEdicts (mins, maxs, &touchlist[numtouch], sv.max_edicts - numtouch, AREA_TRIGGERS);
 
+	// the game walks the result by passing the last one back, so return the lowest after start
+	for (i = 0; i < numtouch; i++)
+	{
+		ed = touchlist[i];
+
+		if (ed->e->entnum <= e || (found && ed->e->entnum >= found->e->entnum))
+			continue;
 		if (ed->e->free)
 			continue;
 		if (ed->v.solid == SOLID_NOT)
 			continue;
 		for (j=0 ; j<3 ; j++)
-			eorg[j] = org[j] - (ed->v.origin[j] + (ed->v.mins[j] + ed->v.maxs[j])*0.5);			
+			eorg[j] = org[j] - (ed->v.origin[j] + (ed->v.mins[j] + ed->v.maxs[j])*0.5);
 		if (VectorLength(eorg) > rad)
 			continue;
-		retval->_int = POINTER_TO_VM( base, mask, ed );
-		return;
+
+		found = ed;
 	}
-	retval->_int = 0;
-	return;
+
+	retval->_int = found ? POINTER_TO_VM( base, mask, found ) : 0;
 }
 
 /*
@@ -1588,6 +1600,181 @@ void PF2_WriteEntity(byte* base, uintptr_t mask, pr2val_t* stack, pr2val_t*retva
 		MSG_WriteShort(WriteDest2(to), data);
 }
 
+/*
+==================
+PF2_WriteBatch
+
+Reads the whole run first, so the reliable block and the demo message are
+begun once per chunk that fits them, and malformed data writes nothing.
+A run with a single write bigger than a reliable block or a demo message
+can never be sent and is refused as well.
+==================
+*/
+#define	MAX_WRITEBATCH	1024
+
+typedef struct {
+	int			op;
+	int			i;
+	float		f;
+	char		*s;
+	int			size;		// bytes on the wire
+} writebatchop_t;
+
+static void PF2_WriteBatchOp(const writebatchop_t *op, client_t *cl, sizebuf_t *msg, qbool mvd)
+{
+	switch (op->op)
+	{
+	case G_WRITEBYTE:
+		if (cl)
+			ClientReliableWrite_Byte(cl, op->i);
+		else if (mvd)
+			MVD_MSG_WriteByte(op->i);
+		else
+			MSG_WriteByte(msg, op->i);
+		break;
+	case G_WRITECHAR:
+		if (cl)
+			ClientReliableWrite_Char(cl, op->i);
+		else if (mvd)
+			MVD_MSG_WriteByte(op->i);
+		else
+			MSG_WriteChar(msg, op->i);
+		break;
+	case G_WRITESHORT:
+	case G_WRITEENTITY:
+		if (cl)
+			ClientReliableWrite_Short(cl, op->i);
+		else if (mvd)
+			MVD_MSG_WriteShort(op->i);
+		else
+			MSG_WriteShort(msg, op->i);
+		break;
+	case G_WRITELONG:
+		if (cl)
+			ClientReliableWrite_Long(cl, op->i);
+		else if (mvd)
+			MVD_MSG_WriteLong(op->i);
+		else
+			MSG_WriteLong(msg, op->i);
+		break;
+	case G_WRITEANGLE:
+		if (cl)
+			ClientReliableWrite_Angle(cl, op->f);
+		else if (mvd)
+			MVD_MSG_WriteAngle(op->f);
+		else
+			MSG_WriteAngle(msg, op->f);
+		break;
+	case G_WRITECOORD:
+		if (cl)
+			ClientReliableWrite_Coord(cl, op->f);
+		else if (mvd)
+			MVD_MSG_WriteCoord(op->f);
+		else
+			MSG_WriteCoord(msg, op->f);
+		break;
+	case G_WRITESTRING:
+		if (cl)
+			ClientReliableWrite_String(cl, op->s);
+		else if (mvd)
+			MVD_MSG_WriteString(op->s);
+		else
+			MSG_WriteString(msg, op->s);
+		break;
+	}
+}
+
+void PF2_WriteBatch(byte* base, uintptr_t mask, pr2val_t* stack, pr2val_t*retval)
+{
+	static writebatchop_t ops[MAX_WRITEBATCH];
+	int to   = stack[0]._int;
+	int len  = stack[2]._int;
+	byte *data = (byte *) VM_ArrayPointer(base, mask, stack[1]._int, len);
+	byte *end, *s;
+	int numops = 0, size, limit, first, i, n;
+	float f;
+
+	retval->_int = -1;
+	if (!data || len <= 0)
+		return;
+
+	for (end = data + len; data < end; numops++)
+	{
+		if (numops == MAX_WRITEBATCH)
+			return;
+
+		ops[numops].op = *data++;
+		switch (ops[numops].op)
+		{
+		case G_WRITEBYTE: case G_WRITECHAR: case G_WRITESHORT: case G_WRITELONG: case G_WRITEENTITY:
+			if (end - data < 4)
+				return;
+			memcpy(&n, data, 4);
+			ops[numops].i = n;
+			data += 4;
+			ops[numops].size = ops[numops].op == G_WRITELONG ? 4 : ops[numops].op == G_WRITESHORT || ops[numops].op == G_WRITEENTITY ? 2 : 1;
+			break;
+		case G_WRITEANGLE: case G_WRITECOORD:
+			if (end - data < 4)
+				return;
+			memcpy(&f, data, 4);
+			ops[numops].f = f;
+			data += 4;
+#ifdef FTE_PEXT_FLOATCOORDS
+			ops[numops].size = ops[numops].op == G_WRITEANGLE ? msg_anglesize : msg_coordsize;
+#else
+			ops[numops].size = ops[numops].op == G_WRITEANGLE ? 1 : 2;
+#endif
+			break;
+		case G_WRITESTRING:
+			if (!(s = memchr(data, 0, end - data)))
+				return;
+			ops[numops].s = (char *) data;
+			ops[numops].size = s - data + 1;
+			data = s + 1;
+			break;
+		default:
+			return;
+		}
+	}
+
+	if (to == MSG_ONE)
+	{
+		client_t *cl = Write_GetClient();
+
+		limit = min(cl->netchan.message.maxsize - 1, MAX_MVD_SIZE);
+		for (i = 0; i < numops; i++)
+			if (ops[i].size > limit)
+				return;
+
+		for (first = 0; first < numops; first = i)
+		{
+			for (i = first, size = 0; i < numops && size + ops[i].size <= limit; i++)
+				size += ops[i].size;
+
+			ClientReliableCheckBlock(cl, size);
+			for (n = first; n < i; n++)
+				PF2_WriteBatchOp(&ops[n], cl, NULL, false);
+			if (sv.mvdrecording)
+			{
+				if (MVDWrite_Begin(dem_single, cl - svs.clients, size))
+				{
+					for (n = first; n < i; n++)
+						PF2_WriteBatchOp(&ops[n], NULL, NULL, true);
+				}
+			}
+		}
+	}
+	else
+	{
+		sizebuf_t *msg = WriteDest2(to);
+		for (i = 0; i < numops; i++)
+			PF2_WriteBatchOp(&ops[i], NULL, msg, false);
+	}
+
+	retval->_int = numops;
+}
+
 //=============================================================================
 
 int SV_ModelIndex(char *name);
@@ -2937,16 +3124,117 @@ pr2_trapcall_t pr2_API[]=
 		PF2_setpause,		//G_SETPAUSE
 		PF2_SetUserInfo,	//G_SETUSERINFO
 		PF2_MoveToGoal,		//G_MOVETOGOAL
+		PF2_WriteBatch,		//G_WRITEBATCH
     };
 int pr2_numAPI = sizeof(pr2_API)/sizeof(pr2_API[0]);
 
+// for trapprofile, in pr2_API order
+static const char *pr2_API_names[] =
+{
+	"G_GETAPIVERSION", "G_DPRINT", "G_ERROR", "G_GetEntityToken",
+	"G_SPAWN_ENT", "G_REMOVE_ENT", "G_PRECACHE_SOUND", "G_PRECACHE_MODEL",
+	"G_LIGHTSTYLE", "G_SETORIGIN", "G_SETSIZE", "G_SETMODEL",
+	"G_BPRINT", "G_SPRINT", "G_CENTERPRINT", "G_AMBIENTSOUND",
+	"G_SOUND", "G_TRACELINE", "G_CHECKCLIENT", "G_STUFFCMD",
+	"G_LOCALCMD", "G_CVAR", "G_CVAR_SET", "G_FINDRADIUS",
+	"G_WALKMOVE", "G_DROPTOFLOOR", "G_CHECKBOTTOM", "G_POINTCONTENTS",
+	"G_NEXTENT", "G_AIM", "G_MAKESTATIC", "G_SETSPAWNPARAMS",
+	"G_CHANGELEVEL", "G_LOGFRAG", "G_GETINFOKEY", "G_MULTICAST",
+	"G_DISABLEUPDATES", "G_WRITEBYTE", "G_WRITECHAR", "G_WRITESHORT",
+	"G_WRITELONG", "G_WRITEANGLE", "G_WRITECOORD", "G_WRITESTRING",
+	"G_WRITEENTITY", "G_FLUSHSIGNON", "g_memset", "g_memcpy",
+	"g_strncpy", "g_sin", "g_cos", "g_atan2",
+	"g_sqrt", "g_floor", "g_ceil", "g_acos",
+	"G_CMD_ARGC", "G_CMD_ARGV", "G_TraceCapsule", "G_FSOpenFile",
+	"G_FSCloseFile", "G_FSReadFile", "G_FSWriteFile", "G_FSSeekFile",
+	"G_FSTellFile", "G_FSGetFileList", "G_CVAR_SET_FLOAT", "G_CVAR_STRING",
+	"G_Map_Extension", "G_strcmp", "G_strncmp", "G_stricmp",
+	"G_strnicmp", "G_Find", "G_executecmd", "G_conprint",
+	"G_readcmd", "G_redirectcmd", "G_Add_Bot", "G_Remove_Bot",
+	"G_SetBotUserInfo", "G_SetBotCMD", "G_QVMstrftime", "G_CMD_ARGS",
+	"G_CMD_TOKENIZE", "g_strlcpy", "g_strlcat", "G_MAKEVECTORS",
+	"G_NEXTCLIENT", "G_PRECACHE_VWEP_MODEL", "G_SETPAUSE", "G_SETUSERINFO",
+	"G_MOVETOGOAL", "G_WRITEBATCH",
+};
+
+typedef char pr2_API_names_complete[sizeof(pr2_API_names) / sizeof(pr2_API_names[0]) == sizeof(pr2_API) / sizeof(pr2_API[0]) ? 1 : -1];
+
+static unsigned int	pr2_trapcalls[sizeof(pr2_API) / sizeof(pr2_API[0])];
+static double		pr2_traptime[sizeof(pr2_API) / sizeof(pr2_API[0])];	// only while sv_frameprofile is on
+
+static void PR2_CallTrap(int fn, byte* base, uintptr_t mask, pr2val_t* stack, pr2val_t* retval)
+{
+	double start;
+
+	pr2_trapcalls[fn]++;
+
+	if (!SV_ProfileActive())
+	{
+		pr2_API[fn](base, mask, stack, retval);
+		return;
+	}
+
+	start = Sys_DoubleTime();
+	pr2_API[fn](base, mask, stack, retval);
+	pr2_traptime[fn] += Sys_DoubleTime() - start;
+}
+
+/*
+==================
+PR2_TrapProfile_f
+
+Calls to each trap since the last reset, busiest first. Times include
+whatever game code the trap ran in turn, such as touch functions.
+==================
+*/
+void PR2_TrapProfile_f(void)
+{
+	int order[sizeof(pr2_API) / sizeof(pr2_API[0])];
+	int i, j, k, shown;
+	double total = 0;
+
+	if (Cmd_Argc() > 1 && !strcmp(Cmd_Argv(1), "reset"))
+	{
+		memset(pr2_trapcalls, 0, sizeof(pr2_trapcalls));
+		memset(pr2_traptime, 0, sizeof(pr2_traptime));
+		Con_Printf("Trap profile cleared\n");
+		return;
+	}
+
+	for (i = 0; i < pr2_numAPI; i++)
+	{
+		// by time, then by calls
+		for (j = i; j > 0; j--)
+		{
+			k = order[j - 1];
+			if (pr2_traptime[k] > pr2_traptime[i] || (pr2_traptime[k] == pr2_traptime[i] && pr2_trapcalls[k] >= pr2_trapcalls[i]))
+				break;
+			order[j] = k;
+		}
+		order[j] = i;
+		total += pr2_traptime[i];
+	}
+
+	Con_Printf("trap                       calls   total ms    avg us\n");
+	for (i = shown = 0; i < pr2_numAPI && shown < 25; i++)
+	{
+		k = order[i];
+		if (!pr2_trapcalls[k])
+			continue;
+		Con_Printf("%-22s %10u %10.2f %9.2f\n", pr2_API_names[k], pr2_trapcalls[k],
+			pr2_traptime[k] * 1000, pr2_traptime[k] * 1000000 / pr2_trapcalls[k]);
+		shown++;
+	}
+	Con_Printf("total %.2f ms%s\n", total * 1000, SV_ProfileActive() ? "" : ", times are only taken with sv_frameprofile 1");
+}
+
 intptr_t sv_syscall(intptr_t arg, ...) //must passed ints
 {
 	intptr_t args[20];
 	va_list argptr;
 	pr2val_t ret;
 
-	if( arg >= pr2_numAPI )
+	if( arg < 0 || arg >= pr2_numAPI )
 		PR2_RunError ("sv_syscall: Bad API call number");
 
 	va_start(argptr, arg);
@@ -2972,7 +3260,7 @@ intptr_t sv_syscall(intptr_t arg, ...) //must passed ints
 	args[19]=va_arg(argptr, intptr_t);
 	va_end(argptr);
 
-	pr2_API[arg] ( 0, (uintptr_t)~0, (pr2val_t*)args, &ret);
+	PR2_CallTrap(arg, 0, (uintptr_t)~0, (pr2val_t*)args, &ret);
 
 	return ret._int;
 }
@@ -2981,10 +3269,10 @@ int sv_sys_callex(byte *data, unsigned int mask, int fn, pr2val_t*arg)
 {
 	pr2val_t ret;
 
-	if( fn >= pr2_numAPI )
+	if( fn < 0 || fn >= pr2_numAPI )
 		PR2_RunError ("sv_sys_callex: Bad API call number");
 
-	pr2_API[fn](data, mask, arg,&ret);
+	PR2_CallTrap(fn, data, mask, arg, &ret);
 	return ret._int;
 }
 
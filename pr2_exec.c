@@ -73,6 +73,7 @@ void PR2_Init(void)
 	Cmd_AddCommand ("edicts", ED2_PrintEdicts);
 	Cmd_AddCommand ("edictcount", ED_Count);
 	Cmd_AddCommand ("profile", PR2_Profile_f);
+	Cmd_AddCommand ("trapprofile", PR2_TrapProfile_f);
 	Cmd_AddCommand ("mod", PR2_GameConsoleCommand);
 
 	memset(pr_newstrtbl, 0, sizeof(pr_newstrtbl));
@@ -80,8 +80,18 @@ qbool PR2_IsValidWriteAddress(register qvm_t * qvm, intptr_t address)
 void* VM_POINTER(byte* base, uintptr_t mask, intptr_t offset)
 {
 	intptr_t address = (intptr_t) base + offset;
-	qvm_t* qvm = (qvm_t*) sv_vm->hInst;
+	qvm_t* qvm;
 
+	// native mods pass real pointers, base is 0 and mask all ones
+	if (sv_vm->type != VM_BYTECODE) {
+		return OLD_VM_POINTER(base, mask, offset);
+	}
+
+	// nearly always a pointer into the data segment, try that first
+	qvm = (qvm_t*) sv_vm->hInst;
+	if (address >= (intptr_t)qvm->ds && address < (intptr_t)qvm->ds + qvm->len_ds) {
+		return (void*)address;
+	}
 	if (PR2_IsValidWriteAddress(qvm, address)) {
 		return (void*)address;
 	}
@@ -89,6 +99,27 @@ void* VM_POINTER(byte* base, uintptr_t mask, intptr_t offset)
 	return OLD_VM_POINTER(base, mask, offset);
 }
 
+// a block of size bytes the game passed, NULL unless it all lies within the data segment
+void* VM_ArrayPointer(byte* base, uintptr_t mask, intptr_t offset, int size)
+{
+	intptr_t address = (intptr_t) base + offset;
+	qvm_t* qvm;
+
+	if (size < 0) {
+		return NULL;
+	}
+	if (sv_vm->type != VM_BYTECODE) {
+		return OLD_VM_POINTER(base, mask, offset);
+	}
+
+	qvm = (qvm_t*) sv_vm->hInst;
+	if (address < (intptr_t)qvm->ds || address > (intptr_t)qvm->ds + qvm->len_ds - size) {
+		return NULL;
+	}
+
+	return (void*)address;
+}
+
 profile_t* ProfileEnterFunction(int adress)
 {
 	int i;
@@ -531,16 +562,24 @@ int     QVM_Exec( register qvm_t * qvm, int command, int arg0, int arg1, int arg
 intptr_t VM_Call( vm_t * vm, int command, int arg0, int arg1, int arg2, int arg3, int arg4, int arg5,
              int arg6, int arg7, int arg8, int arg9, int arg10, int arg11 )
 {
+	intptr_t ret;
+
 	if ( !vm )
 		Sys_Error( "VM_Call with NULL vm" );
 
 	switch ( vm->type )
 	{
 	case VM_NATIVE:
-		return vm->vmMain( command, arg0, arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8, arg9, arg10, arg11 );
+		SV_ProfileEnter( SVPROF_PROGS );
+		ret = vm->vmMain( command, arg0, arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8, arg9, arg10, arg11 );
+		SV_ProfileLeave( SVPROF_PROGS );
+		return ret;
 	case VM_BYTECODE:
-		return QVM_Exec( (qvm_t*) vm->hInst, command, arg0, arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8, arg9, arg10,
+		SV_ProfileEnter( SVPROF_PROGS );
+		ret = QVM_Exec( (qvm_t*) vm->hInst, command, arg0, arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8, arg9, arg10,
 		                 arg11 );
+		SV_ProfileLeave( SVPROF_PROGS );
+		return ret;
 	case VM_NONE:
 		Sys_Error( "VM_Call with VM_NONE type vm" );
 	}
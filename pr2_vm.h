@@ -43,6 +43,7 @@
 
 // #define VM_POINTER(base,mask,x)			((void*)((char *)base+((x)&mask)))
 void* VM_POINTER(byte* base, uintptr_t mask, intptr_t offset);
+void* VM_ArrayPointer(byte* base, uintptr_t mask, intptr_t offset, int size);
 
 // meag: can leave this right now only because it is only used to return pointers to edicts
 #define POINTER_TO_VM(base,mask,x)		((x)?(intptr_t)((char *)(x) - (char*)base)&mask:0)
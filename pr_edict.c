@@ -80,6 +80,7 @@ cvar_t	sv_progsname = {"sv_progsname", "qwprogs"};
 #ifdef WITH_NQPROGS
 cvar_t  sv_forcenqprogs = {"sv_forcenqprogs", "0"};
 #endif
+extern cvar_t sv_progs_verify;
 
 /*
 =================
@@ -1228,6 +1229,8 @@ void PR1_InitProg(void)
 {
 	sv.edicts = (edict_t*) Hunk_AllocName (MAX_EDICTS * pr_edict_size, "edicts");
 	sv.max_edicts = MAX_EDICTS;
+
+	PR_DecodeProgram ();
 }
 
 /*
@@ -1241,6 +1244,7 @@ void PR1_Init (void)
 #ifdef WITH_NQPROGS
 	Cvar_Register(&sv_forcenqprogs);
 #endif
+	Cvar_Register(&sv_progs_verify);
 
 	Cmd_AddCommand ("edict", ED_PrintEdict_f);
 	Cmd_AddCommand ("edicts", ED_PrintEdicts);
@@ -348,14 +348,16 @@ int PR_LeaveFunction (void)
 	return pr_stack[pr_depth].s;
 }
 
+static void PR_CallBuiltin (int num);
+
 /*
 ============================================================================
-PR_ExecuteProgram
+PR_ExecuteClassic
 
-The interpretation main loop
+The interpretation main loop, works straight on the progs statements
 ============================================================================
 */
-void PR_ExecuteProgram (func_t fnum)
+static void PR_ExecuteClassic (func_t fnum)
 {
 	eval_t *a = NULL, *b = NULL, *c = NULL;
 	int s;
@@ -631,7 +633,7 @@ void PR_ExecuteProgram (func_t fnum)
 				i = -newf->first_statement;
 				if (i >= pr_numbuiltins)
 					PR_RunError ("Bad builtin call number");
-				pr_builtins[i] ();
+				PR_CallBuiltin (i);
 				break;
 			}
 
@@ -667,6 +669,762 @@ void PR_ExecuteProgram (func_t fnum)
 
 }
 
+/*
+============================================================================
+Pre-decoded statements
+
+PR_DecodeProgram translates the statements once the progs are loaded: the
+operands become pointers into pr_globals, branches become statement indexes
+and loads/addresses of constant fields get the entity offset baked in.
+PR_ExecuteDecoded then runs them with computed goto dispatch where the
+compiler supports it, falling back to a switch otherwise.
+============================================================================
+*/
+
+#ifdef __GNUC__
+#define PR_COMPUTED_GOTO
+#endif
+
+// ops which only exist in the decoded form
+enum {
+	OPX_LOAD_FIELD = OP_BITOR + 1,	// OP_LOAD_* with a constant field
+	OPX_LOAD_VFIELD,				// OP_LOAD_V with a constant field
+	OPX_ADDRESS_FIELD,				// OP_ADDRESS with a constant field
+	OPX_BAD,						// unknown op, errors out when reached
+	OPX_NUMOPS
+};
+
+typedef struct {
+	int		op;
+	int		arg;		// branch target or field offset in ints
+	eval_t	*a, *b, *c;
+} prdecoded_t;
+
+static prdecoded_t *pr_decoded;
+
+static void PR_VerifyFree (void);
+
+cvar_t sv_progs_verify = {"sv_progs_verify", "0"};
+
+static void PR_DecodeMarkWritten(byte *written, int ofs, int count)
+{
+	for ( ; count > 0; count--, ofs++)
+	{
+		if ((unsigned int)ofs < (unsigned int)progs->numglobals)
+			written[ofs] = true;
+	}
+}
+
+void PR_DecodeProgram (void)
+{
+	dstatement_t *st;
+	prdecoded_t *ds;
+	dfunction_t *f;
+	byte *written;
+	int i, op, ofs;
+
+	PR_VerifyFree ();
+
+	pr_decoded = (prdecoded_t *) Hunk_AllocName (progs->numstatements * sizeof(prdecoded_t), "prdecode");
+
+	// find the globals which can't change, field references live in those
+	written = (byte *) Q_calloc (progs->numglobals, 1);
+
+	PR_DecodeMarkWritten (written, 0, sizeof(globalvars_t) / 4); // parms, return value and everything builtins set
+
+	for (i = 0, f = pr_functions; i < progs->numfunctions; i++, f++)
+	{
+		if (f->first_statement >= 0)
+			PR_DecodeMarkWritten (written, f->parm_start, f->locals);
+	}
+
+	for (i = 0, st = pr_statements; i < progs->numstatements; i++, st++)
+	{
+		switch (st->op)
+		{
+		case OP_STORE_F: case OP_STORE_ENT: case OP_STORE_FLD: case OP_STORE_S: case OP_STORE_FNC:
+			PR_DecodeMarkWritten (written, st->b, 1);
+			break;
+		case OP_STORE_V:
+			PR_DecodeMarkWritten (written, st->b, 3);
+			break;
+		case OP_STOREP_F: case OP_STOREP_ENT: case OP_STOREP_FLD: case OP_STOREP_S: case OP_STOREP_FNC: case OP_STOREP_V:
+		case OP_IF: case OP_IFNOT: case OP_GOTO: case OP_STATE: case OP_DONE: case OP_RETURN:
+		case OP_CALL0: case OP_CALL1: case OP_CALL2: case OP_CALL3: case OP_CALL4:
+		case OP_CALL5: case OP_CALL6: case OP_CALL7: case OP_CALL8:
+			break;
+		case OP_ADD_V: case OP_SUB_V: case OP_MUL_FV: case OP_MUL_VF: case OP_LOAD_V:
+			PR_DecodeMarkWritten (written, st->c, 3);
+			break;
+		default:
+			PR_DecodeMarkWritten (written, st->c, 1);
+			break;
+		}
+	}
+
+	for (i = 0, st = pr_statements, ds = pr_decoded; i < progs->numstatements; i++, st++, ds++)
+	{
+		op = st->op;
+
+		ds->op = (op > OP_BITOR) ? OPX_BAD : op;
+		ds->a = (eval_t *)&pr_globals[st->a];
+		ds->b = (eval_t *)&pr_globals[st->b];
+		ds->c = (eval_t *)&pr_globals[st->c];
+
+		switch (op)
+		{
+		case OP_IF:
+		case OP_IFNOT:
+			ds->arg = i + st->b;
+			break;
+		case OP_GOTO:
+			ds->arg = i + st->a;
+			break;
+		case OP_LOAD_F: case OP_LOAD_FLD: case OP_LOAD_ENT: case OP_LOAD_S: case OP_LOAD_FNC:
+		case OP_LOAD_V:
+		case OP_ADDRESS:
+			ofs = (unsigned short) st->b;
+			if (ofs >= progs->numglobals || written[ofs] || ds->b->_int < 0)
+				break;
+
+			ds->arg = PR_FIELDOFS(ds->b->_int);
+			ds->op = (op == OP_ADDRESS) ? OPX_ADDRESS_FIELD : (op == OP_LOAD_V) ? OPX_LOAD_VFIELD : OPX_LOAD_FIELD;
+			break;
+		}
+	}
+
+	Q_free (written);
+}
+
+static void PR_ExecuteDecoded (func_t fnum)
+{
+	prdecoded_t *ds;
+	eval_t *a, *b, *c, *ptr;
+	dfunction_t *f, *newf;
+	edict_t *ed;
+	int runaway, profiled;
+	int exitdepth;
+	int i;
+#ifdef PR_COMPUTED_GOTO
+	static const void *const labels[OPX_NUMOPS] = {
+		&&L_OP_DONE, &&L_OP_MUL_F, &&L_OP_MUL_V, &&L_OP_MUL_FV, &&L_OP_MUL_VF, &&L_OP_DIV_F,
+		&&L_OP_ADD_F, &&L_OP_ADD_V, &&L_OP_SUB_F, &&L_OP_SUB_V,
+		&&L_OP_EQ_F, &&L_OP_EQ_V, &&L_OP_EQ_S, &&L_OP_EQ_E, &&L_OP_EQ_FNC,
+		&&L_OP_NE_F, &&L_OP_NE_V, &&L_OP_NE_S, &&L_OP_NE_E, &&L_OP_NE_FNC,
+		&&L_OP_LE, &&L_OP_GE, &&L_OP_LT, &&L_OP_GT,
+		&&L_OP_LOAD_F, &&L_OP_LOAD_V, &&L_OP_LOAD_S, &&L_OP_LOAD_ENT, &&L_OP_LOAD_FLD, &&L_OP_LOAD_FNC,
+		&&L_OP_ADDRESS,
+		&&L_OP_STORE_F, &&L_OP_STORE_V, &&L_OP_STORE_S, &&L_OP_STORE_ENT, &&L_OP_STORE_FLD, &&L_OP_STORE_FNC,
+		&&L_OP_STOREP_F, &&L_OP_STOREP_V, &&L_OP_STOREP_S, &&L_OP_STOREP_ENT, &&L_OP_STOREP_FLD, &&L_OP_STOREP_FNC,
+		&&L_OP_RETURN, &&L_OP_NOT_F, &&L_OP_NOT_V, &&L_OP_NOT_S, &&L_OP_NOT_ENT, &&L_OP_NOT_FNC,
+		&&L_OP_IF, &&L_OP_IFNOT,
+		&&L_OP_CALL0, &&L_OP_CALL1, &&L_OP_CALL2, &&L_OP_CALL3, &&L_OP_CALL4,
+		&&L_OP_CALL5, &&L_OP_CALL6, &&L_OP_CALL7, &&L_OP_CALL8,
+		&&L_OP_STATE, &&L_OP_GOTO, &&L_OP_AND, &&L_OP_OR, &&L_OP_BITAND, &&L_OP_BITOR,
+		&&L_OPX_LOAD_FIELD, &&L_OPX_LOAD_VFIELD, &&L_OPX_ADDRESS_FIELD, &&L_OPX_BAD
+	};
+	static const void *trace_labels[OPX_NUMOPS];
+	const void *const *dispatch;
+
+#define CASE(x)		L_##x: case x:
+#define DISPATCH	if (--runaway == 0) goto runaway_error; a = ds->a; b = ds->b; c = ds->c; goto *dispatch[ds->op]
+#define NEXT		ds++; DISPATCH
+#define JUMP(t)		ds = pr_decoded + (t); DISPATCH
+#else
+#define CASE(x)		case x:
+#define NEXT		ds++; break
+#define JUMP(t)		ds = pr_decoded + (t); break
+#endif
+#define PROFILE()	(pr_xfunction->profile += profiled - runaway, profiled = runaway)
+#define SYNC()		(pr_xstatement = ds - pr_decoded)
+
+	if (!fnum || fnum >= progs->numfunctions)
+	{
+		if (pr_global_struct->self)
+			ED_Print (PROG_TO_EDICT(pr_global_struct->self));
+		SV_Error ("PR_ExecuteProgram: NULL function");
+	}
+
+	f = &pr_functions[fnum];
+
+	runaway = profiled = 100000;
+	pr_trace = false;
+
+	// make a stack frame
+	exitdepth = pr_depth;
+
+	ds = pr_decoded + PR_EnterFunction (f) + 1;
+
+#ifdef PR_COMPUTED_GOTO
+	if (!trace_labels[0])
+	{
+		for (i = 0; i < OPX_NUMOPS; i++)
+			trace_labels[i] = &&L_trace;
+	}
+	dispatch = labels;
+
+	DISPATCH;
+#endif
+
+	while (1)
+	{
+#ifndef PR_COMPUTED_GOTO
+		if (--runaway == 0)
+			goto runaway_error;
+		if (pr_trace)
+			PR_PrintStatement (pr_statements + (ds - pr_decoded));
+		a = ds->a;
+		b = ds->b;
+		c = ds->c;
+#endif
+
+		switch (ds->op)
+		{
+		CASE(OP_ADD_F)
+			c->_float = a->_float + b->_float;
+			NEXT;
+		CASE(OP_ADD_V)
+			c->vector[0] = a->vector[0] + b->vector[0];
+			c->vector[1] = a->vector[1] + b->vector[1];
+			c->vector[2] = a->vector[2] + b->vector[2];
+			NEXT;
+
+		CASE(OP_SUB_F)
+			c->_float = a->_float - b->_float;
+			NEXT;
+		CASE(OP_SUB_V)
+			c->vector[0] = a->vector[0] - b->vector[0];
+			c->vector[1] = a->vector[1] - b->vector[1];
+			c->vector[2] = a->vector[2] - b->vector[2];
+			NEXT;
+
+		CASE(OP_MUL_F)
+			c->_float = a->_float * b->_float;
+			NEXT;
+		CASE(OP_MUL_V)
+			c->_float = a->vector[0]*b->vector[0]
+			            + a->vector[1]*b->vector[1]
+			            + a->vector[2]*b->vector[2];
+			NEXT;
+		CASE(OP_MUL_FV)
+			c->vector[0] = a->_float * b->vector[0];
+			c->vector[1] = a->_float * b->vector[1];
+			c->vector[2] = a->_float * b->vector[2];
+			NEXT;
+		CASE(OP_MUL_VF)
+			c->vector[0] = b->_float * a->vector[0];
+			c->vector[1] = b->_float * a->vector[1];
+			c->vector[2] = b->_float * a->vector[2];
+			NEXT;
+
+		CASE(OP_DIV_F)
+			c->_float = a->_float / b->_float;
+			NEXT;
+
+		CASE(OP_BITAND)
+			c->_float = (int)a->_float & (int)b->_float;
+			NEXT;
+
+		CASE(OP_BITOR)
+			c->_float = (int)a->_float | (int)b->_float;
+			NEXT;
+
+
+		CASE(OP_GE)
+			c->_float = a->_float >= b->_float;
+			NEXT;
+		CASE(OP_LE)
+			c->_float = a->_float <= b->_float;
+			NEXT;
+		CASE(OP_GT)
+			c->_float = a->_float > b->_float;
+			NEXT;
+		CASE(OP_LT)
+			c->_float = a->_float < b->_float;
+			NEXT;
+		CASE(OP_AND)
+			c->_float = a->_float && b->_float;
+			NEXT;
+		CASE(OP_OR)
+			c->_float = a->_float || b->_float;
+			NEXT;
+
+		CASE(OP_NOT_F)
+			c->_float = !a->_float;
+			NEXT;
+		CASE(OP_NOT_V)
+			c->_float = !a->vector[0] && !a->vector[1] && !a->vector[2];
+			NEXT;
+		CASE(OP_NOT_S)
+			c->_float = !a->string || !*PR1_GetString(a->string);
+			NEXT;
+		CASE(OP_NOT_FNC)
+			c->_float = !a->function;
+			NEXT;
+		CASE(OP_NOT_ENT)
+			c->_float = (PROG_TO_EDICT(a->edict) == sv.edicts);
+			NEXT;
+
+		CASE(OP_EQ_F)
+			c->_float = a->_float == b->_float;
+			NEXT;
+		CASE(OP_EQ_V)
+			c->_float = (a->vector[0] == b->vector[0]) &&
+			            (a->vector[1] == b->vector[1]) &&
+			            (a->vector[2] == b->vector[2]);
+			NEXT;
+		CASE(OP_EQ_S)
+			c->_float = !strcmp(PR1_GetString(a->string), PR1_GetString(b->string));
+			NEXT;
+		CASE(OP_EQ_E)
+			c->_float = a->_int == b->_int;
+			NEXT;
+		CASE(OP_EQ_FNC)
+			c->_float = a->function == b->function;
+			NEXT;
+
+
+		CASE(OP_NE_F)
+			c->_float = a->_float != b->_float;
+			NEXT;
+		CASE(OP_NE_V)
+			c->_float = (a->vector[0] != b->vector[0]) ||
+			            (a->vector[1] != b->vector[1]) ||
+			            (a->vector[2] != b->vector[2]);
+			NEXT;
+		CASE(OP_NE_S)
+			c->_float = strcmp(PR1_GetString(a->string), PR1_GetString(b->string));
+			NEXT;
+		CASE(OP_NE_E)
+			c->_float = a->_int != b->_int;
+			NEXT;
+		CASE(OP_NE_FNC)
+			c->_float = a->function != b->function;
+			NEXT;
+
+			//==================
+		CASE(OP_STORE_F)
+		CASE(OP_STORE_ENT)
+		CASE(OP_STORE_FLD)		// integers
+		CASE(OP_STORE_S)
+		CASE(OP_STORE_FNC)		// pointers
+			b->_int = a->_int;
+			NEXT;
+		CASE(OP_STORE_V)
+			b->vector[0] = a->vector[0];
+			b->vector[1] = a->vector[1];
+			b->vector[2] = a->vector[2];
+			NEXT;
+
+		CASE(OP_STOREP_F)
+		CASE(OP_STOREP_ENT)
+		CASE(OP_STOREP_FLD)		// integers
+		CASE(OP_STOREP_S)
+		CASE(OP_STOREP_FNC)		// pointers
+			ptr = (eval_t *)((byte *)sv.edicts + b->_int);
+			ptr->_int = a->_int;
+			NEXT;
+		CASE(OP_STOREP_V)
+			ptr = (eval_t *)((byte *)sv.edicts + b->_int);
+			ptr->vector[0] = a->vector[0];
+			ptr->vector[1] = a->vector[1];
+			ptr->vector[2] = a->vector[2];
+			NEXT;
+
+		CASE(OP_ADDRESS)
+			ed = PROG_TO_EDICT(a->edict);
+#ifdef PARANOID
+			NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+			if (ed == (edict_t *)sv.edicts && sv.state == ss_active)
+			{
+				SYNC();
+				PR_RunError ("assignment to world entity");
+			}
+			c->_int = (byte *)((int *)&ed->v + PR_FIELDOFS(b->_int)) - (byte *)sv.edicts;
+			NEXT;
+
+		CASE(OPX_ADDRESS_FIELD)
+			ed = PROG_TO_EDICT(a->edict);
+#ifdef PARANOID
+			NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+			if (ed == (edict_t *)sv.edicts && sv.state == ss_active)
+			{
+				SYNC();
+				PR_RunError ("assignment to world entity");
+			}
+			c->_int = (byte *)((int *)&ed->v + ds->arg) - (byte *)sv.edicts;
+			NEXT;
+
+		CASE(OP_LOAD_F)
+		CASE(OP_LOAD_FLD)
+		CASE(OP_LOAD_ENT)
+		CASE(OP_LOAD_S)
+		CASE(OP_LOAD_FNC)
+			ed = PROG_TO_EDICT(a->edict);
+#ifdef PARANOID
+			NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+			//need for checking 'cmd mmode player N', if N >= 0x10000000 =(signed)=> negative
+			if (b->_int >= 0)
+			{
+				a = (eval_t *)((int *)&ed->v + PR_FIELDOFS(b->_int));
+				c->_int = a->_int;
+			}
+			else
+				c->_int = 0;
+			NEXT;
+
+		CASE(OPX_LOAD_FIELD)
+			ed = PROG_TO_EDICT(a->edict);
+#ifdef PARANOID
+			NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+			c->_int = ((int *)&ed->v)[ds->arg];
+			NEXT;
+
+		CASE(OP_LOAD_V)
+			ed = PROG_TO_EDICT(a->edict);
+#ifdef PARANOID
+			NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+			a = (eval_t *)((int *)&ed->v + PR_FIELDOFS(b->_int));
+			c->vector[0] = a->vector[0];
+			c->vector[1] = a->vector[1];
+			c->vector[2] = a->vector[2];
+			NEXT;
+
+		CASE(OPX_LOAD_VFIELD)
+			ed = PROG_TO_EDICT(a->edict);
+#ifdef PARANOID
+			NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+			a = (eval_t *)((int *)&ed->v + ds->arg);
+			c->vector[0] = a->vector[0];
+			c->vector[1] = a->vector[1];
+			c->vector[2] = a->vector[2];
+			NEXT;
+
+			//==================
+
+		CASE(OP_IFNOT)
+			if (!a->_int)
+			{
+				JUMP(ds->arg);
+			}
+			NEXT;
+
+		CASE(OP_IF)
+			if (a->_int)
+			{
+				JUMP(ds->arg);
+			}
+			NEXT;
+
+		CASE(OP_GOTO)
+			JUMP(ds->arg);
+
+		CASE(OP_CALL0)
+		CASE(OP_CALL1)
+		CASE(OP_CALL2)
+		CASE(OP_CALL3)
+		CASE(OP_CALL4)
+		CASE(OP_CALL5)
+		CASE(OP_CALL6)
+		CASE(OP_CALL7)
+		CASE(OP_CALL8)
+			SYNC();
+			PROFILE();
+			pr_argc = ds->op - OP_CALL0;
+			if (!a->function)
+				PR_RunError ("NULL function");
+
+			newf = &pr_functions[a->function];
+
+			if (newf->first_statement < 0)
+			{	// negative statements are built in functions
+				i = -newf->first_statement;
+				if (i >= pr_numbuiltins)
+					PR_RunError ("Bad builtin call number");
+				PR_CallBuiltin (i);
+#ifdef PR_COMPUTED_GOTO
+				if (pr_trace)
+					dispatch = trace_labels;
+#endif
+				NEXT;
+			}
+
+			JUMP(PR_EnterFunction (newf) + 1);
+
+		CASE(OP_DONE)
+		CASE(OP_RETURN)
+			pr_globals[OFS_RETURN] = a->vector[0];
+			pr_globals[OFS_RETURN+1] = a->vector[1];
+			pr_globals[OFS_RETURN+2] = a->vector[2];
+
+			PROFILE();
+			i = PR_LeaveFunction ();
+			if (pr_depth == exitdepth)
+				return;		// all done
+			JUMP(i + 1);
+
+		CASE(OP_STATE)
+			ed = PROG_TO_EDICT(pr_global_struct->self);
+			ed->v.nextthink = pr_global_struct->time + 0.1;
+			if (a->_float != ed->v.frame)
+			{
+				ed->v.frame = a->_float;
+			}
+			ed->v.think = b->function;
+			NEXT;
+
+		CASE(OPX_BAD)
+		default:
+			SYNC();
+			PR_RunError ("Bad opcode %i", pr_statements[ds - pr_decoded].op);
+		}
+	}
+
+#ifdef PR_COMPUTED_GOTO
+L_trace:
+	if (!pr_trace)
+		dispatch = labels;
+	else
+		PR_PrintStatement (pr_statements + (ds - pr_decoded));
+	goto *labels[ds->op];
+#endif
+
+runaway_error:
+	SYNC();
+	PR_RunError ("runaway loop error");
+
+#undef CASE
+#undef DISPATCH
+#undef NEXT
+#undef JUMP
+#undef PROFILE
+#undef SYNC
+}
+
+/*
+============================================================================
+Interpreter verification
+
+With sv_progs_verify set, every top level call runs through the decoded
+interpreter first and then again through the plain one, starting from the
+same globals and edicts.  Builtins only run once: the second pass checks
+the state it reached against the one the builtin saw in the first pass and
+then replays what the builtin left behind.  Anything that differs is
+reported.
+============================================================================
+*/
+
+#define PR_VERIFY_MAXBUILTINS	128
+
+typedef struct {
+	int		num_edicts;
+	byte	*globals;
+	byte	*edicts;
+	int		edictssize;
+} prsnapshot_t;
+
+typedef struct {
+	int				builtin;
+	prsnapshot_t	before, after;
+} prbuiltincall_t;
+
+static prsnapshot_t		pr_verify_start, pr_verify_end;
+static prbuiltincall_t	pr_verify_builtins[PR_VERIFY_MAXBUILTINS];
+static int				pr_verify_numbuiltins;
+static int				pr_verify_replay;		// index of the next builtin to replay, -1 when recording
+static qbool			pr_verify_overflow;
+static qbool			pr_verify_inbuiltin;
+static qbool			pr_verify_active;
+static func_t			pr_verify_function;
+static qbool			pr_verify_failed;
+
+static void PR_SnapshotSave (prsnapshot_t *snap)
+{
+	int size = sv.num_edicts * pr_edict_size;
+
+	if (!snap->globals)
+		snap->globals = (byte *) Q_malloc (progs->numglobals * 4);
+	memcpy (snap->globals, pr_globals, progs->numglobals * 4);
+
+	if (snap->edictssize < size)
+	{
+		Q_free (snap->edicts);
+		snap->edicts = (byte *) Q_malloc (size);
+		snap->edictssize = size;
+	}
+	memcpy (snap->edicts, sv.edicts, size);
+	snap->num_edicts = sv.num_edicts;
+}
+
+static void PR_SnapshotRestore (prsnapshot_t *snap)
+{
+	memcpy (pr_globals, snap->globals, progs->numglobals * 4);
+	memcpy (sv.edicts, snap->edicts, snap->num_edicts * pr_edict_size);
+	sv.num_edicts = snap->num_edicts;
+}
+
+static void PR_SnapshotFree (prsnapshot_t *snap)
+{
+	Q_free (snap->globals);
+	Q_free (snap->edicts);
+	snap->edictssize = 0;
+}
+
+// reports the first difference between the current state and snap, once per call
+static void PR_SnapshotCompare (prsnapshot_t *snap, char *where)
+{
+	char *name = PR1_GetString(pr_functions[pr_verify_function].s_name);
+	int i;
+
+	if (pr_verify_failed)
+		return;
+
+	pr_verify_failed = true;
+
+	if (sv.num_edicts != snap->num_edicts)
+	{
+		Con_Printf ("sv_progs_verify: %s: %s: %i edicts instead of %i\n", name, where, sv.num_edicts, snap->num_edicts);
+	}
+	else if (memcmp (pr_globals, snap->globals, progs->numglobals * 4))
+	{
+		for (i = 0; ((int *)pr_globals)[i] == ((int *)snap->globals)[i]; i++)
+			;
+		Con_Printf ("sv_progs_verify: %s: %s: global %i differs\n", name, where, i);
+	}
+	else if (memcmp (sv.edicts, snap->edicts, snap->num_edicts * pr_edict_size))
+	{
+		for (i = 0; ((byte *)sv.edicts)[i] == snap->edicts[i]; i++)
+			;
+		Con_Printf ("sv_progs_verify: %s: %s: edict %i differs at offset %i\n", name, where,
+			i / pr_edict_size, i % pr_edict_size);
+	}
+	else
+	{
+		pr_verify_failed = false;
+	}
+}
+
+// drop the snapshot buffers, the globals size changes with the progs
+static void PR_VerifyFree (void)
+{
+	int i;
+
+	for (i = 0; i < PR_VERIFY_MAXBUILTINS; i++)
+	{
+		PR_SnapshotFree (&pr_verify_builtins[i].before);
+		PR_SnapshotFree (&pr_verify_builtins[i].after);
+	}
+	PR_SnapshotFree (&pr_verify_start);
+	PR_SnapshotFree (&pr_verify_end);
+}
+
+static void PR_CallBuiltin (int num)
+{
+	prbuiltincall_t *call;
+
+	if (!sv_progs_verify.value || !pr_verify_active || pr_verify_inbuiltin)
+	{
+		pr_builtins[num] ();
+		return;
+	}
+
+	if (pr_verify_replay >= 0)
+	{
+		// second pass, the builtin already ran
+		if (pr_verify_replay >= pr_verify_numbuiltins || pr_verify_builtins[pr_verify_replay].builtin != num)
+			PR_RunError ("sv_progs_verify: builtin #%i called out of order", num);
+
+		call = &pr_verify_builtins[pr_verify_replay++];
+		PR_SnapshotCompare (&call->before, va("before builtin #%i", num));
+		PR_SnapshotRestore (&call->after);
+		return;
+	}
+
+	if (pr_verify_numbuiltins >= PR_VERIFY_MAXBUILTINS)
+	{
+		pr_verify_overflow = true;
+		pr_builtins[num] ();
+		return;
+	}
+
+	call = &pr_verify_builtins[pr_verify_numbuiltins++];
+	call->builtin = num;
+	PR_SnapshotSave (&call->before);
+
+	pr_verify_inbuiltin = true;
+	pr_builtins[num] ();
+	pr_verify_inbuiltin = false;
+
+	PR_SnapshotSave (&call->after);
+}
+
+static void PR_ExecuteVerified (func_t fnum)
+{
+	pr_verify_numbuiltins = 0;
+	pr_verify_replay = -1;
+	pr_verify_overflow = false;
+	pr_verify_inbuiltin = false;
+	pr_verify_failed = false;
+	pr_verify_function = fnum;
+	pr_verify_active = true;
+
+	PR_SnapshotSave (&pr_verify_start);
+	PR_ExecuteDecoded (fnum);
+
+	if (pr_verify_overflow)
+	{
+		pr_verify_active = false;
+		return;		// too many builtins to replay, skip this one
+	}
+
+	PR_SnapshotSave (&pr_verify_end);
+	PR_SnapshotRestore (&pr_verify_start);
+
+	pr_verify_replay = 0;
+	PR_ExecuteClassic (fnum);
+	pr_verify_active = false;
+
+	if (pr_verify_replay != pr_verify_numbuiltins)
+		PR_RunError ("sv_progs_verify: %i builtin calls instead of %i", pr_verify_replay, pr_verify_numbuiltins);
+	pr_verify_replay = -1;
+
+	PR_SnapshotCompare (&pr_verify_end, "on return");
+
+	// carry on with what the decoded pass produced
+	PR_SnapshotRestore (&pr_verify_end);
+}
+
+/*
+============================================================================
+PR_ExecuteProgram
+============================================================================
+*/
+void PR_ExecuteProgram (func_t fnum)
+{
+	SV_ProfileEnter (SVPROF_PROGS);
+
+	if (!pr_decoded)
+	{
+		PR_ExecuteClassic (fnum);
+	}
+	else if (sv_progs_verify.value && !pr_depth)
+	{
+		PR_ExecuteVerified (fnum);
+	}
+	else
+	{
+		PR_ExecuteDecoded (fnum);
+	}
+
+	SV_ProfileLeave (SVPROF_PROGS);
+}
+
 //=============================================================================
 
 char *pr_newstrtbl[MAX_PRSTR];
@@ -869,6 +1627,8 @@ void PR1_UnLoadProgs(void)
 #ifdef WITH_NQPROGS
 		pr_nqprogs = false;
 #endif
+		pr_decoded = NULL;
+		PR_VerifyFree ();
 		progs = NULL;
 	}
 }
@@ -119,6 +119,7 @@ void NQP_Reset (void);
 void PR_Init (void);
 
 void PR_ExecuteProgram (func_t fnum);
+void PR_DecodeProgram (void);
 void PR_InitPatchTables (void);	// NQ progs support
 
 void PR_Profile_f (void);
@@ -258,6 +258,7 @@ typedef struct client_s
 #ifdef PROTOCOL_VERSION_FTE
 #ifdef FTE_PEXT_CHUNKEDDOWNLOADS
 	int				download_chunks_perframe;
+	double			download_cleartime;		// paces chunks of windowed downloads by drate
 #endif
 #endif
 	int				downloadsize;			// total bytes
@@ -425,6 +426,18 @@ typedef enum {DEST_NONE, DEST_FILE, DEST_BUFFEREDFILE, DEST_STREAM} desttype_t;
 
 #define MAX_PROXY_INBUFFER		4096 /* qqshka: too small??? */
 
+// demo data for QTV streams is written once into a chain of these and each stream sends it from its own cursor,
+// a segment is freed when no stream cursor is left at or before it.
+#define MVD_SEGMENT_SIZE		65536
+
+typedef struct mvdseg_s
+{
+	int				refs; // stream cursors inside this segment
+	int				used;
+	struct mvdseg_s	*next;
+	byte			data[MVD_SEGMENT_SIZE];
+} mvdseg_t;
+
 typedef struct mvddest_s
 {
 	qbool error; //disables writers, quit ASAP.
@@ -457,6 +470,10 @@ typedef struct mvddest_s
 
 	char            qtvaddress[128];
 	int             qtvstreamid;
+
+	mvdseg_t		*seg; // cursor into the shared stream, data in ->cache is sent before it
+	int				segpos;
+	unsigned int	streampos; // shared stream offset of the cursor
 // }
 
 	struct mvddest_s *nextdest;
@@ -507,13 +524,17 @@ typedef struct
 	double			active;
 	double			idle;
 	double			demo;
+	double			touch;				// SV_TouchLinks, including the touch functions
 	int				count;
 	int				packets;
+	int				touches;			// touch functions called
 
 	double			latched_active;
 	double			latched_idle;
 	double			latched_demo;
+	double			latched_touch;
 	int				latched_packets;
+	int				latched_touches;
 } svstats_t;
 
 // MAX_CHALLENGES is made large to prevent a denial
@@ -673,6 +694,7 @@ extern	cvar_t	sv_paused; // 1 - normal, 2 - auto (single player), 3 - both
 extern	cvar_t	sv_maxspeed;
 extern	cvar_t	sv_mintic, sv_maxtic, sv_maxfps;
 extern	cvar_t	sv_antilag, sv_antilag_no_pred, sv_antilag_projectiles;
+extern	cvar_t	sv_triggergrid, sv_touchdedup;
 
 extern	int current_skill;
 
@@ -858,6 +880,7 @@ void SV_UserInit (void);
 void SV_TogglePause (const char *msg, int bit);
 void ProcessUserInfoChange (client_t* sv_client, const char* key, const char* old_value);
 void SV_RotateCmd(client_t* cl, usercmd_t* cmd);
+void SV_DownloadCache_Flush(qbool force);
 
 #ifdef FTE_PEXT2_VOICECHAT
 void SV_VoiceInitClient(client_t *client);
@@ -937,6 +960,7 @@ extern cvar_t	sv_demofps;
 extern cvar_t	sv_demoPings;
 extern cvar_t	sv_demoMaxSize;
 extern cvar_t	sv_demoExtraNames;
+extern cvar_t	sv_demoCompress;
 
 extern cvar_t	sv_demoPrefix;
 extern cvar_t	sv_demoSuffix;
@@ -957,6 +981,7 @@ char *SV_MVDNum(int num);
 
 char	*SV_PrintTeams (void);
 void	Run_sv_demotxt_and_sv_onrecordfinish (const char *dest_name, const char *dest_path, qbool destroyfiles);
+void	SV_DemoCompress_Poll (void);
 qbool	SV_DirSizeCheck (void);
 char	*SV_CleanName (unsigned char *name);
 int     Dem_CountPlayers (void);
@@ -977,6 +1002,40 @@ void	SV_MVDInfo_f (void);
 void	SV_LastScores_f (void);
 char*   SV_MVDName2Txt (const char *name);
 
+//
+// sv_demo_index.c
+//
+
+typedef struct
+{
+	char		name[MAX_DEMO_NAME];
+	int			size;
+	int			time;
+	qbool		isdemo;		// matches sv_demoRegexp
+	qbool		meta;		// fields below were read from the .txt
+	char		map[MAX_QPATH];
+	char		players[256];
+} demoentry_t;
+
+typedef struct
+{
+	demoentry_t	*files;		// all files of sv_demoDir, oldest first
+	int			numfiles;
+	int			maxfiles;
+	int			numdemos;
+	double		size;		// bytes of all files
+	double		demosize;	// bytes of the demos
+} demoindex_t;
+
+extern cvar_t	sv_demoIndex;
+
+demoindex_t	*SV_DemoIndex (void);
+demoentry_t	*SV_DemoIndex_Demo (int num);
+demoentry_t	*SV_DemoIndex_FindStem (const char *stem, int *count);
+void		SV_DemoIndex_Update (const char *filename);
+void		SV_DemoIndex_Meta (demoentry_t *e);
+void		SV_DemoIndex_Init (void);
+
 //
 // sv_demo_qtv.c
 //
@@ -989,6 +1048,10 @@ void SV_MVDCloseStreams(void);
 void SV_QTV_Init(void);
 
 void DemoWriteQTV (sizebuf_t *msg);
+void SV_MVDStream_Write (void *data, int len);
+void SV_MVDStream_WritePrivate (mvddest_t *d, void *data, int len);
+void SV_MVDStream_Flush (mvddest_t *d);
+void SV_MVDStream_Detach (mvddest_t *d);
 void QTVsv_FreeUserList(mvddest_t *d);
 void QTV_Streams_List (void);
 void QTV_Streams_UserList (void);
@@ -1018,6 +1081,25 @@ void Master_Heartbeat (void);
 void SV_SaveGame_f (void); 
 void SV_LoadGame_f (void); 
 
+// sv_profile.c
+typedef enum {
+	SVPROF_FRAME,			// the whole of SV_Frame
+	SVPROF_READ,			// SV_ReadPackets
+	SVPROF_PHYSICS,			// SV_Physics and bots
+	SVPROF_PROGS,			// game code, QVM or QuakeC, wherever it was called from
+	SVPROF_ENTITIES,		// SV_WriteEntitiesToClient, for clients and the demo
+	SVPROF_SEND,			// SV_SendClientMessages
+	SVPROF_DEMO,			// SV_SendDemoMessage
+	SVPROF_MAX
+} svprof_stage_t;
+
+void SV_ProfileInit (void);
+qbool SV_ProfileActive (void);
+void SV_ProfileStartFrame (void);
+void SV_ProfileEndFrame (void);
+void SV_ProfileEnter (svprof_stage_t stage);
+void SV_ProfileLeave (svprof_stage_t stage);
+
 //
 void SV_WriteDelta(client_t* client, entity_state_t *from, entity_state_t *to, sizebuf_t *msg, qbool force);
 qbool SV_SkipCommsBotMessage(client_t* client);
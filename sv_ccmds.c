@@ -84,6 +84,7 @@ void SV_Logfile (int sv_log, qbool newlog)
 {
 	int		sv_port = NET_UDPSVPort();
 	char	name[MAX_OSPATH];
+	FILE	*f;
 	int		i;
 
 	// newlog - stands for: we want open new log file
@@ -92,8 +93,7 @@ void SV_Logfile (int sv_log, qbool newlog)
 	{
 		// turn off logging
 
-		fclose (logs[sv_log].sv_logfile);
-		logs[sv_log].sv_logfile = NULL;
+		SV_LogSetFile (sv_log, NULL);
 
 		// in case of NON "newlog" we do some additional work and exit function
 		if (!newlog)
@@ -121,13 +121,14 @@ void SV_Logfile (int sv_log, qbool newlog)
 
 	Con_Printf ("Logging %s to %s\n", logs[sv_log].message_on, name);
 
-	if (!(logs[sv_log].sv_logfile = fopen (name, "a")))
+	if (!(f = fopen (name, "a")))
 	{
 		Con_Printf ("Failed.\n");
-		logs[sv_log].sv_logfile = NULL;
 		return;
 	}
 
+	SV_LogSetFile (sv_log, f);
+
 	switch (sv_log)
 	{
 	case TELNET_LOG:
@@ -1167,7 +1168,7 @@ void SV_Status_f (void)
 {
 	int i;
 	client_t *cl;
-	float cpu, avg, pak, demo1 = 0.0;
+	float cpu, avg, pak, demo1 = 0.0, touch = 0.0;
 	char *s;
 
 	cpu = (svs.stats.latched_active + svs.stats.latched_idle);
@@ -1175,6 +1176,7 @@ void SV_Status_f (void)
 	if (cpu)
 	{
 		demo1 = 100.0 * svs.stats.latched_demo  / cpu;
+		touch = 100.0 * svs.stats.latched_touch / cpu;
 		cpu  = 100.0 * svs.stats.latched_active / cpu;
 	}
 
@@ -1184,13 +1186,17 @@ void SV_Status_f (void)
 	Con_Printf ("net address                 : %s\n"
 				"cpu utilization (overall)   : %3i%%\n"
 				"cpu utilization (recording) : %3i%%\n"
+				"cpu utilization (triggers)  : %3i%%\n"
 				"avg response time           : %i ms\n"
-				"packets/frame               : %5.2f (%d)\n",
+				"packets/frame               : %5.2f (%d)\n"
+				"trigger touches/frame       : %5.2f\n",
 				NET_AdrToString (net_local_sv_ipadr),
 				(int)cpu,
 				(int)demo1,
+				(int)touch,
 				(int)avg,
-				pak, num_prstr);
+				pak, num_prstr,
+				(float)svs.stats.latched_touches / STATFRAMES);
 
 	switch (sv_redirected)
 	{
@@ -45,6 +45,7 @@ cvar_t  sv_demoExtraNames   = {"sv_demoExtraNames", "0"};
 cvar_t	sv_demoPrefix		= {"sv_demoPrefix",		""};
 cvar_t	sv_demoSuffix		= {"sv_demoSuffix",		""};
 cvar_t	sv_demotxt			= {"sv_demotxt",		"1"};
+cvar_t	sv_demoCompress		= {"sv_demoCompress",	"0"};
 cvar_t	sv_onrecordfinish	= {"sv_onRecordFinish", ""};
 
 cvar_t	sv_ondemoremove		= {"sv_onDemoRemove",	""};
@@ -138,6 +139,8 @@ void DestClose (mvddest_t *d, qbool destroyfiles)
 {
 	char path[MAX_OSPATH];
 
+	if (d->desttype == DEST_STREAM)
+		SV_MVDStream_Detach(d);
 	if (d->cache)
 		Q_free(d->cache);
 	if (d->file)
@@ -154,6 +157,12 @@ void DestClose (mvddest_t *d, qbool destroyfiles)
 		strlcpy(path + strlen(path) - 3, "txt", MAX_OSPATH - strlen(path) + 3);
 		Sys_remove(path);
 
+		if (!strcmp(d->path, sv_demoDir.string))
+		{
+			SV_DemoIndex_Update(d->name);
+			SV_DemoIndex_Update(COM_SkipPath(path));
+		}
+
 		// force cache rebuild.
 		FS_FlushFSHash();
 	}
@@ -218,32 +227,8 @@ void DestFlush (qbool compleate)
 				d->error = true;
 			}
 
-			if (d->cacheused && !d->error)
-			{
-				len = send(d->socket, d->cache, d->cacheused, 0);
-
-				if (len == 0) //client died
-				{
-//					d->error = true;
-					// man says: The calls return the number of characters sent, or -1 if an error occurred.   
-					// so 0 is legal or what?
-				}
-				else if (len > 0) //we put some data through
-				{ //move up the buffer
-					d->cacheused -= len;
-					memmove(d->cache, d->cache+len, d->cacheused);
-
-					d->io_time = Sys_DoubleTime(); // update IO activity
-				}
-				else
-				{ //error of some kind. would block or something
-					if (qerrno != EWOULDBLOCK && qerrno != EAGAIN)
-					{
-						Sys_Printf("DestFlush: error on stream\n");
-						d->error = true;
-					}
-				}
-			}
+			if (!d->error)
+				SV_MVDStream_Flush(d);
 			break;
 
 		case DEST_NONE:
@@ -330,8 +315,13 @@ int DemoWriteDest (void *data, int len, mvddest_t *d)
 			}
 
 			break;
-		case DEST_BUFFEREDFILE:	//these write to a cache, which is flushed later
 		case DEST_STREAM:
+			SV_MVDStream_WritePrivate(d, data, len);
+			if (d->error)
+				return 0;
+
+			break;
+		case DEST_BUFFEREDFILE:	//these write to a cache, which is flushed later
 			if (d->cacheused + len > d->maxcachesize)
 			{
 				Sys_Printf("DemoWriteDest: cache overflow %d > %d\n", d->cacheused + len, d->maxcachesize);
@@ -357,8 +347,15 @@ static void DemoWrite (void *data, int len) //broadcast to all proxies/mvds
 		if (singledest && singledest != d)
 			continue;
 
+		// streams share one copy of the data, unless it is meant for a single stream only
+		if (d->desttype == DEST_STREAM && !singledest)
+			continue;
+
 		DemoWriteDest(data, len, d);
 	}
+
+	if (!singledest)
+		SV_MVDStream_Write(data, len);
 }
 
 /*
@@ -835,6 +832,9 @@ static mvddest_t *SV_InitRecordFile (char *name)
 	else
 		Sys_remove(path);
 
+	SV_DemoIndex_Update(dst->name);
+	SV_DemoIndex_Update(COM_SkipPath(path));
+
 	// force cache rebuild.
 	FS_FlushFSHash();
 
@@ -1656,9 +1656,7 @@ void SV_MVDEasyRecord_f (void)
 	char	name2[MAX_OSPATH*7]; // scream
 	char	name4[MAX_OSPATH*7]; // scream
 
-	int		i;
-	dir_t	dir;
-	char	*name3;
+	int		i, count;
 
 	c = Cmd_Argc();
 	if (c > 2)
@@ -1715,20 +1713,13 @@ void SV_MVDEasyRecord_f (void)
 	strlcpy(name2, name, sizeof(name2));
 	Sys_mkdir(va("%s/%s", fs_gamedir, sv_demoDir.string));
 
-	// FIXME: very SLOW
-	if (!(name3 = quote(name2)))
+	if (!name2[0])
 		return;
-	dir = Sys_listdir(va("%s/%s", fs_gamedir, sv_demoDir.string),
-					  va("^%s%s", name3, sv_demoRegexp.string), SORT_NO);
-	Q_free(name3);
-	for (i = 1; dir.numfiles; )
+	SV_DemoIndex_FindStem(name2, &count);
+	for (i = 1; count; )
 	{
 		snprintf(name2, sizeof(name2), "%s_%02i", name, i++);
-		if (!(name3 = quote(name2)))
-			return;
-		dir = Sys_listdir(va("%s/%s", fs_gamedir, sv_demoDir.string),
-						  va("^%s%s", name3, sv_demoRegexp.string), SORT_NO);
-		Q_free(name3);
+		SV_DemoIndex_FindStem(name2, &count);
 	}
 
 	strlcpy(name4, name2, sizeof(name4));
@@ -1746,6 +1737,8 @@ static void MVD_Init (void)
 	int p, size = DEMO_CACHE_MIN_SIZE;
 
 	memset(&demo, 0, sizeof(demo)); // clear whole demo struct at least once
+
+	SV_DemoIndex_Init();
 	
 	Cvar_Register (&sv_demofps);
 	Cvar_Register (&sv_demoIdlefps);
@@ -1762,6 +1755,7 @@ static void MVD_Init (void)
 	Cvar_Register (&sv_onrecordfinish);
 	Cvar_Register (&sv_ondemoremove);
 	Cvar_Register (&sv_demotxt);
+	Cvar_Register (&sv_demoCompress);
 	Cvar_Register (&sv_demoExtraNames);
 	Cvar_Register (&sv_demoRegexp);
 	Cvar_Register (&sv_silentrecord);
@@ -0,0 +1,433 @@
+/*
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// sv_demo_index.c -- in memory index of the demo directory
+
+// The demo directory is listed once and kept in memory, sorted by date. The server updates the
+// index itself when it records or removes demos, anything else changing the directory (compressed
+// demos, files copied in by hand) is noticed through the directory modification time and makes
+// the next query list the directory again.
+
+#include "qwsvdef.h"
+#ifndef SERVERONLY
+#include "pcre.h"
+#endif
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+cvar_t	sv_demoIndex		= {"sv_demoIndex",		"1"};
+
+static demoindex_t	demoindex;
+static qbool		demoindex_valid;
+static char			demoindex_path[MAX_OSPATH];	// directory the index was built for
+static char			*demoindex_regexp;			// sv_demoRegexp the index was built with
+static int			demoindex_dirtime;			// directory mtime the index is in sync with, -1 if unknown
+
+static pcre			*demo_regexp;
+static char			*demo_regexp_string;
+
+/*
+====================
+SV_DemoRegexp
+
+sv_demoRegexp, compiled once for each value it takes
+====================
+*/
+pcre *SV_DemoRegexp (void)
+{
+	const char *errbuf;
+	int r;
+
+	if (demo_regexp_string && !strcmp(demo_regexp_string, sv_demoRegexp.string))
+		return demo_regexp;
+
+	if (demo_regexp)
+		Q_free(demo_regexp);
+	if (demo_regexp_string)
+		Q_free(demo_regexp_string);
+
+	demo_regexp_string = Q_strdup(sv_demoRegexp.string);
+	if (!(demo_regexp = pcre_compile(sv_demoRegexp.string, PCRE_CASELESS, &errbuf, &r, NULL)))
+		Con_Printf("SV_DemoRegexp: pcre_compile(%s) error: %s at offset %d\n", sv_demoRegexp.string, errbuf, r);
+
+	return demo_regexp;
+}
+
+static qbool SV_DemoIndex_IsDemo (const char *name)
+{
+	pcre *preg = SV_DemoRegexp();
+
+	return preg && pcre_exec(preg, NULL, name, strlen(name), 0, 0, NULL, 0) >= 0;
+}
+
+// modification time of the demo directory, -1 if there is none
+static int SV_DemoIndex_DirTime (void)
+{
+	struct stat st;
+
+	if (stat(demoindex_path, &st))
+		return -1;
+
+	return (int) st.st_mtime;
+}
+
+static int SV_DemoIndex_Compare (const void *a, const void *b)
+{
+	const demoentry_t *e1 = (const demoentry_t *) a;
+	const demoentry_t *e2 = (const demoentry_t *) b;
+
+	if (e1->time != e2->time)
+		return e1->time < e2->time ? -1 : 1;
+
+	return strcmp(e1->name, e2->name);
+}
+
+static void SV_DemoIndex_Grow (int count)
+{
+	if (count <= demoindex.maxfiles)
+		return;
+
+	demoindex.maxfiles = max(count, demoindex.maxfiles * 2);
+	demoindex.files = (demoentry_t *) Q_realloc(demoindex.files, demoindex.maxfiles * sizeof(demoentry_t));
+}
+
+// adds a file found in the directory while the index is rebuilt
+static void SV_DemoIndex_Add (const char *filename)
+{
+	char path[MAX_OSPATH];
+	struct stat st;
+	demoentry_t *e;
+	int len;
+
+	// names too long for an entry would be cut and point at another file
+	if (!strcmp(filename, ".") || !strcmp(filename, "..") || strlen(filename) >= sizeof(e->name))
+		return;
+
+	len = snprintf(path, sizeof(path), "%s/%s", demoindex_path, filename);
+	if (len < 0 || len >= sizeof(path) || stat(path, &st) || (st.st_mode & S_IFDIR))
+		return;
+
+	SV_DemoIndex_Grow(demoindex.numfiles + 1);
+	e = &demoindex.files[demoindex.numfiles++];
+	memset(e, 0, sizeof(*e));
+	strlcpy(e->name, filename, sizeof(e->name));
+	e->size = (int) st.st_size;
+	e->time = (int) st.st_mtime;
+	e->isdemo = SV_DemoIndex_IsDemo(e->name);
+
+	demoindex.size += e->size;
+	if (e->isdemo)
+	{
+		demoindex.numdemos++;
+		demoindex.demosize += e->size;
+	}
+}
+
+static void SV_DemoIndex_Rebuild (void)
+{
+#ifdef _WIN32
+	WIN32_FIND_DATA fd;
+	HANDLE h;
+#else
+	struct dirent *de;
+	DIR *d;
+#endif
+
+	if (demoindex_regexp)
+		Q_free(demoindex_regexp);
+	demoindex_regexp = Q_strdup(sv_demoRegexp.string);
+	strlcpy(demoindex_path, va("%s/%s", fs_gamedir, sv_demoDir.string), sizeof(demoindex_path));
+	demoindex_dirtime = SV_DemoIndex_DirTime();
+	if (demoindex_dirtime >= time(NULL) - 1)
+		demoindex_dirtime = -1; // may still change within the same second, list it again next time
+
+	demoindex.numfiles = demoindex.numdemos = 0;
+	demoindex.size = demoindex.demosize = 0;
+
+	// not Sys_listdir, its list is capped at MAX_DIRFILES and big demo directories hold far more
+#ifdef _WIN32
+	if ((h = FindFirstFile(va("%s/*", demoindex_path), &fd)) != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			SV_DemoIndex_Add(fd.cFileName);
+		} while (FindNextFile(h, &fd));
+		FindClose(h);
+	}
+#else
+	if ((d = opendir(demoindex_path)))
+	{
+		while ((de = readdir(d)))
+			SV_DemoIndex_Add(de->d_name);
+		closedir(d);
+	}
+#endif
+
+	qsort(demoindex.files, demoindex.numfiles, sizeof(demoentry_t), SV_DemoIndex_Compare);
+	demoindex_valid = true;
+}
+
+/*
+====================
+SV_DemoIndex
+
+the index of sv_demoDir, listed again if it is out of date
+====================
+*/
+demoindex_t *SV_DemoIndex (void)
+{
+	if (!(int)sv_demoIndex.value || !demoindex_valid
+		|| strcmp(demoindex_path, va("%s/%s", fs_gamedir, sv_demoDir.string))
+		|| strcmp(demoindex_regexp, sv_demoRegexp.string)
+		|| demoindex_dirtime == -1 || SV_DemoIndex_DirTime() != demoindex_dirtime)
+	{
+		SV_DemoIndex_Rebuild();
+	}
+
+	return &demoindex;
+}
+
+static void SV_DemoIndex_Unlink (int i)
+{
+	demoentry_t *e = &demoindex.files[i];
+
+	demoindex.size -= e->size;
+	if (e->isdemo)
+	{
+		demoindex.numdemos--;
+		demoindex.demosize -= e->size;
+	}
+
+	memmove(e, e + 1, (demoindex.numfiles - i - 1) * sizeof(demoentry_t));
+	demoindex.numfiles--;
+}
+
+static void SV_DemoIndex_Link (demoentry_t *e)
+{
+	int lo = 0, hi = demoindex.numfiles, mid;
+
+	// keep the date order
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if (SV_DemoIndex_Compare(&demoindex.files[mid], e) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	SV_DemoIndex_Grow(demoindex.numfiles + 1);
+	memmove(&demoindex.files[lo + 1], &demoindex.files[lo], (demoindex.numfiles - lo) * sizeof(demoentry_t));
+	demoindex.files[lo] = *e;
+	demoindex.numfiles++;
+
+	demoindex.size += e->size;
+	if (e->isdemo)
+	{
+		demoindex.numdemos++;
+		demoindex.demosize += e->size;
+	}
+}
+
+/*
+====================
+SV_DemoIndex_Update
+
+the file name in sv_demoDir was created, changed or removed by the server
+====================
+*/
+void SV_DemoIndex_Update (const char *filename)
+{
+	char name[MAX_DEMO_NAME], path[MAX_OSPATH], *txt;
+	struct stat st;
+	demoentry_t e;
+	int i, dirtime, len;
+
+	if (!demoindex_valid || !filename || !*filename)
+		return;
+
+	// may point into the index, a name too long for an entry isn't indexed
+	if (strlcpy(name, filename, sizeof(name)) >= sizeof(name))
+		return;
+
+	// only files right in sv_demoDir are indexed
+	if (strchr(name, '/'))
+		return;
+
+	// the directory changed before the server touched it, next query lists it again anyway
+	dirtime = SV_DemoIndex_DirTime();
+	if (strcmp(demoindex_path, va("%s/%s", fs_gamedir, sv_demoDir.string))
+		|| demoindex_dirtime == -1 || (dirtime != demoindex_dirtime && dirtime < time(NULL) - 1))
+	{
+		demoindex_valid = false;
+		return;
+	}
+
+	for (i = 0; i < demoindex.numfiles; i++)
+	{
+		if (!strcmp(demoindex.files[i].name, name))
+		{
+			SV_DemoIndex_Unlink(i);
+			break;
+		}
+	}
+
+	len = snprintf(path, sizeof(path), "%s/%s", demoindex_path, name);
+	if (len >= 0 && len < sizeof(path) && !stat(path, &st) && !(st.st_mode & S_IFDIR))
+	{
+		memset(&e, 0, sizeof(e));
+		strlcpy(e.name, name, sizeof(e.name));
+		e.size = (int) st.st_size;
+		e.time = (int) st.st_mtime;
+		e.isdemo = SV_DemoIndex_IsDemo(e.name);
+		SV_DemoIndex_Link(&e);
+	}
+
+	// a changed sidecar has to be read again
+	for (i = 0; i < demoindex.numfiles; i++)
+	{
+		if (demoindex.files[i].meta && (txt = SV_MVDName2Txt(demoindex.files[i].name)) && !strcmp(txt, name))
+			demoindex.files[i].meta = false;
+	}
+
+	demoindex_dirtime = SV_DemoIndex_DirTime();
+}
+
+/*
+====================
+SV_DemoIndex_Demo
+
+num'th demo by date, counting from 1
+====================
+*/
+demoentry_t *SV_DemoIndex_Demo (int num)
+{
+	demoindex_t *index = SV_DemoIndex();
+	int i;
+
+	if (num < 1 || num > index->numdemos)
+		return NULL;
+
+	for (i = 0; i < index->numfiles; i++)
+		if (index->files[i].isdemo && !--num)
+			return &index->files[i];
+
+	return NULL;
+}
+
+/*
+====================
+SV_DemoIndex_FindStem
+
+newest demo named stem followed by something matching sv_demoRegexp, count gets the number of such demos
+====================
+*/
+demoentry_t *SV_DemoIndex_FindStem (const char *stem, int *count)
+{
+	demoindex_t *index = SV_DemoIndex();
+	demoentry_t *found = NULL;
+	pcre *preg = SV_DemoRegexp();
+	int i, len = strlen(stem);
+	const char *rest;
+
+	*count = 0;
+	if (!preg)
+		return NULL;
+
+	for (i = 0; i < index->numfiles; i++)
+	{
+		if (!index->files[i].isdemo || strncasecmp(index->files[i].name, stem, len))
+			continue;
+
+		rest = index->files[i].name + len;
+		if (pcre_exec(preg, NULL, rest, strlen(rest), 0, PCRE_ANCHORED, NULL, 0) < 0)
+			continue;
+
+		found = &index->files[i]; // the index is oldest first, the last one is the newest
+		(*count)++;
+	}
+
+	return found;
+}
+
+/*
+====================
+SV_DemoIndex_Meta
+
+reads map and players from the .txt of a demo, once
+====================
+*/
+void SV_DemoIndex_Meta (demoentry_t *e)
+{
+	char buf[2048], *line, *next, *s, *txt;
+	char path[MAX_OSPATH];
+	FILE *f;
+	int len;
+
+	if (e->meta)
+		return;
+
+	e->meta = true;
+	e->map[0] = e->players[0] = 0;
+
+	if (!(txt = SV_MVDName2Txt(e->name)))
+		return;
+
+	len = snprintf(path, sizeof(path), "%s/%s", demoindex_path, txt);
+	if (len < 0 || len >= sizeof(path) || !(f = fopen(path, "rt")))
+		return;
+
+	len = fread(buf, 1, sizeof(buf) - 1, f);
+	buf[max(len, 0)] = 0;
+	fclose(f);
+
+	for (line = buf; line && *line; line = next)
+	{
+		if ((next = strchr(line, '\n')))
+			*next++ = 0;
+
+		if (!strncmp(line, "map ", 4))
+		{
+			strlcpy(e->map, line + 4, sizeof(e->map));
+			continue;
+		}
+
+		// "player1: name (frags)" in duels, "  name (frags)" otherwise
+		if (!strncmp(line, "player", 6) && (s = strstr(line, ": ")))
+			line = s + 2;
+		else if (!strncmp(line, "  ", 2))
+			line += 2;
+		else
+			continue;
+
+		if ((s = strrchr(line, '(')) && s > line && s[-1] == ' ')
+			s[-1] = 0;
+
+		if (e->players[0])
+			strlcat(e->players, ", ", sizeof(e->players));
+		strlcat(e->players, line, sizeof(e->players));
+	}
+}
+
+void SV_DemoIndex_Init (void)
+{
+	Cvar_Register (&sv_demoIndex);
+}
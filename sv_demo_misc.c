@@ -24,6 +24,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "pcre.h"
 #endif
 
+pcre *SV_DemoRegexp (void);
+
 static char chartbl[256];
 
 /*
@@ -142,36 +144,39 @@ Deletes sv_demoClearOld files from demo dir if out of space
 */
 qbool SV_DirSizeCheck (void)
 {
-	dir_t	dir;
-	file_t	*list;
-	int	n;
+	demoindex_t	*index;
+	char	*names;
+	int	i, n;
 
 	if ((int)sv_demoMaxDirSize.value)
 	{
-		dir = Sys_listdir(va("%s/%s", fs_gamedir, sv_demoDir.string), ".*", SORT_NO/*BY_DATE*/);
-		if ((float)dir.size > sv_demoMaxDirSize.value * 1024)
+		index = SV_DemoIndex();
+		if ((float)index->size > sv_demoMaxDirSize.value * 1024)
 		{
 			if ((int)sv_demoClearOld.value <= 0)
 			{
 				Con_Printf("Insufficient directory space, increase sv_demoMaxDirSize\n");
 				return false;
 			}
-			list = dir.files;
 			n = (int) sv_demoClearOld.value;
 			Con_Printf("Clearing %d old demos\n", n);
 			// HACK!!! HACK!!! HACK!!!
 			if ((int)sv_demotxt.value) // if our server record demos and txts, then to remove
 				n <<= 1;  // 50 demos, we have to remove 50 demos and 50 txts = 50*2 = 100 files
 
-			qsort((void *)list, dir.numfiles, sizeof(file_t), Sys_compare_by_date);
-			for (; list->name[0] && n > 0; list++)
+			// the index is sorted by date, take the names first as removing files updates it
+			n = min(n, index->numfiles);
+			names = (char *) Q_malloc(max(n, 1) * MAX_DEMO_NAME);
+			for (i = 0; i < n; i++)
+				strlcpy(names + i * MAX_DEMO_NAME, index->files[i].name, MAX_DEMO_NAME);
+
+			for (i = 0; i < n; i++)
 			{
-				if (list->isdir)
-					continue;
-				Sys_remove(va("%s/%s/%s", fs_gamedir, sv_demoDir.string, list->name));
-				//Con_Printf("Remove %d - %s/%s/%s\n", n, fs_gamedir, sv_demoDir.string, list->name);
-				n--;
+				Sys_remove(va("%s/%s/%s", fs_gamedir, sv_demoDir.string, names + i * MAX_DEMO_NAME));
+				//Con_Printf("Remove %d - %s/%s/%s\n", n, fs_gamedir, sv_demoDir.string, names + i * MAX_DEMO_NAME);
+				SV_DemoIndex_Update(names + i * MAX_DEMO_NAME);
 			}
+			Q_free(names);
 
 			// force cache rebuild.
 			FS_FlushFSHash();
@@ -180,9 +185,158 @@ qbool SV_DirSizeCheck (void)
 	return true;
 }
 
+// Runs sv_onrecordfinish for a demo that is complete on disk.
+static void SV_OnRecordFinish (const char *dest_name, const char *dest_path)
+{
+	extern redirect_t sv_redirected;
+	redirect_t old = sv_redirected;
+	char path[MAX_OSPATH];
+	char *p;
+
+	if ((p = strchr(sv_onrecordfinish.string, ' ')) != NULL)
+		*p = 0; // strip parameters
+
+	strlcpy(path, dest_name, sizeof(path));
+#ifdef SERVERONLY
+	COM_StripExtension(path);
+#else
+	COM_StripExtension(path, path, sizeof(path));
+#endif
+
+	sv_redirected = RD_NONE; // onrecord script is called always from the console
+	Cmd_TokenizeString(va("script %s \"%s\" \"%s\" %s", sv_onrecordfinish.string, dest_path, path, p != NULL ? p+1 : ""));
+
+	if (p)
+		*p = ' '; // restore params
+
+	SV_Script_f();
+
+	sv_redirected = old;
+}
+
+#ifdef WITH_ZLIB
+// A demo being packed on its own thread. The thread only sets done, the main
+// thread links the job, picks it up in SV_DemoCompress_Poll and frees it.
+typedef struct demo_compressjob_s {
+	char	path[MAX_OSPATH];	// the .mvd
+	char	dest_name[MAX_OSPATH];
+	char	dest_path[MAX_OSPATH];
+	qbool	done;
+	struct demo_compressjob_s *next;
+} demo_compressjob_t;
+
+static demo_compressjob_t	*compressjobs;
+static sem_t				compressjobs_lock;
+static qbool				compressjobs_lock_init;
+
+//
+// Packs a finished demo into a seekable .gz next to it, runs on its own thread
+// so the server doesn't hitch, the .mvd is only removed once the .gz is complete.
+//
+static int SV_DemoCompressThread(void *arg)
+{
+	demo_compressjob_t *job = (demo_compressjob_t *) arg;
+	char tmp_path[MAX_OSPATH + 8], gz_path[MAX_OSPATH + 8];
+
+	snprintf(tmp_path, sizeof(tmp_path), "%s.gz.tmp", job->path);
+	snprintf(gz_path, sizeof(gz_path), "%s.gz", job->path);
+
+	if (FS_GZipPackBlocked(job->path, tmp_path, true) && !rename(tmp_path, gz_path))
+		remove(job->path);
+	else
+		remove(tmp_path);
+
+	Sys_SemWait(&compressjobs_lock);
+	job->done = true;
+	Sys_SemPost(&compressjobs_lock);
+	return 0;
+}
+
+static qbool SV_DemoCompress_Start (const char *dest_name, const char *dest_path)
+{
+	demo_compressjob_t *job;
+
+	if (!compressjobs_lock_init)
+	{
+		Sys_SemInit(&compressjobs_lock, 1, 1);
+		compressjobs_lock_init = true;
+	}
+
+	job = (demo_compressjob_t *) Q_malloc(sizeof(*job));
+	snprintf(job->path, sizeof(job->path), "%s/%s/%s", fs_gamedir, dest_path, dest_name);
+	strlcpy(job->dest_name, dest_name, sizeof(job->dest_name));
+	strlcpy(job->dest_path, dest_path, sizeof(job->dest_path));
+
+	Sys_SemWait(&compressjobs_lock);
+	job->next = compressjobs;
+	compressjobs = job;
+	Sys_SemPost(&compressjobs_lock);
+
+	if (Sys_CreateDetachedThread(SV_DemoCompressThread, job) < 0)
+	{
+		Sys_SemWait(&compressjobs_lock);
+		compressjobs = job->next;
+		Sys_SemPost(&compressjobs_lock);
+
+		Con_Printf("Failed to start compressing %s\n", dest_name);
+		Q_free(job);
+		return false;
+	}
+
+	return true;
+}
+#endif // WITH_ZLIB
+
+//
+// Finishes demos whose packing is done: sv_onrecordfinish only runs now, so it
+// never races the thread that removes the .mvd.
+//
+void SV_DemoCompress_Poll (void)
+{
+#ifdef WITH_ZLIB
+	demo_compressjob_t **link, *job;
+	qbool finished = false;
+
+	if (!compressjobs_lock_init)
+		return;
+
+	Sys_SemWait(&compressjobs_lock);
+	for (link = &compressjobs; (job = *link); )
+	{
+		if (!job->done)
+		{
+			link = &job->next;
+			continue;
+		}
+
+		*link = job->next;
+		Sys_SemPost(&compressjobs_lock);
+
+		if (!strcmp(job->dest_path, sv_demoDir.string))
+		{
+			SV_DemoIndex_Update(job->dest_name);
+			SV_DemoIndex_Update(va("%s.gz", job->dest_name));
+		}
+
+		if (sv_onrecordfinish.string[0])
+			SV_OnRecordFinish(job->dest_name, job->dest_path);
+
+		Q_free(job);
+		finished = true;
+
+		Sys_SemWait(&compressjobs_lock);
+	}
+	Sys_SemPost(&compressjobs_lock);
+
+	if (finished)
+		FS_FlushFSHash();
+#endif // WITH_ZLIB
+}
+
 void Run_sv_demotxt_and_sv_onrecordfinish (const char *dest_name, const char *dest_path, qbool destroyfiles)
 {
 	char path[MAX_OSPATH];
+	qbool packing = false;
 
 	snprintf(path, MAX_OSPATH, "%s/%s/%s", fs_gamedir, dest_path, dest_name);
 	strlcpy(path + strlen(path) - 3, "txt", MAX_OSPATH - strlen(path) + 3);
@@ -206,32 +360,20 @@ void Run_sv_demotxt_and_sv_onrecordfinish (const char *dest_name, const char *de
 		}
 	}
 
-	if (sv_onrecordfinish.string[0] && !destroyfiles) // dont gzip deleted demos
+	if (!strcmp(dest_path, sv_demoDir.string))
 	{
-		extern redirect_t sv_redirected;
-		redirect_t old = sv_redirected;
-		char *p;
-	
-		if ((p = strchr(sv_onrecordfinish.string, ' ')) != NULL)
-			*p = 0; // strip parameters
-	
-		strlcpy(path, dest_name, sizeof(path));
-#ifdef SERVERONLY
-		COM_StripExtension(path);
-#else
-		COM_StripExtension(path, path, sizeof(path));
-#endif
-
-		sv_redirected = RD_NONE; // onrecord script is called always from the console
-		Cmd_TokenizeString(va("script %s \"%s\" \"%s\" %s", sv_onrecordfinish.string, dest_path, path, p != NULL ? p+1 : ""));
+		SV_DemoIndex_Update(dest_name);
+		SV_DemoIndex_Update(SV_MVDName2Txt(dest_name));
+	}
 
-		if (p)
-			*p = ' '; // restore params
+#ifdef WITH_ZLIB
+	// sv_onrecordfinish runs from SV_DemoCompress_Poll once the .gz is complete
+	if ((int)sv_demoCompress.value && !destroyfiles)
+		packing = SV_DemoCompress_Start(dest_name, dest_path);
+#endif // WITH_ZLIB
 
-		SV_Script_f();
-	
-		sv_redirected = old;
-	}
+	if (sv_onrecordfinish.string[0] && !destroyfiles && !packing) // dont gzip deleted demos
+		SV_OnRecordFinish(dest_name, dest_path);
 
 	// force cache rebuild.
 	FS_FlushFSHash();
@@ -332,88 +474,126 @@ char *SV_PrintTeams (void)
 
 void SV_DemoList (qbool use_regex)
 {
-	mvddest_t *d;
-	dir_t	dir;
-	file_t	*list;
+	mvddest_t	*d;
+	demoindex_t	*index;
+	demoentry_t	*e;
 	float	free_space;
-	int		i, j, n;
-	int		files[MAX_DIRFILES + 1];
+	double	size;
+	int		i, j, n, num, argc;
+	int		*files, *nums;
+	char	*arg;
 
 	int	r;
-	pcre	*preg;
+	pcre	**preg;
 	const char	*errbuf;
 
-	memset(files, 0, sizeof(files));
+	argc = Cmd_Argc();
+	preg = (pcre **) Q_malloc(argc * sizeof(pcre *));
+
+	// compile the patterns once, not for each file
+	for (j = 1; use_regex && j < argc; j++)
+	{
+		if (!strncmp(Cmd_Argv(j), "map:", 4) || !strncmp(Cmd_Argv(j), "player:", 7))
+			continue;
+
+		if (!(preg[j] = pcre_compile(Q_normalizetext(Cmd_Argv(j)), PCRE_CASELESS, &errbuf, &r, NULL)))
+		{
+			Con_Printf("SV_DemoList: pcre_compile(%s) error: %s at offset %d\n",
+			           Cmd_Argv(j), errbuf, r);
+			for (j = 1; j < argc; j++)
+				if (preg[j])
+					Q_free(preg[j]);
+			Q_free(preg);
+			return;
+		}
+	}
 
 	Con_Printf("Listing content of %s/%s/%s\n", fs_gamedir, sv_demoDir.string, sv_demoRegexp.string);
-	dir = Sys_listdir(va("%s/%s", fs_gamedir, sv_demoDir.string), sv_demoRegexp.string, SORT_BY_DATE);
-	list = dir.files;
-	if (!list->name[0])
+	index = SV_DemoIndex();
+	if (!index->numdemos)
 	{
 		Con_Printf("no demos\n");
 	}
 
-	for (i = 1, n = 0; list->name[0]; list++, i++)
+	files = (int *) Q_malloc((index->numdemos + 1) * sizeof(int));
+	nums = (int *) Q_malloc((index->numdemos + 1) * sizeof(int));
+
+	for (i = 0, num = 0, n = 0; i < index->numfiles; i++)
 	{
-		for (j = 1; j < Cmd_Argc(); j++)
+		e = &index->files[i];
+		if (!e->isdemo)
+			continue;
+
+		num++;
+		for (j = 1; j < argc; j++)
 		{
-			if (use_regex)
+			arg = Cmd_Argv(j);
+
+			// map:<text> and player:<text> look at the .txt of the demo
+			if (!strncmp(arg, "map:", 4))
 			{
-				if (!(preg = pcre_compile(Q_normalizetext(Cmd_Argv(j)),	PCRE_CASELESS, &errbuf, &r, NULL)))
-				{
-					Con_Printf("Sys_listdir: pcre_compile(%s) error: %s at offset %d\n",
-					           Cmd_Argv(j), errbuf, r);
-					Q_free(preg);
+				SV_DemoIndex_Meta(e);
+				if (!strstri(e->map, arg + 4))
 					break;
-				}
-				switch (r = pcre_exec(preg, NULL, list->name,
-				                      strlen(list->name), 0, 0, NULL, 0))
+			}
+			else if (!strncmp(arg, "player:", 7))
+			{
+				SV_DemoIndex_Meta(e);
+				if (!strstri(e->players, arg + 7))
+					break;
+			}
+			else if (use_regex)
+			{
+				r = pcre_exec(preg[j], NULL, e->name, strlen(e->name), 0, 0, NULL, 0);
+				if (r == PCRE_ERROR_NOMATCH)
+					break;
+				if (r < 0)
 				{
-				case 0:
-					Q_free(preg);
-					continue;
-				case PCRE_ERROR_NOMATCH:
+					Con_Printf("SV_DemoList: pcre_exec(%s, %s) error code: %d\n",
+					           arg, e->name, r);
 					break;
-				default:
-					Con_Printf("Sys_listdir: pcre_exec(%s, %s) error code: %d\n",
-					           Cmd_Argv(j), list->name, r);
 				}
-				Q_free(preg);
-				break;
 			}
-			else
-				if (strstr(list->name, Cmd_Argv(j)) == NULL)
-					break;
+			else if (strstr(e->name, arg) == NULL)
+				break;
 		}
 
-		if (Cmd_Argc() == j)
+		if (argc == j)
 		{
+			nums[n] = num;
 			files[n++] = i;
 		}
 	}
 
-	list = dir.files;
-	for (j = (GameStarted() && n > 100) ? n - 100 : 0; files[j]; j++)
+	for (j = (GameStarted() && n > 100) ? n - 100 : 0; j < n; j++)
 	{
-		i = files[j];
+		e = &index->files[files[j]];
 
-		if ((d = DestByName(list[i - 1].name)))
-			Con_Printf("*%4d: %s (%dk)\n", i, list[i - 1].name, d->totalsize / 1024);
+		if ((d = DestByName(e->name)))
+			Con_Printf("*%4d: %s (%dk)\n", nums[j], e->name, d->totalsize / 1024);
 		else
-			Con_Printf("%4d: %s (%dk)\n", i, list[i - 1].name, list[i - 1].size / 1024);
+			Con_Printf("%4d: %s (%dk)\n", nums[j], e->name, e->size / 1024);
 	}
 
+	for (j = 1; j < argc; j++)
+		if (preg[j])
+			Q_free(preg[j]);
+	Q_free(preg);
+	Q_free(files);
+	Q_free(nums);
+
+	size = index->demosize;
 	for (d = demo.dest; d; d = d->nextdest)
 	{
 		if (d->desttype == DEST_STREAM)
 			continue; // streams are not saved on to HDD, so inogre it...
-		dir.size += d->totalsize;
+		size += d->totalsize;
 	}
 
-	Con_Printf("\ndirectory size: %.1fMB\n", (float)dir.size / (1024 * 1024));
+	Con_Printf("\ndirectory size: %.1fMB\n", (float)size / (1024 * 1024));
 	if ((int)sv_demoMaxDirSize.value)
 	{
-		free_space = (sv_demoMaxDirSize.value * 1024 - dir.size) / (1024 * 1024);
+		free_space = (sv_demoMaxDirSize.value * 1024 - size) / (1024 * 1024);
 		if (free_space < 0)
 			free_space = 0;
 		Con_Printf("space available: %.1fMB\n", free_space);
@@ -432,8 +612,9 @@ void SV_DemoListRegex_f (void)
 
 char *SV_MVDNum (int num)
 {
-	file_t	*list;
-	dir_t	dir;
+	demoentry_t	*e;
+	char	stem[MAX_DEMO_NAME];
+	int		c;
 
 	if (!num)
 		return NULL;
@@ -442,56 +623,42 @@ char *SV_MVDNum (int num)
 	if (num & 0xFF000000)
 	{
 		char *name = demo.lastdemosname[(demo.lastdemospos - (num >> 24) + 1) & 0xF];
-		char *name2;
-		int c;
 
-		if (!(name2 = quote(name)))
+		if (!name || !*name)
 			return NULL;
-		if ((c = strlen(name2)) > 5)
-			name2[c - 5] = '\0'; // crop quoted extension '\.mvd'
 
-		dir = Sys_listdir(va("%s/%s", fs_gamedir, sv_demoDir.string),
-						  va("^%s%s", name2, sv_demoRegexp.string), SORT_NO);
-		list = dir.files;
-		if (dir.numfiles > 1)
+		strlcpy(stem, name, sizeof(stem));
+		if ((c = strlen(stem)) > 4)
+			stem[c - 4] = '\0'; // crop extension '.mvd'
+
+		e = SV_DemoIndex_FindStem(stem, &c);
+		if (c > 1)
 		{
 			Con_Printf("SV_MVDNum: where are %d demos with name: %s%s\n",
-						dir.numfiles, name2, sv_demoRegexp.string);
+						c, stem, sv_demoRegexp.string);
 		}
-		if (!dir.numfiles)
+		if (!e)
 		{
 			Con_Printf("SV_MVDNum: where are no demos with name: %s%s\n",
-						name2, sv_demoRegexp.string);
+						stem, sv_demoRegexp.string);
 			return NULL;
 		}
-		Q_free(name2);
-		//Con_Printf("%s", dir.files[0].name);
-		return dir.files[0].name;
+		return e->name;
 	}
 
-	dir = Sys_listdir(va("%s/%s", fs_gamedir, sv_demoDir.string), sv_demoRegexp.string, SORT_BY_DATE);
-	list = dir.files;
-
 	if (num & 0x00800000)
 	{
 		num |= 0xFF000000;
-		num += dir.numfiles;
+		num += SV_DemoIndex()->numdemos;
 	}
 	else
 	{
 		--num;
 	}
 
-	if (num > dir.numfiles)
-		return NULL;
-
-	while (list->name[0] && num)
-	{
-		list++;
-		num--;
-	}
+	e = SV_DemoIndex_Demo(num + 1);
 
-	return list->name[0] ? list->name : NULL;
+	return e ? e->name : NULL;
 }
 
 #define OVECCOUNT 3
@@ -502,7 +669,6 @@ char *SV_MVDName2Txt (const char *name)
 
 	int		r, ovector[OVECCOUNT];
 	pcre	*preg;
-	const char	*errbuf;
 
 	if (!name)
 		return NULL;
@@ -513,15 +679,9 @@ char *SV_MVDName2Txt (const char *name)
 	strlcpy(s, name, MAX_OSPATH);
 	len = strlen(s);
 
-	if (!(preg = pcre_compile(sv_demoRegexp.string, PCRE_CASELESS, &errbuf, &r, NULL)))
-	{
-		Con_Printf("SV_MVDName2Txt: pcre_compile(%s) error: %s at offset %d\n",
-					sv_demoRegexp.string, errbuf, r);
-		Q_free(preg);
+	if (!(preg = SV_DemoRegexp()))
 		return NULL;
-	}
 	r = pcre_exec(preg, NULL, s, len, 0, 0, ovector, OVECCOUNT);
-	Q_free(preg);
 	if (r < 0)
 	{
 		switch (r)
@@ -572,32 +732,41 @@ void SV_MVDRemove_f (void)
 	ptr = Cmd_Argv(1);
 	if (*ptr == '*')
 	{
-		dir_t dir;
-		file_t *list;
+		demoindex_t *index;
+		char *names, *list;
+		int j, n;
 
 		// remove all demos with specified token
 		ptr++;
 
-		dir = Sys_listdir(va("%s/%s", fs_gamedir, sv_demoDir.string), sv_demoRegexp.string, SORT_BY_DATE);
-		list = dir.files;
-		for (i = 0;list->name[0]; list++)
+		// take the names first, removing files updates the index
+		index = SV_DemoIndex();
+		names = (char *) Q_malloc(max(index->numdemos, 1) * MAX_DEMO_NAME);
+		for (j = 0, n = 0; j < index->numfiles; j++)
+			if (index->files[j].isdemo && strstr(index->files[j].name, ptr))
+				strlcpy(names + MAX_DEMO_NAME * n++, index->files[j].name, MAX_DEMO_NAME);
+
+		for (i = 0, j = 0; j < n; j++)
 		{
-			if (strstr(list->name, ptr))
-			{
-				if (sv.mvdrecording && DestByName(list->name)/*!strcmp(list->name, demo.name)*/)
-					SV_MVDStop_f(); // FIXME: probably we must stop not all demos, but only partial dest
+			list = names + MAX_DEMO_NAME * j;
 
-				// stop recording first;
-				snprintf(path, MAX_OSPATH, "%s/%s/%s", fs_gamedir, sv_demoDir.string, list->name);
-				if (!Sys_remove(path))
-				{
-					Con_Printf("removing %s...\n", list->name);
-					i++;
-				}
+			if (sv.mvdrecording && DestByName(list)/*!strcmp(list, demo.name)*/)
+				SV_MVDStop_f(); // FIXME: probably we must stop not all demos, but only partial dest
 
-				Sys_remove(SV_MVDName2Txt(path));
+			// stop recording first;
+			snprintf(path, MAX_OSPATH, "%s/%s/%s", fs_gamedir, sv_demoDir.string, list);
+			if (!Sys_remove(path))
+			{
+				Con_Printf("removing %s...\n", list);
+				i++;
 			}
+
+			Sys_remove(SV_MVDName2Txt(path));
+
+			SV_DemoIndex_Update(list);
+			SV_DemoIndex_Update(SV_MVDName2Txt(list));
 		}
+		Q_free(names);
 
 		if (i)
 		{
@@ -643,6 +812,9 @@ void SV_MVDRemove_f (void)
 
 	Sys_remove(SV_MVDName2Txt(path));
 
+	SV_DemoIndex_Update(name);
+	SV_DemoIndex_Update(SV_MVDName2Txt(name));
+
 	// force cache rebuild.
 	FS_FlushFSHash();
 }
@@ -652,6 +824,7 @@ void SV_MVDRemoveNum_f (void)
 	int		num;
 	char	*val, *name;
 	char path[MAX_OSPATH];
+	char demoname[MAX_DEMO_NAME];
 
 	if (Cmd_Argc() != 2)
 	{
@@ -670,6 +843,10 @@ void SV_MVDRemoveNum_f (void)
 
 	if (name != NULL)
 	{
+		// points into the demo index, which changes below
+		strlcpy(demoname, name, sizeof(demoname));
+		name = demoname;
+
 		if (sv.mvdrecording && DestByName(name)/*!strcmp(name, demo.name)*/)
 			SV_MVDStop_f(); // FIXME: probably we must stop not all demos, but only partial dest
 
@@ -694,6 +871,9 @@ void SV_MVDRemoveNum_f (void)
 
 		Sys_remove(SV_MVDName2Txt(path));
 
+		SV_DemoIndex_Update(name);
+		SV_DemoIndex_Update(SV_MVDName2Txt(name));
+
 		// force cache rebuild.
 		FS_FlushFSHash();
 	}
@@ -703,7 +883,7 @@ void SV_MVDRemoveNum_f (void)
 
 void SV_MVDInfoAdd_f (void)
 {
-	char *name, *args, path[MAX_OSPATH];
+	char *name, *args, path[MAX_OSPATH], txtname[MAX_DEMO_NAME];
 	FILE *f;
 
 	if (Cmd_Argc() < 3)
@@ -733,6 +913,8 @@ void SV_MVDInfoAdd_f (void)
 		snprintf(path, MAX_OSPATH, "%s/%s/%s", fs_gamedir, sv_demoDir.string, name);
 	}
 
+	strlcpy(txtname, COM_SkipPath(path), sizeof(txtname));
+
 	if ((f = fopen(path, !strcmp(Cmd_Argv(1), "**") ? "a+b" : "a+t")) == NULL)
 	{
 		Con_Printf("failed to open the file\n");
@@ -777,6 +959,8 @@ void SV_MVDInfoAdd_f (void)
 	fflush(f);
 	fclose(f);
 
+	SV_DemoIndex_Update(txtname);
+
 	// force cache rebuild.
 	FS_FlushFSHash();
 }
@@ -821,6 +1005,8 @@ void SV_MVDInfoRemove_f (void)
 	else
 		Con_Printf("file %s removed\n", path);
 
+	SV_DemoIndex_Update(COM_SkipPath(path));
+
 	// force cache rebuild.
 	FS_FlushFSHash();
 }
@@ -881,11 +1067,11 @@ void SV_MVDInfo_f (void)
 #define MAXDEMOS_RD_PACKET	100
 void SV_LastScores_f (void)
 {
-	int		demos = MAXDEMOS, i;
+	int		demos = MAXDEMOS, i, num;
 	char	buf[512];
 	FILE	*f = NULL;
 	char	path[MAX_OSPATH];
-	dir_t	dir;
+	demoindex_t	*index;
 	extern redirect_t sv_redirected;
 
 	if (Cmd_Argc() > 2)
@@ -898,16 +1084,15 @@ void SV_LastScores_f (void)
 		if ((demos = Q_atoi(Cmd_Argv(1))) <= 0)
 			demos = MAXDEMOS;
 
-	dir = Sys_listdir(va("%s/%s", fs_gamedir, sv_demoDir.string),
-	                  sv_demoRegexp.string, SORT_BY_DATE);
-	if (!dir.numfiles)
+	index = SV_DemoIndex();
+	if (!index->numdemos)
 	{
 		Con_Printf("No demos.\n");
 		return;
 	}
 
-	if (demos > dir.numfiles)
-		demos = dir.numfiles;
+	if (demos > index->numdemos)
+		demos = index->numdemos;
 
 	if (demos > MAXDEMOS && GameStarted())
 		Con_Printf("<numlastdemos> was decreased to %i: match is in progress.\n",
@@ -919,12 +1104,15 @@ void SV_LastScores_f (void)
 
 	Con_Printf("List of %d last demos:\n", demos);
 
-	for (i = dir.numfiles - demos; i < dir.numfiles; )
+	for (i = 0, num = 0; i < index->numfiles; i++)
 	{
+		if (!index->files[i].isdemo || ++num <= index->numdemos - demos)
+			continue;
+
 		snprintf(path, MAX_OSPATH, "%s/%s/%s", fs_gamedir, sv_demoDir.string,
-					SV_MVDName2Txt(dir.files[i].name));
+					SV_MVDName2Txt(index->files[i].name));
 
-		Con_Printf("%i. ", ++i);
+		Con_Printf("%i. ", num);
 		if ((f = fopen(path, "rt")) == NULL)
 			Con_Printf("(empty)\n");
 		else
@@ -27,10 +27,280 @@ static cvar_t qtv_password       = {"qtv_password",         ""};
 static cvar_t qtv_pendingtimeout = {"qtv_pendingtimeout",  "5"}; // 5  seconds must be enough
 static cvar_t qtv_sayenabled     = {"qtv_sayenabled",      "0"}; // allow mod to override GameStarted() logic
 cvar_t qtv_streamtimeout         = {"qtv_streamtimeout",  "45"}; // 45 seconds
+static cvar_t qtv_streambacklog  = {"qtv_streambacklog", "1024"}; // kilobytes a stream may fall behind before it is dropped
 
 static unsigned short int	listenport		= 0;
 static double				warned_time		= 0;
 
+// {
+
+// Shared stream segments.
+// Demo data for streams is appended once to a chain of segments, every DEST_STREAM dest keeps a cursor into it
+// and sends from there. Data for a single stream only (initial gamestate) goes into the dest's own ->cache,
+// which is sent before the shared data.
+
+#define MVD_STREAM_IOV			64
+
+static mvdseg_t		*seg_head;		// oldest segment still referenced
+static mvdseg_t		*seg_tail;		// segment being appended to
+static mvdseg_t		*seg_free;		// spare segments
+static int			seg_count;		// segments in the chain
+static int			seg_spare;		// segments in seg_free
+static int			seg_cursors;	// attached stream cursors
+static unsigned int	seg_written;	// total bytes appended to the shared stream
+
+static mvdseg_t *SV_MVDStream_NewSeg (void)
+{
+	mvdseg_t *seg = seg_free;
+
+	if (seg)
+	{
+		seg_free = seg->next;
+		seg_spare--;
+	}
+	else
+		seg = (mvdseg_t *) Q_malloc (sizeof(*seg));
+
+	seg->refs = 0;
+	seg->used = 0;
+	seg->next = NULL;
+	seg_count++;
+
+	return seg;
+}
+
+// release segments no cursor can reach any more
+static void SV_MVDStream_Trim (void)
+{
+	mvdseg_t *seg;
+
+	while (seg_head && !seg_head->refs && (seg_head != seg_tail || !seg_cursors))
+	{
+		seg = seg_head;
+		seg_head = seg->next;
+		if (seg == seg_tail)
+			seg_tail = NULL;
+
+		seg_count--;
+
+		if (seg_spare < 8)
+		{
+			seg->next = seg_free;
+			seg_free = seg;
+			seg_spare++;
+		}
+		else
+		{
+			Q_free(seg);
+		}
+	}
+}
+
+// start sending shared data to this dest from the current end of the stream
+static void SV_MVDStream_Attach (mvddest_t *d)
+{
+	if (!seg_tail)
+		seg_head = seg_tail = SV_MVDStream_NewSeg();
+
+	d->seg = seg_tail;
+	d->segpos = seg_tail->used;
+	d->streampos = seg_written;
+	d->seg->refs++;
+	seg_cursors++;
+}
+
+void SV_MVDStream_Detach (mvddest_t *d)
+{
+	if (!d->seg)
+		return;
+
+	d->seg->refs--;
+	d->seg = NULL;
+	seg_cursors--;
+
+	SV_MVDStream_Trim();
+}
+
+// step the cursor over len bytes of shared data
+static void SV_MVDStream_Advance (mvddest_t *d, int len)
+{
+	int n;
+
+	d->streampos += len;
+
+	while (len > 0 || (d->segpos == d->seg->used && d->seg->next))
+	{
+		if (d->segpos == d->seg->used)
+		{
+			d->seg->refs--;
+			d->seg = d->seg->next;
+			d->seg->refs++;
+			d->segpos = 0;
+			continue;
+		}
+
+		n = min(len, d->seg->used - d->segpos);
+		d->segpos += n;
+		len -= n;
+	}
+}
+
+// append data to the stream, once for all streams
+void SV_MVDStream_Write (void *data, int len)
+{
+	byte *p = (byte *) data;
+	int n;
+
+	if (!seg_cursors || len <= 0)
+		return;
+
+	while (len > 0)
+	{
+		if (seg_tail->used == MVD_SEGMENT_SIZE)
+		{
+			seg_tail->next = SV_MVDStream_NewSeg();
+			seg_tail = seg_tail->next;
+		}
+
+		n = min(len, MVD_SEGMENT_SIZE - seg_tail->used);
+		memcpy(seg_tail->data + seg_tail->used, p, n);
+		seg_tail->used += n;
+		p += n;
+		len -= n;
+		seg_written += n;
+	}
+}
+
+// write data which is meant for this dest only
+void SV_MVDStream_WritePrivate (mvddest_t *d, void *data, int len)
+{
+	mvdseg_t *seg;
+	int pos, n;
+	int pending = seg_written - d->streampos;
+
+	// shared data queued for this dest must go out first, so move it ahead into the private cache
+	if (pending && d->seg)
+	{
+		if (d->cacheused + pending > d->maxcachesize)
+		{
+			Sys_Printf("SV_MVDStream_WritePrivate: cache overflow %d > %d\n", d->cacheused + pending, d->maxcachesize);
+			d->error = true;
+			return;
+		}
+
+		for (seg = d->seg, pos = d->segpos; seg; seg = seg->next, pos = 0)
+		{
+			n = seg->used - pos;
+			memcpy(d->cache + d->cacheused, seg->data + pos, n);
+			d->cacheused += n;
+		}
+
+		SV_MVDStream_Advance(d, pending);
+	}
+
+	if (d->cacheused + len > d->maxcachesize)
+	{
+		Sys_Printf("SV_MVDStream_WritePrivate: cache overflow %d > %d\n", d->cacheused + len, d->maxcachesize);
+		d->error = true;
+		return;
+	}
+
+	memcpy(d->cache + d->cacheused, data, len);
+	d->cacheused += len;
+}
+
+// send as much of the private cache and the shared stream as the socket takes, in one call
+void SV_MVDStream_Flush (mvddest_t *d)
+{
+#ifdef _WIN32
+	WSABUF iov[MVD_STREAM_IOV];
+	DWORD sent;
+#else
+	struct iovec iov[MVD_STREAM_IOV];
+#endif
+	char *base[MVD_STREAM_IOV];
+	int size[MVD_STREAM_IOV];
+	int i, count = 0, len, n;
+	unsigned int backlog = seg_written - d->streampos;
+	mvdseg_t *seg;
+
+	if (!d->seg)
+		return;
+
+	if ((int)qtv_streambacklog.value > 0 && backlog > (unsigned int)qtv_streambacklog.value * 1024)
+	{
+		Sys_Printf("DestFlush: stream %d is %u bytes behind, dropping\n", d->id, backlog);
+		d->error = true;
+		return;
+	}
+
+	if (d->cacheused)
+	{
+		base[count] = d->cache;
+		size[count++] = d->cacheused;
+	}
+
+	for (seg = d->seg, n = d->segpos; seg && count < MVD_STREAM_IOV; seg = seg->next, n = 0)
+	{
+		if (seg->used > n)
+		{
+			base[count] = (char *) seg->data + n;
+			size[count++] = seg->used - n;
+		}
+	}
+
+	if (!count)
+		return;
+
+	for (i = 0; i < count; i++)
+	{
+#ifdef _WIN32
+		iov[i].buf = base[i];
+		iov[i].len = size[i];
+#else
+		iov[i].iov_base = base[i];
+		iov[i].iov_len = size[i];
+#endif
+	}
+
+#ifdef _WIN32
+	len = WSASend(d->socket, iov, count, &sent, 0, NULL, NULL) ? -1 : (int) sent;
+#else
+	len = writev(d->socket, iov, count);
+#endif
+
+	if (len == 0) //client died
+	{
+		// man says: The calls return the number of characters sent, or -1 if an error occurred.
+		// so 0 is legal or what?
+	}
+	else if (len > 0) //we put some data through
+	{
+		n = min(len, d->cacheused);
+		if (n)
+		{
+			d->cacheused -= n;
+			memmove(d->cache, d->cache + n, d->cacheused);
+			len -= n;
+		}
+
+		SV_MVDStream_Advance(d, len);
+		SV_MVDStream_Trim();
+
+		d->io_time = Sys_DoubleTime(); // update IO activity
+	}
+	else
+	{ //error of some kind. would block or something
+		if (qerrno != EWOULDBLOCK && qerrno != EAGAIN)
+		{
+			Sys_Printf("DestFlush: error on stream\n");
+			d->error = true;
+		}
+	}
+}
+
+// }
+
 static mvddest_t *SV_InitStream (int socket1, netadr_t na, char *userinfo)
 {
 	static int lastdest = 0;
@@ -66,6 +336,7 @@ static mvddest_t *SV_InitStream (int socket1, netadr_t na, char *userinfo)
 	dst->socket = socket1;
 	dst->maxcachesize = 65536;	//is this too small?
 	dst->cache = (char *) Q_malloc(dst->maxcachesize);
+	SV_MVDStream_Attach(dst);
 	dst->io_time = Sys_DoubleTime();
 	dst->id = ++lastdest;
 	dst->na = na;
@@ -1283,7 +1554,6 @@ void DemoWriteQTVTimePad (int msecs)	//broadcast to all proxies
 //broadcast to all proxies
 void DemoWriteQTV (sizebuf_t *msg)
 {
-	mvddest_t		*d;
 	sizebuf_t		mvdheader;
 	byte			mvdheader_buf[6];
 
@@ -1296,14 +1566,8 @@ void DemoWriteQTV (sizebuf_t *msg)
 	//length
 	MSG_WriteLong (&mvdheader, msg->cursize);
 
-	for (d = demo.dest; d; d = d->nextdest)
-	{
-		if (d->desttype == DEST_STREAM)
-		{
-			DemoWriteDest(mvdheader.data, mvdheader.cursize, d);
-			DemoWriteDest(msg->data, msg->cursize, d);
-		}
-	}
+	SV_MVDStream_Write(mvdheader.data, mvdheader.cursize);
+	SV_MVDStream_Write(msg->data, msg->cursize);
 }
 
 void Qtv_List_f(void)
@@ -1422,6 +1686,7 @@ void Qtv_Status_f(void)
 		cnt++;
 
 	Con_Printf ("Pending streams: %d\n", cnt);
+	Con_Printf ("Stream segments: %d (%dk)\n", seg_count, seg_count * (MVD_SEGMENT_SIZE / 1024));
 }
 
 //====================================
@@ -1433,6 +1698,7 @@ void SV_QTV_Init(void)
 	Cvar_Register (&qtv_password);
 	Cvar_Register (&qtv_pendingtimeout);
 	Cvar_Register (&qtv_streamtimeout);
+	Cvar_Register (&qtv_streambacklog);
 	Cvar_Register (&qtv_sayenabled);
 
 	Cmd_AddCommand ("qtv_list", Qtv_List_f);
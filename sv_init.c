@@ -165,14 +165,10 @@ static void SV_SaveSpawnparms (void)
 
 static unsigned SV_CheckModel(char *mdl)
 {
-	unsigned char *buf;
+	fs_mappedfile_t mapped;
 	unsigned short crc;
-	int filesize;
-	int mark;
 
-	mark = Hunk_LowMark ();
-	buf = (byte *) FS_LoadHunkFile (mdl, &filesize);
-	if (!buf)
+	if (!FS_MapFile (mdl, &mapped))
 	{
 		if (!strcmp (mdl, "progs/player.mdl"))
 			return 33168;
@@ -184,8 +180,8 @@ static unsigned SV_CheckModel(char *mdl)
 			SV_Error ("SV_CheckModel: could not load %s\n", mdl);
 	}
 
-	crc = CRC_Block (buf, filesize);
-	Hunk_FreeToLowMark (mark);
+	crc = CRC_Block ((byte *) mapped.data, mapped.len);
+	FS_UnmapFile (&mapped);
 
 	return crc;
 }
@@ -230,6 +226,8 @@ void SV_SpawnServer(char *mapname, qbool devmap, char* entityfile, qbool loading
 
 	SV_SaveSpawnparms ();
 	SV_LoadAccounts();
+	// clients reconnect anyway, don't serve files from the previous map/gamedir
+	SV_DownloadCache_Flush(true);
 
 #ifdef USE_PR2
 	// remove bot clients
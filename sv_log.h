@@ -32,6 +32,17 @@ typedef struct log_s {
 	char		*message_on;
 	xcommand_t	function;
 	int			log_level;
+
+	// buffered writing, see SV_Write_Log
+	char		*buffer;		// lines waiting for the log thread
+	char		*spare;			// swapped with buffer when the lines are written
+	int			buffered;
+	int			size;			// bytes in the file, tracked in memory
+	double		lastflush;
+	char		rotate_prefix[MAX_OSPATH];	// file grew over sv_maxlogsize, open the next one
+	char		rotated_name[MAX_OSPATH];	// opened by the log thread, reported in SV_LogFrame
+	qbool		rotate_failed;				// the next file couldn't be opened, reported in SV_LogFrame
+	qbool		write_failed;
 } log_t;
 
 extern	log_t	logs[MAX_LOG];
@@ -43,5 +54,8 @@ void	SV_Logfile (int sv_log, qbool newlog);
 void	SV_LogPlayer(client_t *cl, char *msg, int level);
 //<-
 void	SV_Write_Log(int sv_log, int level, char *msg);
+void	SV_LogSetFile(int sv_log, FILE *f);
+void	SV_LogFrame(void);
+void	SV_LogInit(void);
 
 #endif /* !__LOG_H__ */
@@ -124,6 +124,7 @@ cvar_t	sv_kicktop = {"sv_kicktop", "1"};
 cvar_t	sv_allowlastscores = {"sv_allowlastscores", "1"};
 
 cvar_t	sv_maxlogsize = {"sv_maxlogsize", "0"};
+cvar_t	sv_logflush = {"sv_logflush", "1"}; // seconds log lines may wait before they are written, 0 writes them at once
 //bliP: 24/9 ->
 void OnChange_logdir_var (cvar_t *var, char *string, qbool *cancel);
 cvar_t  sv_logdir = {"sv_logdir", ".", 0, OnChange_logdir_var};
@@ -225,10 +226,7 @@ void SV_Shutdown (char *finalmsg)
 	for (i = MIN_LOG; i < MAX_LOG; ++i)
 	{
 		if (logs[i].sv_logfile)
-		{
-			fclose (logs[i].sv_logfile);
-			logs[i].sv_logfile = NULL;
-		}
+			SV_LogSetFile(i, NULL);
 	}
 	if (sv.mvdrecording)
 		SV_MVDStop_f();
@@ -3176,6 +3174,8 @@ void SV_Frame (double time1)
 	start = Sys_DoubleTime ();
 	svs.stats.idle += start - end;
 
+	SV_ProfileStartFrame ();
+
 	// keep the random time dependent
 	rand ();
 
@@ -3199,9 +3199,13 @@ void SV_Frame (double time1)
 
 	// toggle the log buffer if full
 	SV_CheckLog ();
+	SV_LogFrame ();
 
 	SV_MVDStream_Poll();
 
+	// finish demos packed on a thread
+	SV_DemoCompress_Poll();
+
 #ifdef SERVERONLY
 	// check for commands typed to the host
 	SV_GetConsoleCommands ();
@@ -3216,33 +3220,43 @@ void SV_Frame (double time1)
 	SV_CheckVars ();
 
 	// get packets
+	SV_ProfileEnter (SVPROF_READ);
 	SV_ReadPackets ();
+	SV_ProfileLeave (SVPROF_READ);
 
 	// move autonomous things around if enough time has passed
 	if (!sv.paused) {
+		SV_ProfileEnter (SVPROF_PHYSICS);
 		SV_Physics();
 #ifdef USE_PR2
 		SV_RunBots();
 #endif
+		SV_ProfileLeave (SVPROF_PHYSICS);
 	}
 	else
 		PausedTic ();
 
 	// send messages back to the clients that had packets read this frame
+	SV_ProfileEnter (SVPROF_SEND);
 	SV_SendClientMessages ();
+	SV_ProfileLeave (SVPROF_SEND);
 
 #if defined(SERVERONLY) && defined(WWW_INTEGRATION)
 	Central_ProcessResponses();
 #endif
 
 	demo_start = Sys_DoubleTime ();
+	SV_ProfileEnter (SVPROF_DEMO);
 	SV_SendDemoMessage();
+	SV_ProfileLeave (SVPROF_DEMO);
 	demo_end = Sys_DoubleTime ();
 	svs.stats.demo += demo_end - demo_start;
 
 	// send a heartbeat to the master if needed
 	Master_Heartbeat ();
 
+	SV_ProfileEndFrame ();
+
 	// collect timing statistics
 	end = Sys_DoubleTime ();
 	svs.stats.active += end-start;
@@ -3252,11 +3266,15 @@ void SV_Frame (double time1)
 		svs.stats.latched_idle = svs.stats.idle;
 		svs.stats.latched_packets = svs.stats.packets;
 		svs.stats.latched_demo = svs.stats.demo;
+		svs.stats.latched_touch = svs.stats.touch;
+		svs.stats.latched_touches = svs.stats.touches;
 		svs.stats.active = 0;
 		svs.stats.idle = 0;
 		svs.stats.packets = 0;
 		svs.stats.count = 0;
 		svs.stats.demo = 0;
+		svs.stats.touch = 0;
+		svs.stats.touches = 0;
 	}
 }
 
@@ -3375,6 +3393,11 @@ void SV_InitLocal (void)
 	Cvar_Register (&sv_antilag_no_pred);
 	Cvar_Register (&sv_antilag_projectiles);
 
+	Cvar_Register (&sv_triggergrid);
+	Cvar_Register (&sv_touchdedup);
+
+	SV_ProfileInit ();
+
 	//Cvar_Register (&pm_bunnyspeedcap);
 	Cvar_Register (&pm_ktjump);
 	//Cvar_Register (&pm_slidefix);
@@ -3398,6 +3421,8 @@ void SV_InitLocal (void)
 	Cvar_Register (&sv_admininfo);
 	Cvar_Register (&sv_reconnectlimit);
 	Cvar_Register (&sv_maxlogsize);
+	Cvar_Register (&sv_logflush);
+	SV_LogInit ();
 	//bliP: 24/9 ->
 	Cvar_Register (&sv_logdir);
 	Cvar_Register (&sv_speedcheck);
@@ -3927,6 +3952,252 @@ void SV_LogPlayer(client_t *cl, char *msg, int level)
 	            );
 }
 
+/*
+============
+Buffered log writing
+
+SV_Write_Log only appends the line to the log's buffer, a background thread
+writes the buffers out every sv_logflush seconds (or sooner when one fills
+up), so the frame never waits for the disk. The thread sleeps on log_wakeup,
+which SV_Write_Log and SV_LogFrame post once a buffer is due. The file size
+is tracked in memory and rotation to the next file is done by the thread as
+well. Messages about that are printed from SV_LogFrame, as the console isn't
+thread safe.
+============
+*/
+
+#define LOG_BUFFER_SIZE		(64 * 1024)
+
+static sem_t log_buffer_lock;	// guards buffer, lastflush, rotate_prefix, rotated_name, rotate_failed, write_failed and log_wakeup_posted
+static sem_t log_file_lock;		// guards sv_logfile and spare
+static sem_t log_wakeup;		// posted when the log thread has work
+static qbool log_wakeup_posted;
+static qbool log_thread_started;
+
+// Opens the first free prefix_NNNN.log, name is left empty if there's none.
+static FILE *SV_LogOpenNext(const char *prefix, char *name, size_t name_size)
+{
+	FILE *f;
+	int i, len;
+
+	for (i = 0; i < 1000; i++)
+	{
+		len = snprintf(name, name_size, "%s_%04d.log", prefix, i);
+		if (len < 0 || len >= name_size)
+		{
+			name[0] = 0; // the prefix doesn't leave room for the number
+			return NULL;
+		}
+
+		if (!COM_FileExists(name))
+			break; // file doesn't exist
+	}
+
+	if (!(f = fopen(name, "a")))
+		name[0] = 0;
+
+	return f;
+}
+
+// Writes out whatever SV_Write_Log buffered, must be called with log_file_lock held.
+static void SV_LogWriteBuffered(log_t *log)
+{
+	char prefix[MAX_OSPATH], name[MAX_OSPATH];
+	qbool failed = false, rotate_failed = false;
+	char *data;
+	int len;
+	FILE *f;
+
+	Sys_SemWait(&log_buffer_lock);
+	data = log->buffer;
+	len = log->buffered;
+	log->buffer = log->spare;
+	log->buffered = 0;
+	log->spare = data;
+	strlcpy(prefix, log->rotate_prefix, sizeof(prefix));
+	log->rotate_prefix[0] = 0;
+	log->lastflush = Sys_DoubleTime();
+	Sys_SemPost(&log_buffer_lock);
+
+	if (!log->sv_logfile)
+		return;
+
+	if (len)
+	{
+		if (fwrite(data, 1, len, log->sv_logfile) != len)
+			failed = true;
+		else
+			fflush(log->sv_logfile);
+	}
+
+	name[0] = 0;
+	if (!failed && prefix[0])
+	{
+		// the current file is kept when the next one can't be opened
+		if ((f = SV_LogOpenNext(prefix, name, sizeof(name))))
+		{
+			fclose(log->sv_logfile);
+			log->sv_logfile = f;
+		}
+		else
+		{
+			rotate_failed = true;
+		}
+	}
+
+	if (failed || rotate_failed || name[0])
+	{
+		Sys_SemWait(&log_buffer_lock);
+		log->write_failed |= failed;
+		log->rotate_failed |= rotate_failed;
+		strlcpy(log->rotated_name, name, sizeof(log->rotated_name));
+		Sys_SemPost(&log_buffer_lock);
+	}
+}
+
+static void SV_LogFlush(log_t *log)
+{
+	Sys_SemWait(&log_file_lock);
+	SV_LogWriteBuffered(log);
+	Sys_SemPost(&log_file_lock);
+}
+
+// Wakes the log thread if the log is due to be written, must be called with log_buffer_lock held.
+static void SV_LogWakeup(log_t *log)
+{
+	if (!log_thread_started || log_wakeup_posted)
+		return;
+	if (!log->buffered && !log->rotate_prefix[0])
+		return;
+	if (log->buffered < LOG_BUFFER_SIZE / 2 && !log->rotate_prefix[0] && log->lastflush + bound(0, sv_logflush.value, 60) > Sys_DoubleTime())
+		return;
+
+	log_wakeup_posted = true;
+	Sys_SemPost(&log_wakeup);
+}
+
+static int SV_LogThread(void *ignored)
+{
+	qbool pending;
+	log_t *log;
+	int i;
+
+	for (;;)
+	{
+		Sys_SemWait(&log_wakeup);
+
+		Sys_SemWait(&log_buffer_lock);
+		log_wakeup_posted = false;
+		Sys_SemPost(&log_buffer_lock);
+
+		for (i = MIN_LOG; i < MAX_LOG; i++)
+		{
+			log = &logs[i];
+
+			Sys_SemWait(&log_buffer_lock);
+			pending = (log->buffered || log->rotate_prefix[0]);
+			Sys_SemPost(&log_buffer_lock);
+
+			if (pending)
+				SV_LogFlush(log);
+		}
+	}
+
+	return 0;
+}
+
+void SV_LogInit(void)
+{
+	Sys_SemInit(&log_buffer_lock, 1, 1);
+	Sys_SemInit(&log_file_lock, 1, 1);
+	Sys_SemInit(&log_wakeup, 0, 1);
+}
+
+// Replaces the log file, lines buffered so far still go to the old one.
+void SV_LogSetFile(int sv_log, FILE *f)
+{
+	log_t *log = &logs[sv_log];
+
+	Sys_SemWait(&log_file_lock);
+
+	Sys_SemWait(&log_buffer_lock);
+	log->rotate_prefix[0] = 0;
+	log->rotated_name[0] = 0;
+	log->rotate_failed = false;
+	log->write_failed = false;
+	Sys_SemPost(&log_buffer_lock);
+
+	SV_LogWriteBuffered(log);
+
+	if (log->sv_logfile)
+		fclose(log->sv_logfile);
+	log->sv_logfile = f;
+	log->size = f ? FS_FileLength(f) : 0;
+
+	Sys_SemPost(&log_file_lock);
+}
+
+static char *SV_LogErrorMessage(int sv_log)
+{
+	switch (sv_log)
+	{
+	case FRAG_LOG:
+	case MOD_FRAG_LOG:
+		return va("Can't write in %s log file: "/*%s/ */"%sN.log.\n",
+		          /*fs_gamedir,*/ logs[sv_log].message_on,
+		          logs[sv_log].file_name);
+	default:
+		return va("Can't write in %s log file: "/*%s/ */"%s%i.log.\n",
+		          /*fs_gamedir,*/ logs[sv_log].message_on,
+		          logs[sv_log].file_name, NET_UDPSVPort());
+	}
+}
+
+// Reports what the log thread did since the last frame.
+void SV_LogFrame(void)
+{
+	char name[MAX_OSPATH];
+	qbool failed, rotate_failed;
+	log_t *log;
+	int i;
+
+	for (i = MIN_LOG; i < MAX_LOG; i++)
+	{
+		log = &logs[i];
+
+		Sys_SemWait(&log_buffer_lock);
+		// lines that were buffered with no others after them still need writing out
+		SV_LogWakeup(log);
+		if (!log->rotated_name[0] && !log->rotate_failed && !log->write_failed)
+		{
+			Sys_SemPost(&log_buffer_lock);
+			continue;
+		}
+		strlcpy(name, log->rotated_name, sizeof(name));
+		failed = log->write_failed;
+		rotate_failed = log->rotate_failed;
+		log->rotated_name[0] = 0;
+		log->rotate_failed = false;
+		log->write_failed = false;
+		Sys_SemPost(&log_buffer_lock);
+
+		if (name[0])
+			Con_Printf ("Logging %s to %s\n", log->message_on, name);
+
+		if (rotate_failed)
+			Sys_Printf ("Can't open the next %s log file in %s, still logging to the current one.\n", log->message_on, sv_logdir.string);
+
+		if (failed)
+		{
+			//bliP: Sys_Error to Con_DPrintf ->
+			//VVD: Con_DPrintf to Sys_Printf ->
+			Sys_Printf("%s", SV_LogErrorMessage(i));
+			//<-
+			SV_Logfile(i, false);
+		}
+	}
+}
+
 /*
 ============
 SV_Write_Log
@@ -3935,48 +4206,70 @@ SV_Write_Log
 void SV_Write_Log(int sv_log, int level, char *msg)
 {
 	static date_t date;
-	char *log_msg, *error_msg;
+	log_t *log = &logs[sv_log];
+	char *log_msg;
+	qbool flush;
+	int len;
 
-	if (!(logs[sv_log].sv_logfile && *msg))
+	if (!(log->sv_logfile && *msg))
 		return;
 
-	if (logs[sv_log].log_level < level)
+	if (log->log_level < level)
 		return;
 
-	SV_TimeOfDay(&date);
-
 	switch (sv_log)
 	{
 	case FRAG_LOG:
 	case MOD_FRAG_LOG:
 		log_msg = msg; // these logs aren't in fs_gamedir
-		error_msg = va("Can't write in %s log file: "/*%s/ */"%sN.log.\n",
-		               /*fs_gamedir,*/ logs[sv_log].message_on,
-		               logs[sv_log].file_name);
 		break;
 	default:
+		SV_TimeOfDay(&date);
 		log_msg = va("[%s].[%d] %s", date.str, level, msg);
-		error_msg = va("Can't write in %s log file: "/*%s/ */"%s%i.log.\n",
-		               /*fs_gamedir,*/ logs[sv_log].message_on,
-		               logs[sv_log].file_name, NET_UDPSVPort());
 	}
 
-	if (fprintf(logs[sv_log].sv_logfile, "%s", log_msg) < 0)
+	len = min(strlen(log_msg), LOG_BUFFER_SIZE);
+
+	if (!log_thread_started && sv_logflush.value)
+		log_thread_started = (Sys_CreateDetachedThread(SV_LogThread, NULL) == 0);
+
+	Sys_SemWait(&log_buffer_lock);
+
+	// no room left, write it out ourselves
+	if (log->buffered + len > LOG_BUFFER_SIZE)
 	{
-		//bliP: Sys_Error to Con_DPrintf ->
-		//VVD: Con_DPrintf to Sys_Printf ->
-		Sys_Printf("%s", error_msg);
-		//<-
-		SV_Logfile(sv_log, false);
+		Sys_SemPost(&log_buffer_lock);
+		SV_LogFlush(log);
+		Sys_SemWait(&log_buffer_lock);
 	}
-	else
+
+	if (!log->buffer)
+	{
+		log->buffer = Q_malloc(LOG_BUFFER_SIZE);
+		log->spare = Q_malloc(LOG_BUFFER_SIZE);
+	}
+	memcpy(log->buffer + log->buffered, log_msg, len);
+	log->buffered += len;
+	log->size += len;
+
+	if ((int)sv_maxlogsize.value && log->size > (int)sv_maxlogsize.value)
 	{
-		fflush(logs[sv_log].sv_logfile);
-		if ((int)sv_maxlogsize.value &&
-		        (FS_FileLength(logs[sv_log].sv_logfile) > (int)sv_maxlogsize.value))
+		if (snprintf(log->rotate_prefix, sizeof(log->rotate_prefix), "%s/%s%d", sv_logdir.string, log->file_name, NET_UDPSVPort()) >= sizeof(log->rotate_prefix))
 		{
-			SV_Logfile(sv_log, true);
+			log->rotate_prefix[0] = 0;
+			log->rotate_failed = true;
 		}
+		log->size = 0;
+	}
+	SV_LogWakeup(log);
+	Sys_SemPost(&log_buffer_lock);
+
+	// errors are usually followed by the exit, don't keep them around
+	flush = (!log_thread_started || !sv_logflush.value || sv_log == ERROR_LOG);
+	if (flush)
+	{
+		SV_LogFlush(log);
+		SV_LogFrame();
 	}
 }
 
@@ -0,0 +1,226 @@
+/*
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// sv_profile.c -- time spent in each stage of the server frame
+
+#include "qwsvdef.h"
+
+#define	SVPROF_HISTORY	4096	// frames kept for the percentiles, must be a power of two
+
+static const char *svprof_names[SVPROF_MAX] = {
+	"frame", "read", "physics", "progs", "entities", "send", "demo"
+};
+
+typedef struct {
+	qbool		active;							// latched at the start of the frame
+	double		start[SVPROF_MAX];
+	int			depth[SVPROF_MAX];				// nested entries are timed once, by the outermost
+	double		frame[SVPROF_MAX];				// this frame so far
+
+	float		history[SVPROF_MAX][SVPROF_HISTORY];	// milliseconds per frame
+	unsigned int frames;						// frames recorded, history is a ring over this
+
+	unsigned int dumpframes;					// frames at the last dump
+	double		lastdump;
+} svprofile_t;
+
+static svprofile_t svprof;
+
+typedef struct {
+	float		p50, p99, max, mean;
+} svprof_stats_t;
+
+cvar_t	sv_frameprofile = {"sv_frameprofile", "0"};
+cvar_t	sv_frameprofile_file = {"sv_frameprofile_file", ""};
+cvar_t	sv_frameprofile_interval = {"sv_frameprofile_interval", "60"};
+
+qbool SV_ProfileActive (void)
+{
+	return svprof.active;
+}
+
+void SV_ProfileEnter (svprof_stage_t stage)
+{
+	if (!svprof.active || svprof.depth[stage]++)
+		return;
+
+	svprof.start[stage] = Sys_DoubleTime ();
+}
+
+void SV_ProfileLeave (svprof_stage_t stage)
+{
+	if (!svprof.active || --svprof.depth[stage])
+		return;
+
+	svprof.frame[stage] += Sys_DoubleTime () - svprof.start[stage];
+}
+
+void SV_ProfileStartFrame (void)
+{
+	svprof.active = sv_frameprofile.value != 0;
+
+	// a Host_Error can leave a stage entered
+	memset (svprof.depth, 0, sizeof(svprof.depth));
+	memset (svprof.frame, 0, sizeof(svprof.frame));
+
+	SV_ProfileEnter (SVPROF_FRAME);
+}
+
+static int SV_ProfileCompare (const void *a, const void *b)
+{
+	float x = *(const float *)a, y = *(const float *)b;
+
+	return (x > y) - (x < y);
+}
+
+// stats over the last count frames, which must be recorded and no more than SVPROF_HISTORY
+static void SV_ProfileStats (int count, svprof_stats_t *stats)
+{
+	static float sorted[SVPROF_HISTORY];
+	unsigned int first = svprof.frames - count;
+	double sum;
+	int stage, i;
+
+	memset (stats, 0, SVPROF_MAX * sizeof(*stats));
+	if (count <= 0)
+		return;
+
+	for (stage = 0; stage < SVPROF_MAX; stage++) {
+		sum = 0;
+		for (i = 0; i < count; i++) {
+			sorted[i] = svprof.history[stage][(first + i) & (SVPROF_HISTORY - 1)];
+			sum += sorted[i];
+		}
+		qsort (sorted, count, sizeof(sorted[0]), SV_ProfileCompare);
+
+		// nearest rank
+		stats[stage].p50 = sorted[(count * 50 + 99) / 100 - 1];
+		stats[stage].p99 = sorted[(count * 99 + 99) / 100 - 1];
+		stats[stage].max = sorted[count - 1];
+		stats[stage].mean = sum / count;
+	}
+}
+
+static void SV_ProfileDump (void)
+{
+	extern cvar_t sv_logdir;
+	svprof_stats_t stats[SVPROF_MAX];
+	char name[MAX_OSPATH], mapname[sizeof(sv.mapname)];
+	int count, clients, i;
+	FILE *f;
+
+	count = min (svprof.frames - svprof.dumpframes, SVPROF_HISTORY);
+	svprof.dumpframes = svprof.frames;
+	if (count <= 0)
+		return;
+
+	snprintf (name, sizeof(name), "%s/%s", sv_logdir.string, sv_frameprofile_file.string);
+	if (!(f = fopen (name, "a"))) {
+		Con_Printf ("Can't open %s, frame profile dump turned off\n", name);
+		Cvar_Set (&sv_frameprofile_file, "");
+		return;
+	}
+
+	for (i = clients = 0; i < MAX_CLIENTS; i++) {
+		if (svs.clients[i].state == cs_spawned)
+			clients++;
+	}
+
+	SV_ProfileStats (count, stats);
+
+	// keep it valid json whatever the map is called
+	strlcpy (mapname, sv.mapname, sizeof(mapname));
+	for (i = 0; mapname[i]; i++) {
+		if (mapname[i] == '"' || mapname[i] == '\\' || (unsigned char)mapname[i] < ' ')
+			mapname[i] = '_';
+	}
+
+	// one JSON object per line, times in milliseconds
+	fprintf (f, "{\"time\":%lu,\"port\":%d,\"map\":\"%s\",\"clients\":%d,\"frames\":%d,\"stages\":{",
+		(unsigned long) time (NULL), NET_UDPSVPort (), mapname, clients, count);
+	for (i = 0; i < SVPROF_MAX; i++) {
+		fprintf (f, "%s\"%s\":{\"p50\":%.3f,\"p99\":%.3f,\"max\":%.3f,\"mean\":%.3f}",
+			i ? "," : "", svprof_names[i], stats[i].p50, stats[i].p99, stats[i].max, stats[i].mean);
+	}
+	fprintf (f, "}}\n");
+	fclose (f);
+}
+
+void SV_ProfileEndFrame (void)
+{
+	unsigned int slot = svprof.frames & (SVPROF_HISTORY - 1);
+	int stage;
+
+	if (!svprof.active)
+		return;
+
+	SV_ProfileLeave (SVPROF_FRAME);
+
+	for (stage = 0; stage < SVPROF_MAX; stage++)
+		svprof.history[stage][slot] = svprof.frame[stage] * 1000;
+	svprof.frames++;
+
+	if (sv_frameprofile_file.string[0] && realtime - svprof.lastdump >= max (1, sv_frameprofile_interval.value)) {
+		svprof.lastdump = realtime;
+		SV_ProfileDump ();
+	}
+}
+
+/*
+==================
+SV_FrameProfile_f
+
+Prints the percentiles over the frames kept, also through rcon.
+==================
+*/
+static void SV_FrameProfile_f (void)
+{
+	svprof_stats_t stats[SVPROF_MAX];
+	int count, i;
+
+	if (Cmd_Argc () > 1 && !strcmp (Cmd_Argv (1), "reset")) {
+		svprof.frames = svprof.dumpframes = 0;
+		Con_Printf ("Frame profile cleared\n");
+		return;
+	}
+
+	if (!sv_frameprofile.value)
+		Con_Printf ("sv_frameprofile is 0, showing what was recorded before\n");
+
+	count = min (svprof.frames, SVPROF_HISTORY);
+	if (!count) {
+		Con_Printf ("No frames recorded\n");
+		return;
+	}
+
+	SV_ProfileStats (count, stats);
+
+	Con_Printf ("last %d frames, ms     p50      p99      max     mean\n", count);
+	for (i = 0; i < SVPROF_MAX; i++) {
+		Con_Printf ("%-16s %8.3f %8.3f %8.3f %8.3f\n", svprof_names[i],
+			stats[i].p50, stats[i].p99, stats[i].max, stats[i].mean);
+	}
+}
+
+void SV_ProfileInit (void)
+{
+	Cvar_Register (&sv_frameprofile);
+	Cvar_Register (&sv_frameprofile_file);
+	Cvar_Register (&sv_frameprofile_interval);
+
+	Cmd_AddCommand ("frameprofile", SV_FrameProfile_f);
+}
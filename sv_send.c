@@ -914,7 +914,9 @@ void SV_SendClientDatagram (client_t *client, int client_num)
 		// send over all the objects that are in the PVS
 		// this will include clients, a packetentities, and
 		// possibly a nails update
+		SV_ProfileEnter (SVPROF_ENTITIES);
 		SV_WriteEntitiesToClient(client, &msg, false);
+		SV_ProfileLeave (SVPROF_ENTITIES);
 
 #ifdef FTE_PEXT2_VOICECHAT
 		SV_VoiceSendPacket(client, &msg);
@@ -1324,7 +1326,9 @@ void SV_SendDemoMessage(void)
 	if (!demo.recorder.delta_sequence)
 		demo.recorder.delta_sequence = -1;
 
+	SV_ProfileEnter (SVPROF_ENTITIES);
 	SV_WriteEntitiesToClient (&demo.recorder, &msg, true);
+	SV_ProfileLeave (SVPROF_ENTITIES);
 
 	if (msg.overflowed)
 	{
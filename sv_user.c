@@ -36,6 +36,7 @@ cvar_t	sv_kickuserinfospamtime = {"sv_kickuserinfospamtime", "3"};
 cvar_t	sv_kickuserinfospamcount = {"sv_kickuserinfospamcount", "30"};
 
 cvar_t	sv_maxuploadsize = {"sv_maxuploadsize", "1048576"};
+cvar_t	sv_download_cache = {"sv_download_cache", "32"}; // megabytes of downloadable files shared between clients
 
 #ifdef FTE_PEXT_CHUNKEDDOWNLOADS
 cvar_t  sv_downloadchunksperframe = {"sv_downloadchunksperframe", "2"};
@@ -1029,6 +1030,281 @@ void SV_CompleteDownoload(void)
 }
 
 
+/*
+==================
+Download cache
+
+Files being downloaded are loaded once (mapped when possible) and shared
+between all clients fetching them, so N clients on the same map don't
+keep N file handles around or seek/read the disk for every chunk.
+==================
+*/
+
+#define SV_DLCACHE_IDLE		60	// seconds an unused file stays cached
+
+typedef struct sv_dlcache_s {
+	char					name[MAX_OSPATH];
+	vfsfile_t				*vfs;			// owns the mapping, NULL when copied
+	byte					*copy;			// heap copy when the file couldn't be mapped
+	const byte				*data;
+	int						len;
+	qbool					copyprotected;
+	qbool					stale;			// file changed on disk, freed with the last reference
+	int						refcount;
+	double					lastused;
+	struct sv_dlcache_s		*next;
+} sv_dlcache_t;
+
+typedef struct {
+	vfsfile_t		funcs; // <= must be at top/begining of struct
+
+	sv_dlcache_t	*entry;
+	unsigned long	position;
+} vfsdlcache_t;
+
+static sv_dlcache_t *sv_dlcache;
+static int sv_dlcache_size;
+
+static void SV_DownloadCache_Free(sv_dlcache_t *entry)
+{
+	sv_dlcache_t **link;
+
+	for (link = &sv_dlcache; *link; link = &(*link)->next)
+	{
+		if (*link == entry)
+		{
+			*link = entry->next;
+			break;
+		}
+	}
+
+	if (!entry->stale)
+		sv_dlcache_size -= entry->len;
+
+	if (entry->vfs)
+		VFS_CLOSE(entry->vfs);
+	Q_free(entry->copy);
+	Q_free(entry);
+}
+
+// Files in use are only freed with their last reference, they can't be found anymore though.
+static void SV_DownloadCache_Drop(sv_dlcache_t *entry)
+{
+	if (!entry->refcount)
+	{
+		SV_DownloadCache_Free(entry);
+		return;
+	}
+
+	if (!entry->stale)
+		sv_dlcache_size -= entry->len;
+	entry->stale = true;
+	entry->name[0] = 0;
+}
+
+// Drops entries that idled for too long, or all of them if force is set.
+void SV_DownloadCache_Flush(qbool force)
+{
+	sv_dlcache_t *entry, *next;
+
+	for (entry = sv_dlcache; entry; entry = next)
+	{
+		next = entry->next;
+		if (force || (!entry->refcount && entry->lastused + SV_DLCACHE_IDLE < realtime))
+			SV_DownloadCache_Drop(entry);
+	}
+}
+
+// Makes room for len bytes by evicting the least recently used unreferenced files.
+static qbool SV_DownloadCache_Reserve(int len)
+{
+	int limit = (int)(bound(0, sv_download_cache.value, 1024) * 1024 * 1024);
+	sv_dlcache_t *entry, *oldest;
+
+	if (len > limit)
+		return false;
+
+	while (sv_dlcache_size + len > limit)
+	{
+		oldest = NULL;
+		for (entry = sv_dlcache; entry; entry = entry->next)
+			if (!entry->refcount && (!oldest || entry->lastused < oldest->lastused))
+				oldest = entry;
+
+		if (!oldest)
+			return false; // everything is in use
+		SV_DownloadCache_Free(oldest);
+	}
+
+	return true;
+}
+
+static void SV_DownloadCache_Release(sv_dlcache_t *entry)
+{
+	entry->lastused = realtime;
+	if (--entry->refcount <= 0 && entry->stale)
+		SV_DownloadCache_Free(entry);
+}
+
+static int VFSDLCACHE_ReadBytes(vfsfile_t *file, void *buffer, int bytestoread, vfserrno_t *err)
+{
+	vfsdlcache_t *intfile = (vfsdlcache_t *)file;
+	int len = intfile->entry->len;
+
+	if (bytestoread < 0 || intfile->position >= len)
+		bytestoread = 0;
+	else if (bytestoread > len - intfile->position)
+		bytestoread = len - intfile->position;
+
+	memcpy(buffer, intfile->entry->data + intfile->position, bytestoread);
+	intfile->position += bytestoread;
+
+	if (err)
+		*err = (intfile->position >= len) ? VFSERR_EOF : VFSERR_NONE;
+
+	return bytestoread;
+}
+
+static int VFSDLCACHE_WriteBytes(vfsfile_t *file, const void *buffer, int bytestowrite)
+{
+	return 0;
+}
+
+static int VFSDLCACHE_Seek(vfsfile_t *file, unsigned long offset, int whence)
+{
+	vfsdlcache_t *intfile = (vfsdlcache_t *)file;
+	unsigned long pos;
+
+	switch (whence)
+	{
+		case SEEK_SET: pos = offset; break;
+		case SEEK_CUR: pos = intfile->position + offset; break;
+		case SEEK_END: pos = intfile->entry->len + offset; break;
+		default: return -1;
+	}
+
+	if (pos > intfile->entry->len)
+		return -1;
+
+	intfile->position = pos;
+	return 0;
+}
+
+static unsigned long VFSDLCACHE_Tell(vfsfile_t *file)
+{
+	return ((vfsdlcache_t *)file)->position;
+}
+
+static unsigned long VFSDLCACHE_GetLen(vfsfile_t *file)
+{
+	return ((vfsdlcache_t *)file)->entry->len;
+}
+
+static const byte *VFSDLCACHE_Map(vfsfile_t *file)
+{
+	return ((vfsdlcache_t *)file)->entry->data;
+}
+
+static void VFSDLCACHE_Flush(vfsfile_t *file)
+{
+}
+
+static void VFSDLCACHE_Close(vfsfile_t *file)
+{
+	SV_DownloadCache_Release(((vfsdlcache_t *)file)->entry);
+	Q_free(file);
+}
+
+static vfsfile_t *SV_DownloadCache_NewVFS(sv_dlcache_t *entry)
+{
+	vfsdlcache_t *file = Q_calloc(1, sizeof(*file));
+
+	file->entry               = entry;
+	file->funcs.ReadBytes     = VFSDLCACHE_ReadBytes;
+	file->funcs.WriteBytes    = VFSDLCACHE_WriteBytes;
+	file->funcs.Seek          = VFSDLCACHE_Seek;
+	file->funcs.Tell          = VFSDLCACHE_Tell;
+	file->funcs.GetLen        = VFSDLCACHE_GetLen;
+	file->funcs.Close         = VFSDLCACHE_Close;
+	file->funcs.Flush         = VFSDLCACHE_Flush;
+	file->funcs.Map           = VFSDLCACHE_Map;
+	file->funcs.copyprotected = entry->copyprotected;
+
+	entry->refcount++;
+	entry->lastused = realtime;
+
+	return (vfsfile_t *)file;
+}
+
+// Opens a file for download, served from the cache when it's small enough.
+// Falls back to the plain file when the cache is disabled or full.
+static vfsfile_t *SV_DownloadCache_Open(const char *name, relativeto_t relativeto)
+{
+	vfsfile_t *raw;
+	sv_dlcache_t *entry;
+	vfserrno_t err;
+	int len;
+
+	if (!(raw = FS_OpenVFS(name, "rb", relativeto)))
+		return NULL;
+
+	SV_DownloadCache_Flush(false);
+
+	if (!sv_download_cache.value)
+		return raw;
+
+	len = VFS_GETLEN(raw);
+
+	for (entry = sv_dlcache; entry; entry = entry->next)
+	{
+		if (strcmp(entry->name, name))
+			continue;
+
+		if (entry->len == len && entry->copyprotected == VFS_COPYPROTECTED(raw))
+		{
+			VFS_CLOSE(raw);
+			return SV_DownloadCache_NewVFS(entry);
+		}
+
+		// the file was replaced, let current downloads finish with the old data
+		SV_DownloadCache_Drop(entry);
+		break;
+	}
+
+	if (len <= 0 || !SV_DownloadCache_Reserve(len))
+		return raw;
+
+	entry = Q_calloc(1, sizeof(*entry));
+	strlcpy(entry->name, name, sizeof(entry->name));
+	entry->len = len;
+	entry->copyprotected = VFS_COPYPROTECTED(raw);
+
+	if ((entry->data = VFS_MAP(raw)))
+	{
+		// keep the file open, it owns the mapping
+		entry->vfs = raw;
+	}
+	else
+	{
+		entry->copy = Q_malloc(len);
+		if (VFS_READ(raw, entry->copy, len, &err) != len)
+		{
+			Q_free(entry->copy);
+			Q_free(entry);
+			VFS_SEEK(raw, 0, SEEK_SET);
+			return raw;
+		}
+		VFS_CLOSE(raw);
+		entry->data = entry->copy;
+	}
+
+	entry->next = sv_dlcache;
+	sv_dlcache = entry;
+	sv_dlcache_size += len;
+
+	return SV_DownloadCache_NewVFS(entry);
+}
+
 /*
 ==================
 Cmd_NextDownload_f
@@ -1038,11 +1314,19 @@ Cmd_NextDownload_f
 #ifdef FTE_PEXT_CHUNKEDDOWNLOADS
 
 // qqshka: percent is optional, u can't relay on it
+//
+// Clients which append their window size keep up to that many chunk requests
+// in flight and ask again for whatever got lost, so instead of the fixed
+// per-frame limit their chunks are paced by drate and the excess is dropped.
 
-void SV_NextChunkedDownload(int chunknum, int percent, int chunked_download_number)
-{
 #define CHUNKSIZE 1024
+#define SV_DOWNLOAD_MAXWINDOW	64		// max chunks per frame for a windowed client
+#define SV_DOWNLOAD_BURST		0.05	// seconds worth of drate which may be sent at once
+
+void SV_NextChunkedDownload(int chunknum, int percent, int chunked_download_number, int window)
+{
 	char buffer[CHUNKSIZE];
+	const byte *mapped;
 	int i;
 
 	sv_client->file_percent = bound(0, percent, 100); //bliP: file percent
@@ -1053,7 +1337,19 @@ void SV_NextChunkedDownload(int chunknum, int percent, int chunked_download_numb
 		return;
 	}
 
-	if (sv_client->download_chunks_perframe)
+	if (window > 0)
+	{
+		if (sv_client->download_chunks_perframe >= min(window, SV_DOWNLOAD_MAXWINDOW))
+			return;
+		if (sv_client->download_chunks_perframe && chunked_download_number < 1)
+			return;
+
+		if (sv_client->download_cleartime < curtime)
+			sv_client->download_cleartime = curtime;
+		if (sv_client->download_cleartime > curtime + SV_DOWNLOAD_BURST)
+			return; // over drate, client will ask again
+	}
+	else if (sv_client->download_chunks_perframe)
 	{
 		int maxchunks = bound(1, (int)sv_downloadchunksperframe.value, 4);
 		// too much requests or client sent something wrong
@@ -1065,15 +1361,27 @@ void SV_NextChunkedDownload(int chunknum, int percent, int chunked_download_numb
 		if (sv_client->datagram.cursize + CHUNKSIZE+5+50 > sv_client->datagram.maxsize)
 			return;	//choked!
 
-	if (VFS_SEEK(sv_client->download, chunknum*CHUNKSIZE, SEEK_SET))
-		return; // FIXME: ERROR of some kind
+	if (chunknum >= (sv_client->downloadsize + CHUNKSIZE - 1) / CHUNKSIZE)
+		return; // past the end of file
+
+	if ((mapped = VFS_MAP(sv_client->download)))
+	{
+		i = min(CHUNKSIZE, sv_client->downloadsize - chunknum*CHUNKSIZE);
+		memcpy(buffer, mapped + chunknum*CHUNKSIZE, i);
+	}
+	else
+	{
+		if (VFS_SEEK(sv_client->download, chunknum*CHUNKSIZE, SEEK_SET))
+			return; // FIXME: ERROR of some kind
 
-	i = VFS_READ(sv_client->download, buffer, CHUNKSIZE, NULL);
+		i = VFS_READ(sv_client->download, buffer, CHUNKSIZE, NULL);
+	}
 
 	if (i > 0)
 	{
 		byte data[1+ (sizeof("\\chunk")-1) + 4 + 1 + 4 + CHUNKSIZE]; // byte + (sizeof("\\chunk")-1) + long + byte + long + CHUNKSIZE
 		sizebuf_t *msg, msg_oob;
+		int start;
 
 		if (sv_client->download_chunks_perframe)
 		{
@@ -1088,6 +1396,9 @@ void SV_NextChunkedDownload(int chunknum, int percent, int chunked_download_numb
 		else
 			msg = &sv_client->datagram;
 
+		// the datagram may hold other things already, an out of band packet is all ours
+		start = (msg == &msg_oob) ? 0 : msg->cursize;
+
 		if (i != CHUNKSIZE)
 			memset(buffer+i, 0, CHUNKSIZE-i);
 
@@ -1096,7 +1407,12 @@ void SV_NextChunkedDownload(int chunknum, int percent, int chunked_download_numb
 		SZ_Write(msg, buffer, CHUNKSIZE);
 
 		if (sv_client->download_chunks_perframe)
+		{
 			Netchan_OutOfBand (NS_SERVER, sv_client->netchan.remote_address, msg->cursize, msg->data);
+			start -= 8; // a packet of its own, charge its header too
+		}
+
+		sv_client->download_cleartime += (msg->cursize - start) * sv_client->netchan.rate;
 	}
 	else {
 		; // FIXME: EOF/READ ERROR
@@ -1121,7 +1437,7 @@ static void Cmd_NextDownload_f (void)
 #ifdef FTE_PEXT_CHUNKEDDOWNLOADS
 	if (sv_client->fteprotocolextensions & FTE_PEXT_CHUNKEDDOWNLOADS)
 	{
-		SV_NextChunkedDownload(atoi(Cmd_Argv(1)), atoi(Cmd_Argv(2)), atoi(Cmd_Argv(3)));
+		SV_NextChunkedDownload(atoi(Cmd_Argv(1)), atoi(Cmd_Argv(2)), atoi(Cmd_Argv(3)), Cmd_Argc() > 4 ? atoi(Cmd_Argv(4)) : 0);
 		return;
 	}
 #endif
@@ -1447,9 +1763,9 @@ static void Cmd_Download_f(void)
 #define CLIENT_DOWNLOAD_RELATIVE_BASE FS_BASE
 #endif
 
-	sv_client->download = FS_OpenVFS(name, "rb", CLIENT_DOWNLOAD_RELATIVE_BASE);
+	sv_client->download = SV_DownloadCache_Open(name, CLIENT_DOWNLOAD_RELATIVE_BASE);
 	if (!sv_client->download && alternative_path[0]) {
-		sv_client->download = FS_OpenVFS(alternative_path, "rb", CLIENT_DOWNLOAD_RELATIVE_BASE);
+		sv_client->download = SV_DownloadCache_Open(alternative_path, CLIENT_DOWNLOAD_RELATIVE_BASE);
 	}
 	if (sv_client->download) {
 		sv_client->downloadsize = VFS_GETLEN(sv_client->download);
@@ -4026,6 +4342,7 @@ void SV_UserInit (void)
 	Cvar_Register (&sv_kickuserinfospamtime);
 	Cvar_Register (&sv_kickuserinfospamcount);
 	Cvar_Register (&sv_maxuploadsize);
+	Cvar_Register (&sv_download_cache);
 #ifdef FTE_PEXT_CHUNKEDDOWNLOADS
 	Cvar_Register (&sv_downloadchunksperframe);
 #endif
@@ -150,6 +150,318 @@ static world_t w;
 areanode_t sv_areanodes[AREA_NODES];
 int sv_numareanodes;
 
+/*
+===============================================================================
+
+TRIGGER GRID
+
+Triggers are also bucketed on a uniform XY grid, with a copy of their abs
+box in every cell they cover, so SV_TouchLinks only looks at the few triggers
+around the mover instead of every trigger list down the area nodes.
+
+===============================================================================
+*/
+
+#define	TRIGGERGRID_SIZE	64		// cells per axis at most
+#define	TRIGGERGRID_MINCELL	128		// smallest cell edge
+#define	TRIGGERGRID_MAXSPAN	32		// triggers covering more cells go on the big list
+
+typedef struct
+{
+	vec3_t		mins, maxs;			// abs box at link time
+	edict_t		*ent;
+} triggerbox_t;
+
+typedef struct
+{
+	triggerbox_t	*boxes;
+	int				numboxes, maxboxes;
+} triggercell_t;
+
+typedef struct
+{
+	qbool		linked;
+	qbool		big;
+	int			x0, y0, x1, y1;		// covered cells, inclusive
+} triggerlink_t;
+
+typedef struct
+{
+	float			origin[2];
+	float			cellsize[2];
+	triggercell_t	cells[TRIGGERGRID_SIZE * TRIGGERGRID_SIZE];
+	triggercell_t	big;
+	triggerlink_t	links[MAX_EDICTS];
+
+	int				seen[MAX_EDICTS];	// SV_GridTriggers visit marks
+	int				visit;
+} triggergrid_t;
+
+static triggergrid_t tg;
+
+// touches already made this frame, for sv_touchdedup
+#define	TOUCHPAIRS			4096	// must be a power of two
+#define	TOUCHPAIRS_PROBE	16
+
+typedef struct
+{
+	int				gen;
+	unsigned short	trigger, other;
+} touchpair_t;
+
+static touchpair_t	touchpairs[TOUCHPAIRS];
+static int			touchgen;
+static double		touchframe;
+
+static int			touchdepth;		// SV_LinkEdict calls from inside touch functions
+
+cvar_t	sv_triggergrid = {"sv_triggergrid", "1"};
+cvar_t	sv_touchdedup = {"sv_touchdedup", "0"};
+
+static void SV_GridClear (void)
+{
+	int i;
+
+	for (i = 0; i < TRIGGERGRID_SIZE * TRIGGERGRID_SIZE; i++)
+		Q_free (tg.cells[i].boxes);
+	Q_free (tg.big.boxes);
+	memset (&tg, 0, sizeof(tg));
+
+	memset (touchpairs, 0, sizeof(touchpairs));
+	touchgen = 0;
+	touchframe = -1;
+	touchdepth = 0;	// a Host_Error may have left it raised
+}
+
+static void SV_GridInit (vec3_t mins, vec3_t maxs)
+{
+	int i;
+
+	SV_GridClear ();
+
+	for (i = 0; i < 2; i++) {
+		tg.origin[i] = mins[i];
+		tg.cellsize[i] = max (TRIGGERGRID_MINCELL, (maxs[i] - mins[i]) / TRIGGERGRID_SIZE);
+	}
+}
+
+static void SV_GridCellRange (const vec3_t mins, const vec3_t maxs, int *x0, int *y0, int *x1, int *y1)
+{
+	*x0 = (int) floor ((mins[0] - tg.origin[0]) / tg.cellsize[0]);
+	*y0 = (int) floor ((mins[1] - tg.origin[1]) / tg.cellsize[1]);
+	*x1 = (int) floor ((maxs[0] - tg.origin[0]) / tg.cellsize[0]);
+	*y1 = (int) floor ((maxs[1] - tg.origin[1]) / tg.cellsize[1]);
+
+	// anything out past the world lands in the border cells
+	*x0 = bound (0, *x0, TRIGGERGRID_SIZE - 1);
+	*y0 = bound (0, *y0, TRIGGERGRID_SIZE - 1);
+	*x1 = bound (0, *x1, TRIGGERGRID_SIZE - 1);
+	*y1 = bound (0, *y1, TRIGGERGRID_SIZE - 1);
+}
+
+static triggerbox_t *SV_GridFindBox (triggercell_t *cell, edict_t *ent)
+{
+	int i;
+
+	for (i = 0; i < cell->numboxes; i++) {
+		if (cell->boxes[i].ent == ent)
+			return &cell->boxes[i];
+	}
+
+	return NULL;
+}
+
+static void SV_GridAddBox (triggercell_t *cell, edict_t *ent)
+{
+	triggerbox_t *box;
+
+	if (cell->numboxes == cell->maxboxes) {
+		cell->maxboxes = max (8, cell->maxboxes * 2);
+		cell->boxes = (triggerbox_t *) Q_realloc (cell->boxes, cell->maxboxes * sizeof(triggerbox_t));
+	}
+
+	box = &cell->boxes[cell->numboxes++];
+	VectorCopy (ent->v.absmin, box->mins);
+	VectorCopy (ent->v.absmax, box->maxs);
+	box->ent = ent;
+}
+
+static void SV_GridRemoveBox (triggercell_t *cell, edict_t *ent)
+{
+	triggerbox_t *box = SV_GridFindBox (cell, ent);
+
+	if (box)
+		*box = cell->boxes[--cell->numboxes];
+}
+
+static void SV_GridUnlink (edict_t *ent)
+{
+	triggerlink_t *link = &tg.links[ent->e->entnum];
+	int x, y;
+
+	if (!link->linked)
+		return;
+
+	if (link->big) {
+		SV_GridRemoveBox (&tg.big, ent);
+	}
+	else {
+		for (y = link->y0; y <= link->y1; y++)
+			for (x = link->x0; x <= link->x1; x++)
+				SV_GridRemoveBox (&tg.cells[y * TRIGGERGRID_SIZE + x], ent);
+	}
+
+	link->linked = false;
+}
+
+/*
+===============
+SV_GridLinkTrigger
+
+A trigger that stays within the same cells only has its boxes refreshed.
+===============
+*/
+static void SV_GridLinkTrigger (edict_t *ent)
+{
+	triggerlink_t *link = &tg.links[ent->e->entnum];
+	triggerbox_t *box;
+	qbool big;
+	int x0, y0, x1, y1, x, y;
+
+	SV_GridCellRange (ent->v.absmin, ent->v.absmax, &x0, &y0, &x1, &y1);
+	big = (x1 - x0 + 1) * (y1 - y0 + 1) > TRIGGERGRID_MAXSPAN;
+
+	if (link->linked && link->big == big && (big || (link->x0 == x0 && link->y0 == y0 && link->x1 == x1 && link->y1 == y1))) {
+		if (big) {
+			if ((box = SV_GridFindBox (&tg.big, ent))) {
+				VectorCopy (ent->v.absmin, box->mins);
+				VectorCopy (ent->v.absmax, box->maxs);
+			}
+			return;
+		}
+
+		for (y = y0; y <= y1; y++) {
+			for (x = x0; x <= x1; x++) {
+				if ((box = SV_GridFindBox (&tg.cells[y * TRIGGERGRID_SIZE + x], ent))) {
+					VectorCopy (ent->v.absmin, box->mins);
+					VectorCopy (ent->v.absmax, box->maxs);
+				}
+			}
+		}
+		return;
+	}
+
+	SV_GridUnlink (ent);
+
+	if (big) {
+		SV_GridAddBox (&tg.big, ent);
+	}
+	else {
+		for (y = y0; y <= y1; y++)
+			for (x = x0; x <= x1; x++)
+				SV_GridAddBox (&tg.cells[y * TRIGGERGRID_SIZE + x], ent);
+	}
+
+	link->linked = true;
+	link->big = big;
+	link->x0 = x0;
+	link->y0 = y0;
+	link->x1 = x1;
+	link->y1 = y1;
+}
+
+static int SV_GridCheckCell (const triggercell_t *cell, const vec3_t mins, const vec3_t maxs, edict_t **edicts, int count, int max_edicts)
+{
+	const triggerbox_t *box;
+	int i, num;
+
+	for (i = 0, box = cell->boxes; i < cell->numboxes && count < max_edicts; i++, box++) {
+		num = box->ent->e->entnum;
+		if (tg.seen[num] == tg.visit)
+			continue;
+		tg.seen[num] = tg.visit;
+
+		if (mins[0] > box->maxs[0]
+					 || mins[1] > box->maxs[1]
+					 || mins[2] > box->maxs[2]
+					 || maxs[0] < box->mins[0]
+					 || maxs[1] < box->mins[1]
+					 || maxs[2] < box->mins[2])
+			continue;
+
+		edicts[count++] = box->ent;
+	}
+
+	return count;
+}
+
+/*
+====================
+SV_GridTriggers
+
+Same as SV_AreaEdicts with AREA_TRIGGERS, but from the grid, in edict order.
+====================
+*/
+static int SV_GridTriggers (const vec3_t mins, const vec3_t maxs, edict_t **edicts, int max_edicts)
+{
+	int x0, y0, x1, y1, x, y, i, j, count;
+	edict_t *ent;
+
+	if (++tg.visit == 0) {
+		memset (tg.seen, 0, sizeof(tg.seen));
+		tg.visit = 1;
+	}
+
+	count = SV_GridCheckCell (&tg.big, mins, maxs, edicts, 0, max_edicts);
+
+	SV_GridCellRange (mins, maxs, &x0, &y0, &x1, &y1);
+	for (y = y0; y <= y1; y++)
+		for (x = x0; x <= x1; x++)
+			count = SV_GridCheckCell (&tg.cells[y * TRIGGERGRID_SIZE + x], mins, maxs, edicts, count, max_edicts);
+
+	// usually a handful, insertion sort is fine
+	for (i = 1; i < count; i++) {
+		ent = edicts[i];
+		for (j = i; j > 0 && edicts[j - 1]->e->entnum > ent->e->entnum; j--)
+			edicts[j] = edicts[j - 1];
+		edicts[j] = ent;
+	}
+
+	return count;
+}
+
+// returns true if trigger already touched other since the frame began
+static qbool SV_TouchedThisFrame (int trigger, int other)
+{
+	touchpair_t *pair;
+	unsigned int h;
+	int i;
+
+	if (touchframe != realtime) {
+		touchframe = realtime;
+		if (++touchgen == 0) {
+			memset (touchpairs, 0, sizeof(touchpairs));
+			touchgen = 1;
+		}
+	}
+
+	h = ((unsigned int)trigger * 2654435761u) ^ ((unsigned int)other * 40503u);
+	for (i = 0; i < TOUCHPAIRS_PROBE; i++, h++) {
+		pair = &touchpairs[h & (TOUCHPAIRS - 1)];
+		if (pair->gen != touchgen) {
+			pair->gen = touchgen;
+			pair->trigger = trigger;
+			pair->other = other;
+			return false;
+		}
+		if (pair->trigger == trigger && pair->other == other)
+			return true;
+	}
+
+	return false;	// crowded, let it through
+}
+
+
 /*
 ===============
 SV_CreateAreaNode
@@ -204,6 +516,7 @@ void SV_ClearWorld (void)
 	memset (sv_areanodes, 0, sizeof(sv_areanodes));
 	sv_numareanodes = 0;
 	SV_CreateAreaNode (0, sv.worldmodel->mins, sv.worldmodel->maxs);
+	SV_GridInit (sv.worldmodel->mins, sv.worldmodel->maxs);
 }
 
 
@@ -214,6 +527,8 @@ SV_UnlinkEdict
 */
 void SV_UnlinkEdict (edict_t *ent)
 {
+	SV_GridUnlink (ent);
+
 	if (!ent->e->area.prev)
 		return;		// not linked in anywhere
 	RemoveLink (&ent->e->area);
@@ -294,13 +609,16 @@ checkstack:
 SV_TouchLinks
 ====================
 */
-static void SV_TouchLinks ( edict_t *ent, areanode_t *node )
+static void SV_TouchLinks (edict_t *ent)
 {
 	int			i, numtouch;
 	edict_t		*touchlist[MAX_EDICTS], *touch;
 	int			old_self, old_other;
 
-	numtouch = SV_AreaEdicts (ent->v.absmin, ent->v.absmax, touchlist, sv.max_edicts, AREA_TRIGGERS);
+	if (sv_triggergrid.value)
+		numtouch = SV_GridTriggers (ent->v.absmin, ent->v.absmax, touchlist, sv.max_edicts);
+	else
+		numtouch = SV_AreaEdicts (ent->v.absmin, ent->v.absmax, touchlist, sv.max_edicts, AREA_TRIGGERS);
 
 // touch linked edicts
 	for (i = 0; i < numtouch; i++)
@@ -310,6 +628,8 @@ static void SV_TouchLinks ( edict_t *ent, areanode_t *node )
 			continue;
 		if (!touch->v.touch || touch->v.solid != SOLID_TRIGGER)
 			continue;
+		if (sv_touchdedup.value && SV_TouchedThisFrame (touch->e->entnum, ent->e->entnum))
+			continue;
 
 		old_self = pr_global_struct->self;
 		old_other = pr_global_struct->other;
@@ -318,6 +638,7 @@ static void SV_TouchLinks ( edict_t *ent, areanode_t *node )
 		pr_global_struct->other = EDICT_TO_PROG(ent);
 		pr_global_struct->time = sv.time;
 		PR_EdictTouch (touch->v.touch);
+		svs.stats.touches++;
 
 		pr_global_struct->self = old_self;
 		pr_global_struct->other = old_other;
@@ -352,14 +673,22 @@ void SV_LinkEdict (edict_t *ent, qbool touch_triggers)
 {
 	areanode_t	*node;
 	
+	double		start;
+
 	if (ent->e->area.prev)
-		SV_UnlinkEdict (ent);	// unlink from old position
+	{	// unlink from old position, the trigger grid is brought up to date below
+		RemoveLink (&ent->e->area);
+		ent->e->area.prev = ent->e->area.next = NULL;
+	}
 		
 	if (ent == sv.edicts)
 		return;		// don't add the world
 
 	if (ent->e->free)
+	{
+		SV_GridUnlink (ent);
 		return;
+	}
 
 // set the abs box
 	VectorAdd (ent->v.origin, ent->v.mins, ent->v.absmin);
@@ -394,7 +723,10 @@ void SV_LinkEdict (edict_t *ent, qbool touch_triggers)
 		ent->e->num_leafs = 0;
 
 	if (ent->v.solid == SOLID_NOT)
+	{
+		SV_GridUnlink (ent);
 		return;
+	}
 
 // find the first node that the ent's box crosses
 	node = sv_areanodes;
@@ -413,13 +745,32 @@ void SV_LinkEdict (edict_t *ent, qbool touch_triggers)
 // link it in	
 
 	if (ent->v.solid == SOLID_TRIGGER)
+	{
 		InsertLinkBefore (&ent->e->area, &node->trigger_edicts);
+		SV_GridLinkTrigger (ent);
+	}
 	else
+	{
 		InsertLinkBefore (&ent->e->area, &node->solid_edicts);
+		SV_GridUnlink (ent);
+	}
 	
 // if touch_triggers, touch all entities at this node and decend for more
 	if (touch_triggers)
-		SV_TouchLinks ( ent, sv_areanodes );
+	{
+		// touch functions may link again, only the outermost call is timed
+		if (!touchdepth++)
+		{
+			start = Sys_DoubleTime ();
+			SV_TouchLinks (ent);
+			svs.stats.touch += Sys_DoubleTime () - start;
+		}
+		else
+		{
+			SV_TouchLinks (ent);
+		}
+		touchdepth--;
+	}
 }
 
 
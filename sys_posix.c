@@ -113,6 +113,7 @@ void Sys_Error(char *error, ...)
 	vsnprintf (string, sizeof(string), error, argptr);
 	va_end (argptr);
 	fprintf(stderr, "Error: %s\n", string);
+	Con_FlushLog();
 	if (qconsole_log)
 		fprintf(qconsole_log, "Error: %s\n", string);
 
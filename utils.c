@@ -142,11 +142,19 @@ int StringToRGB_W(char *s, byte *rgb)
 	rgb[0] = rgb[1] = rgb[2] = rgb[3] = 255;
 
 	strlcpy(buf, s, sizeof(buf));
-	result = strtok(buf, " ");
 
-	for (i = 0; i < 4 && result; i++, result = strtok(NULL, " "))
+	// no strtok, entities are linked on a thread and pick their colours here
+	for (i = 0, result = buf; i < 4; i++)
 	{
+		while (*result == ' ')
+			result++;
+		if (!*result)
+			break;
+
 		rgb[i] = (byte) Q_atoi(result);
+
+		while (*result && *result != ' ')
+			result++;
 	}
 
 	// TODO: Ok to do this in software also?
@@ -72,6 +72,8 @@ typedef struct searchpath_s
 } searchpath_t;
 
 
+vfsfile_t *FS_OpenArchiveEntryVFS(searchpathfuncs_t *funcs, vfsfile_t *raw, const char *archive, const char *inside);
+
 #ifdef WITH_VFS_ARCHIVE_LOADING
 int FS_BreakUpArchivePath(const char *filename, 
 		char *archive, size_t archive_len,
@@ -87,12 +89,16 @@ typedef struct {
 
 	FILE *handle;
 
+	byte *mapped;		// VFSOS_Map view of the file
+	size_t mapped_len;
+	void *mapping;		// win32 file mapping object
 } vfsosfile_t;
 
 vfsfile_t *FS_OpenTemp(void);
 vfsfile_t *VFSOS_Open(char *osname, char *mode);
 
 extern searchpathfuncs_t osfilefuncs;
+extern qbool vfsos_nommap;
 
 //====================
 // PACK (*pak) Support
@@ -132,8 +138,25 @@ vfsfile_t *FS_OpenTCP(char *name);
 //=====================
 #ifdef WITH_ZLIB
 searchpathfuncs_t gzipfilefuncs;
+vfsfile_t *FSGZIP_OpenBlockedVFS(vfsfile_t *raw, const char *desc);
 #endif // WITH_ZLIB
 
+// Blocked gzip: the data is stored as a sequence of independent gzip members
+// of GZIP_BLOCK_SIZE uncompressed bytes each, followed by an empty member whose
+// FEXTRA field ("EB") holds the offset of every block. The result is still
+// a plain gzip stream for any other reader, but lets us seek without inflating
+// everything in front of the wanted position.
+//
+// index member:  1f 8b 08 04 | mtime(4) xfl os | xlen(2) | 'E' 'B' len(2)
+//                block_size(4) blocks(4) total_len(4) ofs[blocks](4) index_ofs(4)
+//                | empty deflate (03 00) | crc32(4) isize(4)
+#define GZIP_BLOCK_SIZE			(1024 * 1024)
+#define GZIP_BLOCK_INDEX_ID1	'E'
+#define GZIP_BLOCK_INDEX_ID2	'B'
+#define GZIP_BLOCK_INDEX_HDR	10	// Fixed gzip member header.
+#define GZIP_BLOCK_INDEX_TRAILER	14	// index_ofs + empty deflate + crc32 + isize.
+#define GZIP_BLOCK_MAX_BLOCKS	((65535 - 4 - 16) / 4)	// Has to fit into a single FEXTRA subfield.
+
 //=====================
 // TAR (*.tar) Support
 //=====================
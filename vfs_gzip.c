@@ -45,6 +45,14 @@ typedef struct gzipfile_s
 	vfsfile_t *raw;
 
 	int references;
+
+	// Blocked gzip (see vfs.h), handle is unused in that case.
+	qbool blocked;
+	unsigned int block_size;
+	unsigned int blocks;
+	unsigned int *block_ofs;	// blocks + 1 entries, the last one is the start of the index.
+	byte *inbuf;				// Compressed block when the raw file can't be mapped.
+	unsigned int inbuf_size;
 } gzipfile_t;
 
 
@@ -57,8 +65,132 @@ typedef struct
 	unsigned long startpos;
 	unsigned long length;
 	unsigned long currentpos;
+
+	// Blocked gzip, one decompressed block is cached per open file.
+	z_stream zs;
+	byte *block;
+	int block_num;
+	unsigned int block_len;
 } vfsgzipfile_t;
 
+//
+// Blocked gzip.
+//
+static qbool VFSGZIP_LoadBlock(vfsgzipfile_t *vfsgz, int num)
+{
+	gzipfile_t *gzip = vfsgz->parent;
+	const byte *mapped, *in;
+	unsigned int in_len, out_len;
+	int r;
+
+	if (vfsgz->block_num == num)
+		return true;
+
+	vfsgz->block_num = -1;
+	in_len = gzip->block_ofs[num + 1] - gzip->block_ofs[num];
+	out_len = min(gzip->block_size, gzip->file.filelen - num * gzip->block_size);
+
+	if ((mapped = VFS_MAP(gzip->raw)))
+	{
+		in = mapped + gzip->block_ofs[num];
+	}
+	else
+	{
+		if (gzip->inbuf_size < in_len)
+		{
+			Q_free(gzip->inbuf);
+			gzip->inbuf = Q_malloc(in_len);
+			gzip->inbuf_size = in_len;
+		}
+
+		if (VFS_SEEK(gzip->raw, gzip->block_ofs[num], SEEK_SET)
+			|| VFS_READ(gzip->raw, gzip->inbuf, in_len, NULL) != in_len)
+			return false;
+
+		in = gzip->inbuf;
+	}
+
+	inflateReset(&vfsgz->zs);
+	vfsgz->zs.next_in   = (Bytef *) in;
+	vfsgz->zs.avail_in  = in_len;
+	vfsgz->zs.next_out  = vfsgz->block;
+	vfsgz->zs.avail_out = out_len;
+
+	r = inflate(&vfsgz->zs, Z_FINISH);
+	if (r != Z_STREAM_END || vfsgz->zs.avail_out)
+	{
+		Com_Printf("Can't extract block %d of \"%s\" (corrupt)\n", num, gzip->filename);
+		return false;
+	}
+
+	vfsgz->block_num = num;
+	vfsgz->block_len = out_len;
+	return true;
+}
+
+static int VFSGZIP_ReadBlocked(vfsfile_t *file, void *buffer, int bytestoread, vfserrno_t *err)
+{
+	vfsgzipfile_t *vfsgz = (vfsgzipfile_t *)file;
+	gzipfile_t *gzip = vfsgz->parent;
+	byte *out = (byte *) buffer;
+	int r = 0;
+
+	if (bytestoread < 0)
+		Sys_Error("VFSGZIP_ReadBlocked: bytestoread < 0");
+
+	while (bytestoread > 0 && vfsgz->currentpos < gzip->file.filelen)
+	{
+		unsigned int ofs = vfsgz->currentpos % gzip->block_size;
+		int len;
+
+		if (!VFSGZIP_LoadBlock(vfsgz, vfsgz->currentpos / gzip->block_size))
+			break;
+
+		len = min(bytestoread, (int)(vfsgz->block_len - ofs));
+		memcpy(out, vfsgz->block + ofs, len);
+
+		out += len;
+		r += len;
+		bytestoread -= len;
+		vfsgz->currentpos += len;
+	}
+
+	if (err)
+		*err = ((r || bytestoread <= 0) ? VFSERR_NONE : VFSERR_EOF);
+
+	return r;
+}
+
+static int VFSGZIP_SeekBlocked(vfsfile_t *file, unsigned long offset, int whence)
+{
+	vfsgzipfile_t *vfsgz = (vfsgzipfile_t *)file;
+	unsigned long len = vfsgz->parent->file.filelen;
+
+	switch (whence)
+	{
+	case SEEK_SET: break;
+	case SEEK_CUR: offset += vfsgz->currentpos; break;
+	case SEEK_END: offset += len; break;
+	default: return -1;
+	}
+
+	if (offset > len)
+		return -1;
+
+	vfsgz->currentpos = offset;
+	return 0;
+}
+
+static unsigned long VFSGZIP_TellBlocked(vfsfile_t *file)
+{
+	return ((vfsgzipfile_t *)file)->currentpos;
+}
+
+static unsigned long VFSGZIP_GetLenBlocked(vfsfile_t *file)
+{
+	return ((vfsgzipfile_t *)file)->parent->file.filelen;
+}
+
 // FIXME:
 // Everything below assumes that the input file was an OS file
 // This may not be the case if we are opening a gz file in a gz file...
@@ -137,7 +269,14 @@ static void VFSGZIP_Close(vfsfile_t *file)
 {
 	vfsgzipfile_t *vfsgz = (vfsgzipfile_t *)file;
 
+	if (vfsgz->parent->blocked)
+	{
+		inflateEnd(&vfsgz->zs);
+		Q_free(vfsgz->block);
+	}
+
 	FSGZIP_ClosePath(vfsgz->parent);
+	Q_free(vfsgz);
 }
 
 static void VFSGZIP_Flush(vfsfile_t *file) 
@@ -164,13 +303,35 @@ static vfsfile_t *FSGZIP_OpenVFS(void *handle, flocation_t *loc, char *mode)
 	vfsgz->length     = loc->len;
 	vfsgz->currentpos = vfsgz->startpos;
 
-	vfsgz->funcs.ReadBytes  = strcmp(mode, "rb") ? NULL : VFSGZIP_ReadBytes;
-	vfsgz->funcs.WriteBytes = strcmp(mode, "wb") ? NULL : VFSGZIP_WriteBytes;
-	vfsgz->funcs.Seek       = VFSGZIP_Seek;
-	vfsgz->funcs.Tell       = VFSGZIP_Tell;
-	vfsgz->funcs.GetLen     = VFSGZIP_GetLen;
-	vfsgz->funcs.Close      = VFSGZIP_Close;
-	vfsgz->funcs.Flush      = VFSGZIP_Flush;
+	if (gzip->blocked)
+	{
+		vfsgz->currentpos = 0;
+		vfsgz->block_num  = -1;
+		vfsgz->block      = Q_malloc(gzip->block_size);
+		if (inflateInit2(&vfsgz->zs, 15 + 16) != Z_OK)
+		{
+			Q_free(vfsgz->block);
+			Q_free(vfsgz);
+			gzip->references--;
+			return NULL;
+		}
+
+		vfsgz->funcs.ReadBytes  = VFSGZIP_ReadBlocked;
+		vfsgz->funcs.Seek       = VFSGZIP_SeekBlocked;
+		vfsgz->funcs.Tell       = VFSGZIP_TellBlocked;
+		vfsgz->funcs.GetLen     = VFSGZIP_GetLenBlocked;
+		vfsgz->funcs.Close      = VFSGZIP_Close;
+	}
+	else
+	{
+		vfsgz->funcs.ReadBytes  = strcmp(mode, "rb") ? NULL : VFSGZIP_ReadBytes;
+		vfsgz->funcs.WriteBytes = strcmp(mode, "wb") ? NULL : VFSGZIP_WriteBytes;
+		vfsgz->funcs.Seek       = VFSGZIP_Seek;
+		vfsgz->funcs.Tell       = VFSGZIP_Tell;
+		vfsgz->funcs.GetLen     = VFSGZIP_GetLen;
+		vfsgz->funcs.Close      = VFSGZIP_Close;
+		vfsgz->funcs.Flush      = VFSGZIP_Flush;
+	}
 	if (loc->search)
 		vfsgz->funcs.copyprotected = loc->search->copyprotected;
 
@@ -199,8 +360,11 @@ static void FSGZIP_ClosePath(void *handle)
 		return; //not yet time
 
 
-	gzclose((gzFile)gzip->handle);
+	if (gzip->handle)
+		gzclose((gzFile)gzip->handle);
 	VFS_CLOSE(gzip->raw);
+	Q_free(gzip->block_ofs);
+	Q_free(gzip->inbuf);
 	Q_free(gzip);
 }
 
@@ -252,6 +416,19 @@ static void FSGZIP_ReadFile(void *handle, flocation_t *loc, char *buffer)
 	gzipfile_t *gzip = handle;
 	int err;
 
+	if (gzip->blocked)
+	{
+		vfsfile_t *f = FSGZIP_OpenVFS(gzip, loc, "rb");
+
+		err = f ? VFS_READ(f, buffer, gzip->file.filelen, NULL) : -1;
+		if (f)
+			VFS_CLOSE(f);
+
+		if (err != gzip->file.filelen)
+			Com_Printf ("Can't extract file \"%s:%s\" (corrupt)\n", gzip->filename, gzip->file.name);
+		return;
+	}
+
 	VFS_SEEK(gzip->handle, gzip->file.filepos, SEEK_SET);
 
 	err = VFS_READ(gzip->handle, buffer, gzip->file.filelen, NULL);
@@ -277,6 +454,91 @@ static int FSGZIP_EnumerateFiles (void *handle, char *match, int (*func)(char *,
 	return true;
 }
 
+static unsigned int FSGZIP_LittleLong(const byte *b)
+{
+	return b[0] | (b[1] << 8) | (b[2] << 16) | ((unsigned int) b[3] << 24);
+}
+
+//
+// Looks for the block index at the end of a blocked gzip file (see vfs.h).
+//
+static qbool FSGZIP_LoadBlockIndex(gzipfile_t *gzip)
+{
+	byte trailer[GZIP_BLOCK_INDEX_TRAILER];
+	byte hdr[GZIP_BLOCK_INDEX_HDR + 6];
+	byte *index;
+	unsigned long filelen;
+	unsigned int index_ofs, len, blocks, i;
+
+	filelen = VFS_GETLEN(gzip->raw);
+	if (filelen < sizeof(hdr) + 16 + 10)
+		return false;
+
+	if (VFS_SEEK(gzip->raw, filelen - sizeof(trailer), SEEK_SET)
+		|| VFS_READ(gzip->raw, trailer, sizeof(trailer), NULL) != sizeof(trailer))
+		return false;
+
+	// Empty final deflate block, zero crc and size.
+	if (trailer[4] != 0x03 || trailer[5] != 0x00 || FSGZIP_LittleLong(trailer + 6) || FSGZIP_LittleLong(trailer + 10))
+		return false;
+
+	index_ofs = FSGZIP_LittleLong(trailer);
+	if (index_ofs >= filelen - sizeof(trailer))
+		return false;
+
+	if (VFS_SEEK(gzip->raw, index_ofs, SEEK_SET)
+		|| VFS_READ(gzip->raw, hdr, sizeof(hdr), NULL) != sizeof(hdr))
+		return false;
+
+	if (hdr[0] != 0x1f || hdr[1] != 0x8b || hdr[2] != 8 || hdr[3] != 4
+		|| hdr[12] != GZIP_BLOCK_INDEX_ID1 || hdr[13] != GZIP_BLOCK_INDEX_ID2)
+		return false;
+
+	len = hdr[14] | (hdr[15] << 8);
+	if (len < 16 || (len & 3) || (hdr[10] | (hdr[11] << 8)) != len + 4
+		|| index_ofs + sizeof(hdr) + len + 10 != filelen)
+		return false;
+
+	index = Q_malloc(len);
+	if (VFS_READ(gzip->raw, index, len, NULL) != len)
+	{
+		Q_free(index);
+		return false;
+	}
+
+	blocks = FSGZIP_LittleLong(index + 4);
+	if (!FSGZIP_LittleLong(index) || FSGZIP_LittleLong(index) > 64 * GZIP_BLOCK_SIZE || blocks != (len - 16) / 4)
+	{
+		Q_free(index);
+		return false;
+	}
+
+	gzip->block_size    = FSGZIP_LittleLong(index);
+	gzip->blocks        = blocks;
+	gzip->file.filelen  = FSGZIP_LittleLong(index + 8);
+	gzip->block_ofs     = Q_malloc((blocks + 1) * sizeof(*gzip->block_ofs));
+
+	for (i = 0; i <= blocks; i++)
+	{
+		gzip->block_ofs[i] = FSGZIP_LittleLong(index + 12 + 4 * i);
+		if ((i && gzip->block_ofs[i] < gzip->block_ofs[i - 1]) || gzip->block_ofs[i] > index_ofs)
+			break;
+	}
+
+	Q_free(index);
+
+	if (i <= blocks || gzip->block_ofs[blocks] != index_ofs || (unsigned long) blocks * gzip->block_size < gzip->file.filelen
+		|| (blocks && (unsigned long) (blocks - 1) * gzip->block_size >= gzip->file.filelen))
+	{
+		Q_free(gzip->block_ofs);
+		gzip->file.filelen = 0;
+		return false;
+	}
+
+	gzip->blocked = true;
+	return true;
+}
+
 // =================
 // FSTAR_LoadGZipFile
 // =================
@@ -296,11 +558,15 @@ static void *FSGZIP_LoadGZipFile(vfsfile_t *gziphandle, const char *desc)
 	strlcpy(gzip->filename, desc, sizeof(gzip->filename));
 	if (gziphandle == NULL) goto fail;
 	gzip->raw = gziphandle;
-
-	fd = fileno(((vfsosfile_t *)gziphandle)->handle); // <-- ASSUMPTION! that file is OS
-	gzip->handle = (vfsfile_t *)gzdopen(dup(fd), "r");
 	gzip->references = 1;
 
+	// Blocked files are read through the raw vfs, so they work inside other archives too.
+	if (!FSGZIP_LoadBlockIndex(gzip))
+	{
+		fd = fileno(((vfsosfile_t *)gziphandle)->handle); // <-- ASSUMPTION! that file is OS
+		gzip->handle = (vfsfile_t *)gzdopen(dup(fd), "r");
+	}
+
 	/* Remove the .gz from the file.name */
 	base = COM_SkipPath(desc);
 	ext = COM_FileExtension(desc);
@@ -318,6 +584,44 @@ fail:
 	return NULL;
 }
 
+//
+// Opens the data of a blocked gzip file for random access reading, takes ownership of raw on success.
+// Returns NULL for ordinary gzip files, which have to be unpacked before they can be seeked in cheaply.
+//
+vfsfile_t *FSGZIP_OpenBlockedVFS(vfsfile_t *raw, const char *desc)
+{
+	gzipfile_t *gzip;
+	flocation_t loc;
+	vfsfile_t *f;
+
+	gzip = Q_calloc(1, sizeof(*gzip));
+	strlcpy(gzip->filename, desc, sizeof(gzip->filename));
+	gzip->raw = raw;
+	gzip->references = 1;
+
+	if (!FSGZIP_LoadBlockIndex(gzip))
+	{
+		Q_free(gzip);
+		return NULL;
+	}
+
+	memset(&loc, 0, sizeof(loc));
+	loc.len = gzip->file.filelen;
+
+	f = FSGZIP_OpenVFS(gzip, &loc, "rb");
+	if (!f)
+	{
+		// Leave raw to the caller.
+		Q_free(gzip->block_ofs);
+		Q_free(gzip);
+		return NULL;
+	}
+
+	gzip->references--; // Owned by the returned file now.
+
+	return f;
+}
+
 searchpathfuncs_t gzipfilefuncs = {
 	FSGZIP_PrintPath,
 	FSGZIP_ClosePath,
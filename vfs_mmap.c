@@ -131,6 +131,13 @@ static unsigned long VFSMMAP_GetLen(vfsfile_t *file)
 	return intfile->len;
 }
 
+static const byte *VFSMMAP_Map(vfsfile_t *file) 
+{
+	vfsmmapfile_t *intfile = (vfsmmapfile_t *)file;
+
+	return intfile->handle;
+}
+
 static void VFSMMAP_Close(vfsfile_t *file) 
 {
 	vfsmmapfile_t *intfile = (vfsmmapfile_t *)file;
@@ -160,6 +167,7 @@ vfsfile_t *FSMMAP_OpenVFS(void *buf, size_t buf_len)
 	mmapfile->funcs.GetLen     = VFSMMAP_GetLen;
 	mmapfile->funcs.Close      = VFSMMAP_Close;
 	mmapfile->funcs.Flush      = VFSMMAP_Flush;
+	mmapfile->funcs.Map        = VFSMMAP_Map;
 
 	return (vfsfile_t *)mmapfile;
 }
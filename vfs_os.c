@@ -23,10 +23,18 @@
 #include "common.h"
 #include "fs.h"
 #include "vfs.h"
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#endif
 
 //==================================
 // STDIO files (OS) - VFS Functions
 //==================================
+qbool vfsos_nommap;	// -nommap, set once at filesystem init
+
 static int VFSOS_ReadBytes (struct vfsfile_s *file, void *buffer, int bytestoread, vfserrno_t *err)
 {
 	int r;
@@ -77,9 +85,63 @@ static unsigned long VFSOS_GetSize (struct vfsfile_s *file)
 	return maxlen;
 }
 
+// Maps the whole file read-only, the view stays valid until the file is closed.
+static const byte *VFSOS_Map (struct vfsfile_s *file)
+{
+	vfsosfile_t *intfile = (vfsosfile_t*)file;
+	unsigned long len;
+	void *view;
+
+	if (intfile->mapped)
+		return intfile->mapped;
+
+	if (vfsos_nommap)
+		return NULL;
+
+	len = VFSOS_GetSize(file);
+	if (len == 0 || len == (unsigned long)-1)
+		return NULL;
+
+#ifdef _WIN32
+	{
+		HANDLE mapping = CreateFileMapping((HANDLE)_get_osfhandle(_fileno(intfile->handle)), NULL, PAGE_READONLY, 0, 0, NULL);
+
+		if (mapping == NULL)
+			return NULL;
+
+		view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (view == NULL) {
+			CloseHandle(mapping);
+			return NULL;
+		}
+
+		intfile->mapping = mapping;
+	}
+#else
+	view = mmap(NULL, len, PROT_READ, MAP_SHARED, fileno(intfile->handle), 0);
+	if (view == MAP_FAILED)
+		return NULL;
+#endif
+
+	intfile->mapped = view;
+	intfile->mapped_len = len;
+
+	return intfile->mapped;
+}
+
 static void VFSOS_Close(vfsfile_t *file)
 {
 	vfsosfile_t *intfile = (vfsosfile_t*)file;
+
+	if (intfile->mapped) {
+#ifdef _WIN32
+		UnmapViewOfFile(intfile->mapped);
+		CloseHandle((HANDLE)intfile->mapping);
+#else
+		munmap(intfile->mapped, intfile->mapped_len);
+#endif
+	}
+
 	fclose(intfile->handle);
 	Q_free(file);
 }
@@ -143,6 +205,7 @@ vfsfile_t *VFSOS_Open(char *osname, char *mode)
 	file->funcs.Tell       = VFSOS_Tell;
 	file->funcs.GetLen     = VFSOS_GetSize;
 	file->funcs.Close      = VFSOS_Close;
+	file->funcs.Map        = (read && !write && !append) ? VFSOS_Map : NULL;
 
 	file->handle = f;
 
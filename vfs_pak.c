@@ -34,6 +34,8 @@ typedef struct pack_s
 	int references;         // seeing as all vfiles from a pak file use the 
 							// parent's vfsfile, we need to keep the parent 
 							// open until all subfiles are closed.
+	const byte *mapped;     // whole pak mapped in memory, NULL if the handle can't be mapped
+	unsigned long mapped_len;
 
 	int     numfiles;
 	packfile_t  *files;
@@ -58,6 +60,7 @@ typedef struct {
     unsigned long startpos;
     unsigned long length;
     unsigned long currentpos;
+    const byte *mapped;     // subfile view into the parent's mapping
 } vfspack_t;
 
 #define	MAX_FILES_IN_PACK	2048
@@ -75,6 +78,14 @@ static int VFSPAK_ReadBytes (struct vfsfile_s *vfs, void *buffer, int bytestorea
 	if (bytestoread <= 0)
 		return -1;
 
+	if (vfsp->mapped) {
+		memcpy(buffer, vfsp->mapped + (vfsp->currentpos - vfsp->startpos), bytestoread);
+		vfsp->currentpos += bytestoread;
+		if (err)
+			*err = VFSERR_NONE;
+		return bytestoread;
+	}
+
 	if (vfsp->parentpak->filepos != vfsp->currentpos) {
 		VFS_SEEK(vfsp->parentpak->handle, vfsp->currentpos, SEEK_SET);
 	}
@@ -132,6 +143,12 @@ static unsigned long VFSPAK_GetLen (struct vfsfile_s *vfs)
 	return vfsp->length;
 }
 
+static const byte *VFSPAK_Map (struct vfsfile_s *vfs)
+{
+	vfspack_t *vfsp = (vfspack_t*)vfs;
+	return vfsp->mapped;
+}
+
 static void FSPAK_ClosePath(void *handle);
 static void VFSPAK_Close(vfsfile_t *vfs)
 {
@@ -158,6 +175,10 @@ static vfsfile_t *FSPAK_OpenVFS(void *handle, flocation_t *loc, char *mode)
 	vfsp->length     = loc->len;
 	vfsp->currentpos = vfsp->startpos;
 
+	// entries pointing past the end of a truncated pak are read the slow way
+	if (pack->mapped && vfsp->startpos + vfsp->length <= pack->mapped_len)
+		vfsp->mapped = pack->mapped + vfsp->startpos;
+
 	vfsp->funcs.ReadBytes     = strcmp(mode, "rb") ? NULL : VFSPAK_ReadBytes;
 	vfsp->funcs.WriteBytes    = strcmp(mode, "wb") ? NULL : VFSPAK_WriteBytes;
 	vfsp->funcs.Seek		  = VFSPAK_Seek;
@@ -165,6 +186,7 @@ static vfsfile_t *FSPAK_OpenVFS(void *handle, flocation_t *loc, char *mode)
 	vfsp->funcs.GetLen	      = VFSPAK_GetLen;
 	vfsp->funcs.Close	      = VFSPAK_Close;
 	vfsp->funcs.Flush         = NULL;
+	vfsp->funcs.Map           = VFSPAK_Map;
 	if (loc->search)
 		vfsp->funcs.copyprotected = loc->search->copyprotected;
 
@@ -347,6 +369,10 @@ static void *FSPAK_LoadPackFile (vfsfile_t *file, const char *desc)
 	pack->filepos = 0;
 	VFS_SEEK(packhandle, pack->filepos, SEEK_SET);
 
+	// map the whole pak once, subfiles are then read without seeking the parent
+	pack->mapped = VFS_MAP(packhandle);
+	pack->mapped_len = pack->mapped ? VFS_GETLEN(packhandle) : 0;
+
 	pack->references++;
 
 	return pack;
@@ -125,6 +125,10 @@ typedef struct zipfile_s
 	zlib_filefunc_def zlib_funcs;
 
 	vfsfile_t *raw;
+	const byte *mapped;		// raw file mapped in memory, NULL if it can't be mapped
+	unsigned long mapped_len;
+	int *dataofs;			// per file offset of stored data in raw, see ZIP_DATAOFS_*
+
 	vfsfile_t *currentfile;	//our unzip.c can only handle one active file at any one time
 							//so we have to keep closing and switching.
 							//slow, but it works. most of the time we'll only have a single file open anyway.
@@ -143,8 +147,60 @@ typedef struct {
 	int length;	//try and optimise some things
 	int index;
 	int startpos;
+	const byte *mapped;	// stored entry read straight from the parent's mapping
 } vfszip_t;
 
+#define ZIP_DATAOFS_UNKNOWN    -1	// stored entry, offset not resolved yet
+#define ZIP_DATAOFS_UNMAPPABLE -2	// compressed or encrypted entry
+
+#define ZIP_CENTRAL_SIGNATURE  0x02014b50
+#define ZIP_LOCAL_SIGNATURE    0x04034b50
+#define ZIP_LOCAL_HEADER_SIZE  30
+
+static unsigned int FSZIP_GetShort(const byte *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static unsigned int FSZIP_GetLong(const byte *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+// Finds the data of a stored entry in the mapped zip by walking from its
+// central directory record to the local header. Doesn't touch the unzip
+// state, so other files from this zip can stay open.
+static const byte *FSZIP_MapEntry(zipfile_t *zip, int index)
+{
+	unsigned long central, local, data;
+
+	if (!zip->mapped || zip->dataofs[index] == ZIP_DATAOFS_UNMAPPABLE)
+		return NULL;
+
+	if (zip->dataofs[index] >= 0)
+		return zip->mapped + zip->dataofs[index];
+
+	zip->dataofs[index] = ZIP_DATAOFS_UNMAPPABLE;
+
+	central = (unsigned long)zip->files[index].filepos;
+	if (central + 46 > zip->mapped_len || FSZIP_GetLong(zip->mapped + central) != ZIP_CENTRAL_SIGNATURE)
+		return NULL;
+
+	local = FSZIP_GetLong(zip->mapped + central + 42);
+	if (local + ZIP_LOCAL_HEADER_SIZE > zip->mapped_len || FSZIP_GetLong(zip->mapped + local) != ZIP_LOCAL_SIGNATURE)
+		return NULL;
+
+	data = local + ZIP_LOCAL_HEADER_SIZE
+		+ FSZIP_GetShort(zip->mapped + local + 26)
+		+ FSZIP_GetShort(zip->mapped + local + 28);
+	if (data + zip->files[index].filelen > zip->mapped_len)
+		return NULL;
+
+	zip->dataofs[index] = data;
+
+	return zip->mapped + data;
+}
+
 // VFS-FIXME Need to figure what this function is trying to do
 static void VFSZIP_MakeActive(vfszip_t *vfsz)
 {
@@ -181,6 +237,16 @@ static int VFSZIP_ReadBytes (struct vfsfile_s *file, void *buffer, int bytestore
 	if (vfsz->defer)
 		return VFS_READ(vfsz->defer, buffer, bytestoread, err);
 
+	if (vfsz->mapped)
+	{
+		read = bound(0, bytestoread, vfsz->length - vfsz->pos);
+		memcpy(buffer, vfsz->mapped + vfsz->pos, read);
+		vfsz->pos += read;
+		if (err)
+			*err = ((read || bytestoread <= 0) ? VFSERR_NONE : VFSERR_EOF);
+		return read;
+	}
+
 //	if (vfsz->iscompressed)
 //	{
 		VFSZIP_MakeActive(vfsz);
@@ -219,6 +285,21 @@ static int VFSZIP_Seek (struct vfsfile_s *file, unsigned long pos, int whence)
 	if (vfsz->defer)
 		return VFS_SEEK(vfsz->defer, pos, whence);
 
+	if (vfsz->mapped)
+	{
+		switch (whence) {
+		case SEEK_SET: break;
+		case SEEK_CUR: pos += vfsz->pos; break;
+		case SEEK_END: pos += vfsz->length; break;
+		default: return -1;
+		}
+
+		if (pos > vfsz->length)
+			return -1;
+		vfsz->pos = pos;
+		return 0;
+	}
+
 	//This is *really* inefficient
 	if (vfsz->parent->currentfile == file)
 	{
@@ -286,6 +367,12 @@ static unsigned long VFSZIP_GetLen (struct vfsfile_s *file)
 	return vfsz->length;
 }
 
+static const byte *VFSZIP_Map (struct vfsfile_s *file)
+{
+	vfszip_t *vfsz = (vfszip_t*)file;
+	return vfsz->mapped;
+}
+
 static void FSZIP_ClosePath(void *handle);
 static void VFSZIP_Close (struct vfsfile_s *file)
 {
@@ -324,9 +411,15 @@ static vfsfile_t *FSZIP_OpenVFS(void *handle, flocation_t *loc, char *mode)
 	vfsz->funcs.Tell       = VFSZIP_Tell;
 	vfsz->funcs.GetLen     = VFSZIP_GetLen;
 	vfsz->funcs.Close      = VFSZIP_Close;
+	vfsz->funcs.Map        = VFSZIP_Map;
 	if (loc->search)
 		vfsz->funcs.copyprotected = loc->search->copyprotected;
 
+	// stored entries are served from the mapping, no need to go through unzip
+	vfsz->mapped = FSZIP_MapEntry(zip, loc->index);
+	if (vfsz->mapped)
+		vfsz->funcs.seekingisabadplan = false;
+
 	// VFS-FIXME: 
 	// What is the point of is compressed etc
 	
@@ -369,6 +462,7 @@ static void FSZIP_ClosePath(void *handle)
 	VFS_CLOSE(zip->raw);
 	if (zip->files)
 		Q_free(zip->files);
+	Q_free(zip->dataofs);
 	Q_free(zip);
 }
 static void FSZIP_BuildHash(void *handle)
@@ -508,6 +602,7 @@ static void *FSZIP_LoadZipFile(vfsfile_t *packhandle, const char *desc)
 
 	// Create a list of the number of files
 	zip->files = newfiles = Q_malloc (zip->numfiles * sizeof(packfile_t));
+	zip->dataofs = Q_malloc (zip->numfiles * sizeof(int));
 	if (unzGoToFirstFile(zip->handle) != UNZ_OK) goto fail;
 	for (i = 0; i < zip->numfiles; i++) {
 		unz_file_info file_info;
@@ -516,6 +611,7 @@ static void *FSZIP_LoadZipFile(vfsfile_t *packhandle, const char *desc)
 		Q_strlwr(newfiles[i].name);
 		newfiles[i].filelen = file_info.uncompressed_size;
 		newfiles[i].filepos = unzGetOffset(zip->handle); // VFS-FIXME: Need to verify this
+		zip->dataofs[i] = (file_info.compression_method == 0 && !(file_info.flag & 1)) ? ZIP_DATAOFS_UNKNOWN : ZIP_DATAOFS_UNMAPPABLE;
 		r = unzGoToNextFile (zip->handle);
 		if (r == UNZ_END_OF_LIST_OF_FILE) {
 			break;
@@ -528,12 +624,17 @@ static void *FSZIP_LoadZipFile(vfsfile_t *packhandle, const char *desc)
 	zip->references = 1;
 	zip->currentfile = NULL;
 
+	// stored entries will be read straight from the mapping
+	zip->mapped = VFS_MAP(packhandle);
+	zip->mapped_len = zip->mapped ? VFS_GETLEN(packhandle) : 0;
+
 	return zip;
 
 fail:
 	// Q_free is safe to call on NULL pointers
 	Q_free(funcs);
 	Q_free(zip->files);
+	Q_free(zip->dataofs);
 	Q_free(zip);
 	return NULL;
 }
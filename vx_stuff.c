@@ -267,11 +267,12 @@ void Draw_AMFStatLoss (int stat, hud_t* hud) {
     *vxdmgcnt_o = cl.stats[stat];
     if (*vxdmgcnt_t > cl.time)
     {
+      	extern float overall_alpha;
+      	float old_alpha = overall_alpha;
+
+      	// Fade through the overall alpha, the numbers are batched with their own blend state.
       	alpha = min(1, (*vxdmgcnt_t - cl.time));
-      	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-      	glDisable(GL_ALPHA_TEST);
-      	glEnable (GL_BLEND);
-      	glColor4f(1, 1, 1, alpha);
+      	Draw_SetOverallAlpha(old_alpha * alpha);
 		if (hud) {
 			static cvar_t *scale = NULL, *style, *digits, *align;
 			if (scale == NULL)  // first time called
@@ -286,10 +287,7 @@ void Draw_AMFStatLoss (int stat, hud_t* hud) {
 		} else {
       		Sbar_DrawNum (x, -24, abs(*vxdmgcnt), 3, (*vxdmgcnt) > 0);
 		}
-      	glEnable(GL_ALPHA_TEST);
-      	glDisable (GL_BLEND);
-      	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
-      	glColor4f(1, 1, 1, 1);
+      	Draw_SetOverallAlpha(old_alpha);
     }
 }
 
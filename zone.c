@@ -26,19 +26,34 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "gl_model.h"
 #endif
 
-void Cache_FreeLow(int new_low_hunk);
-void Cache_FreeHigh(int new_high_hunk);
-
 //============================================================================
 
 #define HUNK_SENTINEL 0x1df001ed
 
+#define HUNK_SEGMENT_SIZE	(16 * 1024 * 1024)	// the hunk grows by at least this much
+#define MAX_HUNK_SEGMENTS	64
+
 typedef struct {
 	int		sentinel;
 	int		size; // including sizeof(hunk_t), -1 = not allocated
 	char	name[8];
 } hunk_t;
 
+// Memory added once the initial block ran out. Low and high allocations get
+// their own segments, marks keep counting on from where the previous segment
+// was left so they stay plain integers.
+typedef struct {
+	byte	*base;
+	int		size;
+	int		start;	// mark of the first byte
+	int		used;
+} hunk_segment_t;
+
+typedef struct {
+	byte	*start;
+	byte	*end;
+} hunk_region_t;
+
 byte	*hunk_base;
 int		hunk_size;
 
@@ -48,6 +63,119 @@ int		hunk_high_used;
 qbool	hunk_tempactive;
 int		hunk_tempmark;
 
+static hunk_segment_t	hunk_low_segments[MAX_HUNK_SEGMENTS];
+static hunk_segment_t	hunk_high_segments[MAX_HUNK_SEGMENTS];
+static int				hunk_low_numsegments;
+static int				hunk_high_numsegments;
+static int				hunk_grown;		// bytes in segments
+static int				hunk_maxsize;	// -maxmem, 0 = grow as needed
+
+static void Hunk_OutOfMemory(const char *func)
+{
+#ifdef SERVERONLY
+	Sys_Error("%s: Not enough RAM allocated. Try starting using \"-maxmem 64\" (or more) on the command line.", func);
+#else
+	Sys_Error("%s: Not enough RAM allocated. Try starting using \"-maxmem 128\" (or more) on the command line.", func);
+#endif
+}
+
+// Makes sure the newest segment has size bytes left, adding one when it hasn't.
+static hunk_segment_t *Hunk_SegmentReserve(hunk_segment_t *segments, int *numsegments, int mark, int size, const char *func)
+{
+	hunk_segment_t *seg = *numsegments ? &segments[*numsegments - 1] : NULL;
+
+	if (!seg || seg->size - seg->used < size) {
+		int segsize = max(size, HUNK_SEGMENT_SIZE);
+
+		if (*numsegments == MAX_HUNK_SEGMENTS) {
+			Hunk_OutOfMemory(func);
+		}
+		if (hunk_maxsize && hunk_size + hunk_grown + segsize > hunk_maxsize) {
+			if (hunk_size + hunk_grown + size > hunk_maxsize) {
+				Hunk_OutOfMemory(func);
+			}
+			segsize = size;
+		}
+
+		seg = &segments[(*numsegments)++];
+		seg->base = Q_malloc(segsize);
+		seg->size = segsize;
+		seg->start = mark;
+		seg->used = 0;
+		hunk_grown += segsize;
+	}
+
+	return seg;
+}
+
+// Takes size bytes from the newest segment, adding one when it's full.
+static byte *Hunk_SegmentAlloc(hunk_segment_t *segments, int *numsegments, int mark, int size, const char *func)
+{
+	hunk_segment_t *seg = Hunk_SegmentReserve(segments, numsegments, mark, size, func);
+	byte *buf;
+
+	buf = seg->base + seg->used;
+	seg->used += size;
+
+	return buf;
+}
+
+// Releases everything above mark, returns false if the mark is in the initial block.
+static qbool Hunk_SegmentFree(hunk_segment_t *segments, int *numsegments, int mark)
+{
+	hunk_segment_t *seg;
+
+	while (*numsegments) {
+		seg = &segments[*numsegments - 1];
+
+		if (mark >= seg->start) {
+			memset(seg->base + mark - seg->start, 0, seg->used - (mark - seg->start));
+			seg->used = mark - seg->start;
+			return true;
+		}
+
+		hunk_grown -= seg->size;
+		Q_free(seg->base);
+		(*numsegments)--;
+	}
+
+	return false;
+}
+
+// Lists the used parts of the hunk, low allocations first.
+static int Hunk_Regions(hunk_region_t *regions, int *numlow)
+{
+	int i, count = 0;
+
+	regions[count].start = hunk_base;
+	regions[count++].end = hunk_base + hunk_low_used;
+	for (i = 0; i < hunk_low_numsegments; i++) {
+		regions[count].start = hunk_low_segments[i].base;
+		regions[count++].end = hunk_low_segments[i].base + hunk_low_segments[i].used;
+	}
+
+	*numlow = count;
+
+	regions[count].start = hunk_base + hunk_size - hunk_high_used;
+	regions[count++].end = hunk_base + hunk_size;
+	for (i = 0; i < hunk_high_numsegments; i++) {
+		regions[count].start = hunk_high_segments[i].base;
+		regions[count++].end = hunk_high_segments[i].base + hunk_high_segments[i].used;
+	}
+
+	return count;
+}
+
+static void Hunk_CheckBlock(hunk_t *h, hunk_region_t *region, const char *func)
+{
+	if (h->sentinel != HUNK_SENTINEL) {
+		Sys_Error("%s: trashed sentinel", func);
+	}
+	if (h->size < 16 || (byte *)h + h->size > region->end) {
+		Sys_Error("%s: bad size", func);
+	}
+}
+
 /*
 ==============
 Hunk_Check
@@ -57,16 +185,17 @@ Run consistency and sentinel trashing checks
 */
 void Hunk_Check(void)
 {
+	hunk_region_t regions[2 * MAX_HUNK_SEGMENTS + 2];
+	int i, count, numlow;
 	hunk_t *h;
 
-	for (h = (hunk_t *)hunk_base; (byte *)h != hunk_base + hunk_low_used;) {
-		if (h->sentinel != HUNK_SENTINEL) {
-			Sys_Error("Hunk_Check: trashed sentinel");
-		}
-		if (h->size < 16 || h->size + (byte *)h - hunk_base > hunk_size) {
-			Sys_Error("Hunk_Check: bad size");
+	count = Hunk_Regions(regions, &numlow);
+
+	for (i = 0; i < count; i++) {
+		for (h = (hunk_t *)regions[i].start; (byte *)h != regions[i].end;) {
+			Hunk_CheckBlock(h, &regions[i], "Hunk_Check");
+			h = (hunk_t *)((byte *)h + h->size);
 		}
-		h = (hunk_t *)((byte *)h + h->size);
 	}
 }
 
@@ -80,9 +209,11 @@ Otherwise, allocations with the same name will be totaled up before printing.
 */
 void Hunk_Print(qbool all)
 {
-	hunk_t  *h, *next, *endlow, *starthigh, *endhigh;
+	hunk_region_t regions[2 * MAX_HUNK_SEGMENTS + 2];
+	hunk_t  *h, *next;
 	int     count, sum;
 	int     totalblocks;
+	int     i, numregions, numlow;
 	char    name[9];
 
 	name[8] = 0;
@@ -90,68 +221,157 @@ void Hunk_Print(qbool all)
 	sum = 0;
 	totalblocks = 0;
 
-	h = (hunk_t *)hunk_base;
-	endlow = (hunk_t *)(hunk_base + hunk_low_used);
-	starthigh = (hunk_t *)(hunk_base + hunk_size - hunk_high_used);
-	endhigh = (hunk_t *)(hunk_base + hunk_size);
+	numregions = Hunk_Regions(regions, &numlow);
 
-	Con_Printf("          :%8i total hunk size\n", hunk_size);
+	Con_Printf("          :%8i total hunk size\n", hunk_size + hunk_grown);
+	if (hunk_grown) {
+		Con_Printf("          :%8i in %i added segments\n", hunk_grown, hunk_low_numsegments + hunk_high_numsegments);
+	}
 	Con_Printf("-------------------------\n");
 
-	while (1) {
+	for (i = 0; i < numregions; i++) {
 		// skip to the high hunk if done with low hunk
-		if (h == endlow) {
+		if (i == numlow) {
 			Con_Printf("-------------------------\n");
 			Con_Printf("          :%8i REMAINING\n", hunk_size - hunk_low_used - hunk_high_used);
 			Con_Printf("-------------------------\n");
-			h = starthigh;
 		}
 
-		// if totally done, break
-		if (h == endhigh) {
-			break;
+		for (h = (hunk_t *)regions[i].start; (byte *)h != regions[i].end; h = next) {
+			// run consistency checks
+			Hunk_CheckBlock(h, &regions[i], "Hunk_Print");
+
+			next = (hunk_t *)((byte *)h + h->size);
+			count++;
+			totalblocks++;
+			sum += h->size;
+
+			// print the single block
+			memcpy(name, h->name, 8);
+			if (all) {
+				Con_Printf("%8p :%8i %8s\n", h, h->size, name);
+			}
+
+			// print the total
+			if ((byte *)next == regions[i].end || strncmp(h->name, next->name, 8)) {
+				if (!all) {
+					Con_Printf("          :%8i %8s (TOTAL)\n", sum, name);
+				}
+				count = 0;
+				sum = 0;
+			}
 		}
+	}
 
-		// run consistency checks
-		if (h->sentinel != HUNK_SENTINEL) {
-			Sys_Error("Hunk_Print: trashed sentinel");
+	Con_Printf("-------------------------\n");
+	Con_Printf("%8i total blocks\n", totalblocks);
+}
+
+//
+// Machine readable reports, one JSON object per command.
+//
+
+#define MAX_MEMORY_TAGS	256
+
+typedef struct {
+	char	name[16];
+	int		blocks;
+	int		bytes;
+} memory_tag_t;
+
+static void Memory_AddTag(memory_tag_t *tags, int *numtags, const char *name, int namelen, int size)
+{
+	int i;
+
+	for (i = 0; i < *numtags; i++) {
+		if (!strncmp(tags[i].name, name, namelen)) {
+			break;
 		}
-		if (h->size < 16 || h->size + (byte *)h - hunk_base > hunk_size) {
-			Sys_Error("Hunk_Print: bad size");
+	}
+
+	if (i == *numtags) {
+		if (*numtags == MAX_MEMORY_TAGS - 1 && strcmp(name, "...")) {
+			// lump the rest together
+			Memory_AddTag(tags, numtags, "...", sizeof("..."), size);
+			return;
 		}
 
-		next = (hunk_t *)((byte *)h + h->size);
-		count++;
-		totalblocks++;
-		sum += h->size;
+		memset(tags[i].name, 0, sizeof(tags[i].name));
+		memcpy(tags[i].name, name, min(namelen, (int)sizeof(tags[i].name) - 1));
+		tags[i].blocks = tags[i].bytes = 0;
+		(*numtags)++;
+	}
 
-		// print the single block
-		memcpy(name, h->name, 8);
-		if (all) {
-			Con_Printf("%8p :%8i %8s\n", h, h->size, name);
-		}
+	tags[i].blocks++;
+	tags[i].bytes += size;
+}
 
-		// print the total
-		if (next == endlow || next == endhigh || strncmp(h->name, next->name, 8)) {
-			if (!all) {
-				Con_Printf("          :%8i %8s (TOTAL)\n", sum, name);
+static void Memory_PrintTags(memory_tag_t *tags, int numtags)
+{
+	char name[sizeof(tags->name)];
+	int i, j;
+
+	Con_Printf("\"tags\":{");
+	for (i = 0; i < numtags; i++) {
+		// keep it valid json whatever the name is
+		strlcpy(name, tags[i].name, sizeof(name));
+		for (j = 0; name[j]; j++) {
+			if (name[j] == '"' || name[j] == '\\' || (unsigned char)name[j] < ' ') {
+				name[j] = '_';
 			}
-			count = 0;
-			sum = 0;
 		}
+		Con_Printf("%s\"%s\":{\"blocks\":%i,\"bytes\":%i}", i ? "," : "", name, tags[i].blocks, tags[i].bytes);
+	}
+	Con_Printf("}");
+}
+
+static void Hunk_PrintJSON(void)
+{
+	hunk_region_t regions[2 * MAX_HUNK_SEGMENTS + 2];
+	memory_tag_t tags[MAX_MEMORY_TAGS];
+	int i, numregions, numlow, numtags = 0;
+	int low = 0, high = 0;
+	hunk_t *h;
+
+	numregions = Hunk_Regions(regions, &numlow);
 
-		h = next;
+	for (i = 0; i < numregions; i++) {
+		for (h = (hunk_t *)regions[i].start; (byte *)h != regions[i].end; h = (hunk_t *)((byte *)h + h->size)) {
+			Hunk_CheckBlock(h, &regions[i], "Hunk_Print");
+			Memory_AddTag(tags, &numtags, h->name, sizeof(h->name), h->size);
+		}
+
+		if (i < numlow) {
+			low += regions[i].end - regions[i].start;
+		}
+		else {
+			high += regions[i].end - regions[i].start;
+		}
 	}
 
-	Con_Printf("-------------------------\n");
-	Con_Printf("%8i total blocks\n", totalblocks);
+	Con_Printf("{\"hunk\":{\"size\":%i,\"initial\":%i,\"max\":%i,\"segments\":%i,\"low\":%i,\"high\":%i,\"free\":%i,",
+		hunk_size + hunk_grown, hunk_size, hunk_maxsize, hunk_low_numsegments + hunk_high_numsegments,
+		low, high, hunk_size - hunk_low_used - hunk_high_used);
+	Memory_PrintTags(tags, numtags);
+	Con_Printf("}}\n");
 }
 
 void Hunk_Print_f(void)
 {
-	qbool all = Cmd_Argc() != 1;
+	if (Cmd_Argc() > 1 && !strcmp(Cmd_Argv(1), "json")) {
+		Hunk_PrintJSON();
+		return;
+	}
+
+	Hunk_Print(Cmd_Argc() != 1);
+}
 
-	Hunk_Print(all);
+static void Hunk_InitBlock(hunk_t *h, int size, const char *name)
+{
+	memset(h, 0, size);
+	h->size = size;
+	h->sentinel = HUNK_SENTINEL;
+	strlcpy(h->name, name, sizeof(h->name));
 }
 
 /*
@@ -173,24 +393,15 @@ void *Hunk_AllocName(int size, char *name)
 
 	size = sizeof(hunk_t) + ((size + 15) & ~15);
 
-	if (hunk_size - hunk_low_used - hunk_high_used < size) {
-#ifdef SERVERONLY
-		Sys_Error("Hunk_AllocName: Not enough RAM allocated. Try starting using \"-mem 64\" (or more) on the command line.");
-#else
-		Sys_Error("Hunk_AllocName: Not enough RAM allocated. Try starting using \"-mem 128\" (or more) on the command line.");
-#endif
+	if (hunk_low_numsegments || hunk_size - hunk_low_used - hunk_high_used < size) {
+		h = (hunk_t *)Hunk_SegmentAlloc(hunk_low_segments, &hunk_low_numsegments, Hunk_LowMark(), size, "Hunk_AllocName");
+	}
+	else {
+		h = (hunk_t *)(hunk_base + hunk_low_used);
+		hunk_low_used += size;
 	}
 
-	h = (hunk_t *)(hunk_base + hunk_low_used);
-	hunk_low_used += size;
-
-	Cache_FreeLow(hunk_low_used);
-
-	memset(h, 0, size);
-
-	h->size = size;
-	h->sentinel = HUNK_SENTINEL;
-	strlcpy(h->name, name, sizeof(h->name));
+	Hunk_InitBlock(h, size, name);
 
 	return (void *)(h + 1);
 }
@@ -207,14 +418,60 @@ void *Hunk_Alloc(int size)
 
 int	Hunk_LowMark(void)
 {
+	if (hunk_low_numsegments) {
+		hunk_segment_t *seg = &hunk_low_segments[hunk_low_numsegments - 1];
+
+		return seg->start + seg->used;
+	}
+
 	return hunk_low_used;
 }
 
+/*
+===================
+Hunk_LowContiguous
+
+Tells if everything allocated since mark is in one piece of memory. Loaders
+that copy their data from mark on as a single block check this, the hunk
+might have grown in the middle.
+===================
+*/
+qbool Hunk_LowContiguous(int mark)
+{
+	if (!hunk_low_numsegments) {
+		return true;
+	}
+
+	return mark >= hunk_low_segments[hunk_low_numsegments - 1].start;
+}
+
+/*
+===================
+Hunk_LowReserve
+
+The next size bytes of low allocations (headers included, as counted by
+Hunk_LowMark) will be contiguous.
+===================
+*/
+void Hunk_LowReserve(int size)
+{
+	if (!hunk_low_numsegments && hunk_size - hunk_low_used - hunk_high_used >= size) {
+		return;
+	}
+
+	Hunk_SegmentReserve(hunk_low_segments, &hunk_low_numsegments, Hunk_LowMark(), size, "Hunk_LowReserve");
+}
+
 void Hunk_FreeToLowMark(int mark)
 {
-	if (mark < 0 || mark > hunk_low_used) {
-		Sys_Error("Hunk_FreeToLowMark: bad mark %i, hunk_low_used = %i", mark, hunk_low_used);
+	if (mark < 0 || mark > Hunk_LowMark()) {
+		Sys_Error("Hunk_FreeToLowMark: bad mark %i, hunk_low_used = %i", mark, Hunk_LowMark());
 	}
+
+	if (Hunk_SegmentFree(hunk_low_segments, &hunk_low_numsegments, mark)) {
+		return;
+	}
+
 	memset(hunk_base + mark, 0, hunk_low_used - mark);
 	hunk_low_used = mark;
 }
@@ -226,6 +483,12 @@ int	Hunk_HighMark(void)
 		Hunk_FreeToHighMark(hunk_tempmark);
 	}
 
+	if (hunk_high_numsegments) {
+		hunk_segment_t *seg = &hunk_high_segments[hunk_high_numsegments - 1];
+
+		return seg->start + seg->used;
+	}
+
 	return hunk_high_used;
 }
 
@@ -235,9 +498,14 @@ void Hunk_FreeToHighMark(int mark)
 		hunk_tempactive = false;
 		Hunk_FreeToHighMark(hunk_tempmark);
 	}
-	if (mark < 0 || mark > hunk_high_used) {
+	if (mark < 0 || mark > Hunk_HighMark()) {
 		Sys_Error("Hunk_FreeToHighMark: bad mark %i", mark);
 	}
+
+	if (Hunk_SegmentFree(hunk_high_segments, &hunk_high_numsegments, mark)) {
+		return;
+	}
+
 	memset(hunk_base + hunk_size - hunk_high_used, 0, hunk_high_used - mark);
 	hunk_high_used = mark;
 }
@@ -266,23 +534,15 @@ void *Hunk_HighAllocName(int size, char *name)
 
 	size = sizeof(hunk_t) + ((size + 15)&~15);
 
-	if (hunk_size - hunk_low_used - hunk_high_used < size) {
-#ifdef SERVERONLY
-		Sys_Error("Hunk_HighAllocName: Not enough RAM allocated. Try starting using \"-mem 64\" (or more) on the command line.");
-#else
-		Sys_Error("Hunk_HighAllocName: Not enough RAM allocated. Try starting using \"-mem 128\" (or more) on the command line.");
-#endif
+	if (hunk_high_numsegments || hunk_size - hunk_low_used - hunk_high_used < size) {
+		h = (hunk_t *)Hunk_SegmentAlloc(hunk_high_segments, &hunk_high_numsegments, Hunk_HighMark(), size, "Hunk_HighAllocName");
+	}
+	else {
+		hunk_high_used += size;
+		h = (hunk_t *)(hunk_base + hunk_size - hunk_high_used);
 	}
 
-	hunk_high_used += size;
-	Cache_FreeHigh(hunk_high_used);
-
-	h = (hunk_t *)(hunk_base + hunk_size - hunk_high_used);
-
-	memset(h, 0, size);
-	h->size = size;
-	h->sentinel = HUNK_SENTINEL;
-	strlcpy(h->name, name, sizeof(h->name));
+	Hunk_InitBlock(h, size, name);
 
 	return (void *)(h + 1);
 }
@@ -319,95 +579,90 @@ void *Hunk_TempAlloc(int size)
 
 CACHE MEMORY
 
+Cached objects live on the heap, outside of the hunk. Blocks are rounded up
+to one of a set of size classes (four per power of two) and freed blocks are
+kept on a free list per class, so allocating is a list pop as long as the
+cache is under its limit. Over the limit the least recently used objects are
+thrown out, when that doesn't free a block of the right class the idle
+blocks are given back to the system first.
+
 ===============================================================================
 */
 
+#define CACHE_MIN_CLASS_BITS	6	// smallest class is 64 bytes
+#define CACHE_MAX_CLASS_BITS	24	// blocks over 16MB are allocated exactly
+#define CACHE_CLASS_STEPS		4	// classes per power of two
+#define CACHE_NUM_CLASSES		(1 + (CACHE_MAX_CLASS_BITS - CACHE_MIN_CLASS_BITS) * CACHE_CLASS_STEPS)
+
 typedef struct cache_system_s {
 	int						size; // including this header
+	int						sizeclass; // -1 if allocated exactly
 	cache_user_t			*user;
 	char					name[16];
-	struct cache_system_s	*prev, *next;
+	struct cache_system_s	*prev, *next; // all allocated blocks, next links the free lists
 	struct cache_system_s	*lru_prev, *lru_next; // for LRU flushing
 } cache_system_t;
 
-cache_system_t *Cache_TryAlloc(int size, qbool nobottom);
+#define CACHE_HEADER_SIZE		((sizeof(cache_system_t) + 15) & ~15)
+#define CACHE_DATA(cs)			((void *)((byte *)(cs) + CACHE_HEADER_SIZE))
+#define CACHE_BLOCK(data)		((cache_system_t *)((byte *)(data) - CACHE_HEADER_SIZE))
 
 cache_system_t cache_head;
 
-/*
-===========
-Cache_Move
-===========
-*/
-void Cache_Move(cache_system_t *c)
+static cache_system_t	*cache_free[CACHE_NUM_CLASSES];
+static int				cache_limit;		// soft limit for cache_allocated
+static int				cache_allocated;	// bytes taken from the system, including free blocks
+static int				cache_used;			// bytes in allocated blocks
+static int				cache_freeblocks;
+
+static int Cache_SizeClass(int size)
 {
-	cache_system_t *new_block;
+	int bits;
 
-	// we are clearing up space at the bottom, so only allocate it late
-	new_block = Cache_TryAlloc(c->size, true);
-	if (new_block) {
-		memcpy(new_block + 1, c + 1, c->size - sizeof(cache_system_t));
-		new_block->user = c->user;
-		memcpy(new_block->name, c->name, sizeof(new_block->name));
-		Cache_Free(c->user);
-		new_block->user->data = (void *)(new_block + 1);
+	if (size <= (1 << CACHE_MIN_CLASS_BITS)) {
+		return 0;
 	}
-	else {
-		Cache_Free(c->user); // tough luck...
+
+	size--;
+	for (bits = CACHE_MIN_CLASS_BITS; (size >> bits) > 1; bits++)
+		;
+
+	if (bits >= CACHE_MAX_CLASS_BITS) {
+		return -1;
 	}
-}
 
-/*
-============
-Cache_FreeLow
+	return 1 + (bits - CACHE_MIN_CLASS_BITS) * CACHE_CLASS_STEPS + ((size >> (bits - 2)) & (CACHE_CLASS_STEPS - 1));
+}
 
-Throw things out until the hunk can be expanded to the given point
-============
-*/
-void Cache_FreeLow(int new_low_hunk)
+static int Cache_ClassSize(int sizeclass)
 {
-	cache_system_t *c;
+	int bits;
 
-	while (1) {
-		c = cache_head.next;
-		if (c == &cache_head) {
-			return; // nothing in cache at all
-		}
-		if ((byte *)c >= hunk_base + new_low_hunk) {
-			return; // there is space to grow the hunk
-		}
-		Cache_Move(c); // reclaim the space
+	if (!sizeclass) {
+		return (1 << CACHE_MIN_CLASS_BITS);
 	}
-}
 
-/*
-============
-Cache_FreeHigh
+	sizeclass--;
+	bits = CACHE_MIN_CLASS_BITS + sizeclass / CACHE_CLASS_STEPS;
 
-Throw things out until the hunk can be expanded to the given point
-============
-*/
-void Cache_FreeHigh(int new_high_hunk)
+	return (1 << bits) + ((sizeclass % CACHE_CLASS_STEPS + 1) << (bits - 2));
+}
+
+// Gives the blocks on the free lists back to the system.
+static void Cache_ReleaseFree(void)
 {
-	cache_system_t *c, *prev;
+	cache_system_t *cs;
+	int i;
 
-	prev = NULL;
-	while (1) {
-		c = cache_head.prev;
-		if (c == &cache_head) {
-			return; // nothing in cache at all
-		}
-		if ((byte *)c + c->size <= hunk_base + hunk_size - new_high_hunk) {
-			return; // there is space to grow the hunk
-		}
-		if (c == prev) {
-			Cache_Free(c->user); // didn't move out of the way
-		}
-		else {
-			Cache_Move(c); // try to move it
-			prev = c;
+	for (i = 0; i < CACHE_NUM_CLASSES; i++) {
+		while ((cs = cache_free[i])) {
+			cache_free[i] = cs->next;
+			cache_allocated -= cs->size;
+			Q_free(cs);
 		}
 	}
+
+	cache_freeblocks = 0;
 }
 
 void Cache_UnlinkLRU(cache_system_t *cs)
@@ -438,74 +693,47 @@ void Cache_MakeLRU(cache_system_t *cs)
 ============
 Cache_TryAlloc
 
-Looks for a free block of memory between the high and low hunk marks
-Size should already include the header and padding
+Takes a block from the free list of its class, or a new one from the system
+while the cache is under its limit. Size should already include the header
 ============
 */
-cache_system_t *Cache_TryAlloc(int size, qbool nobottom)
+cache_system_t *Cache_TryAlloc(int size)
 {
-	cache_system_t *cs, *new_block;
-
-	// is the cache completely empty?
-	if (!nobottom && cache_head.prev == &cache_head) {
-		if (hunk_size - hunk_high_used - hunk_low_used < size) {
-			Sys_Error("Cache_TryAlloc: %i is greater than free hunk", size);
-		}
-
-		new_block = (cache_system_t *)(hunk_base + hunk_low_used);
-		memset(new_block, 0, sizeof(*new_block));
-		new_block->size = size;
-
-		cache_head.prev = cache_head.next = new_block;
-		new_block->prev = new_block->next = &cache_head;
+	int sizeclass = Cache_SizeClass(size);
+	cache_system_t *cs;
 
-		Cache_MakeLRU(new_block);
-		return new_block;
+	if (sizeclass >= 0) {
+		size = Cache_ClassSize(sizeclass);
 	}
 
-	// search from the bottom up for space
-	new_block = (cache_system_t *)(hunk_base + hunk_low_used);
-	cs = cache_head.next;
-
-	do {
-		if (!nobottom || cs != cache_head.next) {
-			if ((byte *)cs - (byte *)new_block >= size) {
-				// found space
-				memset(new_block, 0, sizeof(*new_block));
-				new_block->size = size;
-
-				new_block->next = cs;
-				new_block->prev = cs->prev;
-				cs->prev->next = new_block;
-				cs->prev = new_block;
-
-				Cache_MakeLRU(new_block);
-
-				return new_block;
-			}
-		}
-
-		// continue looking
-		new_block = (cache_system_t *)((byte *)cs + cs->size);
-		cs = cs->next;
-	} while (cs != &cache_head);
+	if (sizeclass >= 0 && cache_free[sizeclass]) {
+		cs = cache_free[sizeclass];
+		cache_free[sizeclass] = cs->next;
+		cache_freeblocks--;
+	}
+	else if (cache_allocated + size <= cache_limit || (cache_head.next == &cache_head && !cache_freeblocks)) {
+		// the limit is soft, something that doesn't fit an empty cache is still loaded
+		cs = Q_malloc(size);
+		cache_allocated += size;
+	}
+	else {
+		return NULL;
+	}
 
-	// try to allocate one at the very end
-	if (hunk_base + hunk_size - hunk_high_used - (byte *)new_block >= size) {
-		memset(new_block, 0, sizeof(*new_block));
-		new_block->size = size;
+	memset(cs, 0, sizeof(*cs));
+	cs->size = size;
+	cs->sizeclass = sizeclass;
 
-		new_block->next = &cache_head;
-		new_block->prev = cache_head.prev;
-		cache_head.prev->next = new_block;
-		cache_head.prev = new_block;
+	cs->next = &cache_head;
+	cs->prev = cache_head.prev;
+	cache_head.prev->next = cs;
+	cache_head.prev = cs;
 
-		Cache_MakeLRU(new_block);
+	cache_used += size;
 
-		return new_block;
-	}
+	Cache_MakeLRU(cs);
 
-	return NULL; // couldn't allocate
+	return cs;
 }
 
 /*
@@ -520,6 +748,7 @@ void Cache_Flush(void)
 	while (cache_head.next != &cache_head) {
 		Cache_Free(cache_head.next->user); // reclaim the space
 	}
+	Cache_ReleaseFree();
 #ifndef SERVERONLY
 	Mod_ClearSimpleTextures();
 #endif
@@ -540,6 +769,23 @@ void Cache_Print(void)
 	}
 }
 
+static void Cache_PrintJSON(void)
+{
+	memory_tag_t tags[MAX_MEMORY_TAGS];
+	int numtags = 0, blocks = 0;
+	cache_system_t *cd;
+
+	for (cd = cache_head.next; cd != &cache_head; cd = cd->next) {
+		Memory_AddTag(tags, &numtags, cd->name, sizeof(cd->name), cd->size);
+		blocks++;
+	}
+
+	Con_Printf("{\"cache\":{\"limit\":%i,\"allocated\":%i,\"used\":%i,\"blocks\":%i,\"freeblocks\":%i,",
+		cache_limit, cache_allocated, cache_used, blocks, cache_freeblocks);
+	Memory_PrintTags(tags, numtags);
+	Con_Printf("}}\n");
+}
+
 /*
 ============
 Cache_Report
@@ -548,9 +794,16 @@ Cache_Report
 */
 void Cache_Report(void)
 {
+	if (Cmd_Argc() > 1 && !strcmp(Cmd_Argv(1), "json")) {
+		Cache_PrintJSON();
+		return;
+	}
+
 	Con_Printf("%4.1f of %4.1f megabyte data cache free\n",
-		(float)(hunk_size - hunk_high_used - hunk_low_used) / (1024 * 1024),
-		(float)hunk_size / (1024 * 1024));
+		(float)(max(0, cache_limit - cache_used)) / (1024 * 1024),
+		(float)cache_limit / (1024 * 1024));
+	Con_Printf("%4.1f megabyte in %i unused blocks\n",
+		(float)(cache_allocated - cache_used) / (1024 * 1024), cache_freeblocks);
 }
 
 /*
@@ -595,7 +848,7 @@ void Cache_Free(cache_user_t *c)
 		Sys_Error("Cache_Free: not allocated");
 	}
 
-	cs = ((cache_system_t *)c->data) - 1;
+	cs = CACHE_BLOCK(c->data);
 
 	cs->prev->next = cs->next;
 	cs->next->prev = cs->prev;
@@ -604,6 +857,18 @@ void Cache_Free(cache_user_t *c)
 	c->data = NULL;
 
 	Cache_UnlinkLRU(cs);
+
+	cache_used -= cs->size;
+
+	if (cs->sizeclass < 0) {
+		cache_allocated -= cs->size;
+		Q_free(cs);
+	}
+	else {
+		cs->next = cache_free[cs->sizeclass];
+		cache_free[cs->sizeclass] = cs;
+		cache_freeblocks++;
+	}
 }
 
 /*
@@ -619,7 +884,7 @@ void *Cache_Check(cache_user_t *c)
 		return NULL;
 	}
 
-	cs = ((cache_system_t *)c->data) - 1;
+	cs = CACHE_BLOCK(c->data);
 
 	// move to head of LRU
 	Cache_UnlinkLRU(cs);
@@ -645,18 +910,24 @@ void *Cache_Alloc(cache_user_t *c, int size, char *name)
 		Sys_Error("Cache_Alloc: size %i", size);
 	}
 
-	size = (size + sizeof(cache_system_t) + 15) & ~15;
+	size = (size + CACHE_HEADER_SIZE + 15) & ~15;
 
 	// find memory for it
 	while (1) {
-		cs = Cache_TryAlloc(size, false);
+		cs = Cache_TryAlloc(size);
 		if (cs) {
 			strlcpy(cs->name, name, sizeof(cs->name));
-			c->data = (void *)(cs + 1);
+			c->data = CACHE_DATA(cs);
 			cs->user = c;
 			break;
 		}
 
+		// blocks of other sizes are lying around, make room with them first
+		if (cache_freeblocks) {
+			Cache_ReleaseFree();
+			continue;
+		}
+
 		// free the least recently used cahedat
 		if (cache_head.lru_prev == &cache_head) {
 			Sys_Error("Cache_Alloc: out of memory");
@@ -678,10 +949,24 @@ Memory_Init
 */
 void Memory_Init(void *buf, int size)
 {
+	int t;
+
 	hunk_base = (byte *)buf;
 	hunk_size = size;
 	hunk_low_used = 0;
 	hunk_high_used = 0;
 
+	// the hunk grows past -mem as needed, -maxmem puts a cap on that
+	hunk_maxsize = 0;
+	if ((t = COM_CheckParm("-maxmem")) != 0 && t + 1 < COM_Argc()) {
+		hunk_maxsize = max(size, Q_atoi(COM_Argv(t + 1)) * 1024 * 1024);
+	}
+
+	// the cache used to get whatever the hunk didn't need
+	cache_limit = size;
+	if ((t = COM_CheckParm("-cachesize")) != 0 && t + 1 < COM_Argc()) {
+		cache_limit = Q_atoi(COM_Argv(t + 1)) * 1024 * 1024;
+	}
+
 	Cache_Init();
 }
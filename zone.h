@@ -24,10 +24,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
  memory allocation
 
 
-H_??? The hunk manages the entire memory block given to quake.  It must be
-contiguous.  Memory can be allocated from either the low or high end in a
-stack fashion.  The only way memory is released is by resetting one of the
-pointers.
+H_??? The hunk manages the memory block given to quake.  Memory can be
+allocated from either the low or high end in a stack fashion.  The only way
+memory is released is by resetting one of the pointers.  When the block is
+full the hunk grows by adding segments (up to -maxmem megabytes if given),
+marks stay plain integers and segments are released again when freeing to
+a mark below them.
 
 Hunk allocations should be given a name, so the Hunk_Print () function
 can display usage.
@@ -39,8 +41,12 @@ server allocations when changing to a higher video mode.
 
 
 Cache_??? Cache memory is for objects that can be dynamically loaded and
-can usefully stay persistent between levels.  The size of the cache
-fluctuates from level to level.
+can usefully stay persistent between levels.  It is kept on the heap in
+size classed blocks, limited to -cachesize megabytes (defaults to the hunk
+size), least recently used objects are thrown out past that.
+
+hunk_print json and cache_report json print the usage per allocation name
+in a machine readable form.
 
 To allocate a cachable object
 
@@ -64,8 +70,6 @@ surface cache
 
 <--- high hunk used
 
-cachable memory
-
 <--- low hunk used
 
 client and server low hunk allocations
@@ -89,6 +93,8 @@ void *Hunk_HighAllocName (int size, char *name);
 
 int	Hunk_LowMark (void);
 void Hunk_FreeToLowMark (int mark);
+qbool Hunk_LowContiguous (int mark);
+void Hunk_LowReserve (int size);
 
 int	Hunk_HighMark (void);
 void Hunk_FreeToHighMark (int mark);